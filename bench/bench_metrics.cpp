@@ -0,0 +1,177 @@
+#include "metricscollector.h"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* The cost of reporting statistics for one received video frame. The frame
+ * is reported as received, presented and delayed and each filter on its way
+ * reports its buffer. The aggregation normally happens in its own thread, here
+ * it is included in the cost of frames. The previous way of recording, a
+ * locked ring of heap allocated values chosen by comparing type strings, is
+ * measured for comparison. Run with more threads to see the effect of
+ * contention. */
+
+namespace
+{
+
+const int FILTERS = 6;
+
+const int THREADS[] = {1, 2, 4};
+
+const uint32_t SESSION = 1;
+
+// fewer frames than this fit in the ring of a thread
+const int AGGREGATION_FRAMES = 128;
+
+
+MetricsCollector& collector()
+{
+  static MetricsCollector metrics;
+  return metrics;
+}
+
+
+void reportFrame(MetricsCollector& metrics, uint32_t size)
+{
+  metrics.record(METRIC_RECEIVED_BYTES, STATS_VIDEO, SESSION, size);
+  metrics.record(METRIC_RECEIVED_BYTES, STATS_NO_MEDIA, 0, size);
+
+  for (uint32_t filter = 1; filter <= FILTERS; ++filter)
+  {
+    metrics.record(METRIC_FILTER_BUFFER, STATS_NO_MEDIA, filter, 1);
+    metrics.record(METRIC_FILTER_BUFFER_SIZE, STATS_NO_MEDIA, filter, 10);
+  }
+
+  metrics.record(METRIC_TOTAL_DELAY, STATS_VIDEO, SESSION, 40);
+  metrics.record(METRIC_PRESENTED, STATS_VIDEO, SESSION, 1);
+}
+
+
+void statsPerFrame(benchmark::State& state)
+{
+  MetricsCollector& metrics = collector();
+
+  int frames = 0;
+  for (auto _ : state)
+  {
+    reportFrame(metrics, 4000);
+
+    ++frames;
+    if (frames == AGGREGATION_FRAMES)
+    {
+      metrics.aggregate();
+      frames = 0;
+    }
+  }
+
+  state.counters["lost"] = metrics.lostValues();
+}
+
+
+// only the part done by the media threads
+void recordPerFrame(benchmark::State& state)
+{
+  MetricsCollector& metrics = collector();
+
+  int frames = 0;
+  for (auto _ : state)
+  {
+    reportFrame(metrics, 4000);
+
+    ++frames;
+    if (frames == AGGREGATION_FRAMES)
+    {
+      state.PauseTiming();
+      metrics.aggregate();
+      state.ResumeTiming();
+      frames = 0;
+    }
+  }
+}
+
+
+// how the statistics window recorded values before
+class LockedRing
+{
+public:
+  LockedRing():
+    values_(65536, nullptr),
+    index_(0)
+  {}
+
+  ~LockedRing()
+  {
+    for (auto value : values_)
+    {
+      delete value;
+    }
+  }
+
+  void add(const std::string& type, uint32_t value)
+  {
+    if (type == "video" || type == "Video")
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+      delete values_[index_%values_.size()];
+      values_[index_%values_.size()] = new Value{now, value};
+      ++index_;
+    }
+  }
+
+private:
+
+  struct Value
+  {
+    int64_t timestamp;
+    uint32_t value;
+  };
+
+  std::mutex mutex_;
+  std::vector<Value*> values_;
+  uint32_t index_;
+};
+
+
+void lockedPerFrame(benchmark::State& state)
+{
+  static LockedRing received;
+  static LockedRing buffers;
+  static LockedRing delays;
+  static LockedRing presented;
+
+  for (auto _ : state)
+  {
+    received.add("Video", 4000);
+    for (int filter = 0; filter < FILTERS; ++filter)
+    {
+      buffers.add("Video", 1);
+    }
+    delays.add("Video", 40);
+    presented.add("Video", 1);
+  }
+}
+
+
+void threads(benchmark::internal::Benchmark* bench)
+{
+  for (int count : THREADS)
+  {
+    bench->Threads(count);
+  }
+  bench->UseRealTime();
+}
+
+}
+
+
+BENCHMARK(statsPerFrame)->Apply(threads);
+BENCHMARK(recordPerFrame)->Apply(threads);
+BENCHMARK(lockedPerFrame)->Apply(threads);
@@ -0,0 +1,272 @@
+#include "media/processing/audiomixing.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+/* The cost of mixing one 10 ms frame of 48 kHz stereo from 2 to 16 inputs,
+ * with and without a mix-minus for every input. The latency benchmarks replay
+ * the same network jitter to the previous mixer, which waited for every input
+ * to have a frame, and to the mixer on the playback clock which mixes missing
+ * inputs as silence. Latency is counted from sending a frame to mixing it,
+ * the bursts of the previous mixer still had to be evened out after mixing. */
+
+namespace
+{
+
+const size_t FRAME_SAMPLES = 960;
+const int64_t FRAME_US = 10000;
+const int64_t GRACE_US = 5000;
+const int64_t LATE_DELAY_US = 1000;
+
+// frames of one input the mixer queues at most
+const size_t MAX_QUEUED_FRAMES = 4;
+
+// simulated length of the call
+const int SIMULATED_FRAMES = 1000;
+
+
+void inputCounts(benchmark::internal::Benchmark* bench)
+{
+  bench->ArgNames({"inputs", "mixminus"});
+  for (int inputs = 2; inputs <= 16; inputs *= 2)
+  {
+    bench->Args({inputs, 0});
+    bench->Args({inputs, 1});
+  }
+}
+
+
+std::vector<int16_t> randomSamples(size_t count, unsigned int seed)
+{
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<int> distribution(INT16_MIN/4, INT16_MAX/4);
+
+  std::vector<int16_t> samples(count);
+  for (auto& sample : samples)
+  {
+    sample = (int16_t)distribution(generator);
+  }
+  return samples;
+}
+
+
+void mixFrame(benchmark::State& state, KernelLevel level)
+{
+  const MixingKernels* kernels = get_mixing_level_kernels(level);
+  if (kernels == nullptr)
+  {
+    state.SkipWithError("Instruction set not supported by this CPU");
+    return;
+  }
+
+  const int inputCount = state.range(0);
+  const bool mixMinus = state.range(1);
+
+  std::vector<std::vector<int16_t>> inputs;
+  for (int i = 0; i < inputCount; ++i)
+  {
+    inputs.push_back(randomSamples(FRAME_SAMPLES, i));
+  }
+
+  std::vector<int32_t> sum(FRAME_SAMPLES);
+  std::vector<int16_t> output(FRAME_SAMPLES);
+
+  for (auto _ : state)
+  {
+    std::fill(sum.begin(), sum.end(), 0);
+    for (auto& input : inputs)
+    {
+      kernels->accumulate_samples(sum.data(), input.data(), FRAME_SAMPLES);
+    }
+
+    kernels->saturate_mix(sum.data(), nullptr, output.data(), FRAME_SAMPLES);
+    benchmark::DoNotOptimize(output.data());
+
+    if (mixMinus)
+    {
+      for (auto& input : inputs)
+      {
+        kernels->saturate_mix(sum.data(), input.data(), output.data(), FRAME_SAMPLES);
+        benchmark::DoNotOptimize(output.data());
+      }
+    }
+  }
+
+  state.counters["frames"] = benchmark::Counter((double)state.iterations(),
+                                                benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_CAPTURE(mixFrame, C,    KERNEL_C)->Apply(inputCounts);
+BENCHMARK_CAPTURE(mixFrame, AVX2, KERNEL_AVX2)->Apply(inputCounts);
+
+
+struct Arrival
+{
+  int64_t timeUs;
+  int input;
+  int64_t generatedUs;
+};
+
+
+// Every input sends a frame every 10 ms. Most arrive within a few ms but
+// every input has occasional late frames like on a Wi-Fi link.
+std::vector<Arrival> simulateNetwork(int inputCount)
+{
+  std::mt19937 generator(inputCount);
+  std::exponential_distribution<double> jitter(1.0/3000);
+  std::uniform_real_distribution<double> spike(0.0, 1.0);
+
+  std::vector<Arrival> arrivals;
+  for (int input = 0; input < inputCount; ++input)
+  {
+    int64_t previous = 0;
+    for (int frame = 0; frame < SIMULATED_FRAMES; ++frame)
+    {
+      int64_t generated = frame*FRAME_US;
+      int64_t delay = (int64_t)jitter(generator) + (spike(generator) < 0.01 ? 40000 : 0);
+
+      // frames of one input stay in order
+      previous = std::max(previous, generated + delay);
+      arrivals.push_back({previous, input, generated});
+    }
+  }
+
+  std::sort(arrivals.begin(), arrivals.end(), [](const Arrival& a, const Arrival& b)
+  {
+    return a.timeUs < b.timeUs;
+  });
+
+  return arrivals;
+}
+
+
+void setMixCounters(benchmark::State& state, double latencyUs, uint64_t mixedFrames,
+                    uint64_t silentFrames)
+{
+  uint64_t frames = std::max<uint64_t>(mixedFrames + silentFrames, 1);
+
+  state.counters["latency_ms"] = latencyUs/std::max<uint64_t>(mixedFrames, 1)/1000;
+  state.counters["silent_%"] = 100.0*silentFrames/frames;
+}
+
+
+void mixLatency_waitForAll(benchmark::State& state)
+{
+  const int inputCount = state.range(0);
+  std::vector<Arrival> arrivals = simulateNetwork(inputCount);
+
+  double latencyUs = 0;
+  uint64_t mixedFrames = 0;
+
+  for (auto _ : state)
+  {
+    std::vector<std::deque<int64_t>> queues(inputCount);
+    latencyUs = 0;
+    mixedFrames = 0;
+
+    for (auto& arrival : arrivals)
+    {
+      queues[arrival.input].push_back(arrival.generatedUs);
+
+      bool allHaveFrames = std::all_of(queues.begin(), queues.end(),
+                                       [](const std::deque<int64_t>& queue){ return !queue.empty(); });
+      if (allHaveFrames)
+      {
+        for (auto& queue : queues)
+        {
+          latencyUs += arrival.timeUs - queue.front();
+          queue.pop_front();
+          ++mixedFrames;
+        }
+      }
+    }
+    benchmark::DoNotOptimize(latencyUs);
+  }
+
+  setMixCounters(state, latencyUs, mixedFrames, 0);
+}
+
+
+void mixLatency_playbackClock(benchmark::State& state)
+{
+  const int inputCount = state.range(0);
+  std::vector<Arrival> arrivals = simulateNetwork(inputCount);
+
+  double latencyUs = 0;
+  uint64_t mixedFrames = 0;
+  uint64_t silentFrames = 0;
+
+  for (auto _ : state)
+  {
+    std::vector<std::deque<int64_t>> queues(inputCount);
+    std::vector<MixingBacklog> backlogs(inputCount);
+    MixingClock clock(FRAME_US, GRACE_US);
+    latencyUs = 0;
+    mixedFrames = 0;
+    silentFrames = 0;
+
+    for (auto& arrival : arrivals)
+    {
+      std::deque<int64_t>& queue = queues[arrival.input];
+      if (backlogs[arrival.input].arrived())
+      {
+        clock.delay(LATE_DELAY_US);
+        continue;
+      }
+
+      queue.push_back(arrival.generatedUs);
+      if (queue.size() > MAX_QUEUED_FRAMES)
+      {
+        queue.pop_front();
+      }
+
+      auto framesDue = [&]()
+      {
+        auto hasFrame = [](const std::deque<int64_t>& queue){ return !queue.empty(); };
+
+        if (std::all_of(queues.begin(), queues.end(), hasFrame))
+        {
+          clock.mixedEarly(arrival.timeUs);
+          return true;
+        }
+        return std::any_of(queues.begin(), queues.end(), hasFrame) && clock.due(arrival.timeUs);
+      };
+
+      while (framesDue())
+      {
+        for (int i = 0; i < inputCount; ++i)
+        {
+          std::deque<int64_t>& input = queues[i];
+          bool hadFrame = !input.empty();
+          if (hadFrame)
+          {
+            latencyUs += arrival.timeUs - input.front();
+            input.pop_front();
+            ++mixedFrames;
+          }
+          else
+          {
+            ++silentFrames;
+          }
+
+          for (size_t drop = backlogs[i].mixed(hadFrame, input.size()); drop > 0; --drop)
+          {
+            input.pop_front();
+          }
+        }
+      }
+    }
+    benchmark::DoNotOptimize(latencyUs);
+  }
+
+  setMixCounters(state, latencyUs, mixedFrames, silentFrames);
+}
+
+BENCHMARK(mixLatency_waitForAll)->ArgName("inputs")->RangeMultiplier(2)->Range(2, 16);
+BENCHMARK(mixLatency_playbackClock)->ArgName("inputs")->RangeMultiplier(2)->Range(2, 16);
+
+}
@@ -0,0 +1,73 @@
+#include "media/processing/audioresampling.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+/* The cost of resampling 10 ms frames between 44.1 kHz devices and 48 kHz
+ * Opus in both directions with each quality and channel count. The
+ * channel_realtime counter tells how many seconds of one channel are
+ * resampled in a second of CPU, its inverse is the share of one core a
+ * channel takes. */
+
+namespace
+{
+
+void resamplerArgs(benchmark::internal::Benchmark* bench)
+{
+  bench->ArgNames({"quality", "channels", "to48k"});
+  for (int quality : {RESAMPLER_FAST, RESAMPLER_DEFAULT, RESAMPLER_BEST})
+  {
+    for (int channels : {1, 2})
+    {
+      bench->Args({quality, channels, 1});
+      bench->Args({quality, channels, 0});
+    }
+  }
+}
+
+
+void resampleFrame(benchmark::State& state, KernelLevel level)
+{
+  const ResamplingKernels* kernels = get_resampling_level_kernels(level);
+  if (kernels == nullptr)
+  {
+    state.SkipWithError("Instruction set not supported by this CPU");
+    return;
+  }
+
+  const ResamplerQuality quality = ResamplerQuality(state.range(0));
+  const uint16_t channels = uint16_t(state.range(1));
+  const uint32_t inputRate = state.range(2) ? 44100 : 48000;
+  const uint32_t outputRate = state.range(2) ? 48000 : 44100;
+
+  const size_t frameSamples = inputRate/100;
+
+  std::mt19937 generator(1);
+  std::uniform_int_distribution<int> distribution(INT16_MIN/4, INT16_MAX/4);
+
+  std::vector<int16_t> frame(frameSamples*channels);
+  for (auto& sample : frame)
+  {
+    sample = (int16_t)distribution(generator);
+  }
+
+  PolyphaseResampler resampler(inputRate, outputRate, channels, quality, *kernels);
+  std::vector<int16_t> output;
+
+  for (auto _ : state)
+  {
+    resampler.process(frame.data(), frameSamples, output);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  // each frame is 10 ms of every channel
+  state.counters["channel_realtime"] = benchmark::Counter(0.01*channels*state.iterations(),
+                                                          benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_CAPTURE(resampleFrame, C,    KERNEL_C)->Apply(resamplerArgs);
+BENCHMARK_CAPTURE(resampleFrame, AVX2, KERNEL_AVX2)->Apply(resamplerArgs);
+
+}
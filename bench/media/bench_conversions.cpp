@@ -0,0 +1,706 @@
+#include "media/processing/yuvconversions.h"
+#include "media/processing/yuvscaling.h"
+
+#include <benchmark/benchmark.h>
+#include <libyuv.h>
+
+#include <QImage>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+/* Compares our conversion kernels at every instruction set level against
+ * the libyuv functions that do the same job. Run with
+ * --benchmark_format=json or --benchmark_out=<file> to get JSON results. */
+
+namespace
+{
+
+const int RESOLUTIONS[][2] = {{640, 360}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+const int THREADS[] = {1, 2, 4, 8};
+
+const uint16_t DIRTY_BLOCK_SIZE = 64;
+
+
+void resolutions(benchmark::internal::Benchmark* bench)
+{
+  bench->ArgNames({"width", "height"});
+  for (auto& resolution : RESOLUTIONS)
+  {
+    bench->Args({resolution[0], resolution[1]});
+  }
+  bench->UseRealTime();
+}
+
+
+void resolutionsAndThreads(benchmark::internal::Benchmark* bench)
+{
+  bench->ArgNames({"width", "height", "threads"});
+  for (auto& resolution : RESOLUTIONS)
+  {
+    for (int threads : THREADS)
+    {
+      bench->Args({resolution[0], resolution[1], threads});
+    }
+  }
+
+  // the work happens in other threads so CPU time of this thread means nothing
+  bench->UseRealTime();
+}
+
+
+std::vector<uint8_t> randomFrame(size_t size)
+{
+  std::mt19937 generator(size);
+  std::uniform_int_distribution<int> distribution(0, 255);
+
+  std::vector<uint8_t> frame(size);
+  for (auto& byte : frame)
+  {
+    byte = (uint8_t)distribution(generator);
+  }
+  return frame;
+}
+
+
+// returns nullptr and marks the benchmark skipped if the CPU lacks the level
+const ConversionKernels* kernelsOrSkip(benchmark::State& state, KernelLevel level)
+{
+  const ConversionKernels* kernels = get_level_kernels(level);
+  if (kernels == nullptr)
+  {
+    state.SkipWithError("Instruction set not supported by this CPU");
+  }
+  return kernels;
+}
+
+
+void setFrameCounters(benchmark::State& state, size_t inputBytes)
+{
+  state.SetBytesProcessed(state.iterations()*inputBytes);
+  state.counters["fps"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+
+
+// Reports the median, 99th percentile and worst frame time in microseconds.
+// With several benchmark threads the values are averaged over the threads.
+void setLatencyCounters(benchmark::State& state, std::vector<double>& frameTimes)
+{
+  if (frameTimes.empty())
+  {
+    return;
+  }
+
+  std::sort(frameTimes.begin(), frameTimes.end());
+  auto percentile = [&frameTimes](double p)
+  {
+    return frameTimes[std::min(frameTimes.size() - 1, (size_t)(p*frameTimes.size()))];
+  };
+
+  state.counters["p50_us"] = benchmark::Counter(percentile(0.50), benchmark::Counter::kAvgThreads);
+  state.counters["p99_us"] = benchmark::Counter(percentile(0.99), benchmark::Counter::kAvgThreads);
+  state.counters["max_us"] = benchmark::Counter(frameTimes.back(), benchmark::Counter::kAvgThreads);
+}
+
+}
+
+
+// ------------------- YUV 4:2:0 to RGB32 -------------------
+
+void yuv420ToRGB(benchmark::State& state, KernelLevel level)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  const ConversionKernels* kernels = kernelsOrSkip(state, level);
+  std::vector<uint8_t> input = randomFrame(width*height*3/2);
+  std::vector<uint8_t> output(width*height*4);
+
+  for (auto _ : state)
+  {
+    kernels->yuv420_to_rgb(input.data(), output.data(), width, height);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void yuv420ToRGB_AVX2_MT(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  if (kernelsOrSkip(state, KERNEL_AVX2) == nullptr)
+  {
+    return;
+  }
+
+  std::vector<uint8_t> input = randomFrame(width*height*3/2);
+  std::vector<uint8_t> output(width*height*4);
+
+  for (auto _ : state)
+  {
+    yuv420_to_rgb_i_avx2_mt(input.data(), output.data(), width, height, state.range(2));
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void yuv420ToRGB_libyuv(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  std::vector<uint8_t> input = randomFrame(width*height*3/2);
+  std::vector<uint8_t> output(width*height*4);
+
+  uint8_t* y = input.data();
+  uint8_t* u = y + width*height;
+  uint8_t* v = u + width*height/4;
+
+  for (auto _ : state)
+  {
+    libyuv::I420ToARGB(y, width, u, width/2, v, width/2, output.data(), width*4, width, height);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+BENCHMARK_CAPTURE(yuv420ToRGB, C,      KERNEL_C)->Apply(resolutions);
+BENCHMARK_CAPTURE(yuv420ToRGB, SSE41,  KERNEL_SSE41)->Apply(resolutions);
+BENCHMARK_CAPTURE(yuv420ToRGB, AVX2,   KERNEL_AVX2)->Apply(resolutions);
+BENCHMARK_CAPTURE(yuv420ToRGB, AVX512, KERNEL_AVX512)->Apply(resolutions);
+BENCHMARK(yuv420ToRGB_AVX2_MT)->Apply(resolutionsAndThreads);
+
+// Frame time distribution of the multithreaded conversion when several
+// streams are converted at the same time, like in a conference call.
+void yuv420ToRGB_AVX2_MT_latency(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  if (kernelsOrSkip(state, KERNEL_AVX2) == nullptr)
+  {
+    return;
+  }
+
+  std::vector<uint8_t> input = randomFrame(width*height*3/2);
+  std::vector<uint8_t> output(width*height*4);
+  std::vector<double> frameTimes;
+
+  for (auto _ : state)
+  {
+    auto start = std::chrono::steady_clock::now();
+    yuv420_to_rgb_i_avx2_mt(input.data(), output.data(), width, height, state.range(2));
+    benchmark::DoNotOptimize(output.data());
+    frameTimes.push_back(std::chrono::duration<double, std::micro>(
+                           std::chrono::steady_clock::now() - start).count());
+  }
+
+  setLatencyCounters(state, frameTimes);
+}
+
+BENCHMARK(yuv420ToRGB_AVX2_MT_latency)->Apply(resolutionsAndThreads)->ThreadRange(1, 4);
+BENCHMARK(yuv420ToRGB_libyuv)->Apply(resolutions);
+
+
+// ------------------- RGB32 to YUV 4:2:0 -------------------
+
+void rgbToYUV420(benchmark::State& state, KernelLevel level)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  const ConversionKernels* kernels = kernelsOrSkip(state, level);
+  std::vector<uint8_t> input = randomFrame(width*height*4);
+  std::vector<uint8_t> output(width*height*3/2);
+
+  for (auto _ : state)
+  {
+    kernels->rgb_to_yuv420(input.data(), output.data(), width, height);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void rgbToYUV420_SSE41_MT(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  if (kernelsOrSkip(state, KERNEL_SSE41) == nullptr)
+  {
+    return;
+  }
+
+  std::vector<uint8_t> input = randomFrame(width*height*4);
+  std::vector<uint8_t> output(width*height*3/2);
+
+  for (auto _ : state)
+  {
+    rgb_to_yuv420_i_sse41_mt(input.data(), output.data(), width, height, state.range(2));
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void rgbToYUV420_libyuv(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  std::vector<uint8_t> input = randomFrame(width*height*4);
+  std::vector<uint8_t> output(width*height*3/2);
+
+  uint8_t* y = output.data();
+  uint8_t* u = y + width*height;
+  uint8_t* v = u + width*height/4;
+
+  for (auto _ : state)
+  {
+    libyuv::ARGBToI420(input.data(), width*4, y, width, u, width/2, v, width/2, width, height);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+BENCHMARK_CAPTURE(rgbToYUV420, C,      KERNEL_C)->Apply(resolutions);
+BENCHMARK_CAPTURE(rgbToYUV420, SSE41,  KERNEL_SSE41)->Apply(resolutions);
+BENCHMARK_CAPTURE(rgbToYUV420, AVX2,   KERNEL_AVX2)->Apply(resolutions);
+BENCHMARK_CAPTURE(rgbToYUV420, AVX512, KERNEL_AVX512)->Apply(resolutions);
+BENCHMARK(rgbToYUV420_SSE41_MT)->Apply(resolutionsAndThreads);
+BENCHMARK(rgbToYUV420_libyuv)->Apply(resolutions);
+
+
+// ------------------- YUYV to YUV 4:2:0 and RGB32 -------------------
+
+void yuyvToYUV420(benchmark::State& state, KernelLevel level)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  const ConversionKernels* kernels = kernelsOrSkip(state, level);
+  std::vector<uint8_t> input = randomFrame(width*height*2);
+  std::vector<uint8_t> output(width*height*3/2);
+
+  for (auto _ : state)
+  {
+    kernels->yuyv_to_yuv420(input.data(), output.data(), width, height);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void yuyvToYUV420_libyuv(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  std::vector<uint8_t> input = randomFrame(width*height*2);
+  std::vector<uint8_t> output(width*height*3/2);
+
+  uint8_t* y = output.data();
+  uint8_t* u = y + width*height;
+  uint8_t* v = u + width*height/4;
+
+  for (auto _ : state)
+  {
+    libyuv::YUY2ToI420(input.data(), width*2, y, width, u, width/2, v, width/2, width, height);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void yuyvToRGB(benchmark::State& state, KernelLevel level)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  const ConversionKernels* kernels = kernelsOrSkip(state, level);
+  std::vector<uint8_t> input = randomFrame(width*height*2);
+  std::vector<uint8_t> output(width*height*4);
+
+  for (auto _ : state)
+  {
+    kernels->yuyv_to_rgb(input.data(), output.data(), width, height);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void yuyvToRGB_libyuv(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  std::vector<uint8_t> input = randomFrame(width*height*2);
+  std::vector<uint8_t> output(width*height*4);
+
+  for (auto _ : state)
+  {
+    libyuv::YUY2ToARGB(input.data(), width*2, output.data(), width*4, width, height);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+BENCHMARK_CAPTURE(yuyvToYUV420, C,      KERNEL_C)->Apply(resolutions);
+BENCHMARK_CAPTURE(yuyvToYUV420, AVX2,   KERNEL_AVX2)->Apply(resolutions);
+BENCHMARK_CAPTURE(yuyvToYUV420, AVX512, KERNEL_AVX512)->Apply(resolutions);
+BENCHMARK(yuyvToYUV420_libyuv)->Apply(resolutions);
+
+BENCHMARK_CAPTURE(yuyvToRGB, C,      KERNEL_C)->Apply(resolutions);
+BENCHMARK_CAPTURE(yuyvToRGB, AVX2,   KERNEL_AVX2)->Apply(resolutions);
+BENCHMARK_CAPTURE(yuyvToRGB, AVX512, KERNEL_AVX512)->Apply(resolutions);
+BENCHMARK(yuyvToRGB_libyuv)->Apply(resolutions);
+
+
+// ------------------- RGB32 half size, flip and scale -------------------
+
+void halfRGB(benchmark::State& state, KernelLevel level)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  const ConversionKernels* kernels = kernelsOrSkip(state, level);
+  std::vector<uint8_t> input = randomFrame(width*height*4);
+  std::vector<uint8_t> output(width*height);
+
+  for (auto _ : state)
+  {
+    kernels->half_rgb(input.data(), output.data(), width, height);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void halfRGB_libyuv(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  std::vector<uint8_t> input = randomFrame(width*height*4);
+  std::vector<uint8_t> output(width*height);
+
+  for (auto _ : state)
+  {
+    // point sampling is what half_rgb does
+    libyuv::ARGBScale(input.data(), width*4, width, height,
+                      output.data(), width*2, width/2, height/2, libyuv::kFilterNone);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void flipRGB(benchmark::State& state, KernelLevel level, bool horizontally, bool vertically)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  const ConversionKernels* kernels = kernelsOrSkip(state, level);
+  std::vector<uint8_t> input = randomFrame(width*height*4);
+  std::vector<uint8_t> output(width*height*4);
+
+  for (auto _ : state)
+  {
+    kernels->flip_rgb(input.data(), output.data(), width, height, horizontally, vertically);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void mirrorRGB_libyuv(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  std::vector<uint8_t> input = randomFrame(width*height*4);
+  std::vector<uint8_t> output(width*height*4);
+
+  for (auto _ : state)
+  {
+    libyuv::ARGBMirror(input.data(), width*4, output.data(), width*4, width, height);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void flipVerticalRGB_libyuv(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  std::vector<uint8_t> input = randomFrame(width*height*4);
+  std::vector<uint8_t> output(width*height*4);
+
+  for (auto _ : state)
+  {
+    // negative height flips the image in libyuv
+    libyuv::ARGBCopy(input.data(), width*4, output.data(), width*4, width, -height);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+// scaling RGB with Qt to 360p, for comparison
+void scaleRGB_QImage(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  std::vector<uint8_t> input = randomFrame(width*height*4);
+  std::vector<uint8_t> output(640*360*4);
+
+  for (auto _ : state)
+  {
+    QImage image(input.data(), width, height, QImage::Format_RGB32);
+    QImage scaled = image.scaled(640, 360);
+    memcpy(output.data(), scaled.bits(), scaled.sizeInBytes());
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void scaleRGB_libyuv(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  std::vector<uint8_t> input = randomFrame(width*height*4);
+  std::vector<uint8_t> output(640*360*4);
+
+  for (auto _ : state)
+  {
+    libyuv::ARGBScale(input.data(), width*4, width, height,
+                      output.data(), 640*4, 640, 360, libyuv::kFilterBilinear);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void scaleYUV420_libyuv(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  std::vector<uint8_t> input = randomFrame(width*height*3/2);
+  std::vector<uint8_t> output(640*360*3/2);
+
+  uint8_t* y = input.data();
+  uint8_t* u = y + width*height;
+  uint8_t* v = u + width*height/4;
+
+  uint8_t* out_y = output.data();
+  uint8_t* out_u = out_y + 640*360;
+  uint8_t* out_v = out_u + 640*360/4;
+
+  for (auto _ : state)
+  {
+    libyuv::I420Scale(y, width, u, width/2, v, width/2, width, height,
+                      out_y, 640, out_u, 320, out_v, 320, 640, 360, libyuv::kFilterBilinear);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void scaleYUV420(benchmark::State& state, int dstWidth, int dstHeight)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  std::vector<uint8_t> input = randomFrame(width*height*3/2);
+  std::vector<uint8_t> output(dstWidth*dstHeight*3/2);
+  std::vector<uint8_t> work(scale_work_size(width, height, dstWidth, dstHeight));
+
+  for (auto _ : state)
+  {
+    scale_yuv420(input.data(), width, height, output.data(), dstWidth, dstHeight, work.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+void scalePlane(benchmark::State& state, KernelLevel level, bool box)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+
+  const ConversionKernels* kernels = kernelsOrSkip(state, level);
+  std::vector<uint8_t> input = randomFrame(width*height);
+  std::vector<uint8_t> output(width*height/4);
+  std::vector<uint8_t> work(scale_work_size(width, height, width/2, height/2));
+
+  auto scale = box ? kernels->scale_plane_box : kernels->scale_plane_bilinear;
+
+  for (auto _ : state)
+  {
+    scale(input.data(), width, height, width, output.data(), width/2, height/2, width/2, work.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+BENCHMARK_CAPTURE(halfRGB, C,      KERNEL_C)->Apply(resolutions);
+BENCHMARK_CAPTURE(halfRGB, AVX2,   KERNEL_AVX2)->Apply(resolutions);
+BENCHMARK_CAPTURE(halfRGB, AVX512, KERNEL_AVX512)->Apply(resolutions);
+BENCHMARK(halfRGB_libyuv)->Apply(resolutions);
+
+BENCHMARK_CAPTURE(flipRGB, mirror_C,        KERNEL_C,      true,  false)->Apply(resolutions);
+BENCHMARK_CAPTURE(flipRGB, mirror_AVX2,     KERNEL_AVX2,   true,  false)->Apply(resolutions);
+BENCHMARK_CAPTURE(flipRGB, mirror_AVX512,   KERNEL_AVX512, true,  false)->Apply(resolutions);
+BENCHMARK_CAPTURE(flipRGB, vertical_C,      KERNEL_C,      false, true)->Apply(resolutions);
+BENCHMARK_CAPTURE(flipRGB, vertical_AVX2,   KERNEL_AVX2,   false, true)->Apply(resolutions);
+BENCHMARK_CAPTURE(flipRGB, vertical_AVX512, KERNEL_AVX512, false, true)->Apply(resolutions);
+BENCHMARK(mirrorRGB_libyuv)->Apply(resolutions);
+BENCHMARK(flipVerticalRGB_libyuv)->Apply(resolutions);
+
+BENCHMARK(scaleRGB_QImage)->Apply(resolutions);
+BENCHMARK_CAPTURE(scaleYUV420, to360p, 640, 360)->Apply(resolutions);
+BENCHMARK_CAPTURE(scalePlane, half_bilinear_C,    KERNEL_C,    false)->Apply(resolutions);
+BENCHMARK_CAPTURE(scalePlane, half_bilinear_AVX2, KERNEL_AVX2, false)->Apply(resolutions);
+BENCHMARK_CAPTURE(scalePlane, half_box_C,         KERNEL_C,    true)->Apply(resolutions);
+BENCHMARK_CAPTURE(scalePlane, half_box_AVX2,      KERNEL_AVX2, true)->Apply(resolutions);
+BENCHMARK(scaleRGB_libyuv)->Apply(resolutions);
+BENCHMARK(scaleYUV420_libyuv)->Apply(resolutions);
+
+
+// ------------------- Self view -------------------
+
+// the self view is at most this high
+const int SELF_VIEW_HEIGHT = 540;
+
+void selfView(benchmark::State& state, KernelLevel level, SelfViewFormat format)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+  const int factor = (height + SELF_VIEW_HEIGHT - 1)/SELF_VIEW_HEIGHT;
+
+  const ConversionKernels* kernels = kernelsOrSkip(state, level);
+
+  std::vector<uint8_t> input = randomFrame(format == SELF_VIEW_YUYV ? width*height*2 : width*height*3/2);
+  std::vector<uint8_t> output(((width/factor) & ~1)*(height/factor)*4);
+  std::vector<uint8_t> work(selfview_work_size(width));
+
+  for (auto _ : state)
+  {
+    if (kernels)
+    {
+      kernels->selfview_to_rgb(input.data(), output.data(), width, height, format, factor, true, work.data());
+      benchmark::DoNotOptimize(output.data());
+    }
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+// The separate steps the fused kernel replaces with the best kernels of this CPU
+void selfViewSeparate(benchmark::State& state)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+  const int factor = (height + SELF_VIEW_HEIGHT - 1)/SELF_VIEW_HEIGHT;
+  const int outWidth = (width/factor) & ~1;
+  const int outHeight = (height/factor) & ~1;
+
+  const ConversionKernels& kernels = get_conversion_kernels();
+
+  std::vector<uint8_t> input = randomFrame(width*height*2);
+  std::vector<uint8_t> yuv420(width*height*3/2);
+  std::vector<uint8_t> scaled(outWidth*outHeight*3/2);
+  std::vector<uint8_t> rgb(outWidth*outHeight*4);
+  std::vector<uint8_t> mirrored(outWidth*outHeight*4);
+  std::vector<uint8_t> work(scale_work_size(width, height, outWidth, outHeight));
+
+  for (auto _ : state)
+  {
+    kernels.yuyv_to_yuv420(input.data(), yuv420.data(), width, height);
+    scale_yuv420(yuv420.data(), width, height, scaled.data(), outWidth, outHeight, work.data());
+    kernels.yuv420_to_rgb(scaled.data(), rgb.data(), outWidth, outHeight);
+    kernels.flip_rgb(rgb.data(), mirrored.data(), outWidth, outHeight, true, false);
+    benchmark::DoNotOptimize(mirrored.data());
+  }
+
+  setFrameCounters(state, input.size());
+}
+
+
+BENCHMARK_CAPTURE(selfView, YUYV_C,      KERNEL_C,    SELF_VIEW_YUYV)->Apply(resolutions);
+BENCHMARK_CAPTURE(selfView, YUYV_AVX2,   KERNEL_AVX2, SELF_VIEW_YUYV)->Apply(resolutions);
+BENCHMARK_CAPTURE(selfView, NV12_AVX2,   KERNEL_AVX2, SELF_VIEW_NV12)->Apply(resolutions);
+BENCHMARK_CAPTURE(selfView, YUV420_AVX2, KERNEL_AVX2, SELF_VIEW_YUV420)->Apply(resolutions);
+BENCHMARK(selfViewSeparate)->Apply(resolutions);
+
+
+// ------------------- Screen content change detection -------------------
+
+void dirtyBlocks(benchmark::State& state, KernelLevel level)
+{
+  const int width = state.range(0);
+  const int height = state.range(1);
+  const int blocks = ((width + DIRTY_BLOCK_SIZE - 1)/DIRTY_BLOCK_SIZE)*
+      ((height + DIRTY_BLOCK_SIZE - 1)/DIRTY_BLOCK_SIZE);
+
+  const ConversionKernels* kernels = kernelsOrSkip(state, level);
+
+  // mostly static screen is the common case
+  std::vector<uint8_t> current = randomFrame(width*height*4);
+  std::vector<uint8_t> previous = current;
+  std::vector<uint8_t> dirtyMap(blocks);
+
+  for (auto _ : state)
+  {
+    previous[previous.size()/2] ^= 0xff;
+    benchmark::DoNotOptimize(kernels->update_dirty_blocks(previous.data(), current.data(),
+                                                          dirtyMap.data(), width, height,
+                                                          width*4, DIRTY_BLOCK_SIZE));
+  }
+
+  setFrameCounters(state, current.size());
+}
+
+
+BENCHMARK_CAPTURE(dirtyBlocks, C,      KERNEL_C)->Apply(resolutions);
+BENCHMARK_CAPTURE(dirtyBlocks, AVX2,   KERNEL_AVX2)->Apply(resolutions);
+BENCHMARK_CAPTURE(dirtyBlocks, AVX512, KERNEL_AVX512)->Apply(resolutions);
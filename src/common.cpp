@@ -1,6 +1,7 @@
 
 #include "common.h"
 #include "settingskeys.h"
+#include "global.h"
 
 #include "initiation/negotiation/sdptypes.h"
 
@@ -16,6 +17,7 @@
 #include <QMutex>
 #include <QNetworkInterface>
 
+#include <cmath>
 #include <cstdlib>
 
 
@@ -341,3 +343,86 @@ uint32_t findMID(const MediaInfo &media)
 
   return 0;
 }
+
+
+static uint32_t findPacketTimeAttribute(const MediaInfo &media, SDPAttributeType type)
+{
+  for (auto& attribute : media.valueAttributes)
+  {
+    if (attribute.type == type)
+    {
+      bool ok = false;
+      double ms = attribute.value.toDouble(&ok);
+
+      if (ok && ms > 0)
+      {
+        return uint32_t(std::lrint(ms*1000));
+      }
+    }
+  }
+
+  return 0;
+}
+
+
+uint32_t findPacketTime(const MediaInfo &media)
+{
+  return findPacketTimeAttribute(media, A_PTIME);
+}
+
+
+uint32_t findMaxPacketTime(const MediaInfo &media)
+{
+  return findPacketTimeAttribute(media, A_MAXPTIME);
+}
+
+
+QString packetTimeString(uint32_t frameUs)
+{
+  return QString::number(frameUs/1000.0);
+}
+
+
+uint32_t supportedAudioFrameDuration(uint32_t frameUs)
+{
+  const uint32_t OPUS_FRAME_US[] = {2500, 5000, 10000, 20000, 40000, 60000};
+
+  uint32_t supported = MIN_AUDIO_FRAME_US;
+  for (uint32_t duration : OPUS_FRAME_US)
+  {
+    if (duration <= frameUs && duration <= MAX_AUDIO_FRAME_US)
+    {
+      supported = duration;
+    }
+  }
+
+  return supported;
+}
+
+
+bool audioFrameHasFEC(uint32_t frameUs)
+{
+  return frameUs >= 10000;
+}
+
+
+uint32_t audioFrameSamples(uint32_t sampleRate, uint32_t frameUs)
+{
+  return uint32_t(uint64_t(sampleRate)*frameUs/1000000);
+}
+
+
+uint32_t settingAudioFrameDuration()
+{
+  QSettings settings(settingsFile, settingsFileFormat);
+
+  bool ok = false;
+  double ms = settings.value(SettingsKey::audioFrameDuration).toDouble(&ok);
+
+  if (!ok || ms <= 0)
+  {
+    return DEFAULT_AUDIO_FRAME_US;
+  }
+
+  return supportedAudioFrameDuration(uint32_t(std::lrint(ms*1000)));
+}
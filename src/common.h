@@ -56,3 +56,23 @@ quint16 getLocalPort(std::shared_ptr<ICEInfo> info);
 
 uint32_t findSSRC(const MediaInfo &media);
 uint32_t findMID(const MediaInfo &media);
+
+// ptime and maxptime of the media in microseconds, 0 if not present
+uint32_t findPacketTime(const MediaInfo &media);
+uint32_t findMaxPacketTime(const MediaInfo &media);
+
+// the SDP ptime value of a frame duration, for example 2.5 or 20
+QString packetTimeString(uint32_t frameUs);
+
+// The longest frame duration Opus supports that is not longer than frameUs.
+// Durations outside the limits in global.h are moved within them.
+uint32_t supportedAudioFrameDuration(uint32_t frameUs);
+
+// Opus has inband FEC only in the SILK and hybrid modes, which need 10 ms frames
+bool audioFrameHasFEC(uint32_t frameUs);
+
+// samples per channel in one frame
+uint32_t audioFrameSamples(uint32_t sampleRate, uint32_t frameUs);
+
+// the frame duration chosen in settings, the default if there is none
+uint32_t settingAudioFrameDuration();
@@ -1,6 +1,8 @@
 #include "controller.h"
 
 #include "statisticsinterface.h"
+#include "statisticsexporter.h"
+#include "statisticsfanout.h"
 
 #include "videoviewfactory.h"
 
@@ -21,6 +23,8 @@ const int DELAYED_NEGOTIATION_TIMEOUT_MS = 500;
 
 uvgCommController::uvgCommController():
   states_(),
+  statsExporter_(nullptr),
+  statsFanOut_(nullptr),
   media_(),
   sip_(),
   userInterface_(),
@@ -39,7 +43,9 @@ void uvgCommController::init()
 
   userInterface_.init(this, viewFactory_);
 
-  stats_ = userInterface_.createStatsWindow();
+  MetricsRecorder* statsWindow = userInterface_.createStatsWindow();
+  stats_ = statsWindow;
+  createStatisticsExport(statsWindow);
 
   QObject::connect(&sip_, &SIPManager::finalLocalSDP,
                    this, &uvgCommController::inputLocalSDP);
@@ -89,6 +95,12 @@ void uvgCommController::init()
   QObject::connect(&media_, &MediaManager::iceMediaFailed,
                    this, &uvgCommController::iceFailed);
 
+  QObject::connect(&media_, &MediaManager::parameterSetsChanged,
+                   this, &uvgCommController::updateParameterSets);
+
+  QObject::connect(&media_, &MediaManager::activeSpeakerChanged,
+                   &userInterface_, &UIManager::setActiveSpeaker);
+
   media_.init(viewFactory_, stats_);
 
   // register the GUI signals indicating GUI changes to be handled
@@ -149,6 +161,60 @@ SIPConfig uvgCommController::createSIPConfig()
 }
 
 
+void uvgCommController::createStatisticsExport(MetricsRecorder* statsWindow)
+{
+  // these are only set on unattended nodes, so don't warn if they are missing
+  QSettings settings(settingsFile, settingsFileFormat);
+  QString file = settings.value(SettingsKey::statsExportFile).toString();
+  int period = settings.value(SettingsKey::statsExportPeriod, 1000).toInt();
+  int port = settings.value(SettingsKey::statsPrometheusPort, 0).toInt();
+  QString socket = settings.value(SettingsKey::statsPrometheusSocket).toString();
+
+  if (file.isEmpty() && port == 0 && socket.isEmpty())
+  {
+    return;
+  }
+
+  // the window and the exporter share the recorded values
+  statsExporter_ = std::make_unique<StatisticsExporter>(
+        statsWindow ? statsWindow->getCollector() : nullptr);
+
+  bool exporting = false;
+  if (!file.isEmpty())
+  {
+    exporting |= statsExporter_->startJSONLines(file, period);
+  }
+
+  if (port > 0 && port <= UINT16_MAX)
+  {
+    exporting |= statsExporter_->listenTCP((uint16_t)port);
+  }
+
+  if (!socket.isEmpty())
+  {
+    exporting |= statsExporter_->listenLocal(socket);
+  }
+
+  if (!exporting)
+  {
+    statsExporter_ = nullptr;
+    return;
+  }
+
+  if (statsWindow)
+  {
+    statsFanOut_ = std::make_unique<StatisticsFanOut>(statsWindow->getCollector());
+    statsFanOut_->addSink(statsWindow);
+    statsFanOut_->addSink(statsExporter_.get());
+    stats_ = statsFanOut_.get();
+  }
+  else
+  {
+    stats_ = statsExporter_.get();
+  }
+}
+
+
 void uvgCommController::quit()
 {
   uninit();
@@ -292,6 +358,15 @@ void uvgCommController::updateAudioSettings()
 }
 
 
+void uvgCommController::updateParameterSets(QByteArray vps, QByteArray sps, QByteArray pps)
+{
+  // only used in future negotiations, the ongoing calls get these in-band
+  sip_.setFormatParameters("H265", {{"sprop-vps", QString(vps.toBase64())},
+                                    {"sprop-sps", QString(sps.toBase64())},
+                                    {"sprop-pps", QString(pps.toBase64())}});
+}
+
+
 void uvgCommController::updateVideoSettings()
 {
   std::shared_ptr<SDPMessageInfo> sdp = sip_.generateSDP(getLocalUsername(), 1, 1,
@@ -18,6 +18,9 @@
 
 struct SDPMessageInfo;
 class StatisticsInterface;
+class MetricsRecorder;
+class StatisticsExporter;
+class StatisticsFanOut;
 
 class uvgCommController : public QObject, public ParticipantInterface
 {
@@ -78,6 +81,9 @@ public slots:
 
   void updateAudioSettings();
   void updateVideoSettings();
+
+  // advertise the parameter sets of our encoder in SDP (sprop, RFC 7798)
+  void updateParameterSets(QByteArray vps, QByteArray sps, QByteArray pps);
   void updateCallSettings();
 
   void negotiateNextCall();
@@ -116,6 +122,9 @@ private:
   // we cannot however bind to those so we must translate the addresses to our local addresses
   void getStunBindings(uint32_t sessionID, MediaInfo &media);
 
+  // export statistics in addition to the window if the settings ask for it
+  void createStatisticsExport(MetricsRecorder* statsWindow);
+
   bool areWeFocus() const
   {
     return states_.size() > 1;
@@ -152,6 +161,10 @@ private:
 
   std::deque<uint32_t> pendingRenegotiations_;
 
+  // destroyed after the components reporting to them
+  std::unique_ptr<StatisticsExporter> statsExporter_;
+  std::unique_ptr<StatisticsFanOut> statsFanOut_;
+
   MediaManager media_; // Media processing and delivery
   SIPManager sip_; // SIP
   UIManager userInterface_; // UI
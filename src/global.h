@@ -19,16 +19,20 @@ const unsigned int INVITE_TIMEOUT = 60000;
 // has arrived before sending the packet. If packet is too small,
 // we waste bandwidth.
 
-// With a value of 100, one audio frame constitutes 10 ms of audio samples.
-// It is recommended to keep the audio frame size relatively small to avoid 
-// unnecessary latency.
+// The duration of one audio frame in microseconds is negotiated for each
+// call with SDP ptime within these limits. Opus supports frames of 2.5, 5,
+// 10, 20, 40 and 60 ms. Short frames suit low latency on LANs and long ones
+// reduce the packet rate on mobile uplinks. Frames shorter than 10 ms are
+// encoded in CELT-only mode which has no inband FEC.
+const uint32_t MIN_AUDIO_FRAME_US = 2500;
+const uint32_t MAX_AUDIO_FRAME_US = 60000;
+
 #ifdef __linux__
 // linux uses such large audio frames, that the buffers can't keep up with
 // smaller packet sizes
-// TODO: Make filter buffer sizes relative to this number so the latency stays constant
-const uint16_t AUDIO_FRAMES_PER_SECOND = 50;
+const uint32_t DEFAULT_AUDIO_FRAME_US = 20000;
 #else
-const uint16_t AUDIO_FRAMES_PER_SECOND = 100;
+const uint32_t DEFAULT_AUDIO_FRAME_US = 10000;
 #endif
 
 const uint16_t MIN_ICE_PORT   = 23000;
@@ -67,3 +71,9 @@ struct UvgRTPStream
   uint32_t localSSRC;
   uint32_t remoteSSRC;
 };
+
+// RTCP APP packet asking the sender for a keyframe when the receiver cannot
+// continue decoding. The payload is not used and is zero.
+const char KEYFRAME_APP_NAME[] = "KEYF";
+const uint8_t KEYFRAME_APP_SUBTYPE = 0;
+const uint32_t KEYFRAME_APP_SIZE = 4;
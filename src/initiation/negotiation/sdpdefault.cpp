@@ -256,6 +256,44 @@ void generateMedia(QString type, QList<MediaInfo>& medias,
 }
 
 
+void setFormatParameters(std::shared_ptr<SDPMessageInfo> sdp, QString codec,
+                         const std::vector<FormatParameter>& parameters)
+{
+  for (auto& media : sdp->media)
+  {
+    for (auto& rtpMap : media.rtpMaps)
+    {
+      if (rtpMap.codec == codec)
+      {
+        media.fmtpAttributes[rtpMap.rtpNum] = parameters;
+      }
+    }
+  }
+}
+
+
+void setPacketTime(std::shared_ptr<SDPMessageInfo> sdp, uint32_t frameUs, uint32_t maxFrameUs)
+{
+  for (auto& media : sdp->media)
+  {
+    if (media.type == "audio")
+    {
+      for (int i = media.valueAttributes.size() - 1; i >= 0; --i)
+      {
+        if (media.valueAttributes.at(i).type == A_PTIME ||
+            media.valueAttributes.at(i).type == A_MAXPTIME)
+        {
+          media.valueAttributes.removeAt(i);
+        }
+      }
+
+      media.valueAttributes.push_back({A_PTIME,    packetTimeString(frameUs)});
+      media.valueAttributes.push_back({A_MAXPTIME, packetTimeString(maxFrameUs)});
+    }
+  }
+}
+
+
 RTPMap createMapping(uint8_t& dynamicNumber, const QString subtype,
                      const std::map<QString, uint32_t> &clockFrequencies)
 {
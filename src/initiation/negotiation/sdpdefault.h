@@ -19,3 +19,10 @@ std::shared_ptr<SDPMessageInfo> generateDefaultSDP(QString username, QString loc
 
 void generateOrigin(std::shared_ptr<SDPMessageInfo> sdp, QString localAddress, QString username);
 
+
+// sets the fmtp parameters of all media using this codec, replacing earlier values
+void setFormatParameters(std::shared_ptr<SDPMessageInfo> sdp, QString codec,
+                         const std::vector<FormatParameter>& parameters);
+
+// sets the ptime and maxptime of all audio media, replacing earlier values
+void setPacketTime(std::shared_ptr<SDPMessageInfo> sdp, uint32_t frameUs, uint32_t maxFrameUs);
@@ -44,6 +44,16 @@ void SDPNegotiation::setBaseSDP(std::shared_ptr<SDPMessageInfo> localSDP)
 }
 
 
+void SDPNegotiation::setFormatParameters(QString codec,
+                                         const std::vector<FormatParameter>& parameters)
+{
+  if (localbaseSDP_ != nullptr)
+  {
+    ::setFormatParameters(localbaseSDP_, codec, parameters);
+  }
+}
+
+
 void SDPNegotiation::processOutgoingRequest(SIPRequest& request, QVariant& content)
 {
   Logger::getLogger()->printNormal(this, "Processing outgoing request");
@@ -455,6 +465,9 @@ std::shared_ptr<SDPMessageInfo> SDPNegotiation::findCommonSDP(const SDPMessageIn
         selectBestCodec(comparedSDP.media.at(i).rtpNums,         comparedSDP.media.at(i).rtpMaps,
                         baseSDP.media.at(matches.at(i)).rtpNums, baseSDP.media.at(matches.at(i)).rtpMaps,
                         resultMedia.rtpNums,                     resultMedia.rtpMaps);
+
+        copyFormatParameters(baseSDP.media.at(matches.at(i)), resultMedia);
+        negotiatePacketTime(baseSDP.media.at(matches.at(i)), comparedSDP.media.at(i), resultMedia);
       }
 
       newInfo->media.append(resultMedia);
@@ -516,6 +529,65 @@ bool SDPNegotiation::selectBestCodec(const QList<uint8_t>& comparedNums, const Q
 }
 
 
+void SDPNegotiation::copyFormatParameters(const MediaInfo& baseMedia, MediaInfo& resultMedia)
+{
+  // the payload number of the selected codec may differ from base, so we match by codec name
+  for (auto& resultCodec : resultMedia.rtpMaps)
+  {
+    for (auto& baseCodec : baseMedia.rtpMaps)
+    {
+      auto parameters = baseMedia.fmtpAttributes.find(baseCodec.rtpNum);
+
+      if (resultCodec.codec == baseCodec.codec &&
+          parameters != baseMedia.fmtpAttributes.end())
+      {
+        resultMedia.fmtpAttributes[resultCodec.rtpNum] = parameters->second;
+      }
+    }
+  }
+}
+
+
+void SDPNegotiation::negotiatePacketTime(const MediaInfo& baseMedia, const MediaInfo& comparedMedia,
+                                         MediaInfo& resultMedia)
+{
+  if (resultMedia.type != "audio")
+  {
+    return;
+  }
+
+  uint32_t frameUs = findPacketTime(comparedMedia);
+  if (frameUs == 0)
+  {
+    frameUs = findPacketTime(baseMedia);
+  }
+
+  if (frameUs == 0)
+  {
+    // neither side cares, the default is used
+    return;
+  }
+
+  for (uint32_t maxFrameUs : {findMaxPacketTime(baseMedia), findMaxPacketTime(comparedMedia)})
+  {
+    if (maxFrameUs != 0 && frameUs > maxFrameUs)
+    {
+      frameUs = maxFrameUs;
+    }
+  }
+
+  frameUs = supportedAudioFrameDuration(frameUs);
+
+  resultMedia.valueAttributes.push_back({A_PTIME, packetTimeString(frameUs)});
+
+  uint32_t ourMaxFrameUs = findMaxPacketTime(baseMedia);
+  if (ourMaxFrameUs != 0)
+  {
+    resultMedia.valueAttributes.push_back({A_MAXPTIME, packetTimeString(ourMaxFrameUs)});
+  }
+}
+
+
 bool SDPNegotiation::matchMedia(std::vector<int> &matches,
                                 const SDPMessageInfo &firstSDP,
                                 const SDPMessageInfo &secondSDP)
@@ -41,6 +41,9 @@ public:
 
   void setBaseSDP(std::shared_ptr<SDPMessageInfo> localSDP);
 
+  // updates fmtp of our SDP without changing the session version
+  void setFormatParameters(QString codec, const std::vector<FormatParameter>& parameters);
+
   // frees the ports when they are not needed in rest of the program
   virtual void uninit();
 
@@ -81,6 +84,14 @@ private:
                        const QList<uint8_t> &baseNums,     const QList<RTPMap> &baseCodecs,
                              QList<uint8_t>& resultNums,         QList<RTPMap>& resultCodecs);
 
+  // format parameters such as sprop parameter sets describe the base media
+  void copyFormatParameters(const MediaInfo& baseMedia, MediaInfo& resultMedia);
+
+  // the audio frame duration is the same in both directions so both sides
+  // end up with the ptime of the offer, limited by the maxptime of either side
+  void negotiatePacketTime(const MediaInfo& baseMedia, const MediaInfo& comparedMedia,
+                           MediaInfo& resultMedia);
+
   bool matchMedia(std::vector<int>& matches,
                   const SDPMessageInfo &firstSDP,
                   const SDPMessageInfo& secondSDP);
@@ -219,6 +219,21 @@ QString composeSDPContent(const SDPMessageInfo &sdpInfo)
           + rtpmap.codec + "/" + QString::number(rtpmap.clockFrequency) + LINE_END;
     }
 
+    for (auto& rtpNum : mediaStream.rtpNums)
+    {
+      auto parameters = mediaStream.fmtpAttributes.find(rtpNum);
+      if (parameters != mediaStream.fmtpAttributes.end() && !parameters->second.empty())
+      {
+        QStringList parameterStrings;
+        for (auto& parameter : parameters->second)
+        {
+          parameterStrings.push_back(parameter.name + "=" + parameter.value);
+        }
+
+        sdp += "a=fmtp:" + QString::number(rtpNum) + " " + parameterStrings.join(";") + LINE_END;
+      }
+    }
+
     for (auto& info : mediaStream.candidates)
     {
       sdp += "a=candidate:"
@@ -1016,7 +1031,8 @@ void parseFormatParameters(QString value, QString secondWord,
 
     for (auto& parameter : parameterStrings)
     {
-      QRegularExpression re_attribute("(?:([\\w-]+)=(\\w+))");
+      // values may be base64 (for example sprop parameter sets in RFC 7798)
+      QRegularExpression re_attribute("(?:([\\w-]+)=([\\w+/=.-]+))");
       QRegularExpressionMatch match = re_attribute.match(parameter);
 
       if (match.hasMatch() && match.lastCapturedIndex() == 2)
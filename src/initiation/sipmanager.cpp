@@ -87,6 +87,13 @@ std::shared_ptr<SDPMessageInfo> SIPManager::generateSDP(QString username,
 
 void SIPManager::setSDP(std::shared_ptr<SDPMessageInfo> sdp)
 {
+  for (auto& parameters : formatParameters_)
+  {
+    ::setFormatParameters(sdp, parameters.first, parameters.second);
+  }
+
+  setPacketTime(sdp, settingAudioFrameDuration(), MAX_AUDIO_FRAME_US);
+
   ourSDP_ = sdp;
 
   for (auto& dialog : dialogs_)
@@ -99,6 +106,26 @@ void SIPManager::setSDP(std::shared_ptr<SDPMessageInfo> sdp)
 }
 
 
+void SIPManager::setFormatParameters(QString codec,
+                                     const std::vector<FormatParameter>& parameters)
+{
+  formatParameters_[codec] = parameters;
+
+  if (ourSDP_ != nullptr)
+  {
+    ::setFormatParameters(ourSDP_, codec, parameters);
+  }
+
+  for (auto& dialog : dialogs_)
+  {
+    if (dialog.second != nullptr)
+    {
+      dialog.second->sdp->setFormatParameters(codec, parameters);
+    }
+  }
+}
+
+
 void SIPManager::refreshDelayTimer()
 {
   if (!dMessages_.empty() && !delayTimer_.isActive())
@@ -898,11 +925,19 @@ void SIPManager::createDialog(uint32_t sessionID, NameAddr &local,
   if (ourSDP_ == nullptr)
   {
     ourSDP_ = generateDefaultSDP(getLocalUsername(), "",  1, 1, {"opus"}, {"H265"}, {0}, {});
+
+    for (auto& parameters : formatParameters_)
+    {
+      ::setFormatParameters(ourSDP_, parameters.first, parameters.second);
+    }
   }
 
   std::shared_ptr<SDPMessageInfo> sdp = std::shared_ptr<SDPMessageInfo> (new SDPMessageInfo);
   *sdp = *ourSDP_;
 
+  // the audio frame duration may have been changed in settings since the SDP was created
+  setPacketTime(sdp, settingAudioFrameDuration(), MAX_AUDIO_FRAME_US);
+
   dialog->sdp = std::shared_ptr<SDPNegotiation> (new SDPNegotiation(sessionID, localAddress, sdp, sdpConf_));
   std::shared_ptr<SDPICE> ice = std::shared_ptr<SDPICE> (new SDPICE(nCandidates_, sessionID, config_.ice, config_.privateAddresses));
 
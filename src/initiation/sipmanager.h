@@ -6,6 +6,8 @@
 
 #include "initiation/sipmessageflow.h"
 
+#include "initiation/negotiation/sdptypes.h"
+
 #include <QObject>
 #include <QTimer>
 #include <map>
@@ -106,6 +108,10 @@ public:
 
   void setSDP(std::shared_ptr<SDPMessageInfo> sdp);
 
+  // Format parameters that are not known when SDP is generated, such as the
+  // parameter sets of our encoder. These are kept over SDP changes.
+  void setFormatParameters(QString codec, const std::vector<FormatParameter>& parameters);
+
   // start listening to incoming SIP messages
   void init(const SIPConfig& config, StatisticsInterface *stats);
   void uninit();
@@ -277,6 +283,9 @@ private:
 
   std::shared_ptr<SDPMessageInfo> ourSDP_;
 
+  // key is codec
+  std::map<QString, std::vector<FormatParameter>> formatParameters_;
+
   /* Used to avoid congestion when sending multiple messages
    * mutexing is not needed at this point since both adding and
    * processing are done by Qt main thread */
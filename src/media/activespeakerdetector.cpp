@@ -0,0 +1,86 @@
+#include "activespeakerdetector.h"
+
+#include <cmath>
+
+// levels this loud or louder are speech, quieter ones are background noise
+const uint8_t SPEECH_LEVEL = 50;
+
+// how fast the activity follows the speech
+const double ACTIVITY_TIME_MS = 500.0;
+
+// the activity a stream needs to become the speaker
+const double MIN_ACTIVITY = 0.3;
+
+// how much more active and for how long another stream must be to take over
+const double SWITCH_MARGIN = 0.2;
+const int64_t SWITCH_HOLD_MS = 400;
+
+
+ActiveSpeakerDetector::ActiveSpeakerDetector():
+  speakers_(),
+  active_(0)
+{}
+
+
+bool ActiveSpeakerDetector::addLevel(uint32_t sessionID, uint8_t level, int64_t timeMs)
+{
+  auto found = speakers_.find(sessionID);
+  if (found == speakers_.end())
+  {
+    found = speakers_.insert({sessionID, Speaker()}).first;
+    found->second.updatedMs = timeMs;
+  }
+
+  Speaker& speaker = found->second;
+
+  double rise = 1.0 - std::exp(-(timeMs - speaker.updatedMs)/ACTIVITY_TIME_MS);
+  speaker.activity = activityAt(speaker, timeMs) + (level <= SPEECH_LEVEL ? rise : 0.0);
+  speaker.updatedMs = timeMs;
+
+  if (sessionID == active_ || speaker.activity < MIN_ACTIVITY)
+  {
+    speaker.leadingSinceMs = -1;
+    return false;
+  }
+
+  if (active_ != 0 &&
+      speaker.activity < activityAt(speakers_[active_], timeMs) + SWITCH_MARGIN)
+  {
+    speaker.leadingSinceMs = -1;
+    return false;
+  }
+
+  if (active_ != 0 && speaker.leadingSinceMs == -1)
+  {
+    speaker.leadingSinceMs = timeMs;
+  }
+
+  if (active_ != 0 && timeMs - speaker.leadingSinceMs < SWITCH_HOLD_MS)
+  {
+    return false;
+  }
+
+  speaker.leadingSinceMs = -1;
+  active_ = sessionID;
+  return true;
+}
+
+
+bool ActiveSpeakerDetector::removeSession(uint32_t sessionID)
+{
+  speakers_.erase(sessionID);
+
+  if (sessionID == active_)
+  {
+    active_ = 0;
+    return true;
+  }
+
+  return false;
+}
+
+
+double ActiveSpeakerDetector::activityAt(const Speaker& speaker, int64_t timeMs) const
+{
+  return speaker.activity*std::exp(-(timeMs - speaker.updatedMs)/ACTIVITY_TIME_MS);
+}
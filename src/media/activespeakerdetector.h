@@ -0,0 +1,47 @@
+#pragma once
+
+#include <map>
+
+#include <stdint.h>
+
+// Finds who is speaking from the audio levels of the received streams. The
+// levels are in -dBov like in RFC 6464, 0 is the loudest and 127 silence.
+// Each stream has a speech activity which rises while its level is speech
+// and decays otherwise, also while nothing is received (DTX). Another stream
+// takes over only after it has been clearly more active for a while, so two
+// people talking at the same time do not make the speaker flap. The speaker
+// stays active through pauses until someone else speaks.
+
+class ActiveSpeakerDetector
+{
+public:
+  ActiveSpeakerDetector();
+
+  // returns true if the active speaker changed
+  bool addLevel(uint32_t sessionID, uint8_t level, int64_t timeMs);
+
+  // returns true if the active speaker changed
+  bool removeSession(uint32_t sessionID);
+
+  // 0 if nobody has spoken yet
+  uint32_t activeSpeaker() const
+  {
+    return active_;
+  }
+
+private:
+
+  struct Speaker
+  {
+    double activity = 0;
+    int64_t updatedMs = 0;
+
+    // since when this one has been more active than the speaker, -1 if not
+    int64_t leadingSinceMs = -1;
+  };
+
+  double activityAt(const Speaker& speaker, int64_t timeMs) const;
+
+  std::map<uint32_t, Speaker> speakers_;
+  uint32_t active_;
+};
@@ -308,6 +308,10 @@ bool Delivery::addMediaStream(uint32_t sessionID, DeliverySession &session,
   // This makes the uvgRTP keep the firewall open even if the other side is not sending media
   int flags = RCE_HOLEPUNCH_KEEPALIVE;
 
+  // RTCP carries the reception reports that adapt the bitrate and audio FEC,
+  // and the keyframe requests of our video decoders
+  flags |= RCE_RTCP;
+
   if (fmt == RTP_FORMAT_H264 ||
       fmt == RTP_FORMAT_H265 ||
       fmt == RTP_FORMAT_H266)
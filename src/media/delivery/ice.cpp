@@ -341,6 +341,7 @@ void ICE::updateMedia(MediaInfo& oldMedia, const MediaInfo &newMedia)
   oldMedia.encryptionKey = newMedia.encryptionKey;
 
   oldMedia.rtpMaps = newMedia.rtpMaps;
+  oldMedia.fmtpAttributes = newMedia.fmtpAttributes;
   oldMedia.flagAttributes = newMedia.flagAttributes;
   oldMedia.valueAttributes = newMedia.valueAttributes;
   oldMedia.candidates = newMedia.candidates;
@@ -10,12 +10,18 @@
 #include <QDateTime>
 #include <QDebug>
 
+#include <algorithm>
 #include <functional>
 #include <cstdio>
 
 #define RTP_HEADER_SIZE 2
 #define FU_HEADER_SIZE  1
 
+// Larger jumps in sequence numbers mean the sender has restarted and the
+// packets in between are not counted as lost (RFC 3550 A.1)
+const uint16_t MAX_DROPOUT = 3000;
+const uint16_t MAX_MISORDER = 100;
+
 static void __receiveHook(void *arg, uvg_rtp::frame::rtp_frame *frame)
 {
   if (arg && frame)
@@ -29,7 +35,11 @@ UvgRTPReceiver::UvgRTPReceiver(uint32_t sessionID, QString id, StatisticsInterfa
                                DataType type, QString media, std::shared_ptr<UvgRTPStream> stream):
   Filter(id, "RTP Receiver " + media, stats, hwResources, DT_NONE, type),
   discardUntilIntra_(false),
+  seqInitialized_(false),
   lastSeq_(0),
+  timestampInitialized_(false),
+  lastTimestamp_(0),
+  frameTicks_(0),
   sessionID_(sessionID),
   us_(stream)
 {
@@ -42,6 +52,13 @@ UvgRTPReceiver::UvgRTPReceiver(uint32_t sessionID, QString id, StatisticsInterfa
   us_->ms->install_receive_hook(this, __receiveHook);
   us_->ms->get_rtcp()->install_sender_hook(std::bind(&UvgRTPReceiver::processRTCPSenderReport,
                                                       this, std::placeholders::_1 ));
+
+  if (isVideo(output_))
+  {
+    // the decoder thread asks for the keyframe and it is sent right away
+    QObject::connect(getHWManager().get(), &ResourceAllocator::sendKeyframeRequest,
+                     this, &UvgRTPReceiver::sendKeyframeRequest, Qt::DirectConnection);
+  }
 }
 
 
@@ -73,12 +90,24 @@ void UvgRTPReceiver::receiveHook(uvg_rtp::frame::rtp_frame *frame)
     return;
   }
 
-  lastSeq_ = frame->header.seq;
+  uint16_t lost = 0;
+  if (!checkSequence(frame->header.seq, lost) && isAudio(output_))
+  {
+    // the audio of late packets has already been concealed by the decoder
+    (void)uvg_rtp::frame::dealloc_frame(frame);
+    return;
+  }
 
   std::unique_ptr<Data> received_picture = initializeData(output_, DS_REMOTE);
 
   if (!received_picture)
     return;
+
+  if (received_picture->aInfo)
+  {
+    received_picture->aInfo->lostBefore = lost;
+    received_picture->aInfo->silentBefore = checkSilence(frame->header.timestamp, lost);
+  }
   
   received_picture->creationTimestamp = QDateTime::currentMSecsSinceEpoch();
   received_picture->presentationTimestamp = received_picture->creationTimestamp;
@@ -116,6 +145,79 @@ void UvgRTPReceiver::receiveHook(uvg_rtp::frame::rtp_frame *frame)
 }
 
 
+bool UvgRTPReceiver::checkSequence(uint16_t seq, uint16_t& lost)
+{
+  lost = 0;
+
+  if (!seqInitialized_)
+  {
+    seqInitialized_ = true;
+    lastSeq_ = seq;
+    return true;
+  }
+
+  // the difference wraps around with the sequence number
+  uint16_t difference = seq - lastSeq_;
+
+  if (difference == 0 || difference > UINT16_MAX - MAX_MISORDER)
+  {
+    return false;
+  }
+
+  if (difference <= MAX_DROPOUT)
+  {
+    lost = difference - 1;
+  }
+  else
+  {
+    Logger::getLogger()->printWarning(this, "Large jump in RTP sequence number",
+                                      {"Previous", "Current"},
+                                      {QString::number(lastSeq_), QString::number(seq)});
+  }
+
+  lastSeq_ = seq;
+  return true;
+}
+
+
+uint16_t UvgRTPReceiver::checkSilence(uint32_t timestamp, uint16_t lost)
+{
+  if (!timestampInitialized_)
+  {
+    timestampInitialized_ = true;
+    lastTimestamp_ = timestamp;
+    return 0;
+  }
+
+  uint32_t step = timestamp - lastTimestamp_;
+  lastTimestamp_ = timestamp;
+
+  // the sender may have restarted its timestamps
+  if (step == 0 || step > INT32_MAX)
+  {
+    return 0;
+  }
+
+  if (lost == 0 && (frameTicks_ == 0 || step < frameTicks_))
+  {
+    frameTicks_ = step;
+  }
+
+  if (frameTicks_ == 0)
+  {
+    return 0;
+  }
+
+  uint32_t frames = step/frameTicks_;
+  if (frames <= uint32_t(lost) + 1)
+  {
+    return 0;
+  }
+
+  return uint16_t(std::min<uint32_t>(frames - lost - 1, UINT16_MAX));
+}
+
+
 void UvgRTPReceiver::processRTCPSenderReport(std::unique_ptr<uvgrtp::frame::rtcp_sender_report> sr)
 {
   //TODO: Record the newest NTP and RTP timestamps from sender report
@@ -129,19 +231,20 @@ void UvgRTPReceiver::processRTCPSenderReport(std::unique_ptr<uvgrtp::frame::rtcp
   {
     if (block.ssrc == ourSSRC)
     {
-      getHWManager()->addRTCPReport(sessionID_, outputType(), block.lost, block.jitter);
+      getHWManager()->addRTCPReport(sessionID_, outputType(), block.fraction,
+                                    block.lost, block.jitter);
 
-      QString type = "Other";
+      StatsMedia media = STATS_NO_MEDIA;
       if (isVideo(outputType()))
       {
-        type = "Video";
+        media = STATS_VIDEO;
       }
       else if (isAudio(outputType()))
       {
-        type = "Audio";
+        media = STATS_AUDIO;
       }
 
-      getStats()->addRTCPPacket(sessionID_, type,
+      getStats()->addRTCPPacket(sessionID_, media,
                                 block.fraction,
                                 block.lost,
                                 block.last_seq,
@@ -149,3 +252,20 @@ void UvgRTPReceiver::processRTCPSenderReport(std::unique_ptr<uvgrtp::frame::rtcp
     }
   }
 }
+
+
+void UvgRTPReceiver::sendKeyframeRequest(uint32_t sessionID)
+{
+  if (sessionID != sessionID_)
+  {
+    return;
+  }
+
+  uint8_t payload[KEYFRAME_APP_SIZE] = {0, 0, 0, 0};
+
+  if (us_->ms->get_rtcp()->send_app_packet(KEYFRAME_APP_NAME, KEYFRAME_APP_SUBTYPE,
+                                           KEYFRAME_APP_SIZE, payload) != RTP_OK)
+  {
+    Logger::getLogger()->printWarning(this, "Failed to send keyframe request");
+  }
+}
@@ -27,9 +27,25 @@ private:
 
   void processRTCPSenderReport(std::unique_ptr<uvgrtp::frame::rtcp_sender_report> sr);
 
+  // asks the sender for a keyframe if the request is for this session
+  void sendKeyframeRequest(uint32_t sessionID);
+
+  // sets how many packets were lost before this one. Returns false if the
+  // packet is a duplicate or arrived after newer packets.
+  bool checkSequence(uint16_t seq, uint16_t& lost);
+
+  // Returns how many frames were not sent before this one because of silence.
+  // The sequence numbers continue over a pause while the timestamp jumps.
+  uint16_t checkSilence(uint32_t timestamp, uint16_t lost);
+
   bool discardUntilIntra_;
 
+  bool seqInitialized_;
   uint16_t lastSeq_;
+
+  bool timestampInitialized_;
+  uint32_t lastTimestamp_;
+  uint32_t frameTicks_; // the shortest timestamp step seen
   uint32_t sessionID_;
 
   std::shared_ptr<UvgRTPStream> us_;
@@ -5,6 +5,7 @@
 
 #include "common.h"
 #include "settingskeys.h"
+#include "global.h"
 #include "logger.h"
 
 #include <QSettings>
@@ -12,6 +13,11 @@
 #include <QFuture>
 
 #include <functional>
+#include <cstring>
+#include <random>
+
+// Opus always uses a 48 kHz RTP clock (RFC 7587)
+const uint32_t OPUS_RTP_CLOCK = 48000;
 
 UvgRTPSender::UvgRTPSender(uint32_t sessionID, QString id, StatisticsInterface *stats,
                            std::shared_ptr<ResourceAllocator> hwResources,
@@ -22,7 +28,8 @@ UvgRTPSender::UvgRTPSender(uint32_t sessionID, QString id, StatisticsInterface *
   sessionID_(sessionID),
   rtpFlags_(RTP_NO_FLAGS),
   framerateNumerator_(0),
-  framerateDenominator_(0)
+  framerateDenominator_(0),
+  rtpTimestamp_(std::random_device{}())
 {
   Logger::getLogger()->printDebug(DEBUG_NORMAL, this, "Initializing uvgRTP sender",
                                   {"LocalSSRC", "Remote SSRC", "Sender type"},
@@ -41,6 +48,12 @@ UvgRTPSender::UvgRTPSender(uint32_t sessionID, QString id, StatisticsInterface *
     stream_->ms->configure_ctx(RCC_REMOTE_SSRC, stream_->remoteSSRC);
   }
 
+  if (input_ == DT_HEVCVIDEO)
+  {
+    stream_->ms->get_rtcp()->install_app_hook(std::bind(&UvgRTPSender::processRTCPApp,
+                                                        this, std::placeholders::_1));
+  }
+
   if (stream->runZRTP)
   {
     stream->runZRTP = false;
@@ -103,7 +116,27 @@ void UvgRTPSender::process()
   // TODO: For HEVC, make sure that the first frame we send is intra
   while (input)
   {
-    ret = stream_->ms->push_frame(std::move(input->data), input->data_size, rtpFlags_);
+    if (isAudio(input_) && input->aInfo)
+    {
+      // The timestamp advances over the frames not sent during silence so
+      // that the receiver can tell the pause from lost packets
+      uint32_t clockRate = input_ == DT_OPUSAUDIO ? OPUS_RTP_CLOCK : input->aInfo->sampleRate;
+      uint32_t frameTicks = uint64_t(clockRate)*DEFAULT_AUDIO_FRAME_US/1000000;
+
+      if (input->aInfo->sampleRate != 0 && input->aInfo->frameSamples != 0)
+      {
+        frameTicks = uint64_t(clockRate)*input->aInfo->frameSamples/input->aInfo->sampleRate;
+      }
+
+      rtpTimestamp_ += input->aInfo->silentBefore*frameTicks;
+      ret = stream_->ms->push_frame(std::move(input->data), input->data_size,
+                                    rtpTimestamp_, rtpFlags_);
+      rtpTimestamp_ += frameTicks;
+    }
+    else
+    {
+      ret = stream_->ms->push_frame(std::move(input->data), input->data_size, rtpFlags_);
+    }
 
     if (ret != RTP_OK)
     {
@@ -126,19 +159,20 @@ void UvgRTPSender::processRTCPReceiverReport(std::unique_ptr<uvgrtp::frame::rtcp
   {
     if (block.ssrc == ourSSRC)
     {
-      getHWManager()->addRTCPReport(sessionID_, inputType(), block.lost, block.jitter);
+      getHWManager()->addRTCPReport(sessionID_, inputType(), block.fraction,
+                                    block.lost, block.jitter);
 
-      QString type = "Other";
+      StatsMedia media = STATS_NO_MEDIA;
       if (isVideo(inputType()))
       {
-        type = "Video";
+        media = STATS_VIDEO;
       }
       else if (isAudio(inputType()))
       {
-        type = "Audio";
+        media = STATS_AUDIO;
       }
 
-      getStats()->addRTCPPacket(sessionID_, type,
+      getStats()->addRTCPPacket(sessionID_, media,
                                 block.fraction,
                                 block.lost,
                                 block.last_seq,
@@ -146,3 +180,12 @@ void UvgRTPSender::processRTCPReceiverReport(std::unique_ptr<uvgrtp::frame::rtcp
     }
   }
 }
+
+
+void UvgRTPSender::processRTCPApp(std::unique_ptr<uvgrtp::frame::rtcp_app_packet> app)
+{
+  if (memcmp(app->name, KEYFRAME_APP_NAME, 4) == 0)
+  {
+    getHWManager()->peerRequestsKeyframe(sessionID_);
+  }
+}
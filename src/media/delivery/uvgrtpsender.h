@@ -30,6 +30,9 @@ private:
 
   void processRTCPReceiverReport(std::unique_ptr<uvgrtp::frame::rtcp_receiver_report> rr);
 
+  // the receiver tells us that it needs a keyframe
+  void processRTCPApp(std::unique_ptr<uvgrtp::frame::rtcp_app_packet> app);
+
   std::shared_ptr<UvgRTPStream> stream_;
 
   QFutureWatcher<uvg_rtp::media_stream *> watcher_;
@@ -40,6 +43,9 @@ private:
   int32_t framerateNumerator_;
   int32_t framerateDenominator_;
 
+  // RTP timestamp of the next audio frame
+  uint32_t rtpTimestamp_;
+
 
 
   QFuture<rtp_error_t> futureRes_;
@@ -65,6 +65,12 @@ void MediaManager::init(std::shared_ptr<VideoviewFactory> viewFactory,
 
   QObject::connect(this, &MediaManager::updateAutomaticSettings,
                    fg_.get(), &FilterGraph::updateAutomaticSettings);
+
+  QObject::connect(fg_.get(), &FilterGraph::parameterSetsChanged,
+                   this, &MediaManager::parameterSetsChanged);
+
+  QObject::connect(hwResources.get(), &ResourceAllocator::activeSpeakerChanged,
+                   this, &MediaManager::activeSpeakerChanged);
 }
 
 
@@ -280,6 +286,7 @@ void MediaManager::createOutgoingMedia(uint32_t sessionID,
 
     if(remoteMedia.type == "audio")
     {
+      fg_->setAudioFrameDuration(findPacketTime(localMedia));
       fg_->sendAudioTo(sessionID, senderFilter, id);
     }
     else if(remoteMedia.type == "video")
@@ -350,6 +357,7 @@ void MediaManager::createIncomingMedia(uint32_t sessionID,
     Q_ASSERT(receiverFilter != nullptr);
     if(localMedia.type == "audio")
     {
+      fg_->setAudioFrameDuration(findPacketTime(localMedia));
       fg_->receiveAudioFrom(sessionID, receiverFilter, id);
     }
     else if(localMedia.type == "video")
@@ -357,7 +365,8 @@ void MediaManager::createIncomingMedia(uint32_t sessionID,
       Q_ASSERT(videoView);
       if (videoView != nullptr)
       {
-        fg_->receiveVideoFrom(sessionID, receiverFilter, videoView, id);
+        fg_->receiveVideoFrom(sessionID, receiverFilter, videoView, id,
+                              getParameterSets(remoteMedia));
       }
       else
       {
@@ -461,6 +470,46 @@ QString MediaManager::rtpNumberToCodec(const MediaInfo& info)
 }
 
 
+QList<QByteArray> MediaManager::getParameterSets(const MediaInfo& info)
+{
+  QList<QByteArray> parameterSets;
+
+  for (auto& rtpMap : info.rtpMaps)
+  {
+    auto parameters = info.fmtpAttributes.find(rtpMap.rtpNum);
+
+    if (rtpMap.codec != "H265" || parameters == info.fmtpAttributes.end())
+    {
+      continue;
+    }
+
+    // the order matters, because SPS refers to VPS and PPS refers to SPS
+    for (QString name : {"sprop-vps", "sprop-sps", "sprop-pps"})
+    {
+      for (auto& parameter : parameters->second)
+      {
+        if (parameter.name == name)
+        {
+          // may contain multiple comma separated parameter sets
+          for (auto& nal : parameter.value.split(","))
+          {
+            parameterSets.push_back(QByteArray::fromBase64(nal.toLatin1()));
+          }
+        }
+      }
+    }
+  }
+
+  if (!parameterSets.empty())
+  {
+    Logger::getLogger()->printNormal(this, "Found parameter sets in SDP",
+                                     "Count", QString::number(parameterSets.size()));
+  }
+
+  return parameterSets;
+}
+
+
 void MediaManager::sdpToStats(uint32_t sessionID, std::shared_ptr<SDPMessageInfo> sdp, bool local)
 {
   if (stats_)
@@ -106,6 +106,12 @@ signals:
   void updateAudioSettings();
   void updateAutomaticSettings();
 
+  // our encoder has new parameter sets (NAL units without start codes)
+  void parameterSetsChanged(QByteArray vps, QByteArray sps, QByteArray pps);
+
+  // the participant talking the most has changed, 0 if nobody talks
+  void activeSpeakerChanged(uint32_t sessionID);
+
 public slots:
   void iceSucceeded(const MediaID &id, uint32_t sessionID,
                     MediaInfo local, MediaInfo remote);
@@ -127,6 +133,9 @@ private:
 
   QString rtpNumberToCodec(const MediaInfo& info);
 
+  // sprop parameter sets of H265 from SDP, see RFC 7798 section 7.1
+  QList<QByteArray> getParameterSets(const MediaInfo& info);
+
   void sdpToStats(uint32_t sessionID, std::shared_ptr<SDPMessageInfo> sdp, bool local);
 
   QString getMediaNettype(std::shared_ptr<SDPMessageInfo> sdp, int mediaIndex);
@@ -4,6 +4,7 @@
 #include "audioframebuffer.h"
 
 #include "settingskeys.h"
+#include "common.h"
 #include "global.h"
 #include "logger.h"
 
@@ -14,11 +15,12 @@
 #include <QMediaDevices>
 
 
-AudioCaptureFilter::AudioCaptureFilter(QString id, QAudioFormat format,
+AudioCaptureFilter::AudioCaptureFilter(QString id, QAudioFormat format, uint32_t frameUs,
                                        StatisticsInterface *stats,
                                        std::shared_ptr<ResourceAllocator> hwResources):
   Filter(id, "Audio_Capture", stats, hwResources, DT_NONE, DT_RAWAUDIO),
   format_(format),
+  frameUs_(frameUs),
   audioInput_(nullptr),
   input_(nullptr),
   readBuffer_(nullptr),
@@ -47,10 +49,9 @@ bool AudioCaptureFilter::init()
     QString deviceName = settings.value(SettingsKey::audioDevice).toString();
     int deviceID = settings.value(SettingsKey::audioDeviceID).toInt();
 
-    int frame_length = 1000/AUDIO_FRAMES_PER_SECOND;
     if (settings.value(SettingsKey::audioMutingPeriod).toInt() != 0)
     {
-      mutingPeriod_ = settings.value(SettingsKey::audioMutingPeriod).toInt()/frame_length;
+      mutingPeriod_ = settings.value(SettingsKey::audioMutingPeriod).toInt()*1000/frameUs_;
     }
     Logger::getLogger()->printNormal(this, "Muting period set", "Samples to mute", QString::number(mutingPeriod_));
 
@@ -101,9 +102,23 @@ bool AudioCaptureFilter::init()
 
   Logger::getLogger()->printNormal(this, "A microphone chosen.", {"Device name"}, {info.description()});
 
-  if (!info.isFormatSupported(format_)) {
-    Logger::getLogger()->printError(this, "Audio settings not supported");
-    return false;
+  if (!info.isFormatSupported(format_))
+  {
+    // the graph resamples the rate the microphone prefers
+    QAudioFormat deviceFormat = format_;
+    deviceFormat.setSampleRate(info.preferredFormat().sampleRate());
+
+    if (!info.isFormatSupported(deviceFormat))
+    {
+      Logger::getLogger()->printError(this, "Audio settings not supported");
+      return false;
+    }
+
+    Logger::getLogger()->printWarning(this, "Microphone does not support the sample rate. "
+                                            "Capturing at its preferred rate",
+                                      {"Rates"}, {QString::number(format_.sampleRate()) + " -> " +
+                                                  QString::number(deviceFormat.sampleRate())});
+    format_ = deviceFormat;
   }
 
   if(format_.sampleRate() != -1)
@@ -127,10 +142,11 @@ void AudioCaptureFilter::createAudioInput()
 
     input_ = audioInput_->start();
 
-    int frameSize = format_.sampleRate()*format_.bytesPerFrame()/AUDIO_FRAMES_PER_SECOND;
+    int frameSize = audioFrameSamples(format_.sampleRate(), frameUs_)*format_.bytesPerFrame();
 
-    // here we input the samples to be made the right size for our application
-    buffer_ = std::make_unique<AudioFrameBuffer>(frameSize);
+    // here we input the samples to be made the right size for our application,
+    // at most half a second of them
+    buffer_ = std::make_unique<AudioFrameBuffer>(frameSize, 500000/frameUs_);
 
     createReadBuffer(audioInput_->bufferSize());
 
@@ -202,13 +218,18 @@ void AudioCaptureFilter::readMore()
     }
     else if (readData > 0)
     {
-      buffer_->inputData((uint8_t*)readBuffer_, readData);
+      if (!buffer_->inputData((uint8_t*)readBuffer_, readData))
+      {
+        Logger::getLogger()->printWarning(this, "Mic frame buffer full, dropping samples",
+                                          {"Amount"}, {QString::number(readData)});
+      }
     }
 
-    uint8_t* frame = buffer_->readFrame();
-
-    while (frame != nullptr)
+    while (buffer_->getBufferSize() > 0)
     {
+      std::unique_ptr<uint8_t[]> frame(new uint8_t[buffer_->getDesiredSize()]);
+      buffer_->readFrame(frame.get());
+
       std::unique_ptr<Data> audioFrame = initializeData(DT_RAWAUDIO, DS_LOCAL);
 
       // create audio data packet to be sent to filter graph
@@ -216,8 +237,9 @@ void AudioCaptureFilter::readMore()
       audioFrame->presentationTimestamp = audioFrame->creationTimestamp;
 
       audioFrame->data_size = buffer_->getDesiredSize();
-      audioFrame->data = std::unique_ptr<uint8_t[]>(frame);
+      audioFrame->data = std::move(frame);
       audioFrame->aInfo->sampleRate = format_.sampleRate();
+      audioFrame->aInfo->frameSamples = buffer_->getDesiredSize()/format_.bytesPerFrame();
 
       if (muteSamples_ > 0)
       {
@@ -229,8 +251,6 @@ void AudioCaptureFilter::readMore()
       //                                 {QString::number(audioFrame->data_size)});
 
       sendOutput(std::move(audioFrame));
-
-      frame = buffer_->readFrame();
     }
   }
 }
@@ -15,7 +15,7 @@ class AudioCaptureFilter : public Filter
 {
   Q_OBJECT
 public:
-  AudioCaptureFilter(QString id, QAudioFormat format,
+  AudioCaptureFilter(QString id, QAudioFormat format, uint32_t frameUs,
                      StatisticsInterface* stats,
                      std::shared_ptr<ResourceAllocator> hwResources);
   virtual ~AudioCaptureFilter();
@@ -25,6 +25,12 @@ public:
   virtual void start(); // resumes audio input
   virtual void stop(); // suspends audio input
 
+  // the format of the microphone, known after init
+  QAudioFormat format() const
+  {
+    return format_;
+  }
+
 public slots:
 
   void mute();
@@ -52,6 +58,7 @@ private:
   void destroyReadBuffer();
 
   QAudioFormat format_;
+  uint32_t frameUs_;
   QAudioSource *audioInput_;
   QIODevice *input_;
   QAudioDevice device_;
@@ -64,6 +71,7 @@ private:
 
   std::unique_ptr<AudioFrameBuffer> buffer_;
 
-  uint8_t muteSamples_;
-  uint8_t mutingPeriod_;
+  // in frames
+  uint16_t muteSamples_;
+  uint16_t mutingPeriod_;
 };
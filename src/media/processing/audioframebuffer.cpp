@@ -1,118 +1,84 @@
 #include "audioframebuffer.h"
 
+#include <algorithm>
 #include <cstring>
 
-AudioFrameBuffer::AudioFrameBuffer(uint32_t desiredFrameSize):
+AudioFrameBuffer::AudioFrameBuffer(uint32_t desiredFrameSize, uint32_t capacityFrames):
   desiredFrameSize_(desiredFrameSize),
-  readyFrames_(),
-  partialFrame_(new uint8_t [desiredFrameSize]),
-  partialFrameSize_(0)
+  capacity_(uint64_t(desiredFrameSize)*capacityFrames),
+  ring_(new uint8_t[capacity_]),
+  written_(0),
+  read_(0)
 {}
 
 
 AudioFrameBuffer::~AudioFrameBuffer()
-{
-  delete[] partialFrame_;
-  partialFrame_ = nullptr;
-  partialFrameSize_ = 0;
-
-  readyBuffer_.lock();
-  for (unsigned int i = 0; i < readyFrames_.size(); ++i)
-  {
-    delete [] readyFrames_.at(i);
-  }
-
-  readyFrames_.clear();
-  readyBuffer_.unlock();
-}
+{}
 
 
-void AudioFrameBuffer::inputData(uint8_t* data, uint32_t dataAmount)
+bool AudioFrameBuffer::inputData(const uint8_t* data, uint32_t dataAmount)
 {
-  if (data == nullptr)
+  if (data == nullptr || capacity_ == 0)
   {
-    return;
+    return false;
   }
 
-  uint8_t* totalData = data;
-  uint32_t totalDataAmount = dataAmount;
+  uint64_t written = written_.load(std::memory_order_relaxed);
+  uint64_t space = capacity_ - (written - read_.load(std::memory_order_acquire));
 
-  // Step 1: Take previous partial frame into account if it exists
-  if (partialFrameSize_ != 0)
+  bool fits = dataAmount <= space;
+  if (!fits)
   {
-    totalData = new uint8_t [partialFrameSize_ + dataAmount];
-    totalDataAmount = partialFrameSize_ + dataAmount;
-
-    memcpy(totalData,                     partialFrame_, partialFrameSize_);
-    memcpy(totalData + partialFrameSize_, data,          dataAmount);
-
-    partialFrameSize_ = 0;
+    // Reads move whole frames so the free space ends at a frame boundary and
+    // the data after the dropped part starts a new frame.
+    dataAmount = uint32_t(space);
   }
 
-  uint32_t processedData = 0;
+  uint64_t position = written%capacity_;
+  uint64_t untilEnd = std::min<uint64_t>(dataAmount, capacity_ - position);
 
-  // Step 2: Get all ready frames from the partial frame + input data
-  while (processedData + desiredFrameSize_ <= totalDataAmount)
-  {
-    addSampleToBuffer(totalData + processedData, desiredFrameSize_);
-    processedData += desiredFrameSize_;
-  }
+  memcpy(ring_.get() + position, data, untilEnd);
+  memcpy(ring_.get(), data + untilEnd, dataAmount - untilEnd);
 
-  // Step 3: Save remaining data into partial frame
-  if (processedData < totalDataAmount)
-  {
-    partialFrameSize_ = totalDataAmount - processedData;
-    memcpy(partialFrame_, totalData + processedData, partialFrameSize_);
-  }
+  written_.store(written + dataAmount, std::memory_order_release);
 
-  // totaldata is deleted if we had to allocate new memory for it because of previous data
-  if (totalDataAmount != dataAmount)
-  {
-    delete[] totalData;
-  }
+  return fits;
 }
 
 
-uint8_t *AudioFrameBuffer::readFrame()
+bool AudioFrameBuffer::readFrame(uint8_t* frame)
 {
-  uint8_t* outFrame = nullptr;
+  uint64_t read = read_.load(std::memory_order_relaxed);
 
-  readyBuffer_.lock();
-  if (!readyFrames_.empty())
+  if (written_.load(std::memory_order_acquire) - read < desiredFrameSize_)
   {
-    outFrame = readyFrames_.back();
-    readyFrames_.pop_back();
+    return false;
   }
-  readyBuffer_.unlock();
 
-  return outFrame;
+  memcpy(frame, ring_.get() + read%capacity_, desiredFrameSize_);
+  read_.store(read + desiredFrameSize_, std::memory_order_release);
+
+  return true;
 }
 
 
-void AudioFrameBuffer::changeDesiredFrameSize(uint32_t desiredSize)
+bool AudioFrameBuffer::skipFrame()
 {
-  readyBuffer_.lock();
-  readyFrames_.clear();
-  readyBuffer_.unlock();
-
-  desiredFrameSize_ = desiredSize;
+  uint64_t read = read_.load(std::memory_order_relaxed);
 
-  if (partialFrame_ != nullptr)
+  if (written_.load(std::memory_order_acquire) - read < desiredFrameSize_)
   {
-    delete [] partialFrame_;
-    partialFrameSize_ = 0;
+    return false;
   }
 
-  partialFrame_ = new uint8_t [desiredSize];
+  read_.store(read + desiredFrameSize_, std::memory_order_release);
+
+  return true;
 }
 
 
-void AudioFrameBuffer::addSampleToBuffer(uint8_t *sample, int sampleSize)
+size_t AudioFrameBuffer::getBufferSize() const
 {
-  uint8_t* new_sample = new uint8_t[sampleSize];
-  memcpy(new_sample, sample, sampleSize);
-
-  readyBuffer_.lock();
-  readyFrames_.push_front(new_sample);
-  readyBuffer_.unlock();
+  uint64_t read = read_.load(std::memory_order_acquire);
+  return size_t((written_.load(std::memory_order_acquire) - read)/desiredFrameSize_);
 }
@@ -1,52 +1,53 @@
 #pragma once
 
-#include <QMutex>
+#include <atomic>
+#include <memory>
 
-#include <deque>
+#include <stdint.h>
+#include <stddef.h>
 
 // The goal of this class is to convert arbitary size frames to desired size
-// audio frames
+// audio frames. The frames are kept in a ring allocated at construction.
+// One thread may input data while another reads frames without locks, so
+// the reads are safe in real-time audio callbacks.
 
 class AudioFrameBuffer
 {
 public:
-  AudioFrameBuffer(uint32_t desiredFrameSize);
+  AudioFrameBuffer(uint32_t desiredFrameSize, uint32_t capacityFrames);
   ~AudioFrameBuffer();
 
-  // Put any size data into frame buffer.
-  // Does not modify or delete input data.
-  void inputData(uint8_t* data, uint32_t dataAmount);
+  // Put any size data into frame buffer. Does not modify or delete input
+  // data. If the buffer is full, the data that does not fit is dropped and
+  // false is returned.
+  bool inputData(const uint8_t* data, uint32_t dataAmount);
 
-  // returns desired size frames if available. Returns nullptr if not
-  // Gives away the ownership of the returned frame. Delete with delete[]
-  uint8_t* readFrame();
+  // Copies the oldest desired size frame to frame if one is available.
+  // Returns false if not.
+  bool readFrame(uint8_t* frame);
 
-  void changeDesiredFrameSize(uint32_t desiredSize);
+  // discards the oldest frame, returns false if there was none
+  bool skipFrame();
 
   uint32_t getDesiredSize() const
   {
     return desiredFrameSize_;
   }
 
-  size_t getBufferSize()
-  {
-    return readyFrames_.size();
-  }
+  // number of whole frames ready for reading
+  size_t getBufferSize() const;
 
 private:
 
-  void addSampleToBuffer(uint8_t* sample, int sampleSize);
-
-  uint32_t desiredFrameSize_;
-
-  QMutex readyBuffer_;
-  std::deque<uint8_t*> readyFrames_;
+  const uint32_t desiredFrameSize_;
 
-  // partialFrame_ memory is reserved at the beginning, released at the end
-  // and not freed between inputs
-  uint8_t* partialFrame_;
+  // whole frames so that a frame never wraps around the end
+  const uint64_t capacity_;
+  std::unique_ptr<uint8_t[]> ring_;
 
-  // How much the partialFrame_ currently has data. Values should from 0 to
-  // desiredFrameSize_.
-  uint32_t partialFrameSize_;
+  // total bytes written and read, their position in the ring is modulo
+  // capacity. Only the input thread moves written_ and only the reading
+  // thread moves read_.
+  std::atomic<uint64_t> written_;
+  std::atomic<uint64_t> read_;
 };
@@ -0,0 +1,456 @@
+#include "audiojitterbuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// the pitch periods searched, 66 - 400 Hz
+const float MIN_LAG_MS = 2.5f;
+const float MAX_LAG_MS = 15.0f;
+
+// the coarse period search is done at a lower rate
+const uint32_t DECIMATION = 4;
+
+// how similar the periods must be for stretching to be inaudible
+const double MIN_CORRELATION = 0.6;
+
+// below this mean square the audio is silence and can be stretched anywhere
+const double SILENCE_ENERGY = 100.0*100.0;
+
+const uint32_t MAX_TARGET_MS = 150;
+
+// audio beyond this is dropped
+const uint32_t MAX_DEPTH_MS = 300;
+
+// the earliest arrival may rise this much per elapsed time so that clock drift
+// and permanent changes in delay are followed
+const double REFERENCE_RISE = 0.01;
+
+// how fast the lateness of a past spike is forgotten
+const double PEAK_DECAY_US = 5000000.0;
+
+// a longer break in arrivals starts the measurement again
+const int64_t RESYNC_US = 500000;
+
+const float LEVEL_SMOOTHING = 0.1f;
+
+// the gain of concealment after each 10 ms
+const float CONCEAL_FADE = 0.7f;
+
+
+AudioJitterBuffer::AudioJitterBuffer(uint32_t sampleRate, uint16_t channels,
+                                     uint32_t frameSamples):
+  sampleRate_(sampleRate),
+  channels_(channels),
+  frameSamples_(frameSamples),
+  frameSize_(frameSamples*channels),
+  minLag_(uint32_t(sampleRate*MIN_LAG_MS/1000)),
+  maxLag_(uint32_t(sampleRate*MAX_LAG_MS/1000)),
+  maxTarget_(sampleRate*MAX_TARGET_MS/1000),
+  maxDepth_(sampleRate*MAX_DEPTH_MS/1000),
+  input_(frameSamples*channels*sizeof(int16_t), maxDepth_/frameSamples + 1),
+  started_(false),
+  referenceUs_(0),
+  mediaSamples_(0),
+  lastArrivalUs_(0),
+  earliestTransitUs_(0),
+  peakLateUs_(0),
+  target_(frameSamples),
+  depth_(0),
+  dropped_(0),
+  work_(),
+  history_(2*maxLag_*channels, 0),
+  scratch_(maxLag_*channels, 0),
+  decimated_(2*maxLag_/DECIMATION + 1, 0),
+  averageLevel_(0),
+  silentOutput_(false),
+  concealing_(false),
+  concealGain_(0),
+  concealFade_(std::pow(CONCEAL_FADE, frameSamples*100.0f/sampleRate)),
+  concealLag_(0),
+  concealPosition_(0),
+  concealPeriod_(maxLag_*channels, 0)
+{
+  // expansion adds at most one period, so the reads never allocate
+  work_.reserve((maxDepth_ + maxLag_ + frameSamples_)*channels_);
+}
+
+
+void AudioJitterBuffer::input(const uint8_t* data, uint32_t size, int64_t arrivalUs,
+                              bool afterSilence)
+{
+  if (!input_.inputData(data, size))
+  {
+    // the output has not been reading
+    ++dropped_;
+  }
+
+  if (!started_ || afterSilence || arrivalUs - lastArrivalUs_ > RESYNC_US)
+  {
+    // the first audio after a break is the new reference
+    referenceUs_ = arrivalUs;
+    mediaSamples_ = 0;
+    earliestTransitUs_ = 0;
+    started_ = true;
+  }
+  else
+  {
+    // how much later than the media timing this arrived compared to the
+    // earliest arrival
+    int64_t transit = arrivalUs - referenceUs_ - int64_t(mediaSamples_*1000000/sampleRate_);
+    int64_t elapsed = arrivalUs - lastArrivalUs_;
+
+    earliestTransitUs_ = std::min(transit, earliestTransitUs_ + int64_t(elapsed*REFERENCE_RISE));
+    peakLateUs_ = std::max(double(transit - earliestTransitUs_),
+                           peakLateUs_*std::exp(-elapsed/PEAK_DECAY_US));
+  }
+
+  lastArrivalUs_ = arrivalUs;
+  mediaSamples_ += size/(sizeof(int16_t)*channels_);
+
+  // the buffer must cover the latest arrivals in addition to the frame being read
+  uint32_t target = frameSamples_ + uint32_t(peakLateUs_*sampleRate_/1000000);
+  target_ = std::min(target, maxTarget_);
+}
+
+
+AudioFrameType AudioJitterBuffer::readFrame(int16_t* output)
+{
+  pullInput();
+
+  if (work_.size() < frameSize_)
+  {
+    averageLevel_ -= averageLevel_*LEVEL_SMOOTHING;
+    depth_ = uint32_t(work_.size()/channels_);
+
+    if (silentOutput_ && !concealing_)
+    {
+      // nothing to conceal during a pause
+      std::fill(output, output + frameSize_, 0);
+      updateHistory(output);
+      return AUDIO_FRAME_PAUSED;
+    }
+
+    conceal(output);
+    return AUDIO_FRAME_CONCEALED;
+  }
+
+  AudioFrameType type = AUDIO_FRAME_NORMAL;
+
+  float level = float((work_.size() - frameSize_)/channels_);
+  averageLevel_ += (level - averageLevel_)*LEVEL_SMOOTHING;
+
+  float target = float(target_);
+  if (averageLevel_ > target + frameSamples_/2.0f)
+  {
+    if (compress())
+    {
+      type = AUDIO_FRAME_COMPRESSED;
+    }
+  }
+  else if (averageLevel_ + frameSamples_/2.0f < target)
+  {
+    if (expand())
+    {
+      type = AUDIO_FRAME_EXPANDED;
+    }
+  }
+
+  memcpy(output, work_.data(), frameSize_*sizeof(int16_t));
+  work_.erase(work_.begin(), work_.begin() + frameSize_);
+
+  if (concealing_)
+  {
+    endConcealment(output);
+  }
+
+  silentOutput_ = isSilent(output);
+  updateHistory(output);
+  depth_ = uint32_t(work_.size()/channels_);
+  return type;
+}
+
+
+bool AudioJitterBuffer::aboveTarget()
+{
+  pullInput();
+  return work_.size() >= frameSize_ + target_*channels_;
+}
+
+
+uint32_t AudioJitterBuffer::depthMs() const
+{
+  return toMs(depth_);
+}
+
+
+uint32_t AudioJitterBuffer::targetMs() const
+{
+  return toMs(target_);
+}
+
+
+void AudioJitterBuffer::pullInput()
+{
+  while (input_.getBufferSize() > 0)
+  {
+    if (work_.size() + frameSize_ > maxDepth_*channels_)
+    {
+      // far too much audio, drop the oldest
+      work_.erase(work_.begin(), work_.begin() + frameSize_);
+      averageLevel_ -= frameSamples_;
+      ++dropped_;
+    }
+
+    // within the reserved capacity
+    size_t end = work_.size();
+    work_.resize(end + frameSize_);
+    input_.readFrame((uint8_t*)&work_[end]);
+  }
+}
+
+
+uint32_t AudioJitterBuffer::findPeriod(const int16_t* samples, uint32_t length)
+{
+  uint32_t maxLag = std::min(maxLag_, length/2);
+  if (maxLag < minLag_ || maxLag < DECIMATION)
+  {
+    return 0;
+  }
+
+  // coarse search from downmixed and decimated audio
+  uint32_t decimatedLength = 2*maxLag/DECIMATION;
+  for (uint32_t i = 0; i < decimatedLength; ++i)
+  {
+    int32_t sum = 0;
+    const int16_t* in = samples + i*DECIMATION*channels_;
+    for (uint32_t j = 0; j < DECIMATION*channels_; ++j)
+    {
+      sum += in[j];
+    }
+    decimated_[i] = float(sum);
+  }
+
+  uint32_t window = maxLag/DECIMATION;
+  double energy = 0;
+  for (uint32_t j = 0; j < window; ++j)
+  {
+    energy += double(decimated_[j])*decimated_[j];
+  }
+
+  uint32_t coarseLag = std::max(1u, minLag_/DECIMATION);
+  double bestCorrelation = -2.0;
+  for (uint32_t lag = coarseLag; lag <= window; ++lag)
+  {
+    double correlation = 0;
+    double lagEnergy = 0;
+    for (uint32_t j = 0; j < window; ++j)
+    {
+      correlation += double(decimated_[j])*decimated_[j + lag];
+      lagEnergy += double(decimated_[j + lag])*decimated_[j + lag];
+    }
+
+    correlation /= std::sqrt(energy*lagEnergy + 1.0);
+    if (correlation > bestCorrelation)
+    {
+      bestCorrelation = correlation;
+      coarseLag = lag;
+    }
+  }
+
+  // refine at the full rate around the coarse result
+  auto mono = [this, samples](uint32_t i)
+  {
+    int32_t sum = 0;
+    for (uint16_t c = 0; c < channels_; ++c)
+    {
+      sum += samples[i*channels_ + c];
+    }
+    return double(sum);
+  };
+
+  uint32_t first = std::max(minLag_, coarseLag*DECIMATION - (DECIMATION - 1));
+  uint32_t last = std::min(maxLag, coarseLag*DECIMATION + (DECIMATION - 1));
+
+  energy = 0;
+  for (uint32_t j = 0; j < maxLag; ++j)
+  {
+    energy += mono(j)*mono(j);
+  }
+
+  uint32_t bestLag = first;
+  bestCorrelation = -2.0;
+  for (uint32_t lag = first; lag <= last; ++lag)
+  {
+    double correlation = 0;
+    double lagEnergy = 0;
+    for (uint32_t j = 0; j < maxLag; ++j)
+    {
+      double lagged = mono(j + lag);
+      correlation += mono(j)*lagged;
+      lagEnergy += lagged*lagged;
+    }
+
+    correlation /= std::sqrt(energy*lagEnergy + 1.0);
+    if (correlation > bestCorrelation)
+    {
+      bestCorrelation = correlation;
+      bestLag = lag;
+    }
+  }
+
+  if (energy/maxLag/(channels_*channels_) < SILENCE_ENERGY)
+  {
+    return bestLag;
+  }
+
+  if (bestCorrelation < MIN_CORRELATION)
+  {
+    return 0;
+  }
+
+  return bestLag;
+}
+
+
+bool AudioJitterBuffer::compress()
+{
+  // the frame being read must remain after the period has been removed
+  uint32_t lag = findPeriod(work_.data(), uint32_t((work_.size() - frameSize_)/channels_));
+  if (lag == 0)
+  {
+    return false;
+  }
+
+  // periods A B become one period fading from A to B
+  uint32_t size = lag*channels_;
+  int16_t* a = work_.data();
+  const int16_t* b = a + size;
+  for (uint32_t i = 0; i < lag; ++i)
+  {
+    float weight = float(i)/lag;
+    for (uint16_t c = 0; c < channels_; ++c)
+    {
+      uint32_t index = i*channels_ + c;
+      a[index] = int16_t(std::lrint(a[index]*(1.0f - weight) + b[index]*weight));
+    }
+  }
+
+  work_.erase(work_.begin() + size, work_.begin() + 2*size);
+  averageLevel_ -= lag;
+  return true;
+}
+
+
+bool AudioJitterBuffer::expand()
+{
+  uint32_t lag = findPeriod(work_.data(), uint32_t(work_.size()/channels_));
+  if (lag == 0)
+  {
+    return false;
+  }
+
+  // periods A B become A, B fading to A, B
+  uint32_t size = lag*channels_;
+  const int16_t* a = work_.data();
+  const int16_t* b = a + size;
+  for (uint32_t i = 0; i < lag; ++i)
+  {
+    float weight = float(i)/lag;
+    for (uint16_t c = 0; c < channels_; ++c)
+    {
+      uint32_t index = i*channels_ + c;
+      scratch_[index] = int16_t(std::lrint(b[index]*(1.0f - weight) + a[index]*weight));
+    }
+  }
+
+  work_.insert(work_.begin() + size, scratch_.begin(), scratch_.begin() + size);
+  averageLevel_ += lag;
+  return true;
+}
+
+
+void AudioJitterBuffer::conceal(int16_t* output)
+{
+  if (!concealing_)
+  {
+    // repeat the latest period of output
+    concealLag_ = findPeriod(history_.data(), uint32_t(history_.size()/channels_));
+    if (concealLag_ == 0)
+    {
+      concealLag_ = maxLag_;
+    }
+
+    std::copy(history_.end() - concealLag_*channels_, history_.end(), concealPeriod_.begin());
+    concealPosition_ = 0;
+    concealGain_ = 1.0f;
+    concealing_ = true;
+  }
+
+  for (uint32_t i = 0; i < frameSamples_; ++i)
+  {
+    float gain = concealGain_*(1.0f - (1.0f - concealFade_)*i/frameSamples_);
+    const int16_t* period = concealPeriod_.data() + (concealPosition_%concealLag_)*channels_;
+    for (uint16_t c = 0; c < channels_; ++c)
+    {
+      output[i*channels_ + c] = int16_t(std::lrint(period[c]*gain));
+    }
+    ++concealPosition_;
+  }
+
+  concealGain_ *= concealFade_;
+  updateHistory(output);
+}
+
+
+void AudioJitterBuffer::endConcealment(int16_t* output)
+{
+  uint32_t length = std::min(concealLag_, frameSamples_);
+  for (uint32_t i = 0; i < length; ++i)
+  {
+    float weight = float(i)/length;
+    const int16_t* period = concealPeriod_.data() + (concealPosition_%concealLag_)*channels_;
+    for (uint16_t c = 0; c < channels_; ++c)
+    {
+      uint32_t index = i*channels_ + c;
+      output[index] = int16_t(std::lrint(output[index]*weight +
+                                         period[c]*concealGain_*(1.0f - weight)));
+    }
+    ++concealPosition_;
+  }
+
+  concealing_ = false;
+}
+
+
+void AudioJitterBuffer::updateHistory(const int16_t* output)
+{
+  if (frameSize_ >= history_.size())
+  {
+    memcpy(history_.data(), output + frameSize_ - history_.size(),
+           history_.size()*sizeof(int16_t));
+    return;
+  }
+
+  memmove(history_.data(), history_.data() + frameSize_,
+          (history_.size() - frameSize_)*sizeof(int16_t));
+  memcpy(history_.data() + history_.size() - frameSize_, output, frameSize_*sizeof(int16_t));
+}
+
+
+bool AudioJitterBuffer::isSilent(const int16_t* samples) const
+{
+  double energy = 0;
+  for (uint32_t i = 0; i < frameSize_; ++i)
+  {
+    energy += double(samples[i])*samples[i];
+  }
+
+  return energy/frameSize_ < SILENCE_ENERGY;
+}
+
+
+uint32_t AudioJitterBuffer::toMs(uint32_t samples) const
+{
+  return uint32_t(uint64_t(samples)*1000/sampleRate_);
+}
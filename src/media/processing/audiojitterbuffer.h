@@ -0,0 +1,128 @@
+#pragma once
+
+#include "audioframebuffer.h"
+
+#include <atomic>
+#include <vector>
+
+#include <stdint.h>
+
+// Adaptive jitter buffer for the audio output. The depth it aims for follows
+// how late the audio has been arriving, and the buffer is shrunk or grown
+// towards it by time-stretching (WSOLA) one pitch period at a time so the
+// changes are not heard as clicks. If nothing has arrived in time, the latest
+// pitch period is repeated while it fades to silence. If the audio was silent
+// before running out, the sender has paused (DTX) and silence is played
+// instead until it continues.
+//
+// Handles 16-bit interleaved samples. Input comes from one thread and the
+// frames are read by the audio output thread.
+
+enum AudioFrameType {AUDIO_FRAME_NORMAL, AUDIO_FRAME_EXPANDED,
+                     AUDIO_FRAME_COMPRESSED, AUDIO_FRAME_CONCEALED,
+                     AUDIO_FRAME_PAUSED};
+
+class AudioJitterBuffer
+{
+public:
+  // frameSamples is the size of output frames per channel
+  AudioJitterBuffer(uint32_t sampleRate, uint16_t channels, uint32_t frameSamples);
+
+  // Arrival is a monotonic time in microseconds. afterSilence tells that the
+  // sender paused before this (DTX), so the gap is not counted as lateness.
+  void input(const uint8_t* data, uint32_t size, int64_t arrivalUs,
+             bool afterSilence = false);
+
+  // writes one frame to output and tells how it was made
+  AudioFrameType readFrame(int16_t* output);
+
+  // whether more than the target depth is buffered, so that another frame
+  // can be read without reducing the buffer too much
+  bool aboveTarget();
+
+  // size of output frames in bytes
+  uint32_t getFrameSize() const
+  {
+    return frameSize_*sizeof(int16_t);
+  }
+
+  // the depth after the latest read
+  uint32_t depthMs() const;
+  uint32_t targetMs() const;
+
+  // frames dropped because the buffer was full
+  uint64_t droppedFrames() const
+  {
+    return dropped_;
+  }
+
+private:
+
+  // moves the arrived frames to the work buffer
+  void pullInput();
+
+  // the pitch period in the beginning of samples, 0 if there is no clear period
+  uint32_t findPeriod(const int16_t* samples, uint32_t length);
+
+  // remove or add one pitch period at the start of the work buffer
+  bool compress();
+  bool expand();
+
+  void conceal(int16_t* output);
+
+  // fades from the concealment to the output after a loss
+  void endConcealment(int16_t* output);
+
+  void updateHistory(const int16_t* output);
+
+  // whether the frame is quiet enough to be the background noise of a pause
+  bool isSilent(const int16_t* samples) const;
+
+  uint32_t toMs(uint32_t samples) const;
+
+  const uint32_t sampleRate_;
+  const uint16_t channels_;
+  const uint32_t frameSamples_; // per channel
+  const uint32_t frameSize_;    // all channels
+
+  // per channel
+  const uint32_t minLag_;
+  const uint32_t maxLag_;
+  const uint32_t maxTarget_;
+  const uint32_t maxDepth_;
+
+  AudioFrameBuffer input_;
+
+  // only used by the input thread
+  bool started_;
+  int64_t referenceUs_;
+  uint64_t mediaSamples_; // since the reference
+  int64_t lastArrivalUs_;
+  int64_t earliestTransitUs_;
+  double peakLateUs_;
+
+  // per channel
+  std::atomic<uint32_t> target_;
+  std::atomic<uint32_t> depth_;
+  std::atomic<uint64_t> dropped_;
+
+  // only used by the reading thread
+  std::vector<int16_t> work_;
+  std::vector<int16_t> history_;
+  std::vector<int16_t> scratch_;
+  std::vector<float> decimated_;
+
+  // buffer level after reads, smoothed so that the arrival pattern of frames
+  // does not trigger stretching
+  float averageLevel_;
+
+  // the latest frame read was silent, so running out of audio is a pause
+  bool silentOutput_;
+
+  bool concealing_;
+  float concealGain_;
+  float concealFade_;
+  uint32_t concealLag_;
+  uint32_t concealPosition_;
+  std::vector<int16_t> concealPeriod_;
+};
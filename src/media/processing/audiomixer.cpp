@@ -1,134 +1,275 @@
 #include "audiomixer.h"
 
 #include "common.h"
-#include "global.h"
 #include "logger.h"
 
 #include <QString>
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
 
-const unsigned int MAX_MIX_BUFFER = AUDIO_FRAMES_PER_SECOND/5;
 
+// Frames of one input beyond this are dropped to limit the latency
+const uint32_t MAX_MIX_BUFFER_US = 40000;
 
-AudioMixer::AudioMixer():
-  inputs_(0),
+// How long a due frame waits for late inputs. Each frame that still comes
+// too late makes the frames due a little later.
+const int64_t MIX_GRACE_US = 5000;
+const int64_t LATE_DELAY_US = 1000;
+
+// Only the loudest inputs are mixed so that the background noise of the
+// others does not add up. Quieter inputs than this are only background noise.
+const size_t MAX_MIXED_INPUTS = 3;
+const uint8_t QUIETEST_MIXED_LEVEL = 70;
+
+// how long an input stays in the mix after it was last among the loudest
+const int64_t MIX_HOLD_US = 500000;
+
+
+AudioMixer::AudioMixer(uint32_t frameUs):
   mixingMutex_(),
-  mixingBuffer_()
+  mixingBuffer_(),
+  mixMinusSinks_(),
+  clock_(frameUs, MIX_GRACE_US),
+  maxMixBuffer_(std::max(MAX_MIX_BUFFER_US/frameUs, 2u)),
+  selector_(MAX_MIXED_INPUTS, QUIETEST_MIXED_LEVEL, frameUs, MIX_HOLD_US),
+  sum_(),
+  ids_(),
+  levels_()
 {}
 
 
-std::unique_ptr<Data> AudioMixer::mixAudio(std::unique_ptr<Data> input,
-                                           std::unique_ptr<Data> potentialOutput,
-                                           uint32_t sessionID)
+void AudioMixer::addInput(uint32_t sessionID)
 {
   mixingMutex_.lock();
+  mixingBuffer_[sessionID];
+  mixingMutex_.unlock();
+}
 
-  // make sure the buffer exists for this sessionID
-  if (mixingBuffer_.find(sessionID) == mixingBuffer_.end())
+
+void AudioMixer::removeInput(uint32_t sessionID)
+{
+  mixingMutex_.lock();
+  mixingBuffer_.erase(sessionID);
+  selector_.removeInput(sessionID);
+
+  if (mixingBuffer_.empty())
   {
-    mixingBuffer_[sessionID] = std::deque<std::unique_ptr<Data>>();
+    clock_.reset();
   }
+  mixingMutex_.unlock();
+}
 
-  // store size before moving sample to buffer
-  uint32_t data_size = input->data_size;
 
-  // add new sample to its buffer
-  mixingBuffer_[sessionID].push_back(std::move(input));
+void AudioMixer::setMixMinusSink(uint32_t sessionID,
+                                 std::function<void(std::unique_ptr<int16_t[]>, uint32_t)> sink)
+{
+  mixingMutex_.lock();
+  mixMinusSinks_[sessionID] = sink;
+  mixingMutex_.unlock();
+}
 
-  // check if all buffers have a sample we can mix
-  unsigned int samples = 0;
-  for (auto& buffer : mixingBuffer_)
-  {
-    if (!buffer.second.empty())
-    {
-      ++samples;
-    }
-  }
 
-  // if all inputs have provided a sample for mixing
-  if (samples == inputs_)
+void AudioMixer::removeMixMinusSink(uint32_t sessionID)
+{
+  mixingMutex_.lock();
+  mixMinusSinks_.erase(sessionID);
+  mixingMutex_.unlock();
+}
+
+
+void AudioMixer::mixAudio(std::unique_ptr<Data> input, uint32_t sessionID,
+                          std::function<void(std::unique_ptr<Data>)> output)
+{
+  mixingMutex_.lock();
+
+  MixerInput& mixerInput = mixingBuffer_[sessionID];
+
+  if (mixerInput.backlog.arrived())
   {
-    potentialOutput->data = doMixing(data_size);
+    // its place in the mix was already filled with silence
+    clock_.delay(LATE_DELAY_US);
     mixingMutex_.unlock();
-    return std::move(potentialOutput);
+    return;
   }
-  else if (mixingBuffer_.at(sessionID).size() >= MAX_MIX_BUFFER)
+
+  mixerInput.frames.push_back(std::move(input));
+
+  if (mixerInput.frames.size() > maxMixBuffer_)
   {
-    Logger::getLogger()->printWarning(this, "Too many samples from one source and not enough from others. "
-                                            "Forced mixing to avoid latency",
-                                      "Buffer status", QString::number(mixingBuffer_.at(sessionID).size()) + "/" +
-                                                         QString::number(MAX_MIX_BUFFER));
+    Logger::getLogger()->printWarning(this, "Too many samples from one source. "
+                                            "Dropping the oldest to avoid latency",
+                                      "Buffer status", QString::number(mixerInput.frames.size()) + "/" +
+                                                         QString::number(maxMixBuffer_));
+    mixerInput.frames.pop_front();
+  }
 
-    potentialOutput->data = doMixing(data_size);
-    mixingMutex_.unlock();
-    return std::move(potentialOutput);
+  int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+  // Frames are given forward while holding the lock so that they stay in
+  // order. Giving them forward only queues them to the next filter.
+  while (frameDue(now))
+  {
+    std::unique_ptr<Data> mixed = mixFrame();
+    if (mixed != nullptr)
+    {
+      output(std::move(mixed));
+    }
   }
 
   mixingMutex_.unlock();
-
-  return std::unique_ptr<Data> (nullptr);
 }
 
 
-std::unique_ptr<uchar[]> AudioMixer::doMixing(uint32_t frameSize)
+bool AudioMixer::frameDue(int64_t nowUs)
 {
-  // don't do mixing if we have only one stream.
-  if (mixingBuffer_.size() == 1)
+  bool anyFrames = false;
+  bool allFrames = true;
+
+  for (auto& input : mixingBuffer_)
   {
-    if (!mixingBuffer_.begin()->second.empty())
+    if (input.second.frames.empty())
     {
-    std::unique_ptr<uchar[]> oneSample =
-        std::move(mixingBuffer_.begin()->second.front()->data);
-    mixingBuffer_.begin()->second.pop_front();
-    mixingBuffer_.clear();
-    return oneSample;
+      allFrames = false;
     }
     else
     {
-      Logger::getLogger()->printProgramError(this, "Tried to mix without anything to mix");
-      return nullptr;
+      anyFrames = true;
     }
   }
 
-  std::unique_ptr<uchar[]> result =
-      std::unique_ptr<uint8_t[]>(new uint8_t[frameSize]);
-  int16_t * output_ptr = (int16_t*)result.get();
+  if (allFrames && anyFrames)
+  {
+    clock_.mixedEarly(nowUs);
+    return true;
+  }
 
-  for (unsigned int i = 0; i < frameSize/2; ++i)
+  return anyFrames && clock_.due(nowUs);
+}
+
+
+std::unique_ptr<Data> AudioMixer::mixFrame()
+{
+  // don't do mixing if we have only one stream.
+  if (mixingBuffer_.size() == 1 && mixMinusSinks_.empty())
   {
-    int32_t sum = 0;
+    std::unique_ptr<Data> oneSample = std::move(mixingBuffer_.begin()->second.frames.front());
+    mixingBuffer_.begin()->second.frames.pop_front();
+    return oneSample;
+  }
 
-    // This is in my understanding the correct way to do audio mixing.
-    // Just add them up and divide by number of participants
-    // the level should be corrected with Speex AGC
-    for (auto& buffer : mixingBuffer_)
+  uint32_t frameSize = 0;
+  for (auto& input : mixingBuffer_)
+  {
+    std::deque<std::unique_ptr<Data>>& frames = input.second.frames;
+    if (!frames.empty())
     {
-      if (!buffer.second.empty())
+      if (frameSize == 0)
       {
-        sum += *((int16_t*)buffer.second.front()->data.get() + i);
+        frameSize = frames.front()->data_size;
+      }
+      else if (frames.front()->data_size != frameSize)
+      {
+        Logger::getLogger()->printWarning(this, "Audio frame size differs from other inputs. Not mixing it",
+                                          "Frame size", QString::number(frames.front()->data_size));
+        frames.pop_front();
       }
     }
+  }
 
-    sum = sum/inputs_;
+  ids_.clear();
+  levels_.clear();
+  for (auto& input : mixingBuffer_)
+  {
+    ids_.push_back(input.first);
 
-    // round correctly
-    if (sum%inputs_ >= inputs_/2)
+    std::deque<std::unique_ptr<Data>>& frames = input.second.frames;
+    if (frames.empty())
+    {
+      levels_.push_back(UINT8_MAX);
+    }
+    else
     {
-      ++sum;
+      levels_.push_back(frames.front()->aInfo ? frames.front()->aInfo->level : 0);
     }
+  }
+
+  std::vector<bool> mixed = selector_.select(ids_, levels_);
 
-    *output_ptr = (int16_t)sum;
-    ++output_ptr;
+  uint32_t samples = frameSize/sizeof(int16_t);
+  const MixingKernels& kernels = get_mixing_kernels();
+
+  sum_.assign(samples, 0);
+  size_t index = 0;
+  for (auto& input : mixingBuffer_)
+  {
+    if (mixed[index] && !input.second.frames.empty())
+    {
+      kernels.accumulate_samples(sum_.data(), (int16_t*)input.second.frames.front()->data.get(), samples);
+    }
+    ++index;
   }
 
-  // remove the samples that were mixed
-  for (auto& buffer : mixingBuffer_)
+  std::unique_ptr<uchar[]> mix(new uchar[frameSize]);
+  kernels.saturate_mix(sum_.data(), nullptr, (int16_t*)mix.get(), samples);
+
+  for (auto& sink : mixMinusSinks_)
   {
-    if (!buffer.second.empty())
+    const int16_t* own = nullptr;
+
+    auto input = mixingBuffer_.find(sink.first);
+    if (input != mixingBuffer_.end() && mixed[std::distance(mixingBuffer_.begin(), input)] &&
+        !input->second.frames.empty())
     {
-      buffer.second.pop_front();
+      own = (int16_t*)input->second.frames.front()->data.get();
     }
+
+    std::unique_ptr<int16_t[]> mixMinus(new int16_t[samples]);
+    kernels.saturate_mix(sum_.data(), own, mixMinus.get(), samples);
+    sink.second(std::move(mixMinus), samples);
+  }
+
+  // The mix follows a pause only if all the mixed inputs paused (DTX). An
+  // input that starts talking while others talk does not pause the mix.
+  uint16_t silentBefore = UINT16_MAX;
+
+  // remove the samples that were mixed, the first one carries the mix forward
+  std::unique_ptr<Data> output = nullptr;
+  for (auto& input : mixingBuffer_)
+  {
+    std::deque<std::unique_ptr<Data>>& frames = input.second.frames;
+    bool hadFrame = !frames.empty();
+
+    if (hadFrame)
+    {
+      if (frames.front()->aInfo)
+      {
+        silentBefore = std::min(silentBefore, frames.front()->aInfo->silentBefore);
+      }
+
+      if (output == nullptr)
+      {
+        output = std::move(frames.front());
+      }
+      frames.pop_front();
+    }
+
+    for (size_t drop = input.second.backlog.mixed(hadFrame, frames.size());
+         drop > 0 && !frames.empty(); --drop)
+    {
+      frames.pop_front();
+    }
+  }
+
+  output->data = std::move(mix);
+  output->data_size = frameSize;
+
+  if (output->aInfo)
+  {
+    output->aInfo->silentBefore = silentBefore;
   }
 
-  return result;
+  return output;
 }
@@ -1,48 +1,78 @@
 #pragma once
 
 #include "filter.h"
+#include "audiomixing.h"
 
 #include <QMutex>
 #include <QObject>
 
 #include <map>
 #include <deque>
+#include <vector>
+#include <functional>
 
 #include <memory>
 
 struct Data;
 
-// Mixes multiple audio tracks into one
+// Mixes multiple audio tracks into one. A frame is mixed as soon as every
+// input has one, or otherwise when it is due on the playback clock. Inputs
+// without a frame are silent in that mix so one late participant does not
+// delay the others. Only the few loudest inputs are mixed and a stream stays
+// in the mix for a while after it was last among the loudest.
 
 class AudioMixer : public QObject
 {
   Q_OBJECT
 public:
-  AudioMixer();
+  // the inputs are in frames of frameUs, the decoders make sure of that
+  AudioMixer(uint32_t frameUs);
 
-  // TODO: This should take into account different sizes of audio frames for
-  // compatability with other applications
+  // Queues the frame of this session and gives output the mixed frames that
+  // are due. The output is called in the order of the frames.
+  void mixAudio(std::unique_ptr<Data> input, uint32_t sessionID,
+                std::function<void(std::unique_ptr<Data>)> output);
 
-  std::unique_ptr<Data> mixAudio(std::unique_ptr<Data> input,
-                                 std::unique_ptr<Data> potentialOutput,
-                                    uint32_t sessionID);
+  void addInput(uint32_t sessionID);
+  void removeInput(uint32_t sessionID);
 
-  void addInput()
-  {
-    ++inputs_;
-  }
-
-  void removeInput()
-  {
-    --inputs_;
-  }
+  // Gives the sink the mix without this session's own audio each time a
+  // frame is mixed. Meant for relaying the conference to the participants.
+  void setMixMinusSink(uint32_t sessionID,
+                       std::function<void(std::unique_ptr<int16_t[]> frame, uint32_t samples)> sink);
+  void removeMixMinusSink(uint32_t sessionID);
 
 private:
 
-  std::unique_ptr<uchar[]> doMixing(uint32_t frameSize);
+  struct MixerInput
+  {
+    std::deque<std::unique_ptr<Data>> frames;
+    MixingBacklog backlog;
+  };
+
+  // returns true and advances the clock if a frame should be mixed now
+  bool frameDue(int64_t nowUs);
 
-  int32_t inputs_;
+  std::unique_ptr<Data> mixFrame();
 
   QMutex mixingMutex_;
-  std::map<uint32_t, std::deque<std::unique_ptr<Data>>> mixingBuffer_;
+  std::map<uint32_t, MixerInput> mixingBuffer_;
+
+  std::map<uint32_t, std::function<void(std::unique_ptr<int16_t[]>, uint32_t)>> mixMinusSinks_;
+
+  MixingClock clock_;
+
+  // frames of one input beyond this are dropped
+  unsigned int maxMixBuffer_;
+
+  // chooses the loudest inputs to mix
+  MixSelector selector_;
+
+  // 32-bit sum of the inputs of one frame
+  std::vector<int32_t> sum_;
+
+  // sessions and levels of the frames being mixed, UINT8_MAX for inputs
+  // without a frame
+  std::vector<uint32_t> ids_;
+  std::vector<uint8_t> levels_;
 };
@@ -1,7 +1,9 @@
 #include "audiomixerfilter.h"
 
 #include "audiomixer.h"
+#include "audiomixing.h"
 
+#include "media/resourceallocator.h"
 #include "statisticsinterface.h"
 #include "common.h"
 #include "logger.h"
@@ -25,7 +27,7 @@ AudioMixerFilter::~AudioMixerFilter()
 
 void AudioMixerFilter::start()
 {
-  mixer_->addInput();
+  mixer_->addInput(sessionID_);
   Filter::start();
 }
 
@@ -33,7 +35,7 @@ void AudioMixerFilter::start()
 void AudioMixerFilter::stop()
 {
   Filter::stop();
-  mixer_->removeInput();
+  mixer_->removeInput(sessionID_);
 }
 
 
@@ -52,23 +54,24 @@ void AudioMixerFilter::process()
     // Add audio delay to statistics
     int64_t delay = QDateTime::currentMSecsSinceEpoch() - input->creationTimestamp;
     
-    stats_->totalDelay(sessionID_, "Audio", delay);
-    //stats_->decodingDelay("Audio", delay);
+    stats_->totalDelay(sessionID_, STATS_AUDIO, delay);
+    //stats_->decodingDelay(STATS_AUDIO, delay);
 
-    if (mixer_)
-    {
-      std::unique_ptr<Data> potentialOutput =
-          std::unique_ptr<Data> (shallowDataCopy(input.get()));
+    uint8_t level = audio_level((int16_t*)input->data.get(), input->data_size/sizeof(int16_t));
+    getHWManager()->addAudioLevel(sessionID_, level);
 
-      potentialOutput->data_size = input->data_size;
-
-      std::unique_ptr<Data> output = mixer_->mixAudio(std::move(input), std::move(potentialOutput), sessionID_);
+    if (input->aInfo)
+    {
+      input->aInfo->level = level;
+    }
 
-      // mixer only provides output if the mixing happens
-      if (output != nullptr && output->data != nullptr)
+    if (mixer_)
+    {
+      // mixer only provides output when a mixed frame is due
+      mixer_->mixAudio(std::move(input), sessionID_, [this](std::unique_ptr<Data> output)
       {
         sendOutput(std::move(output));
-      }
+      });
     }
     else
     {
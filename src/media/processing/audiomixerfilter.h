@@ -10,7 +10,8 @@ class StatisticsInterface;
 
 // This filter handles the mixing of audio streams. The mixing is done having
 // a central mixer that outputs frames. All of the mixer filters connected to
-// same mixer should also be connected to same output
+// same mixer should also be connected to same output. The mixed frames are
+// sent by whichever filter gives the mixer a frame when a mix is due.
 
 class AudioMixerFilter : public Filter
 {
@@ -0,0 +1,361 @@
+#include "audiomixing.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+
+// The kernels are compiled for their instruction set regardless of build flags
+// and selected at runtime based on what the CPU supports.
+#if defined(__GNUC__) || defined(__clang__)
+  #define TARGET_AVX2   __attribute__((target("avx2")))
+#else
+  #define TARGET_AVX2
+#endif
+
+// The clock restarts when it is this many frames late. Until then the missed
+// frames are mixed as soon as possible.
+const int64_t MAX_CLOCK_LAG_FRAMES = 5;
+
+// how many mixes the backlog of an input must last before it is dropped
+const int BACKLOG_WINDOW = 10;
+
+// An input missing from more mixes than this has paused instead of being late
+const int MAX_LATE_FRAMES = 4;
+
+// how fast the smoothed level of an input falls when it gets quieter
+const float LEVEL_RELEASE_DB_PER_SECOND = 20.0f;
+
+const uint8_t SILENT_LEVEL = 127;
+
+
+void accumulate_samples_c(int32_t* sum, const int16_t* samples, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    sum[i] += samples[i];
+  }
+}
+
+
+TARGET_AVX2 void accumulate_samples_avx2(int32_t* sum, const int16_t* samples, size_t count)
+{
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16)
+  {
+    __m256i input = _mm256_loadu_si256((const __m256i*)&samples[i]);
+    __m256i low  = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(input));
+    __m256i high = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(input, 1));
+
+    _mm256_storeu_si256((__m256i*)&sum[i],
+                        _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)&sum[i]), low));
+    _mm256_storeu_si256((__m256i*)&sum[i + 8],
+                        _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)&sum[i + 8]), high));
+  }
+
+  accumulate_samples_c(sum + i, samples + i, count - i);
+}
+
+
+void saturate_mix_c(const int32_t* sum, const int16_t* minus, int16_t* output, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    int32_t sample = sum[i];
+    if (minus)
+    {
+      sample -= minus[i];
+    }
+
+    output[i] = (int16_t)std::min<int32_t>(std::max<int32_t>(sample, INT16_MIN), INT16_MAX);
+  }
+}
+
+
+TARGET_AVX2 void saturate_mix_avx2(const int32_t* sum, const int16_t* minus, int16_t* output, size_t count)
+{
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16)
+  {
+    __m256i low  = _mm256_loadu_si256((const __m256i*)&sum[i]);
+    __m256i high = _mm256_loadu_si256((const __m256i*)&sum[i + 8]);
+
+    if (minus)
+    {
+      __m256i own = _mm256_loadu_si256((const __m256i*)&minus[i]);
+      low  = _mm256_sub_epi32(low,  _mm256_cvtepi16_epi32(_mm256_castsi256_si128(own)));
+      high = _mm256_sub_epi32(high, _mm256_cvtepi16_epi32(_mm256_extracti128_si256(own, 1)));
+    }
+
+    // packing works within 128-bit lanes so the middle quarters are swapped
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), 0xd8);
+    _mm256_storeu_si256((__m256i*)&output[i], packed);
+  }
+
+  saturate_mix_c(sum + i, minus ? minus + i : nullptr, output + i, count - i);
+}
+
+
+static const MixingKernels c_kernels = {KERNEL_C, accumulate_samples_c, saturate_mix_c};
+static const MixingKernels avx2_kernels = {KERNEL_AVX2, accumulate_samples_avx2, saturate_mix_avx2};
+
+
+const MixingKernels* get_mixing_level_kernels(KernelLevel level)
+{
+  switch (level)
+  {
+    case KERNEL_C:
+      return &c_kernels;
+    case KERNEL_AVX2:
+      return is_avx2_available() ? &avx2_kernels : nullptr;
+    default:
+      break;
+  }
+
+  return nullptr;
+}
+
+
+const MixingKernels& get_mixing_kernels()
+{
+  // resolved only once, the CPU does not change while we are running
+  static const MixingKernels* kernels = []()
+  {
+    const MixingKernels* candidate = get_mixing_level_kernels(KERNEL_AVX2);
+    return candidate != nullptr ? candidate : &c_kernels;
+  }();
+
+  return *kernels;
+}
+
+
+uint8_t audio_level(const int16_t* samples, size_t count)
+{
+  const uint8_t SILENCE = SILENT_LEVEL;
+
+  double energy = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    energy += double(samples[i])*samples[i];
+  }
+
+  if (count == 0 || energy == 0)
+  {
+    return SILENCE;
+  }
+
+  double rms = std::sqrt(energy/count)/INT16_MAX;
+  double dbov = -20.0*std::log10(rms);
+
+  return uint8_t(std::lrint(std::min(std::max(dbov, 0.0), double(SILENCE))));
+}
+
+
+std::vector<size_t> loudest_inputs(const std::vector<uint8_t>& levels, uint8_t quietestLevel)
+{
+  std::vector<size_t> order;
+  for (size_t i = 0; i < levels.size(); ++i)
+  {
+    if (levels[i] <= quietestLevel)
+    {
+      order.push_back(i);
+    }
+  }
+
+  // smaller level is louder
+  std::stable_sort(order.begin(), order.end(), [&levels](size_t a, size_t b)
+  {
+    return levels[a] < levels[b];
+  });
+
+  return order;
+}
+
+
+MixSelector::MixSelector(size_t maxInputs, uint8_t quietestLevel, int64_t frameUs, int64_t holdUs):
+  maxInputs_(maxInputs),
+  quietestLevel_(quietestLevel),
+  releasePerFrame_(LEVEL_RELEASE_DB_PER_SECOND*frameUs/1000000.0f),
+  holdFrames_(int(holdUs/frameUs)),
+  inputs_(),
+  smoothed_()
+{}
+
+
+std::vector<bool> MixSelector::select(const std::vector<uint32_t>& ids,
+                                      const std::vector<uint8_t>& levels)
+{
+  smoothed_.clear();
+  for (size_t i = 0; i < ids.size(); ++i)
+  {
+    auto state = inputs_.find(ids[i]);
+    if (state == inputs_.end())
+    {
+      state = inputs_.insert({ids[i], {float(SILENT_LEVEL), 0, false}}).first;
+    }
+
+    float level = std::min(levels[i], SILENT_LEVEL);
+    if (level < state->second.level)
+    {
+      state->second.level = level;
+    }
+    else
+    {
+      state->second.level = std::min(level, state->second.level + releasePerFrame_);
+    }
+
+    smoothed_.push_back(uint8_t(std::lrint(state->second.level)));
+  }
+
+  std::vector<size_t> order = loudest_inputs(smoothed_, quietestLevel_);
+  std::vector<bool> loudest(ids.size(), false);
+  for (size_t i = 0; i < order.size() && i < maxInputs_; ++i)
+  {
+    loudest[order[i]] = true;
+  }
+
+  // the streams in the mix stay while they are among the loudest or held
+  std::vector<bool> mixed(ids.size(), false);
+  size_t count = 0;
+  for (size_t i = 0; i < ids.size(); ++i)
+  {
+    InputState& state = inputs_[ids[i]];
+    if (state.mixed && (loudest[i] || state.holdFrames > 0) && count < maxInputs_)
+    {
+      mixed[i] = true;
+      ++count;
+    }
+  }
+
+  // the free places go to the loudest of the others that have a frame
+  for (size_t i = 0; i < order.size() && count < maxInputs_; ++i)
+  {
+    if (!mixed[order[i]] && levels[order[i]] != UINT8_MAX)
+    {
+      mixed[order[i]] = true;
+      ++count;
+    }
+  }
+
+  for (size_t i = 0; i < ids.size(); ++i)
+  {
+    InputState& state = inputs_[ids[i]];
+
+    if (mixed[i] && (loudest[i] || !state.mixed))
+    {
+      state.holdFrames = holdFrames_;
+    }
+    else if (state.holdFrames > 0)
+    {
+      --state.holdFrames;
+    }
+
+    state.mixed = mixed[i];
+  }
+
+  return mixed;
+}
+
+
+void MixSelector::removeInput(uint32_t id)
+{
+  inputs_.erase(id);
+}
+
+
+MixingClock::MixingClock(int64_t frameUs, int64_t graceUs):
+  frameUs_(frameUs),
+  graceUs_(graceUs),
+  nextUs_(0),
+  started_(false)
+{}
+
+
+bool MixingClock::due(int64_t nowUs)
+{
+  if (!started_ || nowUs - nextUs_ > MAX_CLOCK_LAG_FRAMES*frameUs_)
+  {
+    started_ = true;
+    nextUs_ = nowUs;
+  }
+
+  if (nowUs < nextUs_ + graceUs_)
+  {
+    return false;
+  }
+
+  nextUs_ += frameUs_;
+  return true;
+}
+
+
+void MixingClock::mixedEarly(int64_t nowUs)
+{
+  if (!started_ || nowUs - nextUs_ > MAX_CLOCK_LAG_FRAMES*frameUs_)
+  {
+    started_ = true;
+    nextUs_ = nowUs;
+  }
+
+  nextUs_ = std::min(nextUs_ + frameUs_, nowUs + frameUs_);
+}
+
+
+void MixingClock::delay(int64_t us)
+{
+  nextUs_ += us;
+}
+
+
+void MixingClock::reset()
+{
+  started_ = false;
+}
+
+
+MixingBacklog::MixingBacklog():
+  missed_(0),
+  late_(0),
+  minimum_(SIZE_MAX),
+  mixes_(0)
+{}
+
+
+bool MixingBacklog::arrived()
+{
+  if (late_ > 0)
+  {
+    --late_;
+    return true;
+  }
+
+  return false;
+}
+
+
+size_t MixingBacklog::mixed(bool hadFrame, size_t waitingFrames)
+{
+  if (hadFrame)
+  {
+    missed_ = 0;
+  }
+  else
+  {
+    ++missed_;
+    late_ = missed_ <= MAX_LATE_FRAMES ? late_ + 1 : 0;
+  }
+
+  minimum_ = std::min(minimum_, waitingFrames);
+  ++mixes_;
+
+  if (mixes_ < BACKLOG_WINDOW)
+  {
+    return 0;
+  }
+
+  size_t backlog = minimum_;
+  minimum_ = SIZE_MAX;
+  mixes_ = 0;
+
+  return backlog;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "yuvconversions.h"
+
+#include <map>
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Mixing of 16-bit audio. Inputs are summed with 32-bit precision so that
+// the mix without one input (mix-minus) can be taken from the same sum. The
+// mixes are saturated to 16 bits only when written out. All versions produce
+// identical output, the C versions are the reference.
+
+// adds the samples to sum
+void accumulate_samples_c   (int32_t* sum, const int16_t* samples, size_t count);
+void accumulate_samples_avx2(int32_t* sum, const int16_t* samples, size_t count);
+
+// Writes sum minus the samples of one input saturated to 16 bits. Without
+// minus, the full mix is written.
+void saturate_mix_c   (const int32_t* sum, const int16_t* minus, int16_t* output, size_t count);
+void saturate_mix_avx2(const int32_t* sum, const int16_t* minus, int16_t* output, size_t count);
+
+
+struct MixingKernels
+{
+  KernelLevel level;
+
+  void (*accumulate_samples)(int32_t* sum, const int16_t* samples, size_t count);
+  void (*saturate_mix)(const int32_t* sum, const int16_t* minus, int16_t* output, size_t count);
+};
+
+// returns the kernels of this level or nullptr if the CPU does not support it
+const MixingKernels* get_mixing_level_kernels(KernelLevel level);
+
+// the best kernels this CPU supports, resolved on first call
+const MixingKernels& get_mixing_kernels();
+
+
+// The level of the samples in -dBov as in RFC 6464. 0 is a full scale signal
+// and 127 is silence.
+uint8_t audio_level(const int16_t* samples, size_t count);
+
+// Returns the indexes of the inputs that are not quieter than quietestLevel
+// from the loudest to the quietest, ties go to the earlier input.
+std::vector<size_t> loudest_inputs(const std::vector<uint8_t>& levels, uint8_t quietestLevel);
+
+
+// Chooses which of the inputs are mixed, at most maxInputs of the loudest.
+// The levels are smoothed so that they follow a louder level at once but
+// fall slowly, and the pauses between words do not drop a stream. A stream
+// stays in the mix for the hold time after it was last among the loudest,
+// and only then can a louder stream take its place. This way the mix does
+// not switch streams on every frame when many people talk at once.
+class MixSelector
+{
+public:
+  MixSelector(size_t maxInputs, uint8_t quietestLevel, int64_t frameUs, int64_t holdUs);
+
+  // The levels of this frame of each input in -dBov, UINT8_MAX for inputs
+  // without a frame. Returns whether each input is mixed. A held input may be
+  // mixed without a frame, its place in the mix is then silent.
+  std::vector<bool> select(const std::vector<uint32_t>& ids,
+                           const std::vector<uint8_t>& levels);
+
+  void removeInput(uint32_t id);
+
+private:
+
+  struct InputState
+  {
+    float level;
+    int holdFrames;
+    bool mixed;
+  };
+
+  size_t maxInputs_;
+  uint8_t quietestLevel_;
+  float releasePerFrame_;
+  int holdFrames_;
+
+  std::map<uint32_t, InputState> inputs_;
+
+  std::vector<uint8_t> smoothed_;
+};
+
+
+// The playback clock of the mixer. A frame is due one frame duration after
+// the previous one and the grace period for late inputs, and the clock
+// restarts if nothing has been mixed for a while. Frames can be mixed before
+// they are due if every input has one.
+class MixingClock
+{
+public:
+  MixingClock(int64_t frameUs, int64_t graceUs);
+
+  // returns true and moves to the next frame if a frame is due at nowUs
+  bool due(int64_t nowUs);
+
+  // a frame was mixed at nowUs before it was due
+  void mixedEarly(int64_t nowUs);
+
+  // makes the next frame due later
+  void delay(int64_t us);
+
+  void reset();
+
+private:
+
+  int64_t frameUs_;
+  int64_t graceUs_;
+  int64_t nextUs_;
+  bool started_;
+};
+
+
+// Keeps the latency of one input from growing. Frames arriving after their
+// mix was already done with silence are dropped unless the input has been
+// silent long enough to have paused. Frames that have been left waiting after
+// every mix for a while only add latency and are dropped as well.
+class MixingBacklog
+{
+public:
+  MixingBacklog();
+
+  // returns true if the frame arrived too late and should be dropped
+  bool arrived();
+
+  // Called after each mix. Returns how many of the oldest waiting frames
+  // should be dropped.
+  size_t mixed(bool hadFrame, size_t waitingFrames);
+
+private:
+
+  int missed_;
+  int late_;
+
+  size_t minimum_;
+  int mixes_;
+};
@@ -1,29 +1,36 @@
 #include "audiooutputdevice.h"
 
 #include "filter.h"
-#include "audioframebuffer.h"
+#include "audiojitterbuffer.h"
 
+#include "statisticsinterface.h"
+#include "common.h"
 #include "global.h"
 #include "logger.h"
 
 #include <QMediaDevices>
 
+#include <chrono>
+#include <cmath>
 
-uint8_t MAX_SAMPLE_REPEATS = 5;
 
-uint8_t MAX_BUFFER_SIZE = AUDIO_FRAMES_PER_SECOND/10;
+// the output plays the mix of all sessions
+const uint32_t OUTPUT_SESSION = 0;
 
 
-AudioOutputDevice::AudioOutputDevice():
+AudioOutputDevice::AudioOutputDevice(StatisticsInterface* stats):
   QIODevice(),
+  stats_(stats),
   device_(QMediaDevices::defaultAudioOutput()),
   audioOutput_(nullptr),
   output_(nullptr),
   format_(),
+  frameUs_(DEFAULT_AUDIO_FRAME_US),
   buffer_(nullptr),
-  latestFrame_(nullptr),
-  latestFrameIsSilence_(true),
-  outputRepeats_(0),
+  concealing_(false),
+  concealStarted_(false),
+  loudAmplitude_(0),
+  droppedFrames_(0),
   muting_(false),
   mutingThreshold_(0.1f)
 {}
@@ -35,22 +42,32 @@ AudioOutputDevice::~AudioOutputDevice()
   {
     audioOutput_->stop();
   }
-  destroyLatestFrame();
 }
 
 
-void AudioOutputDevice::init(QAudioFormat format)
+void AudioOutputDevice::init(QAudioFormat format, uint32_t frameUs)
 {
   QAudioDevice info(device_);
-  if (!info.isFormatSupported(format)) {
-    Logger::getLogger()->printDebug(DEBUG_ERROR, this,
-               "Default audio output format not supported");
-    //format_ = info.nearestFormat(format);
-    return;
-  }
-  else
+  format_ = format;
+  frameUs_ = frameUs;
+
+  if (!info.isFormatSupported(format_))
   {
-    format_ = format;
+    // the graph resamples to the rate the speaker prefers
+    format_.setSampleRate(info.preferredFormat().sampleRate());
+
+    if (!info.isFormatSupported(format_))
+    {
+      Logger::getLogger()->printDebug(DEBUG_ERROR, this,
+                 "Default audio output format not supported");
+      format_ = QAudioFormat();
+      return;
+    }
+
+    Logger::getLogger()->printWarning(this, "Speaker does not support the sample rate. "
+                                            "Playing at its preferred rate",
+                                      {"Rates"}, {QString::number(format.sampleRate()) + " -> " +
+                                                  QString::number(format_.sampleRate())});
   }
 
   createAudioOutput();
@@ -71,8 +88,8 @@ void AudioOutputDevice::createAudioOutput()
   open(QIODevice::ReadOnly);
   // pull mode
 
-  int frameSize = format_.sampleRate()*format_.bytesPerFrame()/AUDIO_FRAMES_PER_SECOND;
-  buffer_ = std::make_unique<AudioFrameBuffer>(frameSize);
+  buffer_ = std::make_unique<AudioJitterBuffer>(format_.sampleRate(), format_.channelCount(),
+                                                audioFrameSamples(format_.sampleRate(), frameUs_));
 
   audioOutput_->start(this);
 
@@ -109,94 +126,32 @@ qint64 AudioOutputDevice::readData(char *data, qint64 maxlen)
 {
   qint64 read = 0;
 
-  /*
-  // make sure we are giving the correct size audio frames
-  if (audioOutput_->periodSize() != buffer_->getDesiredSize())
-  {
-    buffer_->changeDesiredFrameSize(audioOutput_->periodSize());
-  }
-*/
-
-  if (maxlen < buffer_->getDesiredSize())
+  if (maxlen < buffer_->getFrameSize())
   {
     return read;
   }
 
-  // on windows, read as many frames from buffer to output as possible
-  // on linux, we only read one sample, since it seems to work better
-  uint8_t* frame = buffer_->readFrame();
-
-#ifdef __linux__
-  if (frame)
-  {
-    writeFrame(data, read, frame);
-  }
+  // The jitter buffer always gives a frame, concealing it if nothing has
+  // arrived or silent during a pause in the audio. Otherwise trouble ensues
+  // (Qt stops asking for frames).
+  writeFrame(data, read);
 
-#else
-  while (frame)
+  // on linux, we only read one frame, since it seems to work better. Elsewhere
+  // read as many as possible while keeping the depth of the jitter buffer
+#ifndef __linux__
+  while (maxlen - read >= buffer_->getFrameSize() && buffer_->aboveTarget())
   {
-    writeFrame(data, read, frame);
-
-    if (maxlen - read < buffer_->getDesiredSize())
-    {
-      break;
-    }
-
-    frame = buffer_->readFrame();
+    writeFrame(data, read);
   }
-
 #endif
 
-  // make sure buffer doesn't grow too large
-  while (MAX_BUFFER_SIZE < buffer_->getBufferSize())
-  {
-    Logger::getLogger()->printWarning(this, "The output device buffer is too large. Dropping audio frames",
-                 "Buffer Status",
-                 QString::number(buffer_->getBufferSize()) + "/" + QString::number(MAX_BUFFER_SIZE));
-
-    frame = buffer_->readFrame();
-    replaceLatestFrame(frame);
-  }
-
-  // If we failed to read any frames, we have to put something (previous or
-  // an empty frame) into output. Otherwise trouble ensues (Qt stops asking for frames).
-  if (read == 0)
+  if (muting_)
   {
-    // we have to give output something
-    if (latestFrame_ == nullptr)
-    {
-      Logger::getLogger()->printWarning(this, "No output audio frame available "
-                                              "in time and no previous frame available. Playing silence");
-      // equals to silence
-      latestFrame_ = createEmptyFrame(buffer_->getDesiredSize());
-      latestFrameIsSilence_ = true;
-    }
-    else if (outputRepeats_ >= MAX_SAMPLE_REPEATS && !latestFrameIsSilence_)
-    {
-      Logger::getLogger()->printWarning(this, "No output audio frame available in time. Switching to silence");
-      destroyLatestFrame();
-      latestFrame_ = createEmptyFrame(buffer_->getDesiredSize());
-      outputRepeats_ = 0;
-      latestFrameIsSilence_ = true;
-    }
-    else if (!latestFrameIsSilence_)
+    float amplitude = loudness((int16_t*)data, read);
+    if (amplitude > 0)
     {
-      Logger::getLogger()->printWarning(this, "No output audio frame available in time. "
-                                              "Repeating previous audio frame",
-                                        {"Consecutive repeats"}, {QString::number(outputRepeats_ + 1)});
+      loudAmplitude_ = amplitude;
     }
-
-    memcpy(data + read, latestFrame_, buffer_->getDesiredSize());
-    read += buffer_->getDesiredSize();
-
-    // keep track of repeats so we can switch to silence at some point.
-    ++outputRepeats_;
-  }
-
-
-  if (muting_ && isLoud((int16_t*)data, read))
-  {
-    emit outputtingSound();
   }
 
   return read;
@@ -217,7 +172,7 @@ qint64 AudioOutputDevice::writeData(const char *data, qint64 len)
 
 qint64 AudioOutputDevice::bytesAvailable() const
 {
-  return buffer_->getDesiredSize() + QIODevice::bytesAvailable();
+  return buffer_->getFrameSize() + QIODevice::bytesAvailable();
 }
 
 
@@ -232,8 +187,35 @@ void AudioOutputDevice::input(std::unique_ptr<Data> input)
 
   if (audioOutput_ && audioOutput_->state() != QAudio::StoppedState)
   {
+    int64_t arrival = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+
     // buffer handles the correct size of the audio frame for output
-    buffer_->inputData(input->data.get(), input->data_size);
+    bool afterSilence = input->aInfo && input->aInfo->silentBefore > 0;
+    buffer_->input(input->data.get(), input->data_size, arrival, afterSilence);
+
+    // the audio thread only records what happened so it never waits for the log
+    if (concealStarted_.exchange(false))
+    {
+      Logger::getLogger()->printWarning(this, "No output audio frame available in time. "
+                                              "Concealing the missing audio");
+    }
+
+    if (droppedFrames_ != buffer_->droppedFrames())
+    {
+      Logger::getLogger()->printWarning(this, "The output device buffer is too large. Dropped audio frames",
+                                        "Dropped frames",
+                                        QString::number(buffer_->droppedFrames() - droppedFrames_));
+      droppedFrames_ = buffer_->droppedFrames();
+    }
+
+    float amplitude = loudAmplitude_.exchange(0);
+    if (amplitude > 0)
+    {
+      Logger::getLogger()->printWarning(this, "Too loud",
+                                        "Sound amplitude", QString::number(amplitude*100) + " %");
+      emit outputtingSound();
+    }
   }
 }
 
@@ -269,63 +251,49 @@ void AudioOutputDevice::stop()
 }
 
 
-uint8_t* AudioOutputDevice::createEmptyFrame(uint32_t size)
+void AudioOutputDevice::writeFrame(char *data, qint64& read)
 {
-  uint8_t* emptyFrame  = new uint8_t[size];
-  memset(emptyFrame, 0, size);
-  return emptyFrame;
-}
+  AudioFrameType type = buffer_->readFrame((int16_t*)(data + read));
+  read += buffer_->getFrameSize();
 
-
-void AudioOutputDevice::replaceLatestFrame(uint8_t* frame)
-{
-  destroyLatestFrame();
-  latestFrame_ = frame;
-  outputRepeats_ = 0;
-  latestFrameIsSilence_ = false;
-}
-
-void AudioOutputDevice::destroyLatestFrame()
-{
-  if (latestFrame_)
+  if (type == AUDIO_FRAME_CONCEALED && !concealing_)
   {
-    delete [] latestFrame_;
-    latestFrame_ = nullptr;
+    concealStarted_ = true;
   }
-}
+  concealing_ = type == AUDIO_FRAME_CONCEALED;
 
-void AudioOutputDevice::writeFrame(char *data, qint64& read, uint8_t* frame)
-{
-  memcpy(data + read, frame, buffer_->getDesiredSize());
-  read += buffer_->getDesiredSize();
+  if (stats_)
+  {
+    stats_->audioBufferStatus(OUTPUT_SESSION, buffer_->depthMs(), buffer_->targetMs());
 
-  // Delete previous latest frame. This is how the memory is eventually freed
-  // for every frame.
-  replaceLatestFrame(frame);
+    switch (type)
+    {
+      case AUDIO_FRAME_EXPANDED:
+        stats_->audioBufferEvent(OUTPUT_SESSION, AUDIO_BUFFER_EXPANDED);
+        break;
+      case AUDIO_FRAME_COMPRESSED:
+        stats_->audioBufferEvent(OUTPUT_SESSION, AUDIO_BUFFER_COMPRESSED);
+        break;
+      case AUDIO_FRAME_CONCEALED:
+        stats_->audioBufferEvent(OUTPUT_SESSION, AUDIO_BUFFER_CONCEALED);
+        break;
+      default:
+        break;
+    }
+  }
 }
 
 
-bool AudioOutputDevice::isLoud(int16_t* data, uint32_t size)
+float AudioOutputDevice::loudness(int16_t* data, uint32_t size)
 {
-  bool sound = false;
-
   for (int16_t* sRead = data; sRead < data + size/2; ++sRead)
   {
-    if (*sRead > INT16_MAX*mutingThreshold_)
+    if (*sRead > INT16_MAX*mutingThreshold_ ||
+        *sRead < INT16_MIN*mutingThreshold_)
     {
-      Logger::getLogger()->printWarning(this, "Too loud (high)",
-                                        "Sound amplitude", QString::number(float(*sRead)/INT16_MAX * 100) + " %");
-      sound = true;
-      break;
-    }
-    else if(*sRead < INT16_MIN*mutingThreshold_)
-    {
-      Logger::getLogger()->printWarning(this, "Too loud (low)",
-                                        "Sound amplitude", QString::number(float(*sRead)/INT16_MAX * 100) + " %");
-      sound = true;
-      break;
+      return std::abs(float(*sRead))/INT16_MAX;
     }
   }
 
-  return sound;
+  return 0;
 }
@@ -7,22 +7,32 @@
 #include <QObject>
 #include <QMutex>
 
+#include <atomic>
 #include <stdint.h>
 #include <memory>
 #include <deque>
 
 class StatisticsInterface;
 struct Data;
-class AudioFrameBuffer;
+class AudioJitterBuffer;
 
 class AudioOutputDevice : public QIODevice
 {
   Q_OBJECT
 public:
-  AudioOutputDevice();
+  AudioOutputDevice(StatisticsInterface* stats);
   virtual ~AudioOutputDevice();
 
-  void init(QAudioFormat format);
+  // Uses the rate the device prefers if it does not support the rate of
+  // format. Check format() for the one in use. The frames given to input are
+  // frameUs long.
+  void init(QAudioFormat format, uint32_t frameUs);
+
+  QAudioFormat format() const
+  {
+    return format_;
+  }
+
   void start(); // resume audio output
   void stop(); // suspend audio output
 
@@ -51,15 +61,10 @@ private:
 
   void createAudioOutput();
 
-  uint8_t* createEmptyFrame(uint32_t size);
+  void writeFrame(char *data, qint64& read);
 
-  void replaceLatestFrame(uint8_t* frame);
-
-  void destroyLatestFrame();
-
-  void writeFrame(char *data, qint64& read, uint8_t* frame);
-
-  bool isLoud(int16_t* data, uint32_t size);
+  // the first amplitude above the muting threshold, 0 if there is none
+  float loudness(int16_t* data, uint32_t size);
 
   StatisticsInterface* stats_;
 
@@ -67,13 +72,20 @@ private:
   QAudioSink *audioOutput_;
   QIODevice *output_; // not owned
   QAudioFormat format_;
+  uint32_t frameUs_;
+
+  std::unique_ptr<AudioJitterBuffer> buffer_;
 
-  std::unique_ptr<AudioFrameBuffer> buffer_;
+  // only used by the audio thread
+  bool concealing_;
 
-  uint8_t* latestFrame_;
-  bool latestFrameIsSilence_;
+  // Set by the audio thread and reported from the input thread. Logging and
+  // signals may lock or allocate, so they are kept out of readData.
+  std::atomic<bool> concealStarted_;
+  std::atomic<float> loudAmplitude_;
 
-  unsigned int outputRepeats_;
+  // only used by the input thread
+  uint64_t droppedFrames_;
 
   bool muting_;
   float mutingThreshold_;
@@ -1,25 +1,24 @@
 #include "audiooutputfilter.h"
 
-#include "global.h"
 #include "common.h"
 
 #include "settingskeys.h"
 
 AudioOutputFilter::AudioOutputFilter(QString id, StatisticsInterface* stats,
                                      std::shared_ptr<ResourceAllocator> hwResources,
-                                     QAudioFormat format):
+                                     QAudioFormat format, uint32_t frameUs):
   Filter(id, "Audio Output", stats, hwResources, DT_RAWAUDIO, DT_NONE),
-  output_()
+  output_(stats)
 {
 #ifdef __linux__
   // linux uses very large audio frames at mic for some reason. That is why there
   // will be many audio samples arriving simultaneously at this filter and we
   // need a relatively large buffer
-  maxBufferSize_ = AUDIO_FRAMES_PER_SECOND/5;
+  maxBufferSize_ = 200000/frameUs;
 #else
-  maxBufferSize_ = AUDIO_FRAMES_PER_SECOND/2;
+  maxBufferSize_ = 500000/frameUs;
 #endif
-  output_.init(format);
+  output_.init(format, frameUs);
 
   QObject::connect(&output_, &AudioOutputDevice::outputtingSound,
                    this,     &AudioOutputFilter::outputtingSound);
@@ -13,10 +13,16 @@ class AudioOutputFilter : public Filter
 public:
   AudioOutputFilter(QString id, StatisticsInterface* stats,
                     std::shared_ptr<ResourceAllocator> hwResources,
-                    QAudioFormat format);
+                    QAudioFormat format, uint32_t frameUs);
 
   virtual void updateSettings();
 
+  // the format the device plays, may differ from the one given in sample rate
+  QAudioFormat format() const
+  {
+    return output_.format();
+  }
+
 signals:
   void outputtingSound();
 
@@ -0,0 +1,226 @@
+#include "audioresampling.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// The kernels are compiled for their instruction set regardless of build flags
+// and selected at runtime based on what the CPU supports.
+#if defined(__GNUC__) || defined(__clang__)
+  #define TARGET_AVX2   __attribute__((target("avx2")))
+#else
+  #define TARGET_AVX2
+#endif
+
+
+struct QualityPreset
+{
+  size_t taps;
+  double kaiserBeta;
+
+  // the passband as a fraction of the lower Nyquist frequency
+  double rolloff;
+};
+
+static const QualityPreset PRESETS[] = {{16, 6.0,  0.85},
+                                        {32, 8.0,  0.90},
+                                        {64, 10.0, 0.94}};
+
+
+float dot_product_c(const float* a, const float* b, size_t count)
+{
+  float sum = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    sum += a[i]*b[i];
+  }
+  return sum;
+}
+
+
+TARGET_AVX2 float dot_product_avx2(const float* a, const float* b, size_t count)
+{
+  __m256 sum = _mm256_setzero_ps();
+
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(&a[i]), _mm256_loadu_ps(&b[i])));
+  }
+
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+  half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+
+  return _mm_cvtss_f32(half) + dot_product_c(a + i, b + i, count - i);
+}
+
+
+static const ResamplingKernels c_kernels = {KERNEL_C, dot_product_c};
+static const ResamplingKernels avx2_kernels = {KERNEL_AVX2, dot_product_avx2};
+
+
+const ResamplingKernels* get_resampling_level_kernels(KernelLevel level)
+{
+  switch (level)
+  {
+    case KERNEL_C:
+      return &c_kernels;
+    case KERNEL_AVX2:
+      return is_avx2_available() ? &avx2_kernels : nullptr;
+    default:
+      break;
+  }
+
+  return nullptr;
+}
+
+
+const ResamplingKernels& get_resampling_kernels()
+{
+  // resolved only once, the CPU does not change while we are running
+  static const ResamplingKernels* kernels = []()
+  {
+    const ResamplingKernels* candidate = get_resampling_level_kernels(KERNEL_AVX2);
+    return candidate != nullptr ? candidate : &c_kernels;
+  }();
+
+  return *kernels;
+}
+
+
+// modified Bessel function of the first kind for the Kaiser window
+static double bessel_i0(double x)
+{
+  double sum = 1;
+  double term = 1;
+  for (int k = 1; k < 50 && term > sum*1e-12; ++k)
+  {
+    term *= (x/(2*k))*(x/(2*k));
+    sum += term;
+  }
+  return sum;
+}
+
+
+PolyphaseResampler::PolyphaseResampler(uint32_t inputRate, uint32_t outputRate, uint16_t channels,
+                                       ResamplerQuality quality, const ResamplingKernels& kernels):
+  kernels_(kernels),
+  channels_(channels),
+  upsampling_(1),
+  downsampling_(1),
+  taps_(PRESETS[quality].taps),
+  coefficients_(),
+  history_(channels),
+  position_(0),
+  phase_(0)
+{
+  uint32_t divisor = std::gcd(inputRate, outputRate);
+  if (divisor != 0)
+  {
+    upsampling_ = outputRate/divisor;
+    downsampling_ = inputRate/divisor;
+  }
+
+  createFilter(PRESETS[quality].kaiserBeta, PRESETS[quality].rolloff);
+  reset();
+}
+
+
+void PolyphaseResampler::createFilter(double kaiserBeta, double rolloff)
+{
+  const size_t length = taps_*upsampling_;
+  const double center = (length - 1)/2.0;
+
+  // cutoff at the upsampled rate below the Nyquist frequency of the lower rate
+  const double cutoff = 0.5*std::min(1.0, double(upsampling_)/downsampling_)/upsampling_*rolloff;
+
+  std::vector<double> prototype(length);
+  for (size_t k = 0; k < length; ++k)
+  {
+    double x = 2*cutoff*(k - center);
+    double sinc = x == 0 ? 1.0 : std::sin(M_PI*x)/(M_PI*x);
+
+    double position = 2.0*k/(length - 1) - 1.0;
+    double window = bessel_i0(kaiserBeta*std::sqrt(std::max(0.0, 1.0 - position*position)))/
+        bessel_i0(kaiserBeta);
+
+    prototype[k] = sinc*window;
+  }
+
+  // each phase is normalized so that a constant stays constant
+  coefficients_.resize(length);
+  for (uint32_t phase = 0; phase < upsampling_; ++phase)
+  {
+    double sum = 0;
+    for (size_t tap = 0; tap < taps_; ++tap)
+    {
+      sum += prototype[tap*upsampling_ + phase];
+    }
+
+    for (size_t tap = 0; tap < taps_; ++tap)
+    {
+      coefficients_[phase*taps_ + taps_ - 1 - tap] = float(prototype[tap*upsampling_ + phase]/sum);
+    }
+  }
+}
+
+
+void PolyphaseResampler::reset()
+{
+  for (auto& channel : history_)
+  {
+    channel.assign(taps_ - 1, 0.0f);
+  }
+  position_ = 0;
+  phase_ = 0;
+}
+
+
+size_t PolyphaseResampler::process(const int16_t* input, size_t count, std::vector<int16_t>& output)
+{
+  output.clear();
+
+  for (uint16_t channel = 0; channel < channels_; ++channel)
+  {
+    std::vector<float>& history = history_[channel];
+    history.resize(taps_ - 1 + count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      history[taps_ - 1 + i] = input[i*channels_ + channel];
+    }
+  }
+
+  size_t position = position_;
+  uint32_t phase = phase_;
+
+  while (position < count)
+  {
+    const float* coefficients = coefficients_.data() + phase*taps_;
+
+    for (uint16_t channel = 0; channel < channels_; ++channel)
+    {
+      // the window ends at the input sample of this output
+      float sample = kernels_.dot_product(coefficients, history_[channel].data() + position, taps_);
+
+      output.push_back(int16_t(std::min(std::max(std::lrint(sample), long(INT16_MIN)), long(INT16_MAX))));
+    }
+
+    phase += downsampling_;
+    position += phase/upsampling_;
+    phase %= upsampling_;
+  }
+
+  position_ = position - count;
+  phase_ = phase;
+
+  for (auto& history : history_)
+  {
+    history.erase(history.begin(), history.end() - (taps_ - 1));
+  }
+
+  return output.size()/channels_;
+}
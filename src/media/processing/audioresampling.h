@@ -0,0 +1,89 @@
+#pragma once
+
+#include "yuvconversions.h"
+
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Sample rate conversion of 16-bit audio between the rates of the devices and
+// the codec. The conversion is polyphase filtering with a windowed sinc: the
+// input is thought to be upsampled by L with zeros, lowpass filtered and
+// downsampled by M, but only the outputs that are kept are computed and only
+// with the taps that hit input samples. The filtering is done in float, only
+// the dot product differs between the kernel levels.
+
+// sum of a[i]*b[i]
+float dot_product_c   (const float* a, const float* b, size_t count);
+float dot_product_avx2(const float* a, const float* b, size_t count);
+
+
+struct ResamplingKernels
+{
+  KernelLevel level;
+
+  float (*dot_product)(const float* a, const float* b, size_t count);
+};
+
+// returns the kernels of this level or nullptr if the CPU does not support it
+const ResamplingKernels* get_resampling_level_kernels(KernelLevel level);
+
+// the best kernels this CPU supports, resolved on first call
+const ResamplingKernels& get_resampling_kernels();
+
+
+// More taps give a steeper filter and less aliasing for more work per sample
+enum ResamplerQuality
+{
+  RESAMPLER_FAST,    // 16 taps, for low end devices
+  RESAMPLER_DEFAULT, // 32 taps, aliasing is below the noise of a microphone
+  RESAMPLER_BEST     // 64 taps
+};
+
+
+class PolyphaseResampler
+{
+public:
+  PolyphaseResampler(uint32_t inputRate, uint32_t outputRate, uint16_t channels,
+                     ResamplerQuality quality,
+                     const ResamplingKernels& kernels = get_resampling_kernels());
+
+  // Replaces output with the resampled interleaved samples of input. Count is
+  // in samples per channel and so is the returned output count, which varies
+  // from call to call for the same input count.
+  size_t process(const int16_t* input, size_t count, std::vector<int16_t>& output);
+
+  // the delay of the filter in input samples
+  size_t delay() const
+  {
+    return taps_/2;
+  }
+
+  void reset();
+
+private:
+
+  void createFilter(double kaiserBeta, double rolloff);
+
+  const ResamplingKernels& kernels_;
+
+  const uint16_t channels_;
+
+  // the rates divided by their greatest common divisor
+  uint32_t upsampling_;
+  uint32_t downsampling_;
+
+  size_t taps_;
+
+  // taps_ coefficients for each phase, reversed so that they line up with
+  // the history in the dot product
+  std::vector<float> coefficients_;
+
+  // per channel the last taps_ - 1 input samples followed by the new ones
+  std::vector<std::vector<float>> history_;
+
+  // input sample and phase of the next output relative to the new input
+  size_t position_;
+  uint32_t phase_;
+};
@@ -0,0 +1,132 @@
+#include "conversionpool.h"
+
+#include <algorithm>
+
+
+ConversionPool& ConversionPool::getPool()
+{
+  static ConversionPool pool;
+  return pool;
+}
+
+
+ConversionPool::ConversionPool():
+  mutex_(),
+  jobAvailable_(),
+  helpersFinished_(),
+  jobs_(),
+  workers_(),
+  stopped_(false)
+{}
+
+
+ConversionPool::~ConversionPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+
+  jobAvailable_.notify_all();
+
+  for (auto& thread : workers_)
+  {
+    thread.join();
+  }
+}
+
+
+void ConversionPool::run(int bands, int threads, const std::function<void(int)>& function)
+{
+  if (threads <= 1 || bands <= 1)
+  {
+    for (int band = 0; band < bands; ++band)
+    {
+      function(band);
+    }
+    return;
+  }
+
+  Job job = {&function, bands, 0, threads - 1, 0};
+
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  if (workers_.empty())
+  {
+    createWorkers();
+  }
+
+  jobs_.push_back(&job);
+  jobAvailable_.notify_all();
+
+  // the caller works too so the job finishes even if all workers are busy
+  work(job, lock);
+
+  // all bands have been taken, wait for the helpers before the job goes out of scope
+  jobs_.erase(std::find(jobs_.begin(), jobs_.end(), &job));
+  helpersFinished_.wait(lock, [&job]{ return job.helpers == 0; });
+}
+
+
+void ConversionPool::createWorkers()
+{
+  // the threads calling run are the rest
+  unsigned int threads = std::thread::hardware_concurrency();
+  if (threads < 2)
+  {
+    threads = 2;
+  }
+
+  for (unsigned int i = 0; i < threads - 1; ++i)
+  {
+    workers_.push_back(std::thread(&ConversionPool::worker, this));
+  }
+}
+
+
+void ConversionPool::worker()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (!stopped_)
+  {
+    Job* job = nullptr;
+    for (Job* candidate : jobs_)
+    {
+      if (candidate->nextBand < candidate->bands && candidate->helpers < candidate->maxHelpers)
+      {
+        job = candidate;
+        break;
+      }
+    }
+
+    if (job == nullptr)
+    {
+      jobAvailable_.wait(lock);
+      continue;
+    }
+
+    ++job->helpers;
+    work(*job, lock);
+    --job->helpers;
+
+    if (job->helpers == 0)
+    {
+      helpersFinished_.notify_all();
+    }
+  }
+}
+
+
+void ConversionPool::work(Job& job, std::unique_lock<std::mutex>& lock)
+{
+  while (job.nextBand < job.bands)
+  {
+    int band = job.nextBand;
+    ++job.nextBand;
+
+    lock.unlock();
+    (*job.function)(band);
+    lock.lock();
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A singleton pool of worker threads shared by all frame conversions. The
+// threads persist for the whole run so there is no cost of creating them for
+// each frame, and the conversions of different streams share the same threads
+// instead of each creating their own.
+
+class ConversionPool
+{
+public:
+  static ConversionPool& getPool();
+
+  ~ConversionPool();
+
+  // Calls function once for every band from 0 to bands - 1 using at most the
+  // given number of threads. The calling thread is one of them.
+  // Returns when all bands have been processed.
+  void run(int bands, int threads, const std::function<void(int band)>& function);
+
+private:
+
+  ConversionPool();
+
+  struct Job
+  {
+    const std::function<void(int)>* function;
+    int bands;
+    int nextBand;
+
+    int maxHelpers;
+    int helpers; // workers currently working on this job
+  };
+
+  void createWorkers();
+  void worker();
+
+  // processes bands until there are none left, mutex must be locked
+  void work(Job& job, std::unique_lock<std::mutex>& lock);
+
+  std::mutex mutex_;
+  std::condition_variable jobAvailable_;
+  std::condition_variable helpersFinished_;
+
+  std::vector<Job*> jobs_;
+  std::vector<std::thread> workers_;
+
+  bool stopped_;
+};
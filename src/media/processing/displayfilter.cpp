@@ -63,12 +63,14 @@ DisplayFilter::~DisplayFilter()
 
 void DisplayFilter::process()
 {
-  // TODO: The display should try to mimic the framerate if possible,
-  // without adding too much latency
-
-  std::unique_ptr<Data> input = getInput();
+  // Only the newest frame is ever shown, so frames that have been waiting behind
+  // it are dropped here before they are copied or flipped.
+  uint32_t discarded = 0;
+  std::unique_ptr<Data> input = getNewestInput(discarded);
   while (input)
   {
+    reportDropped(discarded);
+
     QImage::Format format;
 
     switch(input->type)
@@ -77,7 +79,8 @@ void DisplayFilter::process()
       format = QImage::Format_RGB32;
       break;
     case DT_YUV420VIDEO:
-      format = QImage::Format_Invalid;
+      // the luma plane, widgets find the chroma planes after it
+      format = QImage::Format_Grayscale8;
       break;
     default:
       Logger::getLogger()->printDebug(DEBUG_PROGRAM_ERROR, this, 
@@ -111,12 +114,25 @@ void DisplayFilter::process()
       if( sessionID_ != 1111)
       {
         int32_t delay = QDateTime::currentMSecsSinceEpoch() - input->creationTimestamp;
-        //getStats()->decodingDelay("Video", delay);
-        getStats()->totalDelay(sessionID_, "Video", delay);
+        //getStats()->decodingDelay(STATS_VIDEO, delay);
+        getStats()->totalDelay(sessionID_, STATS_VIDEO, delay);
       }
     }
 
-    input = getInput();
+    input = getNewestInput(discarded);
+  }
+}
+
+
+void DisplayFilter::reportDropped(uint32_t frames)
+{
+  // the self view is not a session
+  if (sessionID_ != 1111)
+  {
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+      getStats()->displayDroppedFrame(sessionID_, STATS_VIDEO);
+    }
   }
 }
 
@@ -141,17 +157,21 @@ std::unique_ptr<Data> DisplayFilter::deliverFrame(VideoInterface* screen,
 
   bool verticalOrientation = input->vInfo->flippedVertically;
   bool horizontalOrientation = input->vInfo->flippedHorizontally;
-  input = normalizeOrientation(std::move(input), mirrorHorizontally);
+
+  // YUV is only drawn for received streams, which are never flipped
+  if (input->type == DT_RGB32VIDEO)
+  {
+    input = normalizeOrientation(std::move(input), mirrorHorizontally);
+  }
 
   QImage image(
         input->data.get(),
         input->vInfo->width,
         input->vInfo->height,
+        input->vInfo->width*(format == QImage::Format_Grayscale8 ? 1 : 4),
         format);
   
-  screen->inputImage(std::move(input->data), image,
-                     double(input->vInfo->framerateNumerator/input->vInfo->framerateDenominator),
-                     input->presentationTimestamp);
+  screen->inputImage(std::move(input->data), image, input->presentationTimestamp);
 
   if (useCopy)
   {
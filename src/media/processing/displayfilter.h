@@ -32,6 +32,9 @@ private:
                                      QImage::Format format,
                                      bool useCopy, bool mirrorHorizontally);
 
+  // tells the stats about frames that were never shown
+  void reportDropped(uint32_t frames);
+
   bool horizontalMirroring_;
 
   // Owned by Conference view
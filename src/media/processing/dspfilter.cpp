@@ -9,20 +9,20 @@
 
 DSPFilter::DSPFilter(QString id, StatisticsInterface* stats,
                      std::shared_ptr<ResourceAllocator> hwResources,
-                     std::shared_ptr<SpeexAEC> aec, QAudioFormat& format,
+                     std::shared_ptr<SpeexAEC> aec, QAudioFormat& format, uint32_t frameUs,
                      bool AECReference, bool doAEC, bool doDenoise,
-                     bool doDereverb, bool doAGC, int32_t volume, int maxGain):
+                     bool doDereverb, bool doAGC, bool doVAD, int32_t volume, int maxGain):
   Filter(id, "DSP", stats, hwResources, DT_RAWAUDIO, DT_RAWAUDIO),
   aec_(aec),
   dsp_(nullptr),
   AECReference_(AECReference),
   doAEC_(doAEC),
-  doDSP_(doDereverb || doDereverb || doAGC)
+  doDSP_(doDenoise || doDereverb || doAGC || doVAD)
 {
   if (doDSP_)
   {
-    dsp_ = std::make_unique<SpeexDSP> (format);
-    dsp_->init(doAGC, doDenoise, doDereverb, volume, maxGain);
+    dsp_ = std::make_unique<SpeexDSP> (format, frameUs);
+    dsp_->init(doAGC, doDenoise, doDereverb, doVAD, volume, maxGain);
   }
 
   if (doAEC_ && AECReference_)
@@ -57,16 +57,19 @@ void DSPFilter::process()
 
   while(input)
   {
-    // do dsp operation such as denoise, dereverb and agc
-    if (doDSP_ && dsp_)
+    // Do echo cancellation first so that the other processing, most
+    // importantly VAD, does not see the echo of the peer as our voice.
+    if (doAEC_ && aec_)
     {
-      input->data = dsp_->processInputFrame(std::move(input->data), input->data_size);
+      input->data = aec_->processInputFrame(std::move(input->data), input->data_size);
     }
 
-    // do echo cancellation
-    if (doAEC_ && aec_)
+    // do dsp operation such as denoise, dereverb, agc and vad
+    if (doDSP_ && dsp_ && input->data != nullptr)
     {
-      input->data = aec_->processInputFrame(std::move(input->data), input->data_size);
+      bool* voiceActivity = input->aInfo ? &input->aInfo->voiceActivity : nullptr;
+      input->data = dsp_->processInputFrame(std::move(input->data), input->data_size,
+                                            voiceActivity);
     }
 
     // provide a reference frame of our speaker output so AEC can remove echo
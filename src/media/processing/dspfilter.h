@@ -14,9 +14,9 @@ class DSPFilter : public Filter
 public:
   DSPFilter(QString id, StatisticsInterface* stats,
             std::shared_ptr<ResourceAllocator> hwResources,
-            std::shared_ptr<SpeexAEC> aec, QAudioFormat &format,
+            std::shared_ptr<SpeexAEC> aec, QAudioFormat &format, uint32_t frameUs,
             bool AECReference, bool doAEC, bool doDenoise, bool doDereverb,
-            bool doAGC, int32_t volume = 0, int maxGain = 0);
+            bool doAGC, bool doVAD, int32_t volume = 0, int maxGain = 0);
 
   ~DSPFilter();
 
@@ -0,0 +1,289 @@
+#include "echoalignment.h"
+
+#include <algorithm>
+#include <cmath>
+
+// how long the correlated signals are and how often the delay is estimated
+const int ESTIMATE_WINDOW_MS = 1000;
+const int ESTIMATE_INTERVAL_MS = 500;
+
+// Below this mean envelope the reference is too quiet to have an echo
+// (about -50 dBov)
+const float MIN_REFERENCE_LEVEL = 100.0f;
+
+// the correlation needed to trust that the peak is the echo
+const double MIN_CORRELATION = 0.5;
+
+
+EchoDelayEstimator::EchoDelayEstimator(uint32_t sampleRate, uint16_t channels, int maxDelayMs):
+  samplesPerMs_(std::max<uint32_t>(sampleRate/1000, 1)*channels),
+  channels_(channels),
+  maxDelayMs_(maxDelayMs),
+  capture_(),
+  reference_(),
+  captureAccumulated_(0),
+  captureSamples_(0),
+  referenceAccumulated_(0),
+  referenceSamples_(0),
+  sinceEstimateMs_(0),
+  delayMs_(0)
+{}
+
+
+bool EchoDelayEstimator::addFrame(const int16_t* capture, const int16_t* reference, size_t samples)
+{
+  size_t historyBefore = capture_.size();
+
+  decimate(capture, samples*channels_, capture_, captureAccumulated_, captureSamples_);
+  decimate(reference, samples*channels_, reference_, referenceAccumulated_, referenceSamples_);
+
+  sinceEstimateMs_ += int(capture_.size() - historyBefore);
+
+  size_t historyLength = ESTIMATE_WINDOW_MS + 2*maxDelayMs_;
+  if (capture_.size() > historyLength)
+  {
+    capture_.erase(capture_.begin(), capture_.end() - historyLength);
+  }
+  if (reference_.size() > historyLength)
+  {
+    reference_.erase(reference_.begin(), reference_.end() - historyLength);
+  }
+
+  if (capture_.size() < historyLength || reference_.size() < historyLength ||
+      sinceEstimateMs_ < ESTIMATE_INTERVAL_MS)
+  {
+    return false;
+  }
+
+  sinceEstimateMs_ = 0;
+  return estimate();
+}
+
+
+void EchoDelayEstimator::reset()
+{
+  capture_.clear();
+  reference_.clear();
+  captureAccumulated_ = 0;
+  captureSamples_ = 0;
+  referenceAccumulated_ = 0;
+  referenceSamples_ = 0;
+  sinceEstimateMs_ = 0;
+}
+
+
+void EchoDelayEstimator::decimate(const int16_t* samples, size_t count, std::vector<float>& history,
+                                  double& accumulated, uint32_t& accumulatedSamples)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    accumulated += std::abs(int(samples[i]));
+    ++accumulatedSamples;
+
+    if (accumulatedSamples == samplesPerMs_)
+    {
+      history.push_back(float(accumulated/accumulatedSamples));
+      accumulated = 0;
+      accumulatedSamples = 0;
+    }
+  }
+}
+
+
+bool EchoDelayEstimator::estimate()
+{
+  // the capture window is in the middle so that the reference can be
+  // compared with it both earlier and later
+  const float* capture = capture_.data() + maxDelayMs_;
+  const size_t window = ESTIMATE_WINDOW_MS;
+
+  double referenceMean = 0;
+  for (float value : reference_)
+  {
+    referenceMean += value;
+  }
+  referenceMean /= reference_.size();
+
+  if (referenceMean < MIN_REFERENCE_LEVEL)
+  {
+    return false;
+  }
+
+  double captureMean = 0;
+  for (size_t t = 0; t < window; ++t)
+  {
+    captureMean += capture[t];
+  }
+  captureMean /= window;
+
+  std::vector<double> centered(window);
+  double captureEnergy = 0;
+  for (size_t t = 0; t < window; ++t)
+  {
+    centered[t] = capture[t] - captureMean;
+    captureEnergy += centered[t]*centered[t];
+  }
+
+  if (captureEnergy <= 0)
+  {
+    return false;
+  }
+
+  // sums of the reference over any window
+  std::vector<double> sum(reference_.size() + 1, 0);
+  std::vector<double> squares(reference_.size() + 1, 0);
+  for (size_t i = 0; i < reference_.size(); ++i)
+  {
+    sum[i + 1] = sum[i] + reference_[i];
+    squares[i + 1] = squares[i] + double(reference_[i])*reference_[i];
+  }
+
+  double bestCorrelation = 0;
+  int bestDelay = 0;
+
+  for (int delay = -maxDelayMs_; delay <= maxDelayMs_; ++delay)
+  {
+    const size_t start = maxDelayMs_ - delay;
+    const float* reference = reference_.data() + start;
+
+    double windowSum = sum[start + window] - sum[start];
+    double referenceEnergy = squares[start + window] - squares[start] - windowSum*windowSum/window;
+    if (referenceEnergy <= 0)
+    {
+      continue;
+    }
+
+    double product = 0;
+    for (size_t t = 0; t < window; ++t)
+    {
+      product += centered[t]*reference[t];
+    }
+
+    double correlation = product/std::sqrt(captureEnergy*referenceEnergy);
+    if (correlation > bestCorrelation)
+    {
+      bestCorrelation = correlation;
+      bestDelay = delay;
+    }
+  }
+
+  if (bestCorrelation < MIN_CORRELATION)
+  {
+    return false;
+  }
+
+  delayMs_ = bestDelay;
+  return true;
+}
+
+
+ClockDriftEstimator::ClockDriftEstimator(uint64_t windowSamples):
+  windowSamples_(windowSamples),
+  started_(false),
+  firstCapture_(0),
+  firstReference_(0),
+  count_(0),
+  sumX_(0),
+  sumY_(0),
+  sumXY_(0),
+  sumXX_(0),
+  drift_(0)
+{}
+
+
+bool ClockDriftEstimator::addPoint(uint64_t captureSamples, uint64_t referenceSamples)
+{
+  if (!started_)
+  {
+    started_ = true;
+    firstCapture_ = captureSamples;
+    firstReference_ = referenceSamples;
+  }
+
+  double x = double(captureSamples - firstCapture_);
+  double y = double(referenceSamples) - double(firstReference_);
+
+  count_ += 1;
+  sumX_ += x;
+  sumY_ += y;
+  sumXY_ += x*y;
+  sumXX_ += x*x;
+
+  if (captureSamples - firstCapture_ < windowSamples_)
+  {
+    return false;
+  }
+
+  double denominator = count_*sumXX_ - sumX_*sumX_;
+  bool measured = denominator > 0;
+  if (measured)
+  {
+    drift_ = (count_*sumXY_ - sumX_*sumY_)/denominator - 1.0;
+  }
+
+  // the next window starts from this point
+  started_ = false;
+  count_ = 0;
+  sumX_ = 0;
+  sumY_ = 0;
+  sumXY_ = 0;
+  sumXX_ = 0;
+
+  addPoint(captureSamples, referenceSamples);
+
+  return measured;
+}
+
+
+DriftResampler::DriftResampler(uint16_t channels):
+  channels_(channels),
+  step_(1.0),
+  position_(0),
+  previous_(channels, 0)
+{}
+
+
+void DriftResampler::setRatio(double ratio)
+{
+  if (ratio > 0)
+  {
+    step_ = 1.0/ratio;
+  }
+}
+
+
+size_t DriftResampler::process(const int16_t* input, size_t count, std::vector<int16_t>& output)
+{
+  output.clear();
+
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  double position = position_;
+  while (position < double(count - 1))
+  {
+    long index = long(std::floor(position));
+    double fraction = position - index;
+
+    for (uint16_t channel = 0; channel < channels_; ++channel)
+    {
+      double first = index < 0 ? previous_[channel] : input[index*channels_ + channel];
+      double second = input[(index + 1)*channels_ + channel];
+
+      output.push_back(int16_t(std::lrint(first + (second - first)*fraction)));
+    }
+
+    position += step_;
+  }
+
+  position_ = position - count;
+
+  for (uint16_t channel = 0; channel < channels_; ++channel)
+  {
+    previous_[channel] = input[(count - 1)*channels_ + channel];
+  }
+
+  return output.size()/channels_;
+}
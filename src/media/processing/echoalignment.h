@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Keeping the playback reference of the echo canceller aligned with the
+// capture. The capture and playback run on different clocks and the audio
+// buffers between them add a delay that changes during a call, while the
+// adaptive filter of the AEC only covers a short echo tail.
+//
+// All classes handle 16-bit interleaved samples.
+
+
+// Estimates how much later the echo is in the capture than in the reference
+// given to the AEC with it. The envelopes of both are decimated to one value
+// per millisecond and the delay is the lag with the largest normalized
+// cross-correlation. Estimates are only made while the reference has sound,
+// and only accepted if the correlation is clear.
+class EchoDelayEstimator
+{
+public:
+  EchoDelayEstimator(uint32_t sampleRate, uint16_t channels, int maxDelayMs);
+
+  // Adds the capture frame and the reference frame it was cancelled with.
+  // Returns true when a new estimate is available.
+  bool addFrame(const int16_t* capture, const int16_t* reference, size_t samples);
+
+  // Positive if the reference is early, negative if it comes after the echo
+  int delayMs() const
+  {
+    return delayMs_;
+  }
+
+  // forgets the history, for example after the reference has been moved
+  void reset();
+
+private:
+
+  // appends the mean absolute values of each millisecond to history
+  void decimate(const int16_t* samples, size_t count, std::vector<float>& history,
+                double& accumulated, uint32_t& accumulatedSamples);
+
+  bool estimate();
+
+  const uint32_t samplesPerMs_;
+  const uint16_t channels_;
+  const int maxDelayMs_;
+
+  std::vector<float> capture_;
+  std::vector<float> reference_;
+
+  double captureAccumulated_;
+  uint32_t captureSamples_;
+  double referenceAccumulated_;
+  uint32_t referenceSamples_;
+
+  int sinceEstimateMs_;
+  int delayMs_;
+};
+
+
+// Measures how much faster the reference arrives than the capture runs as the
+// least squares slope of the reference samples against the capture samples.
+// The bursts of the audio buffers average out over a window.
+class ClockDriftEstimator
+{
+public:
+  explicit ClockDriftEstimator(uint64_t windowSamples);
+
+  // Adds the total samples so far of both. Returns true at the end of each
+  // window when a new measurement is available.
+  bool addPoint(uint64_t captureSamples, uint64_t referenceSamples);
+
+  // reference samples per capture sample minus one
+  double drift() const
+  {
+    return drift_;
+  }
+
+private:
+
+  const uint64_t windowSamples_;
+
+  bool started_;
+  uint64_t firstCapture_;
+  uint64_t firstReference_;
+
+  double count_;
+  double sumX_;
+  double sumY_;
+  double sumXY_;
+  double sumXX_;
+
+  double drift_;
+};
+
+
+// Resamples a stream by a ratio close to one with linear interpolation. Used
+// to take the drift out of the reference before it is buffered.
+class DriftResampler
+{
+public:
+  explicit DriftResampler(uint16_t channels);
+
+  // output samples per input sample
+  void setRatio(double ratio);
+
+  // Replaces output with the resampled frames of input. Count is in samples
+  // per channel and so is the returned output count.
+  size_t process(const int16_t* input, size_t count, std::vector<int16_t>& output);
+
+private:
+
+  const uint16_t channels_;
+  double step_;
+
+  // position of the next output relative to the first input sample, -1 is
+  // the last sample of the previous input
+  double position_;
+  std::vector<int16_t> previous_;
+};
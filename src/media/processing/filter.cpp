@@ -139,6 +139,14 @@ void Filter::removeOutConnection(std::shared_ptr<Filter> out)
   }
 }
 
+bool Filter::hasOutputs()
+{
+  connectionMutex_.lock();
+  bool outputs = !outConnections_.empty() || !outDataCallbacks_.empty();
+  connectionMutex_.unlock();
+  return outputs;
+}
+
 void Filter::emptyBuffer()
 {
   bufferMutex_.lock();
@@ -178,22 +186,33 @@ void Filter::putInput(std::unique_ptr<Data> data)
   {
     if(inBuffer_[0]->type == DT_HEVCVIDEO)
     {
-      // Search for intra frames and discard everything up to it
-      for(uint32_t i = 0; i < inBuffer_.size(); ++i)
+      // Discard everything before the newest IRAP picture and its parameter
+      // sets, since decoding can continue from there. Without one, only the
+      // oldest is discarded.
+      uint32_t next = 0;
+      for(uint32_t i = (uint32_t)inBuffer_.size() - 1; i > 0; --i)
       {
-        const unsigned char *buff = inBuffer_.at(i)->data.get();
-        if(!isHEVCIntra(buff))
+        if(isHEVCIRAP(inBuffer_.at(i)->data.get()))
         {
-          Logger::getLogger()->printWarning(this, "Discarding HEVC frames from buffer. Finding next intra",
-                                            "Frames discarded", QString::number(i));
-
-          for(int j = i; j != 0; --j)
+          next = i;
+          while (next > 0 && isHEVCParameterSet(inBuffer_.at(next - 1)->data.get()))
           {
-            inBuffer_.pop_front();
+            --next;
           }
           break;
         }
       }
+
+      if (next > 0)
+      {
+        Logger::getLogger()->printWarning(this, "Discarding HEVC frames from buffer up to the next intra",
+                                          "Frames discarded", QString::number(next));
+      }
+
+      for(uint32_t j = qMax(next, 1u); j != 0; --j)
+      {
+        inBuffer_.pop_front();
+      }
     }
     else
     {
@@ -277,8 +296,10 @@ std::unique_ptr<Data> Filter::normalizeOrientation(std::unique_ptr<Data> video,
     uint32_t finalDataSize = video->vInfo->width*video->vInfo->height*4;
     std::unique_ptr<uchar[]> flipped_data(new uchar[finalDataSize]);
 
-    flip_rgb(video->data.get(), flipped_data.get(), video->vInfo->width, video->vInfo->height,
-             forceHorizontalFlip || video->vInfo->flippedHorizontally, video->vInfo->flippedVertically);
+    get_conversion_kernels().flip_rgb(video->data.get(), flipped_data.get(),
+                                      video->vInfo->width, video->vInfo->height,
+                                      forceHorizontalFlip || video->vInfo->flippedHorizontally,
+                                      video->vInfo->flippedVertically);
 
 
     if (forceHorizontalFlip || video->vInfo->flippedHorizontally)
@@ -294,6 +315,29 @@ std::unique_ptr<Data> Filter::normalizeOrientation(std::unique_ptr<Data> video,
 }
 
 
+std::unique_ptr<Data> Filter::getNewestInput(uint32_t& discarded)
+{
+  bufferMutex_.lock();
+  std::unique_ptr<Data> r;
+  discarded = 0;
+  if(!inBuffer_.empty())
+  {
+    r = std::move(inBuffer_.back());
+    discarded = inBuffer_.size() - 1;
+    inBuffer_.clear();
+  }
+  inputDiscarded_ += discarded;
+  bufferMutex_.unlock();
+
+  for (uint32_t i = 0; i < discarded; ++i)
+  {
+    stats_->packetDropped(filterID_);
+  }
+
+  return r;
+}
+
+
 std::unique_ptr<Data> Filter::getInput()
 {
   bufferMutex_.lock();
@@ -470,9 +514,8 @@ Data* Filter::shallowDataCopy(Data* original) const
 
     if (original->aInfo != nullptr)
     {
-      copy->aInfo = std::unique_ptr<AudioInfo> (new AudioInfo);
-
-      copy->aInfo->sampleRate = original->aInfo->sampleRate;
+      // the audio info is plain values, so all of it is copied
+      copy->aInfo = std::unique_ptr<AudioInfo> (new AudioInfo(*original->aInfo));
     }
 
     return copy;
@@ -491,6 +534,15 @@ Data* Filter::deepDataCopy(Data* original) const
     memcpy(copy->data.get(), original->data.get(), original->data_size);
     copy->data_size = original->data_size;
 
+    if (original->vInfo != nullptr && original->vInfo->roi.data != nullptr)
+    {
+      int roiSize = original->vInfo->roi.width*original->vInfo->roi.height;
+      copy->vInfo->roi.width = original->vInfo->roi.width;
+      copy->vInfo->roi.height = original->vInfo->roi.height;
+      copy->vInfo->roi.data = std::unique_ptr<int8_t[]>(new int8_t[roiSize]);
+      memcpy(copy->vInfo->roi.data.get(), original->vInfo->roi.data.get(), roiSize);
+    }
+
     return copy;
   }
   Logger::getLogger()->printDebug(DEBUG_WARNING, this, 
@@ -522,6 +574,21 @@ bool Filter::isHEVCIntra(const unsigned char *buff) const
       (buff[4] >> 1) == 19);
 }
 
+
+bool Filter::isHEVCIRAP(const unsigned char *buff) const
+{
+  uint8_t type = (buff[4] >> 1) & 0x3f;
+  return type >= BLA_W_LP && type <= RSV_IRAP_VCL23;
+}
+
+
+bool Filter::isHEVCParameterSet(const unsigned char *buff) const
+{
+  uint8_t type = (buff[4] >> 1) & 0x3f;
+  return type == VPS_NUT || type == SPS_NUT || type == PPS_NUT;
+}
+
+
 bool Filter::isHEVCInter(const unsigned char *buff) const
 {
   return (buff[0] == 0 &&
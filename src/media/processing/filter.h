@@ -17,6 +17,7 @@
 #include <memory>
 #include <functional>
 #include <chrono>
+#include <atomic>
 
 // One of the most fundamental classes of uvgComm. A filter is an indipendent data processing
 // unit running on its own thread. Filters can be linked together to form a data processing pipeline
@@ -51,7 +52,9 @@ enum DataType {DT_NONE        = 0,
 
 enum DataSource {DS_UNKNOWN, DS_LOCAL, DS_REMOTE};
 
-enum HEVC_NAL_UNIT_TYPE {TRAIL_R = 1, IDR_W_RADL = 19,
+enum HEVC_NAL_UNIT_TYPE {TRAIL_N = 0, TRAIL_R = 1, TSA_N = 2, STSA_R = 5,
+                         RASL_N = 8, RASL_R = 9, RSV_VCL_N14 = 14,
+                         BLA_W_LP = 16, IDR_W_RADL = 19, CRA_NUT = 21, RSV_IRAP_VCL23 = 23,
                          VPS_NUT = 32, SPS_NUT = 33, PPS_NUT = 34};
 
 QString datatypeToString(const DataType type);
@@ -72,6 +75,24 @@ struct VideoInfo
 struct AudioInfo
 {
   uint16_t sampleRate = 0;
+
+  // Samples per channel in the frame, or in the PCM an encoded frame decodes
+  // to. Set where the frames are cut and used for the RTP timestamps.
+  uint16_t frameSamples = 0;
+
+  // packets lost just before this one, set by the RTP receiver
+  uint16_t lostBefore = 0;
+
+  // false if the input DSP detected no speech in this frame
+  bool voiceActivity = true;
+
+  // frames not sent just before this one because of silence (DTX). Set by
+  // the encoder for the sender and by the RTP receiver for the playback.
+  uint16_t silentBefore = 0;
+
+  // Level of the decoded frame in -dBov (RFC 6464), set by the audio mixer
+  // filter. The default is loud so that frames without a level are mixed.
+  uint8_t level = 0;
 };
 
 struct Data
@@ -114,6 +135,9 @@ public:
   void addOutConnection(std::shared_ptr<Filter> out);
   void removeOutConnection(std::shared_ptr<Filter> out);
 
+  // whether anything receives the output of this filter
+  bool hasOutputs();
+
   // callback registeration enables other classes besides Filter
   // to receive output data
   template <typename Class>
@@ -169,6 +193,10 @@ protected:
   // return: oldest element in buffer, empty if none found
   std::unique_ptr<Data> getInput();
 
+  // return: newest element in buffer, empty if none found. For filters where only the latest
+  // frame matters, the older ones are discarded without processing and their count returned.
+  std::unique_ptr<Data> getNewestInput(uint32_t& discarded);
+
   //sends output to out connections
   void sendOutput(std::unique_ptr<Data> output);
 
@@ -180,6 +208,8 @@ protected:
   // TODO: Replace with returning NAL unit
   bool isHEVCIntra(const unsigned char *buff) const;
   bool isHEVCInter(const unsigned char *buff) const;
+  bool isHEVCIRAP(const unsigned char *buff) const;
+  bool isHEVCParameterSet(const unsigned char *buff) const;
 
   void wakeUp()
   {
@@ -219,7 +249,8 @@ protected:
   void printDataBytes(QString type, const uint8_t *payload, size_t size,
                       int bytes, int shift);
 
-  unsigned int inputDiscarded_;
+  // read by the processing thread while the input thread discards
+  std::atomic<unsigned int> inputDiscarded_;
 private:
 
   std::unique_ptr<Data> validityCheck(std::unique_ptr<Data> data, bool &ok);
@@ -8,7 +8,8 @@
 #include "media/processing/openhevcfilter.h"
 
 #include "media/processing/yuvtorgb32.h"
-#include "media/processing/halfrgbfilter.h"
+#include "media/processing/scalefilter.h"
+#include "media/processing/selfviewfilter.h"
 #include "media/processing/libyuvconverter.h"
 
 #include "media/processing/displayfilter.h"
@@ -18,6 +19,7 @@
 #include "media/processing/dspfilter.h"
 #include "media/processing/audiomixerfilter.h"
 #include "media/processing/audiooutputfilter.h"
+#include "media/processing/resamplefilter.h"
 
 #ifdef uvgComm_HAVE_ONNX_RUNTIME
   #include "media/processing/roiyolofilter.h"
@@ -62,6 +64,9 @@ const int AUDIO_INPUT_GAIN = 10; // dB
 const int32_t AUDIO_OUTPUT_VOLUME = INT32_MAX - INT32_MAX/4;
 const int AUDIO_OUTPUT_GAIN = 20; // dB
 
+// self view is small so there is no point in converting it to RGB at full resolution
+const int SELF_VIEW_MAX_HEIGHT = 540;
+
 void changeState(std::shared_ptr<Filter> f, bool state);
 
 FilterGraph::FilterGraph(): QObject(),
@@ -72,6 +77,7 @@ FilterGraph::FilterGraph(): QObject(),
   cameraGraph_(),
   screenShareGraph_(),
   selfviewFilter_(nullptr),
+  encoder_(nullptr),
   roiInterface_(nullptr),
   videoFormat_(""),
   videoSendIniated_(false),
@@ -81,7 +87,8 @@ FilterGraph::FilterGraph(): QObject(),
   mixer_(),
   audioInputInitialized_(false),
   audioOutputInitialized_(false),
-  format_()
+  format_(),
+  audioFrameUs_(settingAudioFrameDuration())
 {
   // TODO negotiate these values with all included filters and SDP
   // TODO move these to settings and manage them automatically
@@ -104,6 +111,11 @@ void FilterGraph::init(QList<VideoInterface *> selfViews, StatisticsInterface* s
 
   hwResources_ = hwResources;
 
+  QObject::connect(hwResources_.get(), &ResourceAllocator::activeSpeakerChanged,
+                   this, &FilterGraph::activeSpeakerChanged, Qt::UniqueConnection);
+  QObject::connect(hwResources_.get(), &ResourceAllocator::keyframeRequested,
+                   this, &FilterGraph::keyframeRequested, Qt::UniqueConnection);
+
   if (selfViews.size() > 1)
   {
     roiInterface_ = selfViews.at(0);
@@ -122,6 +134,12 @@ void FilterGraph::init(QList<VideoInterface *> selfViews, StatisticsInterface* s
 
 void FilterGraph::updateVideoSettings()
 {
+  // the screen content QP follows the video QP
+  if (hwResources_)
+  {
+    hwResources_->updateSettings();
+  }
+
   QSettings settings(settingsFile, settingsFileFormat);
   // if the video format has changed so that we need different conversions
 
@@ -276,13 +294,6 @@ void FilterGraph::initCameraSelfView()
   if (selfviewFilter_)
   {
     Logger::getLogger()->printNormal(this, "Iniating self view");
-    // connect scaling filter
-    // TODO: not useful if it does not support YUV. Testing needed to verify
-    /*
-    ScaleFilter* scaler = new ScaleFilter("Self", stats_);
-    scaler->setResolution(selfView->size());
-    addToGraph(std::shared_ptr<Filter>(scaler), videoSend_);
-    */
 
     // Connect selfview to camera and screen sharing. The self view vertical mirroring
     // depends on which conversions are used.
@@ -295,13 +306,34 @@ void FilterGraph::initCameraSelfView()
     // is changed later.
     // Note: mirroring is slow with Qt
 
-    std::shared_ptr<Filter> resizeFilter1 = std::shared_ptr<Filter>(new HalfRGBFilter("", stats_, hwResources_));
-    std::shared_ptr<Filter> resizeFilter2 = std::shared_ptr<Filter>(new HalfRGBFilter("", stats_, hwResources_));
+    // the frames are scaled down before the RGB conversion
+    std::shared_ptr<ScaleFilter> resizeFilter1 = std::make_shared<ScaleFilter>("", stats_, hwResources_);
+    std::shared_ptr<ScaleFilter> resizeFilter2 = std::make_shared<ScaleFilter>("", stats_, hwResources_);
+    resizeFilter1->setMaxHeight(SELF_VIEW_MAX_HEIGHT);
+    resizeFilter2->setMaxHeight(SELF_VIEW_MAX_HEIGHT);
+
     if (!cameraGraph_.empty())
     {
       addToGraph(std::shared_ptr<Filter>(new LibYUVConverter("", stats_, hwResources_,
                                                              cameraGraph_.at(0)->outputType())), cameraGraph_, 0);
-      addToGraph(resizeFilter1, cameraGraph_, cameraGraph_.size() - 1);
+
+      if (selfviewFilter_->inputType() == DT_RGB32VIDEO)
+      {
+        // Scale, convert and mirror the camera frame in one pass. Formats the
+        // self view does not read are taken after the conversion to YUV420.
+        size_t source = SelfViewFilter::supportsFormat(cameraGraph_.at(0)->outputType()) ? 0 : 1;
+
+        std::shared_ptr<SelfViewFilter> selfViewConverter =
+            std::make_shared<SelfViewFilter>("", stats_, hwResources_, cameraGraph_.at(source)->outputType());
+        selfViewConverter->setMaxHeight(SELF_VIEW_MAX_HEIGHT);
+        selfViewConverter->setHorizontalMirroring(true);
+
+        addToGraph(selfViewConverter, cameraGraph_, source);
+      }
+      else
+      {
+        addToGraph(resizeFilter1, cameraGraph_, cameraGraph_.size() - 1);
+      }
       addToGraph(selfviewFilter_, cameraGraph_, cameraGraph_.size() - 1);
     }
 
@@ -314,7 +346,7 @@ void FilterGraph::initCameraSelfView()
       addToGraph(selfviewFilter_, screenShareGraph_, screenShareGraph_.size() - 1);
     }
 
-    selfviewFilter_->setHorizontalMirroring(true);
+    selfviewFilter_->setHorizontalMirroring(cameraMirroredByDisplay());
   }
   else
   {
@@ -344,11 +376,14 @@ void FilterGraph::initVideoSend()
   addToGraph(roi, cameraGraph_, cameraGraph_.size() - 1);
 #endif
 
-  std::shared_ptr<Filter> kvazaar =
-      std::shared_ptr<Filter>(new KvazaarFilter("", stats_, hwResources_));
+  encoder_ = std::shared_ptr<KvazaarFilter>(new KvazaarFilter("", stats_, hwResources_));
+  encoder_->setScreenContent(settingEnabled(SettingsKey::screenShareStatus));
+
+  QObject::connect(encoder_.get(), &KvazaarFilter::parameterSetsChanged,
+                   this, &FilterGraph::parameterSetsChanged);
 
-  addToGraph(kvazaar, cameraGraph_, cameraGraph_.size() - 1);
-  addToGraph(kvazaar, screenShareGraph_, 0);
+  addToGraph(encoder_, cameraGraph_, cameraGraph_.size() - 1);
+  addToGraph(encoder_, screenShareGraph_, 0);
 
   videoSendIniated_ = true;
 }
@@ -356,7 +391,8 @@ void FilterGraph::initVideoSend()
 
 void FilterGraph::initializeAudioInput(bool opus)
 {
-  audioCapture_ = std::shared_ptr<AudioCaptureFilter>(new AudioCaptureFilter("", format_, stats_, hwResources_));
+  audioCapture_ = std::shared_ptr<AudioCaptureFilter>(new AudioCaptureFilter("", format_, audioFrameUs_,
+                                                                         stats_, hwResources_));
 
   if (audioOutput_)
   {
@@ -368,22 +404,32 @@ void FilterGraph::initializeAudioInput(bool opus)
   // Do this before adding participants, otherwise AEC filter wont get attached
   addToGraph(audioCapture_, audioInputGraph_);
 
+  // the rest of the graph and the codec use one rate
+  if (audioCapture_->format().sampleRate() != format_.sampleRate())
+  {
+    addToGraph(std::make_shared<ResampleFilter>("", stats_, hwResources_,
+                                                audioCapture_->format(), format_, audioFrameUs_),
+               audioInputGraph_, (unsigned int)audioInputGraph_.size() - 1);
+  }
+
   if (aec_ == nullptr)
   {
-    aec_ = std::make_shared<SpeexAEC>(format_);
+    aec_ = std::make_shared<SpeexAEC>(format_, audioFrameUs_, stats_);
     aec_->init();
   }
 
-  // Do everything (AGC, AEC, denoise, dereverb) for input expect provide AEC reference
+  // Do everything (AGC, AEC, denoise, dereverb, VAD) for input expect provide AEC reference
   std::shared_ptr<DSPFilter> dspProcessor =
       std::shared_ptr<DSPFilter>(new DSPFilter("", stats_, hwResources_, aec_, format_,
-                                               false, true, true, true, true, AUDIO_INPUT_VOLUME, AUDIO_INPUT_GAIN));
+                                               audioFrameUs_, false, true, true, true, true, true,
+                                               AUDIO_INPUT_VOLUME, AUDIO_INPUT_GAIN));
 
   addToGraph(dspProcessor, audioInputGraph_, (unsigned int)audioInputGraph_.size() - 1);
 
   if (opus)
   {
-    addToGraph(std::shared_ptr<Filter>(new OpusEncoderFilter("", format_, stats_, hwResources_)),
+    addToGraph(std::shared_ptr<Filter>(new OpusEncoderFilter("", format_, audioFrameUs_,
+                                                             stats_, hwResources_)),
                audioInputGraph_, (unsigned int)audioInputGraph_.size() - 1);
   }
 
@@ -397,17 +443,27 @@ void FilterGraph::initializeAudioOutput(bool opus)
 
   if (aec_ == nullptr)
   {
-    aec_ = std::make_shared<SpeexAEC>(format_);
+    aec_ = std::make_shared<SpeexAEC>(format_, audioFrameUs_, stats_);
     aec_->init();
   }
 
   // Provide echo reference and do AGC once more so conference calls will have
   // good volume levels.
   addToGraph(std::make_shared<DSPFilter>("", stats_, hwResources_, aec_, format_,
-                                         true, false, false, false, true, AUDIO_OUTPUT_VOLUME, AUDIO_OUTPUT_GAIN),
+                                         audioFrameUs_, true, false, false, false, true, false,
+                                         AUDIO_OUTPUT_VOLUME, AUDIO_OUTPUT_GAIN),
              audioOutputGraph_);
 
-  audioOutput_ = std::make_shared<AudioOutputFilter>("", stats_, hwResources_, format_);
+  audioOutput_ = std::make_shared<AudioOutputFilter>("", stats_, hwResources_, format_,
+                                                     audioFrameUs_);
+
+  if (audioOutput_->format().sampleRate() > 0 &&
+      audioOutput_->format().sampleRate() != format_.sampleRate())
+  {
+    addToGraph(std::make_shared<ResampleFilter>("", stats_, hwResources_,
+                                                format_, audioOutput_->format(), audioFrameUs_),
+               audioOutputGraph_, (unsigned int)audioOutputGraph_.size() - 1);
+  }
 
   addToGraph(audioOutput_, audioOutputGraph_, (unsigned int)audioOutputGraph_.size() - 1);
 
@@ -550,6 +606,21 @@ void FilterGraph::sendVideoto(uint32_t sessionID, std::shared_ptr<Filter> videoF
 
     cameraGraph_.back()->addOutConnection(videoFramedSource);
     videoFramedSource->start();
+
+    if (encoder_)
+    {
+      // screen content has long intra periods so the new receiver needs a keyframe
+      if (settingEnabled(SettingsKey::screenShareStatus))
+      {
+        encoder_->requestKeyframe();
+      }
+      else
+      {
+        encoder_->resendParameterSets();
+      }
+    }
+
+    rebalanceThreads();
   }
   else
   {
@@ -559,7 +630,8 @@ void FilterGraph::sendVideoto(uint32_t sessionID, std::shared_ptr<Filter> videoF
 
 
 void FilterGraph::receiveVideoFrom(uint32_t sessionID, std::shared_ptr<Filter> videoSink,
-                                   VideoInterface *view, const MediaID &id)
+                                   VideoInterface *view, const MediaID &id,
+                                   const QList<QByteArray> &parameterSets)
 {
   Q_ASSERT(sessionID);
   Q_ASSERT(videoSink);
@@ -574,13 +646,36 @@ void FilterGraph::receiveVideoFrom(uint32_t sessionID, std::shared_ptr<Filter> v
     peers_[sessionID]->videoReceivers.push_back(graph);
 
     addToGraph(videoSink, *graph);
-    addToGraph(std::shared_ptr<Filter>(new OpenHEVCFilter(sessionID, stats_, hwResources_)), *graph, 0);
+
+    std::shared_ptr<OpenHEVCFilter> decoder =
+        std::shared_ptr<OpenHEVCFilter>(new OpenHEVCFilter(sessionID, stats_, hwResources_));
+    decoder->setParameterSets(parameterSets);
+    peers_[sessionID]->decoders.push_back(decoder);
+
+    // the new decoder takes its share of the threads from others
+    rebalanceThreads();
+    activeSpeakerChanged(hwResources_->getActiveSpeaker());
+
+    addToGraph(decoder, *graph, 0);
+
+    // small views such as conference thumbnails get smaller frames so the
+    // pixels that are not visible are not converted or drawn
+    std::shared_ptr<ScaleFilter> scaler = std::make_shared<ScaleFilter>(QString::number(sessionID),
+                                                                        stats_, hwResources_);
+    scaler->setTargetSize([view](){ return view->drawSize(); });
+    addToGraph(scaler, *graph, 1);
 
     std::shared_ptr<DisplayFilter> displayFilter =
         std::shared_ptr<DisplayFilter>(new DisplayFilter(QString::number(sessionID),
                                                          stats_, hwResources_, {view}, sessionID));
 
-    addToGraph(displayFilter, *graph, 1);
+    // the conversion to RGB is only added if the view cannot draw YUV itself
+    if (displayFilter->inputType() == DT_YUV420VIDEO)
+    {
+      Logger::getLogger()->printNormal(this, "Drawing received video without conversion to RGB");
+    }
+
+    addToGraph(displayFilter, *graph, 2);
   }
   else
   {
@@ -647,14 +742,15 @@ void FilterGraph::receiveAudioFrom(uint32_t sessionID, std::shared_ptr<Filter> a
     if (audioSink->outputType() == DT_OPUSAUDIO)
     {
       std::shared_ptr<OpusDecoderFilter> decoder =
-          std::shared_ptr<OpusDecoderFilter>(new OpusDecoderFilter(sessionID, format_, stats_, hwResources_));
+          std::shared_ptr<OpusDecoderFilter>(new OpusDecoderFilter(sessionID, format_, audioFrameUs_,
+                                                                  stats_, hwResources_));
       addToGraph(decoder, *graph, (unsigned int)graph->size() - 1);
     }
 
     // mixer helps mix the incoming audio streams into one output stream
     if (mixer_ == nullptr)
     {
-      mixer_ = std::make_shared<AudioMixer>();
+      mixer_ = std::make_shared<AudioMixer>(audioFrameUs_);
     }
 
     std::shared_ptr<AudioMixerFilter> audioMixer =
@@ -699,6 +795,7 @@ void FilterGraph::uninit()
   removeAllParticipants();
 
   destroyFilters(cameraGraph_);
+  encoder_ = nullptr;
   videoSendIniated_ = false;
 
   destroyFilters(screenShareGraph_);
@@ -774,13 +871,20 @@ void FilterGraph::camera(bool state)
     {
       Logger::getLogger()->printNormal(this, "Starting camera", "Output Type",
                                        QString::number(cameraGraph_.at(0)->outputType()));
-      selfviewFilter_->setHorizontalMirroring(true);
+      selfviewFilter_->setHorizontalMirroring(cameraMirroredByDisplay());
       cameraGraph_.at(0)->start();
     }
   }
 }
 
 
+bool FilterGraph::cameraMirroredByDisplay()
+{
+  // the RGB32 self view is mirrored already when it is converted from the camera format
+  return selfviewFilter_->inputType() != DT_RGB32VIDEO;
+}
+
+
 void FilterGraph::screenShare(bool shareState)
 {
   if(screenShareGraph_.size() > 0)
@@ -810,7 +914,15 @@ void FilterGraph::screenShare(bool shareState)
 
 void FilterGraph::selectVideoSource()
 {
-  if (settingEnabled(SettingsKey::screenShareStatus))
+  bool screenShareEnabled = settingEnabled(SettingsKey::screenShareStatus);
+
+  // screen content is encoded with its own profile
+  if (encoder_)
+  {
+    encoder_->setScreenContent(screenShareEnabled);
+  }
+
+  if (screenShareEnabled)
   {
     Logger::getLogger()->printNormal(this, "Enabled screen sharing in filter graph");
     camera(false);
@@ -831,6 +943,9 @@ void FilterGraph::selectVideoSource()
 
     // maybe some custom image here?
   }
+
+  // the decoders may use the threads of the encoder when we don't send video
+  rebalanceThreads();
 }
 
 
@@ -942,6 +1057,103 @@ void FilterGraph::destroyPeer(Peer* peer)
 }
 
 
+void FilterGraph::rebalanceThreads()
+{
+  if (!hwResources_)
+  {
+    return;
+  }
+
+  int decoders = 0;
+  bool sendingVideo = false;
+  for (auto& peer : peers_)
+  {
+    if (peer.second != nullptr)
+    {
+      decoders += peer.second->decoders.size();
+      sendingVideo |= !peer.second->videoSenders.empty();
+    }
+  }
+
+  // the encoder only works while the camera or screen share is on
+  bool videoSource = settingEnabled(SettingsKey::screenShareStatus) ||
+      settingEnabled(SettingsKey::cameraStatus);
+
+  hwResources_->setVideoDecoders(decoders);
+  hwResources_->setVideoEncoding(encoder_ != nullptr && sendingVideo && videoSource);
+
+  if (encoder_)
+  {
+    encoder_->rebalanceThreads();
+  }
+
+  for (auto& peer : peers_)
+  {
+    if (peer.second != nullptr)
+    {
+      for (auto& decoder : peer.second->decoders)
+      {
+        decoder->rebalanceThreads();
+      }
+    }
+  }
+}
+
+
+void FilterGraph::activeSpeakerChanged(uint32_t sessionID)
+{
+  for (auto& peer : peers_)
+  {
+    if (peer.second != nullptr)
+    {
+      DecodePriority priority = DECODE_PRIORITY_NORMAL;
+      if (sessionID != 0)
+      {
+        priority = peer.first == sessionID ? DECODE_PRIORITY_HIGH : DECODE_PRIORITY_LOW;
+      }
+
+      for (auto& decoder : peer.second->decoders)
+      {
+        decoder->setDecodePriority(priority);
+      }
+    }
+  }
+}
+
+
+void FilterGraph::keyframeRequested(uint32_t sessionID)
+{
+  if (encoder_ && peers_.find(sessionID) != peers_.end())
+  {
+    encoder_->requestKeyframe();
+  }
+}
+
+
+void FilterGraph::setAudioFrameDuration(uint32_t frameUs)
+{
+  if (frameUs == 0 || frameUs == audioFrameUs_)
+  {
+    return;
+  }
+
+  if (audioInputInitialized_ || audioOutputInitialized_)
+  {
+    Logger::getLogger()->printWarning(this, "Audio frame duration can't be changed while audio "
+                                            "is in use, keeping the current one",
+                                      {"Current", "Negotiated"},
+                                      {packetTimeString(audioFrameUs_) + " ms",
+                                       packetTimeString(frameUs) + " ms"});
+    return;
+  }
+
+  audioFrameUs_ = supportedAudioFrameDuration(frameUs);
+
+  Logger::getLogger()->printNormal(this, "Audio frame duration set", {"Duration"},
+                                   {packetTimeString(audioFrameUs_) + " ms"});
+}
+
+
 void FilterGraph::removeParticipant(uint32_t sessionID)
 {
   if (peers_.find(sessionID) != peers_.end() &&
@@ -954,6 +1166,13 @@ void FilterGraph::removeParticipant(uint32_t sessionID)
     destroyPeer(peers_[sessionID]);
     peers_[sessionID] = nullptr;
 
+    rebalanceThreads();
+
+    if (hwResources_)
+    {
+      hwResources_->removeSpeaker(sessionID);
+    }
+
     // destroy send graphs if this was the last peer
     bool peerPresent = false;
     for(auto& peer : peers_)
@@ -970,9 +1189,15 @@ void FilterGraph::removeParticipant(uint32_t sessionID)
       destroyFilters(screenShareGraph_);
       destroyFilters(audioInputGraph_);
       destroyFilters(audioOutputGraph_);
+      encoder_ = nullptr;
       audioOutput_ = nullptr;
       audioCapture_ = nullptr;
 
+      // the next call may negotiate another frame duration
+      aec_ = nullptr;
+      mixer_ = nullptr;
+      audioFrameUs_ = settingAudioFrameDuration();
+
       videoSendIniated_ = false;
       audioInputInitialized_ = false;
       audioOutputInitialized_ = false;
@@ -13,6 +13,8 @@ class StatisticsInterface;
 
 class Filter;
 class ScreenShareFilter;
+class KvazaarFilter;
+class OpenHEVCFilter;
 class DisplayFilter;
 class AudioCaptureFilter;
 class AudioOutputFilter;
@@ -38,25 +40,42 @@ public:
   void sendVideoto(uint32_t sessionID, std::shared_ptr<Filter> videoFramedSource,
                    const MediaID &id);
 
+  // parameter sets are the sprop NAL units from the sender SDP, if any
   void receiveVideoFrom(uint32_t sessionID, std::shared_ptr<Filter> videoSink,
                         VideoInterface *view,
-                        const MediaID &id);
+                        const MediaID &id,
+                        const QList<QByteArray>& parameterSets = {});
   void sendAudioTo(uint32_t sessionID, std::shared_ptr<Filter> audioFramedSource,
                    const MediaID &id);
   void receiveAudioFrom(uint32_t sessionID, std::shared_ptr<Filter> audioSink,
                         const MediaID &id);
 
+  // The audio frame duration negotiated for a call in microseconds. The audio
+  // graphs are shared by all calls so it can only change while they don't exist.
+  void setAudioFrameDuration(uint32_t frameUs);
+
   // removes participant and all its associated filter from filter graph.
   void removeParticipant(uint32_t sessionID);
 
   void running(bool state);
 
+signals:
+
+  // our encoder has new parameter sets which should be advertised to peers
+  void parameterSetsChanged(QByteArray vps, QByteArray sps, QByteArray pps);
+
 public slots:
 
   void updateVideoSettings();
   void updateAudioSettings();
   void updateAutomaticSettings();
 
+  // the decoder of the active speaker is prioritized over the others
+  void activeSpeakerChanged(uint32_t sessionID);
+
+  // a peer cannot decode our video before the next keyframe
+  void keyframeRequested(uint32_t sessionID);
+
 private:
 
   void selectVideoSource();
@@ -80,6 +99,9 @@ private:
   // iniates camera and attaches a self view to it.
   void initCameraSelfView();
 
+  // whether the display filter has to mirror the camera self view
+  bool cameraMirroredByDisplay();
+
   // iniates encoder and attaches it
   void initVideoSend();
 
@@ -105,8 +127,14 @@ private:
     // Each graphsegment receives one mediastream.
     std::vector<std::shared_ptr<GraphSegment>> videoReceivers;
     std::vector<std::shared_ptr<GraphSegment>> audioReceivers;
+
+    // decoders are also in videoReceivers, these are for thread rebalancing
+    std::vector<std::shared_ptr<OpenHEVCFilter>> decoders;
   };
 
+  // divides the thread budget again after participants have changed
+  void rebalanceThreads();
+
   // destroy all filters associated with this peer.
   void destroyPeer(Peer* peer);
 
@@ -127,6 +155,9 @@ private:
   GraphSegment screenShareGraph_;
 
   std::shared_ptr<DisplayFilter> selfviewFilter_;
+
+  // shared by camera and screen share graphs
+  std::shared_ptr<KvazaarFilter> encoder_;
   VideoInterface* roiInterface_; // this is the roi surface from settings
 
   QString videoFormat_;
@@ -148,4 +179,5 @@ private:
 
   // audio configs
   QAudioFormat format_;
+  uint32_t audioFrameUs_;
 };
@@ -29,8 +29,8 @@ void HalfRGBFilter::process()
       uint32_t finalDataSize = input->data_size/4;
       std::unique_ptr<uchar[]> rgb_data(new uchar[finalDataSize]);
 
-      half_rgb(input->data.get(), rgb_data.get(),
-               input->vInfo->width, input->vInfo->height);
+      get_conversion_kernels().half_rgb(input->data.get(), rgb_data.get(),
+                                        input->vInfo->width, input->vInfo->height);
 
       input->data = std::move(rgb_data);
       input->data_size = finalDataSize;
@@ -2,6 +2,8 @@
 
 #include "statisticsinterface.h"
 
+#include "media/resourceallocator.h"
+
 #include "settingskeys.h"
 #include "logger.h"
 
@@ -9,10 +11,24 @@
 
 #include <QtDebug>
 #include <QTime>
+#include <QDateTime>
 #include <QSize>
 
 enum RETURN_STATUS {C_SUCCESS = 0, C_FAILURE = -1};
 
+// Screen content profile. Text and sharp edges suffer from the QP offsets of
+// the hierarchical GOP, so we use a flat QP structure with lower QP.
+// Screen content changes seldom so intra frames are spread far apart and instead
+// sent when requested.
+const QString SCREEN_PRESET = "ultrafast";
+const int SCREEN_INTRA_PERIOD_SECONDS = 10;
+
+// Each keyframe restarts the encoder for all receivers. The requests of
+// different receivers are combined and restarts made at most this often.
+const int64_t MIN_RESTART_INTERVAL_MS = 1000;
+
+const uint8_t START_CODE[4] = {0, 0, 0, 1};
+
 KvazaarFilter::KvazaarFilter(QString id, StatisticsInterface *stats,
                              std::shared_ptr<ResourceAllocator> hwResources):
   Filter(id, "Kvazaar", stats, hwResources, DT_YUV420VIDEO, DT_HEVCVIDEO),
@@ -22,7 +38,16 @@ KvazaarFilter::KvazaarFilter(QString id, StatisticsInterface *stats,
   pts_(0),
   encodingFrames_(),
   inputPics_(),
-  nextInputPic_(-1)
+  nextInputPic_(-1),
+  screenContent_(false),
+  keyframeRequested_(false),
+  lastRestart_(0),
+  threads_(0),
+  parameterSetMutex_(),
+  vps_(),
+  sps_(),
+  pps_(),
+  resendParameterSets_(false)
 {
   maxBufferSize_ = 30;
 }
@@ -110,7 +135,7 @@ void KvazaarFilter::updateSettings()
   {
     Logger::getLogger()->printNormal(this, "Failed to change resolution");
   }
-  encodingFrames_.clear();
+  clearEncodingFrames();
   settingsMutex_.unlock();
 
   start();
@@ -119,6 +144,74 @@ void KvazaarFilter::updateSettings()
 }
 
 
+void KvazaarFilter::setScreenContent(bool screenContent)
+{
+  if (screenContent_ == screenContent)
+  {
+    return;
+  }
+
+  Logger::getLogger()->printNormal(this, "Changing encoding profile", "Profile",
+                                   screenContent ? "Screen" : "Camera");
+
+  screenContent_ = screenContent;
+
+  // the profile is taken into account when the encoder is opened
+  if (api_)
+  {
+    updateSettings();
+  }
+}
+
+
+void KvazaarFilter::requestKeyframe()
+{
+  keyframeRequested_ = true;
+
+  // the restarted encoder sends new parameter sets with the keyframe,
+  // but these are needed if the keyframe is delayed by encoding queue
+  resendParameterSets_ = true;
+}
+
+
+void KvazaarFilter::resendParameterSets()
+{
+  resendParameterSets_ = true;
+}
+
+
+void KvazaarFilter::rebalanceThreads()
+{
+  QSettings settings(settingsFile, settingsFileFormat);
+
+  // the new thread count is taken into use when the encoder is restarted
+  if (api_ && getThreadCount(settings) != threads_)
+  {
+    requestKeyframe();
+  }
+}
+
+
+int KvazaarFilter::getThreadCount(QSettings& settings)
+{
+  int budget = getHWManager()->getEncoderThreads(settings.value(SettingsKey::videoResolutionWidth).toInt(),
+                                                 settings.value(SettingsKey::videoResolutionHeight).toInt());
+
+  if (settings.value(SettingsKey::videoKvzThreads) == "auto")
+  {
+    return budget;
+  }
+  else if (settings.value(SettingsKey::videoKvzThreads) == "Main")
+  {
+    return 0;
+  }
+
+  // the setting is the maximum
+  int threads = settings.value(SettingsKey::videoKvzThreads).toInt();
+  return threads < budget ? threads : budget;
+}
+
+
 bool KvazaarFilter::init()
 {
   Logger::getLogger()->printNormal(this, "Iniating Kvazaar");
@@ -160,6 +253,11 @@ bool KvazaarFilter::init()
     api_->config_init(config_);
 
     QString preset = settings.value(SettingsKey::videoPreset).toString().toUtf8();
+
+    if (screenContent_)
+    {
+      preset = SCREEN_PRESET;
+    }
     
     QString resolutionStr = settings.value(SettingsKey::videoResolutionWidth).toString() + "x" +
         settings.value(SettingsKey::videoResolutionHeight).toString();
@@ -173,23 +271,10 @@ bool KvazaarFilter::init()
     api_->config_parse(config_, "input-res", resolutionStr.toLocal8Bit());
     api_->config_parse(config_, "input-fps", framerate.toLocal8Bit());
 
-    QString threads = "0";
-
     // parallelization
-    if (settings.value(SettingsKey::videoKvzThreads) == "auto")
-    {
-      threads = QString::number(QThread::idealThreadCount());
-    }
-    else if (settings.value(SettingsKey::videoKvzThreads) == "Main")
-    {
-      threads = QString::number(0);
-    }
-    else
-    {
-      threads = settings.value(SettingsKey::videoKvzThreads).toString();
-    }
+    threads_ = getThreadCount(settings);
 
-    api_->config_parse(config_, "threads", threads.toLocal8Bit());
+    api_->config_parse(config_, "threads", QString::number(threads_).toLocal8Bit());
     api_->config_parse(config_, "owf", settings.value(SettingsKey::videoOWF).toString().toLocal8Bit());
     api_->config_parse(config_, "wpp", settings.value(SettingsKey::videoWPP).toString().toLocal8Bit());
 
@@ -283,6 +368,11 @@ bool KvazaarFilter::init()
       api_->config_parse(config_, "vaq", settings.value(SettingsKey::videoVAQ).toString().toLocal8Bit());
     }
 
+    if (screenContent_)
+    {
+      screenContentParameters();
+    }
+
     // compression-tab
     customParameters(settings);
 
@@ -341,6 +431,21 @@ void KvazaarFilter::process()
       break;
     }
     settingsMutex_.lock();
+    int64_t now = QDateTime::currentMSecsSinceEpoch();
+    if (keyframeRequested_ && now - lastRestart_ >= MIN_RESTART_INTERVAL_MS)
+    {
+      restartEncoder();
+      lastRestart_ = now;
+
+      // the keyframe of this restart also answers the requests made during it
+      keyframeRequested_ = false;
+
+      if (inputPics_.empty())
+      {
+        settingsMutex_.unlock();
+        break;
+      }
+    }
     feedInput(std::move(input));
     settingsMutex_.unlock();
 
@@ -371,6 +476,84 @@ void KvazaarFilter::customParameters(QSettings& settings)
 }
 
 
+void KvazaarFilter::screenContentParameters()
+{
+  int qp = getHWManager()->getScreenContentQp();
+
+  int framerate = config_->framerate_num/config_->framerate_denom;
+  if (framerate <= 0)
+  {
+    framerate = 1;
+  }
+
+  Logger::getLogger()->printNormal(this, "Using screen content parameters",
+                                   {"Preset", "QP", "Intra period"},
+                                   {SCREEN_PRESET, QString::number(qp),
+                                    QString::number(SCREEN_INTRA_PERIOD_SECONDS) + " s"});
+
+  api_->config_parse(config_, "qp",         QString::number(qp).toLocal8Bit());
+  api_->config_parse(config_, "gop",        "0");
+  api_->config_parse(config_, "vaq",        "0");
+  api_->config_parse(config_, "period",
+                     QString::number(framerate*SCREEN_INTRA_PERIOD_SECONDS).toLocal8Bit());
+
+  // parameter sets are included with every intra frame so a keyframe is enough
+  // for a new receiver to start decoding
+  api_->config_parse(config_, "vps-period", "1");
+}
+
+
+void KvazaarFilter::restartEncoder()
+{
+  Logger::getLogger()->printNormal(this, "Restarting encoder for a keyframe");
+
+  kvz_picture *recon_pic = nullptr;
+  kvz_frame_info frame_info;
+  kvz_data_chunk *data_out = nullptr;
+  uint32_t len_out = 0;
+
+  // flush the frames still in the encoder
+  while (!encodingFrames_.empty())
+  {
+    api_->encoder_encode(enc_, nullptr,
+                         &data_out, &len_out,
+                         &recon_pic, nullptr,
+                         &frame_info );
+
+    if (data_out == nullptr)
+    {
+      break;
+    }
+
+    parseEncodedFrame(data_out, len_out, recon_pic);
+  }
+
+  close();
+
+  if (!init())
+  {
+    Logger::getLogger()->printError(this, "Failed to restart Kvazaar");
+  }
+
+  clearEncodingFrames();
+}
+
+
+void KvazaarFilter::clearEncodingFrames()
+{
+  for (auto& info : encodingFrames_)
+  {
+    if (info.roi_array)
+    {
+      delete[] info.roi_array;
+      info.roi_array = nullptr;
+    }
+  }
+
+  encodingFrames_.clear();
+}
+
+
 void KvazaarFilter::feedInput(std::unique_ptr<Data> input)
 {
   kvz_picture *recon_pic = nullptr;
@@ -420,6 +603,16 @@ void KvazaarFilter::feedInput(std::unique_ptr<Data> input)
   inputPic->pts = pts_;
   ++pts_;
 
+  // The dirty block map of screen content would leave the unchanged areas of
+  // an intra frame with poor quality, so it is only used for inter frames.
+  bool intraFrame = config_->intra_period > 0 ? inputPic->pts % config_->intra_period == 0 :
+                                                inputPic->pts == 0;
+
+  if (screenContent_ && intraFrame)
+  {
+    input->vInfo->roi.data = nullptr;
+  }
+
   if (config_->target_bitrate == 0)
   {
     // can also be empty by default
@@ -458,7 +651,7 @@ void KvazaarFilter::parseEncodedFrame(kvz_data_chunk *data_out,
 
   if (info.roi_array)
   {
-    delete info.roi_array;
+    delete[] info.roi_array;
     info.roi_array = nullptr;
   }
 
@@ -474,10 +667,12 @@ void KvazaarFilter::parseEncodedFrame(kvz_data_chunk *data_out,
   }
   api_->chunk_free(data_out);
   api_->picture_free(recon_pic);
+
+  cacheParameterSets(hevc_frame.get(), dataWritten);
   
   uint32_t delay = QDateTime::currentMSecsSinceEpoch() - info.data->creationTimestamp;
-  getStats()->encodingDelay("video", delay);
-  getStats()->addEncodedPacket("video", len_out);
+  getStats()->encodingDelay(STATS_VIDEO, delay);
+  getStats()->addEncodedPacket(STATS_VIDEO, len_out);
 
   // send last packet reusing input structure
   sendEncodedFrame(std::move(info.data), std::move(hevc_frame), dataWritten);
@@ -488,8 +683,124 @@ void KvazaarFilter::sendEncodedFrame(std::unique_ptr<Data> input,
                                      std::unique_ptr<uchar[]> hevc_frame,
                                      uint32_t dataWritten)
 {
+  if (resendParameterSets_)
+  {
+    resendParameterSets_ = false;
+    prependParameterSets(hevc_frame, dataWritten);
+  }
+
   input->type = DT_HEVCVIDEO;
   input->data_size = dataWritten;
   input->data = std::move(hevc_frame);
   sendOutput(std::move(input));
 }
+
+
+void KvazaarFilter::cacheParameterSets(const uint8_t* frame, uint32_t size)
+{
+  QByteArray vps;
+  QByteArray sps;
+  QByteArray pps;
+
+  // go through NAL units separated by three or four byte start codes
+  uint32_t nalStart = 0;
+  for (uint32_t i = 0; i + 3 <= size; ++i)
+  {
+    bool startCode = frame[i] == 0 && frame[i + 1] == 0 && frame[i + 2] == 1;
+
+    if (startCode || i + 3 == size)
+    {
+      if (nalStart != 0)
+      {
+        uint32_t nalEnd = startCode ? i : size;
+
+        // the fourth byte of a start code is not part of the previous NAL unit
+        if (startCode && nalEnd > nalStart && frame[nalEnd - 1] == 0)
+        {
+          --nalEnd;
+        }
+
+        uint8_t nalType = (frame[nalStart] >> 1) & 0x3f;
+        QByteArray nal((const char*)&frame[nalStart], nalEnd - nalStart);
+
+        if (nalType == VPS_NUT)
+        {
+          vps = nal;
+        }
+        else if (nalType == SPS_NUT)
+        {
+          sps = nal;
+        }
+        else if (nalType == PPS_NUT)
+        {
+          pps = nal;
+        }
+        else
+        {
+          // parameter sets are always before the slices
+          break;
+        }
+      }
+
+      nalStart = i + 3;
+      i += 2;
+    }
+  }
+
+  if (vps.isEmpty() || sps.isEmpty() || pps.isEmpty())
+  {
+    return;
+  }
+
+  parameterSetMutex_.lock();
+  bool changed = vps != vps_ || sps != sps_ || pps != pps_;
+  if (changed)
+  {
+    vps_ = vps;
+    sps_ = sps;
+    pps_ = pps;
+  }
+  parameterSetMutex_.unlock();
+
+  if (changed)
+  {
+    Logger::getLogger()->printNormal(this, "Encoder parameter sets changed");
+    emit parameterSetsChanged(vps, sps, pps);
+  }
+}
+
+
+void KvazaarFilter::prependParameterSets(std::unique_ptr<uchar[]>& hevc_frame,
+                                         uint32_t& dataWritten)
+{
+  // frames which begin with VPS have all the parameter sets
+  if (dataWritten > 4 && ((hevc_frame[4] >> 1) & 0x3f) == VPS_NUT)
+  {
+    return;
+  }
+
+  parameterSetMutex_.lock();
+  if (vps_.isEmpty())
+  {
+    parameterSetMutex_.unlock();
+    return;
+  }
+
+  uint32_t parameterSize = 3*sizeof(START_CODE) + vps_.size() + sps_.size() + pps_.size();
+  std::unique_ptr<uchar[]> combined(new uchar[parameterSize + dataWritten]);
+  uint8_t* writer = combined.get();
+
+  for (const QByteArray* nal : {&vps_, &sps_, &pps_})
+  {
+    memcpy(writer, START_CODE, sizeof(START_CODE));
+    writer += sizeof(START_CODE);
+    memcpy(writer, nal->constData(), nal->size());
+    writer += nal->size();
+  }
+  parameterSetMutex_.unlock();
+
+  memcpy(writer, hevc_frame.get(), dataWritten);
+
+  hevc_frame = std::move(combined);
+  dataWritten += parameterSize;
+}
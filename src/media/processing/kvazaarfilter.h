@@ -3,6 +3,10 @@
 
 #include <QSize>
 #include <QSettings>
+#include <QByteArray>
+#include <QMutex>
+
+#include <atomic>
 
 struct kvz_api;
 struct kvz_config;
@@ -12,6 +16,7 @@ struct kvz_data_chunk;
 
 class KvazaarFilter : public Filter
 {
+  Q_OBJECT
 public:
   KvazaarFilter(QString id, StatisticsInterface* stats,
                 std::shared_ptr<ResourceAllocator> hwResources);
@@ -22,6 +27,26 @@ public:
 
   void close();
 
+  // switch between camera and screen content encoding profiles.
+  // Reinitializes the encoder if the profile changes.
+  void setScreenContent(bool screenContent);
+
+  // The next frame is encoded as an intra frame, or the first frame after the
+  // previous restart is far enough in the past.
+  void requestKeyframe();
+
+  // restarts the encoder if the thread budget has changed
+  void rebalanceThreads();
+
+  // the cached parameter sets are sent before the next frame so new receivers can
+  // start decoding without waiting for the next VPS
+  void resendParameterSets();
+
+signals:
+
+  // parameter sets are NAL units without start code
+  void parameterSetsChanged(QByteArray vps, QByteArray sps, QByteArray pps);
+
 protected:
   virtual void process();
 
@@ -29,6 +54,18 @@ private:
 
   void customParameters(QSettings& settings);
 
+  // thread count from budget limited by settings
+  int getThreadCount(QSettings& settings);
+
+  // screen content is mostly static text with sharp edges
+  void screenContentParameters();
+
+  // encode the remaining frames and restart the encoder so it begins with an IDR
+  void restartEncoder();
+
+  // forgets the frames still in the encoder and frees their ROI maps
+  void clearEncodingFrames();
+
   // copy the frame data to kvazaar input in suitable format.
   void feedInput(std::unique_ptr<Data> input);
 
@@ -36,6 +73,12 @@ private:
   void parseEncodedFrame(kvz_data_chunk *data_out, uint32_t len_out,
                          kvz_picture *recon_pic);
 
+  // stores the parameter sets found in the encoded frame
+  void cacheParameterSets(const uint8_t* frame, uint32_t size);
+
+  // adds the cached parameter sets in front of the frame unless it already has them
+  void prependParameterSets(std::unique_ptr<uchar[]>& hevc_frame, uint32_t& dataWritten);
+
   void sendEncodedFrame(std::unique_ptr<Data> input,
                         std::unique_ptr<uchar[]> hevc_frame,
                         uint32_t dataWritten);
@@ -58,6 +101,22 @@ private:
   int nextInputPic_;
 
   QMutex settingsMutex_;
+
+  bool screenContent_;
+  // requests are combined until the encoder can be restarted again
+  std::atomic<bool> keyframeRequested_;
+  int64_t lastRestart_;
+
+  int threads_;
+
+  // latest parameter sets from the encoder
+  QMutex parameterSetMutex_;
+  QByteArray vps_;
+  QByteArray sps_;
+  QByteArray pps_;
+
+  std::atomic<bool> resendParameterSets_;
+
   struct FrameInfo
   {
     std::unique_ptr<Data> data;
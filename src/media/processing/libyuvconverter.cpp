@@ -23,6 +23,14 @@ void LibYUVConverter::process()
 
   while(input)
   {
+    // The camera conversion only feeds the encoder when the self view reads
+    // the camera format, so outside calls there is nobody to convert for.
+    if (!hasOutputs())
+    {
+      input = getInput();
+      continue;
+    }
+
     uint32_t fourcc = 0;
 
     switch(inputType())
@@ -2,14 +2,35 @@
 
 #include "statisticsinterface.h"
 
+#include "media/resourceallocator.h"
+
 #include "common.h"
 #include "settingskeys.h"
 #include "logger.h"
 
 #include <QSettings>
+#include <QDateTime>
 
 enum OHThreadType {OH_THREAD_FRAME  = 1, OH_THREAD_SLICE = 2, OH_THREAD_FRAMESLICE  = 3};
 
+// The input queue is mainly bounded by time. When NAL units have waited longer
+// than the budget, we skip pictures that are not used as reference. If the wait
+// exceeds the maximum, we skip everything until the next IRAP picture and ask
+// the peer for one. With low-delay GOPs every picture is a reference, so only
+// the latter helps.
+const int64_t DECODE_LATENCY_BUDGET_MS = 100;
+const int64_t MAX_QUEUE_LATENCY_MS = 300;
+
+// The hard limit of NAL units in queue in case the decoder stalls completely.
+// Exceeding it discards input, after which we skip to the next IRAP picture.
+const int MAX_INPUT_NAL_UNITS = 120;
+
+// While waiting for an IRAP picture, the keyframe request is repeated in case
+// it was lost, since the intra period of the peer may be many seconds.
+const int64_t KEYFRAME_REQUEST_INTERVAL_MS = 1000;
+
+const char START_CODE[4] = {0, 0, 0, 1};
+
 
 OpenHEVCFilter::OpenHEVCFilter(uint32_t sessionID, StatisticsInterface *stats,
                                std::shared_ptr<ResourceAllocator> hwResources):
@@ -18,10 +39,22 @@ OpenHEVCFilter::OpenHEVCFilter(uint32_t sessionID, StatisticsInterface *stats,
   vpsReceived_(false),
   spsReceived_(false),
   ppsReceived_(false),
+  parameterSets_(),
+  parameterSetsPending_(false),
   sessionID_(sessionID),
   threads_(-1),
   parallelizationMode_("Slice"),
-  discardedFrames_(0)
+  discardedFrames_(0),
+  overloadState_(DECODE_ALL),
+  waitForLayerSwitch_(false),
+  skipRASL_(false),
+  skippedFrames_(0),
+  prevInputDiscarded_(0),
+  lastKeyframeRequest_(0),
+  threadsChanged_(false),
+  latencyBudget_(DECODE_LATENCY_BUDGET_MS),
+  priority_(DECODE_PRIORITY_NORMAL),
+  priorityChanged_(false)
 {}
 
 
@@ -30,7 +63,8 @@ bool OpenHEVCFilter::init()
   Logger::getLogger()->printNormal(this, "Starting to initiate OpenHEVC");
   QSettings settings(settingsFile, settingsFileFormat);
 
-  threads_ = settings.value(SettingsKey::videoOpenHEVCThreads).toInt();
+  threads_ = getThreadCount();
+  threadsChanged_ = false;
   parallelizationMode_ = settings.value(SettingsKey::videoOHParallelization).toString();
 
   if (parallelizationMode_ == "Slice")
@@ -64,12 +98,19 @@ bool OpenHEVCFilter::init()
                                   {libOpenHevcVersion(handle_), QString::number(threads_),
                                   parallelizationMode_});
 
-  // This is because we don't know anything about the incoming stream
-  maxBufferSize_ = -1; // no buffer limit
+  // the overload states keep the queue short, this only limits a stalled decoder
+  maxBufferSize_ = MAX_INPUT_NAL_UNITS;
 
   vpsReceived_ = false;
   spsReceived_ = false;
   ppsReceived_ = false;
+  parameterSetsPending_ = !parameterSets_.empty();
+
+  overloadState_ = DECODE_ALL;
+  waitForLayerSwitch_ = false;
+  skipRASL_ = false;
+  skippedFrames_ = 0;
+  lastKeyframeRequest_ = 0;
   return true;
 }
 
@@ -87,7 +128,7 @@ void OpenHEVCFilter::updateSettings()
 {
   QSettings settings(settingsFile, settingsFileFormat);
 
-  if (settings.value(SettingsKey::videoOpenHEVCThreads).toInt() != threads_ ||
+  if (getThreadCount() != threads_ ||
       settings.value(SettingsKey::videoOHParallelization).toString() != parallelizationMode_)
   {
     settingsMutex_.lock();
@@ -100,19 +141,138 @@ void OpenHEVCFilter::updateSettings()
 }
 
 
+void OpenHEVCFilter::rebalanceThreads()
+{
+  if (getThreadCount() != threads_)
+  {
+    threadsChanged_ = true;
+  }
+}
+
+
+void OpenHEVCFilter::setDecodePriority(DecodePriority priority)
+{
+  latencyBudget_ = priority == DECODE_PRIORITY_LOW ? DECODE_LATENCY_BUDGET_MS/2
+                                                   : DECODE_LATENCY_BUDGET_MS;
+
+  // the thread priority can only be set while running, so the thread sets it
+  priority_ = priority;
+  priorityChanged_ = true;
+}
+
+
+void OpenHEVCFilter::setParameterSets(const QList<QByteArray>& parameterSets)
+{
+  settingsMutex_.lock();
+  parameterSets_.clear();
+
+  for (auto& nal : parameterSets)
+  {
+    if (!nal.isEmpty())
+    {
+      parameterSets_.push_back(QByteArray(START_CODE, sizeof(START_CODE)) + nal);
+    }
+  }
+
+  parameterSetsPending_ = !parameterSets_.empty();
+  settingsMutex_.unlock();
+}
+
+
+void OpenHEVCFilter::decodeParameterSets()
+{
+  for (auto& nal : parameterSets_)
+  {
+    uint8_t nalType = ((uint8_t)nal.at(4) >> 1) & 0x3f;
+
+    if (nalType != VPS_NUT && nalType != SPS_NUT && nalType != PPS_NUT)
+    {
+      Logger::getLogger()->printWarning(this, "Ignoring out-of-band NAL unit which is not a parameter set",
+                                        "NAL Type", QString::number(nalType));
+      continue;
+    }
+
+    if (libOpenHevcDecode(handle_, (const unsigned char*)nal.constData(), nal.size(), 0) <= -1)
+    {
+      Logger::getLogger()->printError(this, "Failed to decode out-of-band parameter set");
+      continue;
+    }
+
+    vpsReceived_ = vpsReceived_ || nalType == VPS_NUT;
+    spsReceived_ = spsReceived_ || nalType == SPS_NUT;
+    ppsReceived_ = ppsReceived_ || nalType == PPS_NUT;
+  }
+
+  Logger::getLogger()->printNormal(this, "Decoder seeded with out-of-band parameter sets",
+                                   "Count", QString::number(parameterSets_.size()));
+
+  parameterSetsPending_ = false;
+}
+
+
+int OpenHEVCFilter::getThreadCount()
+{
+  int budget = getHWManager()->getDecoderThreads();
+  int threads = settingValue(SettingsKey::videoOpenHEVCThreads);
+
+  // the setting is the maximum
+  if (threads <= 0 || threads > budget)
+  {
+    threads = budget;
+  }
+
+  return threads;
+}
+
+
 void OpenHEVCFilter::process()
 {
+  if (priorityChanged_.exchange(false))
+  {
+    switch (priority_)
+    {
+      case DECODE_PRIORITY_HIGH:
+        setPriority(QThread::HighPriority);
+        break;
+      case DECODE_PRIORITY_LOW:
+        setPriority(QThread::LowPriority);
+        break;
+      default:
+        setPriority(QThread::NormalPriority);
+        break;
+    }
+  }
+
   std::unique_ptr<Data> input = getInput();
 
   while(input)
   {
-    getStats()->addReceivePacket(sessionID_, "Video", input->data_size);
+    getStats()->addReceivePacket(sessionID_, STATS_VIDEO, input->data_size);
     settingsMutex_.lock();
 
+    if (parameterSetsPending_)
+    {
+      decodeParameterSets();
+    }
+
     const unsigned char *buff = input->data.get();
 
     uint8_t nalType = (buff[4] >> 1);
 
+    // Restart the decoder with new thread count when new parameter sets arrive,
+    // since after them the decoding does not depend on earlier pictures.
+    if (threadsChanged_ && nalType == VPS_NUT)
+    {
+      Logger::getLogger()->printNormal(this, "Restarting decoder with new thread count",
+                                       "Threads", QString::number(getThreadCount()));
+      threadsChanged_ = false;
+      uninit();
+      init();
+
+      // the stream has its own parameter sets
+      parameterSetsPending_ = false;
+    }
+
     if (!vpsReceived_ && nalType == VPS_NUT)
     {
       Logger::getLogger()->printDebug(DEBUG_NORMAL, this,  "VPS found");
@@ -133,6 +293,38 @@ void OpenHEVCFilter::process()
 
     bool vcl = nalType <= 31; // 31 is highest vlc nal_type
 
+    // the pictures after discarded input may reference the discarded pictures
+    if (inputDiscarded_ != prevInputDiscarded_)
+    {
+      prevInputDiscarded_ = inputDiscarded_;
+
+      if (overloadState_ != WAIT_FOR_IRAP)
+      {
+        Logger::getLogger()->printWarning(this, "Input was discarded, skipping to next IRAP");
+        overloadState_ = WAIT_FOR_IRAP;
+      }
+    }
+
+    if (vcl)
+    {
+      int64_t queueLatency = QDateTime::currentMSecsSinceEpoch() - input->creationTimestamp;
+      getStats()->decoderQueueLatency(sessionID_, STATS_VIDEO, queueLatency);
+      updateOverloadState(queueLatency);
+
+      uint8_t temporalIDPlus1 = buff[5] & 0x7;
+      uint8_t temporalID = temporalIDPlus1 > 0 ? temporalIDPlus1 - 1 : 0;
+
+      if (skipPicture(nalType, temporalID))
+      {
+        getStats()->decoderSkippedFrame(sessionID_, STATS_VIDEO);
+        ++skippedFrames_;
+
+        settingsMutex_.unlock();
+        input = getInput();
+        continue;
+      }
+    }
+
     if((vpsReceived_ && spsReceived_ && ppsReceived_) || !vcl)
     {
       if (discardedFrames_ != 0)
@@ -189,6 +381,115 @@ void OpenHEVCFilter::process()
 }
 
 
+void OpenHEVCFilter::updateOverloadState(int64_t queueLatency)
+{
+  if (queueLatency > MAX_QUEUE_LATENCY_MS)
+  {
+    if (overloadState_ != WAIT_FOR_IRAP)
+    {
+      Logger::getLogger()->printWarning(this, "Decoder is too far behind, skipping to next IRAP",
+                                        "Queue latency", QString::number(queueLatency) + " ms");
+      overloadState_ = WAIT_FOR_IRAP;
+    }
+  }
+  else if (queueLatency > latencyBudget_)
+  {
+    if (overloadState_ == DECODE_ALL)
+    {
+      Logger::getLogger()->printWarning(this, "Decoder overloaded, skipping non-reference pictures",
+                                        "Queue latency", QString::number(queueLatency) + " ms");
+      overloadState_ = SKIP_NON_REFERENCE;
+    }
+  }
+  else if (overloadState_ == SKIP_NON_REFERENCE && queueLatency < latencyBudget_/2)
+  {
+    Logger::getLogger()->printNormal(this, "Decoder has caught up",
+                                     "Skipped frames", QString::number(skippedFrames_));
+    overloadState_ = DECODE_ALL;
+    skippedFrames_ = 0;
+  }
+}
+
+
+bool OpenHEVCFilter::skipPicture(uint8_t nalType, uint8_t temporalID)
+{
+  bool irap = nalType >= BLA_W_LP && nalType <= RSV_IRAP_VCL23;
+
+  if (overloadState_ == WAIT_FOR_IRAP)
+  {
+    if (!irap)
+    {
+      requestKeyframe();
+      return true;
+    }
+
+    // the decoding can continue from here. RASL pictures reference pictures before CRA.
+    overloadState_ = SKIP_NON_REFERENCE;
+    skipRASL_ = nalType == CRA_NUT;
+    lastKeyframeRequest_ = 0;
+  }
+
+  if (irap)
+  {
+    waitForLayerSwitch_ = false;
+    return false;
+  }
+
+  if (nalType == RASL_N || nalType == RASL_R)
+  {
+    if (skipRASL_)
+    {
+      return true;
+    }
+  }
+  else
+  {
+    skipRASL_ = false;
+  }
+
+  // TSA and STSA pictures allow switching to higher temporal layer
+  if (waitForLayerSwitch_ && temporalID > 0)
+  {
+    if (overloadState_ == DECODE_ALL && nalType >= TSA_N && nalType <= STSA_R)
+    {
+      waitForLayerSwitch_ = false;
+    }
+    else
+    {
+      return true;
+    }
+  }
+
+  if (overloadState_ == SKIP_NON_REFERENCE)
+  {
+    // even numbered types up to 14 are sub-layer non-reference pictures
+    bool nonReference = nalType <= RSV_VCL_N14 && nalType%2 == 0;
+
+    if (temporalID > 0)
+    {
+      waitForLayerSwitch_ = true;
+      return true;
+    }
+
+    return nonReference;
+  }
+
+  return false;
+}
+
+
+void OpenHEVCFilter::requestKeyframe()
+{
+  int64_t now = QDateTime::currentMSecsSinceEpoch();
+
+  if (lastKeyframeRequest_ == 0 || now - lastKeyframeRequest_ >= KEYFRAME_REQUEST_INTERVAL_MS)
+  {
+    lastKeyframeRequest_ = now;
+    getHWManager()->requestKeyframe(sessionID_);
+  }
+}
+
+
 void OpenHEVCFilter::sendDecodedOutput(int& gotPicture)
 {
   OpenHevc_Frame openHevcFrame;
@@ -3,6 +3,15 @@
 
 #include "openHevcWrapper.h"
 
+#include <QByteArray>
+#include <QList>
+
+#include <atomic>
+
+// The decoder of the active speaker runs at a higher thread priority and the
+// others start skipping pictures sooner when the CPU cannot keep up.
+enum DecodePriority {DECODE_PRIORITY_NORMAL, DECODE_PRIORITY_HIGH, DECODE_PRIORITY_LOW};
+
 class OpenHEVCFilter : public Filter
 {
 public:
@@ -14,19 +23,50 @@ public:
 
   virtual void updateSettings();
 
+  // the decoder is restarted at next parameter sets if the thread budget has changed
+  void rebalanceThreads();
+
+  void setDecodePriority(DecodePriority priority);
+
+  // Parameter sets received out-of-band in SDP (NAL units without start code).
+  // These are given to decoder before the stream so the first IDR can be decoded.
+  void setParameterSets(const QList<QByteArray>& parameterSets);
+
 protected:
   virtual void process();
 
 private:
 
+  // Overload handling states. Pictures are skipped only at points where the
+  // decoding of the following pictures is not affected.
+  enum OverloadState {DECODE_ALL, SKIP_NON_REFERENCE, WAIT_FOR_IRAP};
+
   void sendDecodedOutput(int &gotPicture);
 
+  void decodeParameterSets();
+
+  // thread count from budget limited by settings
+  int getThreadCount();
+
+  // updates the overload state based on how long the NAL unit waited in queue
+  void updateOverloadState(int64_t queueLatency);
+
+  // whether this VCL NAL unit should be skipped based on overload state
+  bool skipPicture(uint8_t nalType, uint8_t temporalID);
+
+  // asks the peer for a keyframe so we don't have to wait for its intra period
+  void requestKeyframe();
+
   OpenHevc_Handle handle_;
 
   bool vpsReceived_;
   bool spsReceived_;
   bool ppsReceived_;
 
+  // with start codes
+  QList<QByteArray> parameterSets_;
+  bool parameterSetsPending_;
+
   uint32_t sessionID_;
 
   int threads_;
@@ -38,4 +78,22 @@ private:
   QMutex settingsMutex_;
 
   uint32_t discardedFrames_;
+
+  OverloadState overloadState_;
+
+  // higher temporal layers can be decoded again only after a switching point
+  bool waitForLayerSwitch_;
+  bool skipRASL_;
+  uint32_t skippedFrames_;
+
+  unsigned int prevInputDiscarded_;
+  int64_t lastKeyframeRequest_; // 0 if not waiting for a requested keyframe
+
+  std::atomic<bool> threadsChanged_;
+
+  // queue latency after which the pictures not used as reference are skipped
+  std::atomic<int64_t> latencyBudget_;
+
+  std::atomic<DecodePriority> priority_;
+  std::atomic<bool> priorityChanged_;
 };
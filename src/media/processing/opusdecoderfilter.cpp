@@ -1,11 +1,18 @@
 #include "opusdecoderfilter.h"
 
 #include "statisticsinterface.h"
+#include "audioframebuffer.h"
 
 #include "common.h"
 #include "logger.h"
 
-OpusDecoderFilter::OpusDecoderFilter(uint32_t sessionID, QAudioFormat format,
+#include <algorithm>
+
+// Longer gaps are outages which the audio output has already concealed and
+// only the last packet of them is recovered
+const uint16_t MAX_RECOVERED_PACKETS = 5;
+
+OpusDecoderFilter::OpusDecoderFilter(uint32_t sessionID, QAudioFormat format, uint32_t frameUs,
                                      StatisticsInterface *stats,
                                      std::shared_ptr<ResourceAllocator> hwResources):
   Filter(QString::number(sessionID), "Opus Decoder", stats, hwResources, DT_OPUSAUDIO, DT_RAWAUDIO),
@@ -13,6 +20,9 @@ OpusDecoderFilter::OpusDecoderFilter(uint32_t sessionID, QAudioFormat format,
   pcmOutput_(nullptr),
   max_data_bytes_(65536),
   format_(format),
+  frameSamples_(audioFrameSamples(format.sampleRate(), frameUs)),
+  buffer_(std::make_unique<AudioFrameBuffer>(frameSamples_*format.bytesPerFrame(),
+                                             1000000/frameUs)),
   sessionID_(sessionID)
 {
   pcmOutput_ = new int16_t[max_data_bytes_];
@@ -23,7 +33,7 @@ OpusDecoderFilter::~OpusDecoderFilter()
 {
   if(pcmOutput_)
   {
-    delete pcmOutput_;
+    delete[] pcmOutput_;
   }
   pcmOutput_ = nullptr;
 }
@@ -50,7 +60,13 @@ void OpusDecoderFilter::process()
 
   while(input)
   {
-    getStats()->addReceivePacket(sessionID_, "Audio", input->data_size);
+    getStats()->addReceivePacket(sessionID_, STATS_AUDIO, input->data_size);
+
+    if (input->aInfo && input->aInfo->lostBefore > 0)
+    {
+      recoverLoss(input.get(), input->aInfo->lostBefore);
+      input->aInfo->lostBefore = 0;
+    }
 
     // TODO: get number of channels from opus sample: opus_packet_get_nb_channels
     int32_t len = 0;
@@ -58,22 +74,14 @@ void OpusDecoderFilter::process()
 
     len = opus_decode(dec_, input->data.get(), input->data_size, pcmOutput_, frame_size, 0);
 
-    uint32_t datasize = len*format_.channelCount()*sizeof(opus_int16);
-
     //Logger::getLogger()->printDebug(DEBUG_NORMAL, this, "Decoded Opus audio.", 
     //                                {"Input size", "Output size"},
     //                                {QString::number(input->data_size),
-    //                                 QString::number(datasize)};
+    //                                 QString::number(len)};
 
     if(len > -1)
     {
-      std::unique_ptr<uchar[]> pcm_frame(new uchar[datasize]);
-      memcpy(pcm_frame.get(), pcmOutput_, datasize);
-      input->data_size = datasize;
-
-      input->data = std::move(pcm_frame);
-      input->type = DT_RAWAUDIO;
-      sendOutput(std::move(input));
+      sendPCM(std::move(input), len);
     }
     else
     {
@@ -83,3 +91,88 @@ void OpusDecoderFilter::process()
     input = getInput();
   }
 }
+
+
+void OpusDecoderFilter::recoverLoss(Data* input, uint16_t lostPackets)
+{
+  // the lost packets are assumed to have been as long as this one
+  int samples = opus_packet_get_nb_samples(input->data.get(), input->data_size,
+                                           format_.sampleRate());
+  if (samples <= 0)
+  {
+    return;
+  }
+
+  Logger::getLogger()->printDebug(DEBUG_NORMAL, this, "Recovering lost audio packets",
+                                  {"Lost packets"}, {QString::number(lostPackets)});
+
+  if (lostPackets > MAX_RECOVERED_PACKETS)
+  {
+    lostPackets = 1;
+  }
+
+  for (uint16_t i = 0; i < lostPackets; ++i)
+  {
+    int32_t len = 0;
+
+    if (i + 1 == lostPackets)
+    {
+      // Opus falls back to concealment if the packet has no redundant data
+      len = opus_decode(dec_, input->data.get(), input->data_size, pcmOutput_, samples, 1);
+    }
+    else
+    {
+      len = opus_decode(dec_, nullptr, 0, pcmOutput_, samples, 0);
+      getStats()->audioBufferEvent(sessionID_, AUDIO_BUFFER_CONCEALED);
+    }
+
+    if (len <= 0)
+    {
+      Logger::getLogger()->printWarning(this, "Failed to recover lost audio frame.",
+                                        {"Error"}, {QString::number(len)});
+      return;
+    }
+
+    sendPCM(std::unique_ptr<Data>(shallowDataCopy(input)), len);
+  }
+}
+
+
+void OpusDecoderFilter::sendPCM(std::unique_ptr<Data> data, int32_t samples)
+{
+  uint32_t datasize = samples*format_.channelCount()*sizeof(opus_int16);
+
+  if (!buffer_->inputData((uint8_t*)pcmOutput_, datasize))
+  {
+    Logger::getLogger()->printWarning(this, "Decoded audio buffer full, dropping samples");
+  }
+
+  if (data->aInfo && data->aInfo->silentBefore > 0 && uint32_t(samples) != frameSamples_)
+  {
+    // the silence was counted in the frames of the sender
+    data->aInfo->silentBefore = uint16_t(std::min<uint32_t>(
+          (data->aInfo->silentBefore*uint32_t(samples) + frameSamples_ - 1)/frameSamples_,
+          UINT16_MAX));
+  }
+
+  while (buffer_->getBufferSize() > 0)
+  {
+    std::unique_ptr<Data> frame(shallowDataCopy(data.get()));
+
+    frame->data_size = buffer_->getDesiredSize();
+    frame->data = std::unique_ptr<uchar[]>(new uchar[frame->data_size]);
+    buffer_->readFrame(frame->data.get());
+    frame->type = DT_RAWAUDIO;
+
+    if (frame->aInfo)
+    {
+      frame->aInfo->frameSamples = frameSamples_;
+
+      // only the first frame comes after the gap
+      data->aInfo->lostBefore = 0;
+      data->aInfo->silentBefore = 0;
+    }
+
+    sendOutput(std::move(frame));
+  }
+}
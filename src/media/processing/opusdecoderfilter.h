@@ -4,10 +4,16 @@
 #include <opus/opus.h>
 #include <QtMultimedia/QAudioFormat>
 
+class AudioFrameBuffer;
+
+// Decodes Opus to frames of frameUs. The peer may send longer or shorter
+// packets than the frames of our graph, so the decoded samples are cut into
+// frames of our duration before they are mixed.
+
 class OpusDecoderFilter : public Filter
 {
 public:
-  OpusDecoderFilter(uint32_t sessionID, QAudioFormat format,
+  OpusDecoderFilter(uint32_t sessionID, QAudioFormat format, uint32_t frameUs,
                     StatisticsInterface* stats,
                     std::shared_ptr<ResourceAllocator> hwResources);
   ~OpusDecoderFilter();
@@ -22,12 +28,23 @@ protected:
 
 private:
 
+  // recovers the packets lost before this one using its redundant data
+  // (LBRR) for the last lost packet and concealment for the rest
+  void recoverLoss(Data* input, uint16_t lostPackets);
+
+  // sends the decoded samples in pcmOutput_ forward in frames, the first
+  // of which is data
+  void sendPCM(std::unique_ptr<Data> data, int32_t samples);
+
   OpusDecoder *dec_;
 
   int16_t* pcmOutput_;
   uint32_t max_data_bytes_;
 
   QAudioFormat format_;
+  uint32_t frameSamples_;
+
+  std::unique_ptr<AudioFrameBuffer> buffer_;
 
   uint32_t sessionID_;
 };
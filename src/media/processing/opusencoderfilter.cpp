@@ -11,8 +11,22 @@
 #include <QDateTime>
 #include <QSettings>
 
+#include <algorithm>
 
-OpusEncoderFilter::OpusEncoderFilter(QString id, QAudioFormat format,
+
+// Speech must have ended this long ago before transmission stops so that
+// the ends of words are not cut
+const uint32_t DTX_HANGOVER_US = 200000;
+
+// During silence a frame is sent this often so that the receiver can update
+// its comfort noise. This is the interval Opus DTX uses.
+const uint32_t DTX_UPDATE_US = 400000;
+
+// encoded frames this small are Opus DTX frames which are not sent
+const opus_int32 MAX_DTX_FRAME_SIZE = 2;
+
+
+OpusEncoderFilter::OpusEncoderFilter(QString id, QAudioFormat format, uint32_t frameUs,
                                      StatisticsInterface* stats,
                                      std::shared_ptr<ResourceAllocator> hwResources):
   Filter(id, "Opus Encoder", stats, hwResources, DT_RAWAUDIO, DT_OPUSAUDIO),
@@ -20,7 +34,13 @@ OpusEncoderFilter::OpusEncoderFilter(QString id, QAudioFormat format,
   opusOutput_(nullptr),
   max_data_bytes_(65536),
   format_(format),
-  samplesPerFrame_(0)
+  samplesPerFrame_(audioFrameSamples(format.sampleRate(), frameUs)),
+  fec_(audioFrameHasFEC(frameUs)),
+  hangoverFrames_(DTX_HANGOVER_US/frameUs),
+  updateFrames_(std::max(DTX_UPDATE_US/frameUs, 1u)),
+  packetLoss_(0),
+  silentFrames_(0),
+  unsentFrames_(0)
 {
   opusOutput_ = new uchar[max_data_bytes_];
 }
@@ -47,7 +67,22 @@ bool OpusEncoderFilter::init()
     return false;
   }
 
-  samplesPerFrame_ = format_.sampleRate()/AUDIO_FRAMES_PER_SECOND;
+  // Each packet carries the previous frame at a lower bit rate for the
+  // receiver to recover from single losses. The amount depends on the loss
+  // percentage reported by the receivers. Short frames used on LANs have no
+  // FEC, and the decoder conceals their losses instead.
+  opus_encoder_ctl(enc_, OPUS_SET_INBAND_FEC(fec_ ? 1 : 0));
+
+  if (!fec_)
+  {
+    Logger::getLogger()->printNormal(this, "Frames are too short for forward error correction",
+                                     "Samples per frame", QString::number(samplesPerFrame_));
+  }
+  opus_encoder_ctl(enc_, OPUS_SET_PACKET_LOSS_PERC(packetLoss_));
+
+  // Opus stops producing packets during silence its own analysis detects.
+  // Silence detected by the input VAD is not encoded at all.
+  opus_encoder_ctl(enc_, OPUS_SET_DTX(1));
 
   updateSettings();
 
@@ -100,11 +135,26 @@ void OpusEncoderFilter::process()
       return;
     }
 
+    if (skipSilence(input.get()))
+    {
+      input = getInput();
+      continue;
+    }
+
     opus_int32 len = 0; // encoded frame size
     uint32_t pos = 0; // output position TODO: Is this pos variable necessary?
 
     opus_encoder_ctl(enc_, OPUS_SET_BITRATE(getHWManager()->getBitrate(outputType())));
 
+    int packetLoss = getHWManager()->getPacketLoss(outputType());
+    if (packetLoss != packetLoss_)
+    {
+      Logger::getLogger()->printDebug(DEBUG_NORMAL, this, "Adjusting forward error correction",
+                                      {"Packet loss"}, {QString::number(packetLoss) + " %"});
+      opus_encoder_ctl(enc_, OPUS_SET_PACKET_LOSS_PERC(packetLoss));
+      packetLoss_ = packetLoss;
+    }
+
     // The audiocapturefilter makes sure the frames are the samplesPerFrame size.
 
     len = opus_encode(enc_, (opus_int16*)input->data.get(), samplesPerFrame_,
@@ -116,7 +166,20 @@ void OpusEncoderFilter::process()
       break;
     }
 
+    if (len <= MAX_DTX_FRAME_SIZE)
+    {
+      countUnsent();
+      input = getInput();
+      continue;
+    }
+
     std::unique_ptr<Data> u_copy(shallowDataCopy(input.get()));
+    if (u_copy->aInfo)
+    {
+      u_copy->aInfo->frameSamples = samplesPerFrame_;
+      u_copy->aInfo->silentBefore = unsentFrames_;
+    }
+    unsentFrames_ = 0;
 
     std::unique_ptr<uchar[]> opus_frame(new uchar[len]);
     memcpy(opus_frame.get(), opusOutput_ + pos, len);
@@ -135,8 +198,8 @@ void OpusEncoderFilter::process()
     {
       uint32_t delay = QDateTime::currentMSecsSinceEpoch() - input->creationTimestamp;
       
-      getStats()->encodingDelay("audio", delay);
-      getStats()->addEncodedPacket("audio", len);
+      getStats()->encodingDelay(STATS_AUDIO, delay);
+      getStats()->addEncodedPacket(STATS_AUDIO, len);
     }
     else
     {
@@ -146,3 +209,33 @@ void OpusEncoderFilter::process()
     input = getInput();
   }
 }
+
+
+bool OpusEncoderFilter::skipSilence(const Data* input)
+{
+  if (input->aInfo == nullptr || input->aInfo->voiceActivity)
+  {
+    silentFrames_ = 0;
+    return false;
+  }
+
+  ++silentFrames_;
+
+  if (silentFrames_ <= hangoverFrames_ ||
+      (silentFrames_ - hangoverFrames_)%updateFrames_ == 0)
+  {
+    return false;
+  }
+
+  countUnsent();
+  return true;
+}
+
+
+void OpusEncoderFilter::countUnsent()
+{
+  if (unsentFrames_ < UINT16_MAX)
+  {
+    ++unsentFrames_;
+  }
+}
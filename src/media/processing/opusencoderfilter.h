@@ -7,7 +7,8 @@
 class OpusEncoderFilter : public Filter
 {
 public:
-  OpusEncoderFilter(QString id, QAudioFormat format, StatisticsInterface* stats,
+  OpusEncoderFilter(QString id, QAudioFormat format, uint32_t frameUs,
+                    StatisticsInterface* stats,
                     std::shared_ptr<ResourceAllocator> hwResources);
   ~OpusEncoderFilter();
 
@@ -19,6 +20,13 @@ protected:
   void process();
 
 private:
+
+  // Returns true if the frame is silence which is not encoded or sent. Every
+  // now and then a silent frame is sent for comfort noise.
+  bool skipSilence(const Data* input);
+
+  void countUnsent();
+
   OpusEncoder* enc_;
 
   uchar* opusOutput_;
@@ -27,4 +35,20 @@ private:
   QAudioFormat format_;
 
   uint32_t samplesPerFrame_;
+
+  // frames shorter than 10 ms are CELT-only which has no inband FEC
+  bool fec_;
+
+  // the DTX durations in frames of this duration
+  uint32_t hangoverFrames_;
+  uint32_t updateFrames_;
+
+  // latest loss percentage given to the encoder
+  int packetLoss_;
+
+  // consecutive frames without voice activity
+  uint32_t silentFrames_;
+
+  // frames not sent since the previous packet
+  uint16_t unsentFrames_;
 };
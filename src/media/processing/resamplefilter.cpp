@@ -0,0 +1,76 @@
+#include "resamplefilter.h"
+
+#include "audioframebuffer.h"
+#include "audioresampling.h"
+
+#include "common.h"
+#include "logger.h"
+
+
+ResampleFilter::ResampleFilter(QString id, StatisticsInterface* stats,
+                               std::shared_ptr<ResourceAllocator> hwResources,
+                               QAudioFormat inputFormat, QAudioFormat outputFormat,
+                               uint32_t frameUs):
+  Filter(id, "Resample", stats, hwResources, DT_RAWAUDIO, DT_RAWAUDIO),
+  inputRate_(inputFormat.sampleRate()),
+  outputRate_(outputFormat.sampleRate()),
+  channels_(outputFormat.channelCount()),
+  resampler_(std::make_unique<PolyphaseResampler>(inputFormat.sampleRate(), outputFormat.sampleRate(),
+                                                  outputFormat.channelCount(), RESAMPLER_DEFAULT)),
+  buffer_(std::make_unique<AudioFrameBuffer>(audioFrameSamples(outputFormat.sampleRate(), frameUs)*
+                                             outputFormat.bytesPerFrame(), 500000/frameUs)),
+  resampled_()
+{
+  Logger::getLogger()->printNormal(this, "Resampling audio", {"Rates"},
+                                   {QString::number(inputFormat.sampleRate()) + " -> " +
+                                    QString::number(outputFormat.sampleRate())});
+}
+
+
+ResampleFilter::~ResampleFilter()
+{}
+
+
+void ResampleFilter::process()
+{
+  std::unique_ptr<Data> input = getInput();
+
+  while(input)
+  {
+    if (input->aInfo && input->aInfo->sampleRate != inputRate_)
+    {
+      inputRate_ = input->aInfo->sampleRate;
+      resampler_ = std::make_unique<PolyphaseResampler>(inputRate_, outputRate_, channels_,
+                                                        RESAMPLER_DEFAULT);
+    }
+
+    size_t count = input->data_size/(sizeof(int16_t)*channels_);
+    resampler_->process((int16_t*)input->data.get(), count, resampled_);
+
+    if (!buffer_->inputData((uint8_t*)resampled_.data(), uint32_t(resampled_.size()*sizeof(int16_t))))
+    {
+      Logger::getLogger()->printWarning(this, "Resampling buffer full, dropping samples");
+    }
+
+    // the frames may not line up with the input so they get its timestamps
+    while (buffer_->getBufferSize() > 0)
+    {
+      std::unique_ptr<Data> output(shallowDataCopy(input.get()));
+
+      output->data_size = buffer_->getDesiredSize();
+      output->data = std::unique_ptr<uchar[]>(new uchar[output->data_size]);
+      buffer_->readFrame(output->data.get());
+
+      if (output->aInfo)
+      {
+        output->aInfo->sampleRate = outputRate_;
+        output->aInfo->frameSamples = output->data_size/(sizeof(int16_t)*channels_);
+      }
+
+      sendOutput(std::move(output));
+    }
+
+    // get next input
+    input = getInput();
+  }
+}
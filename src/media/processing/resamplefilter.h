@@ -0,0 +1,41 @@
+#pragma once
+#include "filter.h"
+
+#include <QAudioFormat>
+
+#include <memory>
+#include <vector>
+
+class AudioFrameBuffer;
+class PolyphaseResampler;
+
+// Converts raw audio between the sample rates of a device and the codec.
+// FilterGraph adds this filter when the device does not support the rate
+// used by the rest of the graph. The output is in frames of frameUs at the
+// output rate. The input rate follows the rate of the
+// frames in case the device is changed.
+
+class ResampleFilter : public Filter
+{
+public:
+  ResampleFilter(QString id, StatisticsInterface* stats,
+                 std::shared_ptr<ResourceAllocator> hwResources,
+                 QAudioFormat inputFormat, QAudioFormat outputFormat, uint32_t frameUs);
+
+  ~ResampleFilter();
+
+protected:
+
+  void process();
+
+private:
+
+  uint32_t inputRate_;
+  uint32_t outputRate_;
+  uint16_t channels_;
+
+  std::unique_ptr<PolyphaseResampler> resampler_;
+  std::unique_ptr<AudioFrameBuffer> buffer_;
+
+  std::vector<int16_t> resampled_;
+};
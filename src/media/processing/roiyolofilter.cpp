@@ -67,7 +67,13 @@ bool ROIYoloFilter::init()
   QString newModelQstr = settings.value(SettingsKey::roiDetectorModel).toString();
 
   roiEnabled_ = settingValue(SettingsKey::roiEnabled) && !newModelQstr.isEmpty();
-  int threads = settings.value(SettingsKey::roiMaxThreads).toInt();
+  // the setting is the maximum
+  int threads = getHWManager()->getROIThreads();
+  int maxThreads = settings.value(SettingsKey::roiMaxThreads).toInt();
+  if (maxThreads > 0 && maxThreads < threads)
+  {
+    threads = maxThreads;
+  }
   if (roiEnabled_)
   {
     roiEnabled_ = initYolo(threads, newModelQstr);
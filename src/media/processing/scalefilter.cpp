@@ -1,86 +1,186 @@
 #include "scalefilter.h"
 
+#include "yuvscaling.h"
+
 #include "common.h"
 #include "logger.h"
 
-#include <QImage>
+#include <algorithm>
+#include <cmath>
+
+// Scaling costs about as much as it saves in later stages if the size barely changes
+const float MAX_TARGET_SCALE = 0.75f;
 
 ScaleFilter::ScaleFilter(QString id, StatisticsInterface *stats,
-                         std::shared_ptr<ResourceAllocator> hwResources):
-  Filter(id, "Scaler", stats, hwResources, DT_RGB32VIDEO, DT_RGB32VIDEO),
-  newSize_(QSize(0,0))
+                         std::shared_ptr<ResourceAllocator> hwResources,
+                         DataType format):
+  Filter(id, "Scaler", stats, hwResources, format, format),
+  newSize_(QSize(0,0)),
+  maxHeight_(0),
+  targetSize_(),
+  spareBuffer_(nullptr),
+  spareSize_(0),
+  work_()
 {
-
+  if (format != DT_YUV420VIDEO && format != DT_NV12VIDEO)
+  {
+    Logger::getLogger()->printProgramError(this, "Scaler only supports YUV420 and NV12");
+  }
 }
 
+
 void ScaleFilter::setResolution(QSize newResolution)
 {
   newSize_ = newResolution;
 }
 
-void ScaleFilter::process()
+
+void ScaleFilter::setMaxHeight(int height)
 {
-  if(newSize_ == QSize(0,0))
-  {
-    Logger::getLogger()->printDebug(DEBUG_PROGRAM_ERROR, this, "Size not set for scaler.");
-    return;
-  }
+  maxHeight_ = height;
+}
+
 
+void ScaleFilter::setTargetSize(std::function<QSize()> targetSize)
+{
+  targetSize_ = targetSize;
+}
+
+
+void ScaleFilter::process()
+{
   std::unique_ptr<Data> input = getInput();
   while(input)
   {
     if(input->vInfo->height == 0 || input->vInfo->width == 0 || input->data_size == 0)
     {
-      Logger::getLogger()->printDebug(DEBUG_PROGRAM_ERROR, this, 
+      Logger::getLogger()->printDebug(DEBUG_PROGRAM_ERROR, this,
                                       "The resolution of input image for scaler is not set.",
                                       {"Width", "Height"}, {QString::number(input->vInfo->width),
                                        QString::number(input->vInfo->height)});
       return;
     }
 
-    QImage::Format format;
-
-    switch(input->type)
+    if (input->type == inputType())
     {
-      case DT_RGB32VIDEO:
-      {
-        format = QImage::Format_RGB32;
-        break;
-      }
-      default:
-      {
-        Logger::getLogger()->printDebug(DEBUG_PROGRAM_ERROR, this,  "Wrong video format for scaler.",
-                                        {"Input type"},{QString::number(input->type)});
-        format = QImage::Format_Invalid;
-        break;
-      }
+      input = scaleFrame(std::move(input));
     }
-
-    if(format != QImage::Format_Invalid)
+    else
     {
-      input = scaleFrame(std::move(input));
+      Logger::getLogger()->printDebug(DEBUG_PROGRAM_ERROR, this,  "Wrong video format for scaler.",
+                                      {"Input type"},{QString::number(input->type)});
     }
+
     sendOutput(std::move(input));
+    input = getInput();
   }
 }
 
+
 std::unique_ptr<Data> ScaleFilter::scaleFrame(std::unique_ptr<Data> input)
 {
-  QImage image(
-        input->data.get(),
-        input->vInfo->width,
-        input->vInfo->height,
-        QImage::Format_RGB32);
-
-  QImage scaled = image.scaled(newSize_);
-  if(newSize_.width() * newSize_.height()
-     > input->vInfo->width * input->vInfo->height)
+  QSize size = outputResolution(*input->vInfo);
+
+  if (size.width() == input->vInfo->width && size.height() == input->vInfo->height)
+  {
+    return input;
+  }
+
+  // the chroma planes of 4:2:0 must have whole pixels
+  if (input->vInfo->width % 2 != 0 || input->vInfo->height % 2 != 0)
   {
-    input->data = std::unique_ptr<uchar[]>(new uchar[scaled.sizeInBytes()]);
+    Logger::getLogger()->printDebug(DEBUG_PROGRAM_ERROR, this, "Cannot scale frame with odd resolution",
+                                    {"Resolution"}, {QString::number(input->vInfo->width) + "x" +
+                                                     QString::number(input->vInfo->height)});
+    return input;
   }
-  memcpy(input->data.get(), scaled.bits(), scaled.sizeInBytes());
-  input->vInfo->width = newSize_.width();
-  input->vInfo->height = newSize_.height();
-  input->data_size = scaled.sizeInBytes();
+
+  uint32_t outputSize = size.width()*size.height()*3/2;
+  if (spareBuffer_ == nullptr || spareSize_ < outputSize)
+  {
+    spareBuffer_ = std::unique_ptr<uchar[]>(new uchar[outputSize]);
+    spareSize_ = outputSize;
+  }
+
+  size_t workSize = scale_work_size(input->vInfo->width, input->vInfo->height,
+                                    size.width(), size.height());
+  if (work_.size() < workSize)
+  {
+    work_.resize(workSize);
+  }
+
+  if (input->type == DT_NV12VIDEO)
+  {
+    scale_nv12(input->data.get(), input->vInfo->width, input->vInfo->height,
+               spareBuffer_.get(), size.width(), size.height(), work_.data());
+  }
+  else
+  {
+    scale_yuv420(input->data.get(), input->vInfo->width, input->vInfo->height,
+                 spareBuffer_.get(), size.width(), size.height(), work_.data());
+  }
+
+  input->data.swap(spareBuffer_);
+  spareSize_ = input->data_size;
+
+  input->data_size = outputSize;
+  input->vInfo->width = size.width();
+  input->vInfo->height = size.height();
   return input;
 }
+
+
+QSize ScaleFilter::outputResolution(const VideoInfo& info) const
+{
+  if (newSize_.width() > 0 && newSize_.height() > 0)
+  {
+    return QSize(newSize_.width() & ~1, newSize_.height() & ~1);
+  }
+
+  if (maxHeight_ > 0 && info.height > maxHeight_)
+  {
+    int height = maxHeight_ & ~1;
+    int width = (info.width*height/info.height + 1) & ~1;
+    return QSize(width, height);
+  }
+
+  if (targetSize_)
+  {
+    return coverResolution(info, targetSize_());
+  }
+
+  return QSize(info.width, info.height);
+}
+
+
+QSize ScaleFilter::coverResolution(const VideoInfo& info, QSize target) const
+{
+  QSize original(info.width, info.height);
+
+  if (target.width() <= 0 || target.height() <= 0)
+  {
+    return original;
+  }
+
+  float scale = std::max((float)target.width()/info.width, (float)target.height()/info.height);
+
+  if (scale > MAX_TARGET_SCALE)
+  {
+    return original;
+  }
+
+  // box filter is cheaper and looks better, use it if it still covers the target
+  int factor = (int)(1.0f/scale);
+  for (; factor >= 2; --factor)
+  {
+    if (info.width % (2*factor) == 0 && info.height % (2*factor) == 0 &&
+        is_box_scalable(info.width, info.height, info.width/factor, info.height/factor))
+    {
+      return QSize(info.width/factor, info.height/factor);
+    }
+  }
+
+  int width = ((int)std::ceil(info.width*scale) + 1) & ~1;
+  int height = ((int)std::ceil(info.height*scale) + 1) & ~1;
+  return QSize(std::min(width, (int)info.width), std::min(height, (int)info.height));
+}
@@ -4,21 +4,50 @@
 
 #include <QSize>
 
-// A filter that can scale video frame.
+#include <functional>
+#include <vector>
+
+// A filter that can scale video frame. Scaling is done directly on YUV 4:2:0
+// or NV12 planes so the frame does not have to be converted to RGB.
 
 class ScaleFilter : public Filter
 {
 public:
   ScaleFilter(QString id, StatisticsInterface *stats,
-              std::shared_ptr<ResourceAllocator> hwResources);
+              std::shared_ptr<ResourceAllocator> hwResources,
+              DataType format = DT_YUV420VIDEO);
 
+  // scale all frames to this resolution
   void setResolution(QSize newResolution);
 
-  void process();
+  // scale frames higher than this keeping their aspect ratio, smaller frames are not touched
+  void setMaxHeight(int height);
+
+  // Downscale frames to the smallest size that still covers the size given by
+  // this function, keeping the aspect ratio. Used to avoid converting and
+  // drawing pixels that are not visible in small views.
+  void setTargetSize(std::function<QSize()> targetSize);
 
   std::unique_ptr<Data> scaleFrame(std::unique_ptr<Data> input);
 
+protected:
+
+  void process();
+
 private:
 
+  QSize outputResolution(const VideoInfo& info) const;
+
+  QSize coverResolution(const VideoInfo& info, QSize target) const;
+
   QSize newSize_;
+  int maxHeight_;
+  std::function<QSize()> targetSize_;
+
+  // When downscaling, the buffer of previous input becomes the output of
+  // next frame so no memory is allocated while the resolution stays the same.
+  std::unique_ptr<uchar[]> spareBuffer_;
+  uint32_t spareSize_;
+
+  std::vector<uint8_t> work_;
 };
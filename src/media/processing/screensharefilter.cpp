@@ -5,16 +5,40 @@
 #include <QGuiApplication>
 #include <QDateTime>
 
+#include "yuvconversions.h"
+
+#include "media/resourceallocator.h"
+
 #include "common.h"
 #include "settingskeys.h"
 #include "logger.h"
 
+// how often an unchanged screen is sent so new and lossy receivers get updated
+const int64_t UNCHANGED_REFRESH_INTERVAL_MS = 1000;
+
+// changes are detected in CTU sized blocks so the map can be used as ROI map
+const uint16_t DIRTY_BLOCK_SIZE = 64;
+
+// The capture is flipped vertically before sending except on Windows
+#ifdef _WIN32
+const bool FLIP_CAPTURE = false;
+#else
+const bool FLIP_CAPTURE = true;
+#endif
+
 ScreenShareFilter::ScreenShareFilter(QString id, StatisticsInterface *stats,
                                      std::shared_ptr<ResourceAllocator> hwResources):
   Filter(id, "Screen Sharing", stats, hwResources, DT_NONE, DT_RGB32VIDEO),
   framerateNumerator_(10),
   framerateDenominator_(1),
-screenID_(0)
+  screenID_(0),
+  previousCapture_(nullptr),
+  previousCaptureSize_(0),
+  forceFullFrame_(true),
+  dirtyMap_(nullptr),
+  blocksX_(0),
+  blocksY_(0),
+  lastSent_(0)
 {}
 
 
@@ -52,6 +76,9 @@ void ScreenShareFilter::updateSettings()
     connect(&sendTimer_, &QTimer::timeout, this, &ScreenShareFilter::sendScreen);
     sendTimer_.start();
 
+    // make sure the first screenshot is sent even if the screen has not changed
+    forceFullFrame_ = true;
+
     // take first screenshot immediately so we don't have to wait
     sendScreen();
   }
@@ -96,34 +123,103 @@ void ScreenShareFilter::process()
   QPixmap screenCapture = screen->grabWindow(0);
   QImage image = screenCapture.toImage();
 
+  int64_t now = QDateTime::currentMSecsSinceEpoch();
+
+  if (forceFullFrame_.exchange(false))
+  {
+    previousCapture_ = nullptr;
+  }
+
+  int dirtyBlocks = updateDirtyBlocks(image);
+
+  if (dirtyBlocks == 0 && now - lastSent_ < UNCHANGED_REFRESH_INTERVAL_MS)
+  {
+    return;
+  }
+
+  lastSent_ = now;
+
   // capture the frame data
   std::unique_ptr<Data> newImage = initializeData(output_, DS_LOCAL);
-  newImage->creationTimestamp = QDateTime::currentMSecsSinceEpoch();
+  newImage->creationTimestamp = now;
   newImage->presentationTimestamp = newImage->creationTimestamp;
   newImage->data = std::unique_ptr<uchar[]>(new uchar[image.sizeInBytes()]);
-
-  image = image.mirrored(false, true);
-  uchar *bits = image.bits();
-
-  memcpy(newImage->data.get(), bits, image.sizeInBytes());
   newImage->data_size = image.sizeInBytes();
 
+  // copy the lines in the order they are sent
+  const uchar *bits = image.constBits();
+  const qsizetype lineBytes = image.bytesPerLine();
+  for (int y = 0; y < image.height(); ++y)
+  {
+    int sourceLine = FLIP_CAPTURE ? image.height() - 1 - y : y;
+    memcpy(newImage->data.get() + y*lineBytes, bits + sourceLine*lineBytes, lineBytes);
+  }
+
   // kvazaar requires divisable by 8 resolution
   newImage->vInfo->width = currentResolution_.width();
   newImage->vInfo->height = currentResolution_.height();
   newImage->vInfo->framerateNumerator = framerateNumerator_;
   newImage->vInfo->framerateDenominator = framerateDenominator_;
 
-#ifdef _WIN32
-  newImage->vInfo->flippedVertically = true;
-  newImage = normalizeOrientation(std::move(newImage));
-#endif
+  // tell the encoder which areas have changed
+  newImage->vInfo->roi.width = blocksX_;
+  newImage->vInfo->roi.height = blocksY_;
+  newImage->vInfo->roi.data = std::unique_ptr<int8_t[]>(new int8_t[blocksX_*blocksY_]);
+  fillRoiMap(dirtyMap_.get(), newImage->vInfo->roi.data.get(), blocksX_*blocksY_,
+             getHWManager()->getStaticScreenQpDelta());
 
   Q_ASSERT(newImage->data);
   sendOutput(std::move(newImage));
 }
 
 
+void ScreenShareFilter::fillRoiMap(const uint8_t* dirtyMap, int8_t* roiMap, int blocks,
+                                   int8_t staticDelta)
+{
+  for (int i = 0; i < blocks; ++i)
+  {
+    roiMap[i] = dirtyMap[i] ? 0 : staticDelta;
+  }
+}
+
+
+int ScreenShareFilter::updateDirtyBlocks(const QImage& image)
+{
+  int width = currentResolution_.width();
+  int height = currentResolution_.height();
+
+  // compare in the same orientation as the frame is sent so the map matches the frame
+  const uchar* current = image.constBits();
+  int stride = image.bytesPerLine();
+
+  if (previousCapture_ == nullptr || previousCaptureSize_ != image.sizeInBytes())
+  {
+    previousCaptureSize_ = image.sizeInBytes();
+    previousCapture_ = std::unique_ptr<uchar[]>(new uchar[previousCaptureSize_]);
+    memcpy(previousCapture_.get(), current, previousCaptureSize_);
+
+    blocksX_ = (width + DIRTY_BLOCK_SIZE - 1)/DIRTY_BLOCK_SIZE;
+    blocksY_ = (height + DIRTY_BLOCK_SIZE - 1)/DIRTY_BLOCK_SIZE;
+    dirtyMap_ = std::unique_ptr<uint8_t[]>(new uint8_t[blocksX_*blocksY_]);
+    memset(dirtyMap_.get(), 1, blocksX_*blocksY_);
+
+    return blocksX_*blocksY_;
+  }
+
+  uint8_t* previous = previousCapture_.get();
+
+  if (FLIP_CAPTURE)
+  {
+    current += (image.height() - 1)*stride;
+    previous += (image.height() - 1)*stride;
+    stride = -stride;
+  }
+
+  return get_conversion_kernels().update_dirty_blocks(previous, current, dirtyMap_.get(),
+                                                     width, height, stride, DIRTY_BLOCK_SIZE);
+}
+
+
 void ScreenShareFilter::sendScreen()
 {
   wakeUp();
@@ -4,6 +4,9 @@
 
 #include <QTimer>
 #include <QSize>
+#include <QImage>
+
+#include <atomic>
 
 class ScreenShareFilter : public Filter
 {
@@ -15,6 +18,11 @@ public:
 
   virtual void updateSettings();
 
+  // Fills the ROI map from the dirty map. The values are QP deltas to the frame
+  // QP: changed blocks are encoded with the frame QP and unchanged ones with staticDelta.
+  static void fillRoiMap(const uint8_t* dirtyMap, int8_t* roiMap, int blocks,
+                         int8_t staticDelta);
+
 protected:
 
   virtual void process();
@@ -25,6 +33,10 @@ private slots:
 
 private:
 
+  // compares the capture to the previous one block by block and updates the
+  // dirty map. Returns the number of changed blocks.
+  int updateDirtyBlocks(const QImage& image);
+
   QTimer sendTimer_;
 
   int32_t framerateNumerator_;
@@ -32,4 +44,19 @@ private:
   QSize currentResolution_;
 
   int screenID_;
+
+  // Variable frame rate: unchanged captures are only sent as a periodic refresh.
+  // The dirty map tells the encoder which blocks can be skipped.
+  std::unique_ptr<uchar[]> previousCapture_;
+  qsizetype previousCaptureSize_;
+
+  // set by the settings thread, the filter thread then drops the previous
+  // capture so that the next one is sent whole
+  std::atomic<bool> forceFullFrame_;
+
+  std::unique_ptr<uint8_t[]> dirtyMap_;
+  int blocksX_;
+  int blocksY_;
+
+  int64_t lastSent_;
 };
@@ -0,0 +1,81 @@
+#include "selfviewfilter.h"
+
+#include "yuvconversions.h"
+
+#include "logger.h"
+
+
+SelfViewFilter::SelfViewFilter(QString id, StatisticsInterface* stats,
+                               std::shared_ptr<ResourceAllocator> hwResources, DataType input):
+  Filter(id, "SelfView", stats, hwResources, input, DT_RGB32VIDEO),
+  maxHeight_(0),
+  horizontalMirroring_(false),
+  work_()
+{
+  if (!supportsFormat(input))
+  {
+    Logger::getLogger()->printProgramError(this, "Self view only supports YUV420, NV12 and YUYV");
+  }
+}
+
+
+bool SelfViewFilter::supportsFormat(DataType type)
+{
+  return type == DT_YUV420VIDEO || type == DT_NV12VIDEO || type == DT_YUYVVIDEO;
+}
+
+
+void SelfViewFilter::process()
+{
+  // only the newest frame is shown, so there is no point converting the older ones
+  uint32_t discarded = 0;
+  std::unique_ptr<Data> input = getNewestInput(discarded);
+
+  while (input)
+  {
+    SelfViewFormat format = SELF_VIEW_YUV420;
+    if (input->type == DT_NV12VIDEO)
+    {
+      format = SELF_VIEW_NV12;
+    }
+    else if (input->type == DT_YUYVVIDEO)
+    {
+      format = SELF_VIEW_YUYV;
+    }
+
+    const int width = input->vInfo->width;
+    const int height = input->vInfo->height;
+
+    // the smallest integer factor that fits the maximum height
+    int factor = 1;
+    if (maxHeight_ > 0 && height > maxHeight_)
+    {
+      factor = (height + maxHeight_ - 1)/maxHeight_;
+    }
+
+    const int outWidth = (width/factor) & ~1;
+    const int outHeight = height/factor;
+
+    if (work_.size() < selfview_work_size(width))
+    {
+      work_.resize(selfview_work_size(width));
+    }
+
+    // the widget takes ownership of the frame, so the output cannot be reused
+    uint32_t finalDataSize = outWidth*outHeight*4;
+    std::unique_ptr<uchar[]> rgb32_frame(new uchar[finalDataSize]);
+
+    get_conversion_kernels().selfview_to_rgb(input->data.get(), rgb32_frame.get(), width, height,
+                                             format, factor, horizontalMirroring_, work_.data());
+
+    input->type = DT_RGB32VIDEO;
+    input->data = std::move(rgb32_frame);
+    input->data_size = finalDataSize;
+    input->vInfo->width = outWidth;
+    input->vInfo->height = outHeight;
+    input->vInfo->flippedHorizontally = false;
+    sendOutput(std::move(input));
+
+    input = getNewestInput(discarded);
+  }
+}
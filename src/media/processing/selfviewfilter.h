@@ -0,0 +1,40 @@
+#pragma once
+
+#include "filter.h"
+
+#include <vector>
+
+// Produces the RGB32 self view directly from the camera format. Downscaling,
+// the conversion to RGB and mirroring are done in one pass so the full size
+// frame is not converted or copied between them.
+
+class SelfViewFilter : public Filter
+{
+public:
+  SelfViewFilter(QString id, StatisticsInterface* stats,
+                 std::shared_ptr<ResourceAllocator> hwResources, DataType input);
+
+  // whether frames of this type can be converted without other conversions
+  static bool supportsFormat(DataType type);
+
+  // frames higher than this are downscaled by an integer factor
+  void setMaxHeight(int height)
+  {
+    maxHeight_ = height;
+  }
+
+  void setHorizontalMirroring(bool status)
+  {
+    horizontalMirroring_ = status;
+  }
+
+protected:
+  void process();
+
+private:
+
+  int maxHeight_;
+  bool horizontalMirroring_;
+
+  std::vector<uint8_t> work_;
+};
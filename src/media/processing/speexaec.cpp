@@ -3,26 +3,69 @@
 #include <QSettings>
 
 #include "audioframebuffer.h"
+#include "audiomixing.h"
 
+#include "statisticsinterface.h"
 #include "settingskeys.h"
 #include "common.h"
 #include "global.h"
 #include "logger.h"
 
+#include <algorithm>
+#include <cmath>
 
-SpeexAEC::SpeexAEC(QAudioFormat format):
+// how far from the current reference the echo is searched for
+const int MAX_ECHO_DELAY_MS = 200;
+
+// The drift is measured over a minute so that the bursts of the audio
+// buffers average out. Larger drift is a fault rather than a clock.
+const int DRIFT_WINDOW_SECONDS = 60;
+const double MAX_DRIFT = 0.001;
+
+// ERLE is measured while the reference is louder than this (-dBov) and
+// reported once a second with the other AEC statistics
+const uint8_t ERLE_REFERENCE_LEVEL = 50;
+const uint32_t ERLE_WINDOW_US = 1000000;
+
+// how much playback is buffered for the reference at most
+const uint32_t ECHO_BUFFER_US = 1000000;
+
+
+SpeexAEC::SpeexAEC(QAudioFormat format, uint32_t frameUs, StatisticsInterface* stats):
   format_(format),
-  samplesPerFrame_(format.sampleRate()/AUDIO_FRAMES_PER_SECOND),
+  frameUs_(frameUs),
+  samplesPerFrame_(audioFrameSamples(format.sampleRate(), frameUs)),
   echo_state_(nullptr),
   preprocessor_(nullptr),
   echoBuffer_(nullptr),
+  echoFrame_(nullptr),
   echoBufferUpdated_(true),
   playbackDelay_(0),
   echoFilterLength_(0),
-  enabled_(false)
+  enabled_(false),
+  stats_(stats),
+  delayFrames_(0),
+  residualDelayMs_(0),
+  delayEstimator_(nullptr),
+  driftEstimator_(nullptr),
+  resampler_(nullptr),
+  resampled_(),
+  referenceSamples_(0),
+  captureSamples_(0),
+  drift_(0),
+  captureEnergy_(0),
+  outputEnergy_(0),
+  erleFrames_(0),
+  erle_(0)
 {}
 
 
+SpeexAEC::~SpeexAEC()
+{
+  cleanup();
+}
+
+
 void SpeexAEC::updateSettings()
 {
   if ( preprocessor_ != nullptr)
@@ -36,7 +79,11 @@ void SpeexAEC::updateSettings()
         init();
       }
 
-      playbackDelay_ = settingValue(SettingsKey::audioAECDelay);
+      if (playbackDelay_ != settingValue(SettingsKey::audioAECDelay))
+      {
+        playbackDelay_ = settingValue(SettingsKey::audioAECDelay);
+        delayFrames_ = playbackDelay_*1000/frameUs_;
+      }
 
       speexMutex_.lock();
       speex_preprocess_ctl(preprocessor_, SPEEX_PREPROCESS_SET_ECHO_STATE, echo_state_);
@@ -102,10 +149,21 @@ void SpeexAEC::init()
   speex_echo_ctl(echo_state_, SPEEX_ECHO_SET_SAMPLING_RATE, &sampleRate);
 
   // TODO: Support multiple channels
-  int frameSize = format_.sampleRate()*format_.bytesPerFrame()/AUDIO_FRAMES_PER_SECOND;
+  int frameSize = samplesPerFrame_*format_.bytesPerFrame();
 
   // here we input the samples to be made the right size for our application
-  echoBuffer_ = std::make_unique<AudioFrameBuffer>(frameSize);
+  echoBuffer_ = std::make_unique<AudioFrameBuffer>(frameSize, ECHO_BUFFER_US/frameUs_);
+  echoFrame_ = std::unique_ptr<uint8_t[]>(new uint8_t[frameSize]);
+
+  delayEstimator_ = std::make_unique<EchoDelayEstimator>(format_.sampleRate(),
+                                                         format_.channelCount(),
+                                                         MAX_ECHO_DELAY_MS);
+  driftEstimator_ = std::make_unique<ClockDriftEstimator>(uint64_t(format_.sampleRate())*
+                                                          DRIFT_WINDOW_SECONDS);
+  resampler_ = std::make_unique<DriftResampler>(format_.channelCount());
+  referenceSamples_ = 0;
+  captureSamples_ = 0;
+  drift_ = 0;
 
 
   preprocessor_ = speex_preprocess_state_init(samplesPerFrame_,
@@ -159,13 +217,18 @@ std::unique_ptr<uchar[]> SpeexAEC::processInputFrame(std::unique_ptr<uchar[]> in
                                               "Something wrong in settings");
     }
 
-    int echoBufferSize = (AUDIO_FRAMES_PER_SECOND*playbackDelay_)/1000;
+    captureSamples_ += samplesPerFrame_;
+    if (driftEstimator_->addPoint(captureSamples_, referenceSamples_))
+    {
+      // the reference is already resampled so only the remaining drift is measured
+      drift_ = std::min(std::max(drift_ + driftEstimator_->drift(), -MAX_DRIFT), MAX_DRIFT);
+    }
+
+    int echoBufferSize = delayFrames_;
 
     if (echoBuffer_->getBufferSize() >= echoBufferSize)
     {
-      uint8_t* echoFrame = echoBuffer_->readFrame();
-
-      if (echoFrame != nullptr)
+      if (echoBuffer_->readFrame(echoFrame_.get()))
       {
         std::unique_ptr<uchar[]> pcmOutput = std::unique_ptr<uchar[]>(new uchar[dataSize]);
 
@@ -176,7 +239,7 @@ std::unique_ptr<uchar[]> SpeexAEC::processInputFrame(std::unique_ptr<uchar[]> in
           // should be minimal for the AEC to work
           speex_echo_cancellation(echo_state_,
                                   (int16_t*)input.get(),
-                                  (int16_t*)echoFrame, (int16_t*)pcmOutput.get());
+                                  (int16_t*)echoFrame_.get(), (int16_t*)pcmOutput.get());
         }
         else
         {
@@ -193,8 +256,8 @@ std::unique_ptr<uchar[]> SpeexAEC::processInputFrame(std::unique_ptr<uchar[]> in
         }
         speexMutex_.unlock();
 
-        delete[] echoFrame;
-        echoFrame = nullptr;
+        updateAlignment((int16_t*)input.get(), (int16_t*)echoFrame_.get(),
+                        (int16_t*)pcmOutput.get());
 
         // a safety valve that drops frames if we have too much echo
         while (echoBuffer_->getBufferSize() >= echoBufferSize*2)
@@ -205,13 +268,7 @@ std::unique_ptr<uchar[]> SpeexAEC::processInputFrame(std::unique_ptr<uchar[]> in
                         QString::number(echoBuffer_->getBufferSize()) + " < " +
                        QString::number(echoBufferSize*2)});
 
-          echoFrame = echoBuffer_->readFrame();
-          if (echoFrame)
-          {
-            delete [] echoFrame;
-            echoFrame = nullptr;
-          }
-          else
+          if (!echoBuffer_->skipFrame())
           {
             break;
           }
@@ -240,7 +297,13 @@ void SpeexAEC::processEchoFrame(uint8_t *echo, uint32_t dataSize)
 {
   if (echoBuffer_)
   {
-    echoBuffer_->inputData(echo, dataSize);
+    // takes out the drift between the playback and capture clocks
+    resampler_->setRatio(1.0/(1.0 + drift_));
+    size_t samples = resampler_->process((int16_t*)echo, dataSize/format_.bytesPerFrame(),
+                                         resampled_);
+
+    echoBuffer_->inputData((uint8_t*)resampled_.data(), samples*format_.bytesPerFrame());
+    referenceSamples_ += samples;
     echoBufferUpdated_ = true;
   }
   else
@@ -250,6 +313,68 @@ void SpeexAEC::processEchoFrame(uint8_t *echo, uint32_t dataSize)
 }
 
 
+void SpeexAEC::updateAlignment(const int16_t* capture, const int16_t* reference,
+                               const int16_t* output)
+{
+  if (delayEstimator_->addFrame(capture, reference, samplesPerFrame_))
+  {
+    // Speex needs the reference before the echo, so the reference is moved
+    // by whole frames until it is at most one frame early
+    int delayMs = delayEstimator_->delayMs();
+    int frames = int(std::floor(delayMs*1000.0/frameUs_));
+    residualDelayMs_ = delayMs - frames*int(frameUs_)/1000;
+
+    if (frames != 0)
+    {
+      int previous = delayFrames_;
+      delayFrames_ = std::max(delayFrames_ + frames, 0);
+
+      for (int i = delayFrames_; i < previous; ++i)
+      {
+        echoBuffer_->skipFrame();
+      }
+
+      delayEstimator_->reset();
+
+      Logger::getLogger()->printNormal(this, "Moved the AEC reference to match the echo",
+                                       {"Delay"}, {QString::number(delayFrames_*int(frameUs_)/1000 +
+                                                                   residualDelayMs_) + " ms"});
+    }
+  }
+
+  uint32_t samples = samplesPerFrame_*format_.channelCount();
+  if (audio_level(reference, samples) <= ERLE_REFERENCE_LEVEL)
+  {
+    for (uint32_t i = 0; i < samples; ++i)
+    {
+      captureEnergy_ += double(capture[i])*capture[i];
+      outputEnergy_ += double(output[i])*output[i];
+    }
+  }
+
+  ++erleFrames_;
+  if (erleFrames_ >= int(ERLE_WINDOW_US/frameUs_))
+  {
+    // The output is after the residual echo suppression. Without far-end
+    // speech the previous ERLE is kept.
+    if (captureEnergy_ > 0)
+    {
+      erle_ = 10.0f*std::log10(float(captureEnergy_/std::max(outputEnergy_, 1.0)));
+    }
+
+    if (stats_)
+    {
+      stats_->aecStatus(delayFrames_*int(frameUs_)/1000 + residualDelayMs_,
+                        int32_t(std::lrint(drift_*1000000)), erle_);
+    }
+
+    captureEnergy_ = 0;
+    outputEnergy_ = 0;
+    erleFrames_ = 0;
+  }
+}
+
+
 uint8_t* SpeexAEC::createEmptyFrame(uint32_t size)
 {
   uint8_t* emptyFrame  = new uint8_t[size];
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "audioframebuffer.h"
+#include "echoalignment.h"
 
 #include <speex/speex_echo.h>
 #include <speex/speex_preprocess.h>
@@ -8,15 +9,25 @@
 #include <QtMultimedia/QAudioFormat>
 #include <QMutex>
 
+#include <atomic>
 #include <deque>
 #include <memory>
+#include <vector>
 
+class StatisticsInterface;
+
+// Echo cancellation of the capture with the playback as reference. The
+// delay of the reference is estimated from the echo and the reference is
+// resampled to follow the capture clock, so the echo stays within the
+// adaptive filter during long calls.
 
 class SpeexAEC : public QObject
 {
   Q_OBJECT
 public:
-  SpeexAEC(QAudioFormat format);
+  // frameUs is the duration of the frames given to both process functions
+  SpeexAEC(QAudioFormat format, uint32_t frameUs, StatisticsInterface* stats);
+  ~SpeexAEC();
 
   void updateSettings();
 
@@ -33,7 +44,13 @@ private:
 
   uint8_t* createEmptyFrame(uint32_t size);
 
+  // moves the reference by whole frames to match the estimated echo delay
+  // and measures the clock drift and ERLE, called for each cancelled frame
+  void updateAlignment(const int16_t* capture, const int16_t* reference,
+                       const int16_t* output);
+
   QAudioFormat format_;
+  uint32_t frameUs_;
   uint32_t samplesPerFrame_;
 
   SpeexEchoState *echo_state_;
@@ -43,6 +60,7 @@ private:
 
   // Buffer for playback frames used in AEC
   std::unique_ptr<AudioFrameBuffer> echoBuffer_;
+  std::unique_ptr<uint8_t[]> echoFrame_;
   bool echoBufferUpdated_; // for debug prints  only
 
 
@@ -50,4 +68,29 @@ private:
   int echoFilterLength_;
 
   bool enabled_;
+
+  StatisticsInterface* stats_;
+
+  // reference frames buffered before cancelling, starts from the delay setting
+  int delayFrames_;
+  int residualDelayMs_; // the part of the delay within the last frame
+
+  std::unique_ptr<EchoDelayEstimator> delayEstimator_;
+  std::unique_ptr<ClockDriftEstimator> driftEstimator_;
+
+  std::unique_ptr<DriftResampler> resampler_;
+  std::vector<int16_t> resampled_;
+
+  // the reference samples buffered so far, written by the playback thread
+  std::atomic<uint64_t> referenceSamples_;
+  uint64_t captureSamples_;
+
+  // how much faster the reference arrives than the capture runs
+  std::atomic<double> drift_;
+
+  // energies of the capture and the output while the reference is loud
+  double captureEnergy_;
+  double outputEnergy_;
+  int erleFrames_;
+  float erle_; // in dB
 };
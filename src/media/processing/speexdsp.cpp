@@ -10,11 +10,12 @@
 #include "logger.h"
 
 
-SpeexDSP::SpeexDSP(QAudioFormat format):
+SpeexDSP::SpeexDSP(QAudioFormat format, uint32_t frameUs):
   format_(format),
-  samplesPerFrame_(format.sampleRate()/AUDIO_FRAMES_PER_SECOND),
+  samplesPerFrame_(audioFrameSamples(format.sampleRate(), frameUs)),
   processMutex_(),
-  preprocessor_(nullptr)
+  preprocessor_(nullptr),
+  voiceDetector_()
 {}
 
 
@@ -75,17 +76,16 @@ void SpeexDSP::updateSettings()
                  {"Level", "Increment", "Decrement"},
                  {QString::number(agcLevel_),
                   QString::number(increment), QString::number(decrement)});
-
-
-      // VAD could be used to fix this AGC increment problem (background sounds
-      // are too loud after a long quiet time), but it doesn't work in current version of Speex
-      //speex_preprocess_ctl(preprocessor_, SPEEX_PREPROCESS_SET_VAD, &activeState);
     }
     else
     {
       speex_preprocess_ctl(preprocessor_, SPEEX_PREPROCESS_SET_AGC, &inactiveState);
     }
 
+    // The VAD of Speex is not used, because we decide the voice activity
+    // from the speech probability with our own limits.
+    speex_preprocess_ctl(preprocessor_, SPEEX_PREPROCESS_SET_VAD, &inactiveState);
+
     processMutex_.unlock();
   }
   else
@@ -96,11 +96,13 @@ void SpeexDSP::updateSettings()
 }
 
 
-void SpeexDSP::init(bool agc, bool denoise, bool dereverb, int32_t agcLevel, int agcMaxGain)
+void SpeexDSP::init(bool agc, bool denoise, bool dereverb, bool vad,
+                    int32_t agcLevel, int agcMaxGain)
 {
   agc_ = agc;
   denoise_ = denoise;
   dereverb_ = dereverb;
+  vad_ = vad;
 
   agcLevel_ = agcLevel;
   agcMaxGain_ = agcMaxGain;
@@ -112,10 +114,11 @@ void SpeexDSP::init(bool agc, bool denoise, bool dereverb, int32_t agcLevel, int
 
   processMutex_.lock();
 
-  if  (agc_ || denoise_ || dereverb_)
+  if  (agc_ || denoise_ || dereverb_ || vad_)
   {
     preprocessor_ = speex_preprocess_state_init(samplesPerFrame_,
                                                 format_.sampleRate());
+    voiceDetector_.reset();
   }
   else
   {
@@ -144,7 +147,8 @@ void SpeexDSP::cleanup()
 
 
 std::unique_ptr<uchar[]> SpeexDSP::processInputFrame(std::unique_ptr<uchar[]> input,
-                                                     uint32_t dataSize)
+                                                     uint32_t dataSize,
+                                                     bool* voiceActivity)
 {
   if (dataSize != samplesPerFrame_*format_.bytesPerFrame())
   {
@@ -159,10 +163,15 @@ std::unique_ptr<uchar[]> SpeexDSP::processInputFrame(std::unique_ptr<uchar[]> in
   // takes effect.
   if(preprocessor_ != nullptr)
   {
-    // The return value of run function is voice activity (if enabled). In my tests
-    // it didn't work very well
     speex_preprocess_run(preprocessor_, (int16_t*)input.get());
 
+    // voice activity decides when the encoder stops sending (DTX)
+    if (vad_ && voiceActivity != nullptr)
+    {
+      spx_int32_t probability = 0;
+      speex_preprocess_ctl(preprocessor_, SPEEX_PREPROCESS_GET_PROB, &probability);
+      *voiceActivity = voiceDetector_.addFrame(probability);
+    }
   }
   else
   {
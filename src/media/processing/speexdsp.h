@@ -1,6 +1,8 @@
 #pragma once
 
 
+#include "voiceactivitydetector.h"
+
 #include <speex/speex_preprocess.h>
 
 #include <QtMultimedia/QAudioFormat>
@@ -19,16 +21,19 @@ class SpeexDSP : public QObject
 {
   Q_OBJECT
 public:
-  SpeexDSP(QAudioFormat format);
+  SpeexDSP(QAudioFormat format, uint32_t frameUs);
 
   void updateSettings();
 
-  void init(bool agc, bool denoise, bool dereverb,
+  void init(bool agc, bool denoise, bool dereverb, bool vad,
             int32_t agcLevel = 0, int agcMaxGain = 0);
   void cleanup();
 
+  // Voice activity is set to whether the frame has speech if VAD is enabled.
+  // The input should already be echo cancelled.
   std::unique_ptr<uchar[]> processInputFrame(std::unique_ptr<uchar[]> input,
-                                             uint32_t dataSize);
+                                             uint32_t dataSize,
+                                             bool* voiceActivity = nullptr);
 private:
 
   QAudioFormat format_;
@@ -42,6 +47,9 @@ private:
   bool agc_ = false;
   bool denoise_ = false;
   bool dereverb_ = false;
+  bool vad_ = false;
+
+  VoiceActivityDetector voiceDetector_;
 
   int32_t agcLevel_ = 0;
   int agcMaxGain_ = 0;
@@ -0,0 +1,29 @@
+#include "voiceactivitydetector.h"
+
+
+VoiceActivityDetector::VoiceActivityDetector(int startProbability, int continueProbability):
+  startProbability_(startProbability),
+  continueProbability_(continueProbability),
+  speech_(false)
+{}
+
+
+bool VoiceActivityDetector::addFrame(int probability)
+{
+  if (speech_)
+  {
+    speech_ = probability >= continueProbability_;
+  }
+  else
+  {
+    speech_ = probability >= startProbability_;
+  }
+
+  return speech_;
+}
+
+
+void VoiceActivityDetector::reset()
+{
+  speech_ = false;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// Decides whether a captured frame has speech from the speech probability
+// Speex estimates for it. Speech starts only when the probability is high and
+// continues while it stays above a lower limit, so short dips inside words do
+// not end it. The probabilities are taken after echo cancellation so that the
+// voice of the peer coming from our speakers is not counted as speech.
+
+// The Speex defaults (35 and 20) let steady background noise through as
+// speech. The encoder keeps sending for a while after speech ends, which
+// covers the pauses between words, so the limits can be higher than those.
+const int VAD_PROB_START = 60;
+const int VAD_PROB_CONTINUE = 40;
+
+class VoiceActivityDetector
+{
+public:
+  // probabilities in percent
+  VoiceActivityDetector(int startProbability = VAD_PROB_START,
+                        int continueProbability = VAD_PROB_CONTINUE);
+
+  // returns whether this frame has speech
+  bool addFrame(int probability);
+
+  void reset();
+
+  bool speech() const
+  {
+    return speech_;
+  }
+
+private:
+
+  int startProbability_;
+  int continueProbability_;
+
+  bool speech_;
+};
@@ -1,4 +1,6 @@
 #include "yuvconversions.h"
+#include "yuvscaling.h"
+#include "conversionpool.h"
 
 #include <emmintrin.h>
 #include <xmmintrin.h>
@@ -9,9 +11,11 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <stddef.h>
 
 #include <math.h>
-#include <omp.h> // for mt versions
+
+#include <algorithm>
 
 // For additional optimizations checks:
 // https://stackoverflow.com/questions/6121792/how-to-check-if-a-cpu-supports-the-sse3-instruction-set
@@ -19,6 +23,7 @@
 #ifdef _WIN32
 #include <intrin.h>
   #define cpuid(info, x)    __cpuidex(info, x, 0)
+  #define xgetbv(index)     _xgetbv(index)
 #else
 
 //  GCC Intrinsics
@@ -27,12 +32,65 @@
       __cpuid_count(InfoType, 0, info[0], info[1], info[2], info[3]);
 }
 
+uint64_t xgetbv(uint32_t index)
+{
+  uint32_t eax, edx;
+  __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+  return ((uint64_t)edx << 32) | eax;
+}
+
+#endif
+
+// The kernels are compiled for their instruction set regardless of build flags
+// and selected at runtime based on what the CPU supports.
+#if defined(__GNUC__) || defined(__clang__)
+  #define TARGET_SSE41  __attribute__((target("sse4.1")))
+  #define TARGET_AVX2   __attribute__((target("avx2")))
+  #define TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#else
+  #define TARGET_SSE41
+  #define TARGET_AVX2
+  #define TARGET_AVX512
 #endif
 
 
 uint8_t clamp_8bit(int32_t input);
 
 
+// Integer approximation of BT.601 shared by all YUV to RGB kernels.
+// Chroma is centered at zero and the output is BGRA with zero alpha.
+static inline void yuv_to_bgra_pixel(int32_t luma, int32_t u, int32_t v, uint8_t* out)
+{
+  int32_t r = v + (v >> 2) + (v >> 3) + (v >> 5);
+  int32_t g = (u >> 2) + (u >> 4) + (u >> 5) + (v >> 1) + (v >> 3) + (v >> 4) + (v >> 5);
+  int32_t b = u + (u >> 1) + (u >> 2) + (u >> 6);
+
+  out[0] = clamp_8bit(luma + b);
+  out[1] = clamp_8bit(luma - g);
+  out[2] = clamp_8bit(luma + r);
+  out[3] = 0;
+}
+
+
+static inline uint8_t bgra_to_luma(const uint8_t* pixel)
+{
+  return (76*pixel[2] + 150*pixel[1] + 29*pixel[0] + 128) >> 8;
+}
+
+
+// chroma of 2x2 block from the sums of its color components
+static inline uint8_t sums_to_chroma_u(int32_t r, int32_t g, int32_t b)
+{
+  return ((-43*r - 84*g + 127*b + 512) >> 10) + 128;
+}
+
+
+static inline uint8_t sums_to_chroma_v(int32_t r, int32_t g, int32_t b)
+{
+  return ((127*r - 106*g - 21*b + 512) >> 10) + 128;
+}
+
+
 bool is_avx2_available()
 {
   int info[4];
@@ -61,15 +119,51 @@ bool is_sse41_available()
   return false;
 }
 
+bool is_avx512_available()
+{
+  int info[4];
+  cpuid(info, 0);
+  int nIds = info[0];
+
+  if (nIds < 0x00000007){
+      return false;
+  }
+
+  // the OS must save the AVX-512 registers (XCR0 bits 1, 2 and 5-7)
+  cpuid(info,0x00000001);
+  if ((info[2] & ((int)1 << 27)) == 0 || (xgetbv(0) & 0xe6) != 0xe6){
+      return false;
+  }
+
+  // AVX-512 foundation and byte/word instructions
+  cpuid(info,0x00000007);
+  return (info[1] & ((int)1 << 16)) != 0 && (info[1] & ((int)1 << 30)) != 0;
+}
+
 
 #define _mm256_set_m128i(/* __m128i */ hi, /* __m128i */ lo) _mm256_insertf128_si256(_mm256_castsi128_si256(lo), (hi), 0x1)
 
 // Return the next aligned address for *p. Result is at most alignment larger than p.
+// Multithreaded conversions split the frame into bands of whole rows. Each
+// thread gets a few bands so a slow thread can be compensated by the others,
+// but bands are kept large enough that dispatching them costs little.
+const int BANDS_PER_THREAD = 2;
+const int MIN_BAND_PIXELS = 32*640;
+
+static int band_rows(int width, int height, int threads)
+{
+  int rows = std::max(height/(std::max(threads, 1)*BANDS_PER_THREAD), MIN_BAND_PIXELS/std::max(width, 1));
+  rows = (rows + 1) & ~1; // chroma rows are shared by two luma rows
+  return std::max(rows, 2);
+}
+
 #define ALIGNED_POINTER(p, alignment) (void*)((intptr_t)(p) + (alignment) - ((intptr_t)(p) % (alignment)))
 // 32 bytes is enough for AVX2
 #define SIMD_ALIGNMENT 32
 
-int yuv420_to_rgb_i_avx2_mt(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height, uint8_t threads)
+// converts rows [first_row, last_row) of the frame, first_row must be even
+static TARGET_AVX2 void yuv420_to_rgb_rows_avx2(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height,
+                                                int first_row, int last_row)
 {
  const int mini[8] = { 0,0,0,0,0,0,0,0 };
  const int middle[8] = { 128, 128, 128, 128,128, 128, 128, 128 };
@@ -88,10 +182,7 @@ int yuv420_to_rgb_i_avx2_mt(uint8_t* input, uint8_t* output, uint16_t width, uin
  __m128i chroma_shufflemask_lo = _mm_set_epi8(-1, -1, -1, 1, -1, -1, -1, 1, -1, -1, -1, 0, -1, -1, -1, 0);
  __m128i chroma_shufflemask_hi = _mm_set_epi8(-1, -1, -1, 3, -1, -1, -1, 3, -1, -1, -1, 2, -1, -1, -1, 2);
 
- // It seems the number of threads needs to be adjusted just before calling omp parrallel
- omp_set_num_threads(threads);
- #pragma omp parallel for
- for (int32_t i = 0; i < width*height; i += 16) {
+ for (int32_t i = first_row*width; i < last_row*width; i += 16) {
    uint8_t *out = output + 4*i;
 
    int8_t row = i%(width*2) >= width ? 1 : 0;
@@ -164,10 +255,22 @@ int yuv420_to_rgb_i_avx2_mt(uint8_t* input, uint8_t* output, uint16_t width, uin
      }
    }
  }
- return 1;
 }
 
-int yuv420_to_rgb_i_avx2(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+
+int yuv420_to_rgb_i_avx2_mt(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height, uint8_t threads)
+{
+  int rows = band_rows(width, height, threads);
+  int bands = (height + rows - 1)/rows;
+
+  ConversionPool::getPool().run(bands, threads, [=](int band)
+  {
+    yuv420_to_rgb_rows_avx2(input, output, width, height, band*rows, std::min<int>(height, band*rows + rows));
+  });
+  return 1;
+}
+
+TARGET_AVX2 int yuv420_to_rgb_i_avx2(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
 {
   const int mini[8] = { 0,0,0,0,0,0,0,0 };
   const int middle[8] = { 128, 128, 128, 128,128, 128, 128, 128 };
@@ -308,7 +411,7 @@ int yuv420_to_rgb_i_avx2(uint8_t* input, uint8_t* output, uint16_t width, uint16
 }
 
 
-int yuv420_to_rgb_i_sse41(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+TARGET_SSE41 int yuv420_to_rgb_i_sse41(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
 {
   const int mini[4] = { 0,0,0,0 };
   const int middle[4] = { 128, 128, 128, 128 };
@@ -420,345 +523,414 @@ int yuv420_to_rgb_i_sse41(uint8_t* input, uint8_t* output, uint16_t width, uint1
 }
 
 
+
 void yuv420_to_rgb_i_c(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
 {
-  // Luma pixels
-  for(int i = 0; i < width*height; ++i)
-  {
-    output[i*4] = input[i];
-    output[i*4+1] = input[i];
-    output[i*4+2] = input[i];
-  }
-
-  uint32_t u_offset = width*height;
-  uint32_t v_offset = width*height + height*width/4;
+  uint8_t *in_u = &input[width*height];
+  uint8_t *in_v = &input[width*height + (width*height >> 2)];
 
-  for(int y = 0; y < height/2; ++y)
+  for (int y = 0; y < height; ++y)
   {
-    for(int x = 0; x < width/2; ++x)
-    {
-      int32_t cr = input[x + y*width/2 + u_offset] - 128;
-      int32_t cb = input[x + y*width/2 + v_offset] - 128;
-
-      int32_t rpixel = cr + (cr >> 2) + (cr >> 3) + (cr >> 5);
-      int32_t gpixel = - ((cb >> 2) + (cb >> 4) + (cb >> 5)) - ((cr >> 1)+(cr >> 3)+(cr >> 4)+(cr >> 5));
-      int32_t bpixel = cb + (cb >> 1)+(cb >> 2)+(cb >> 6);
-
-      int32_t row      = 8*y*width;
-      int32_t next_row = row + 4*width;
-
-      // add chroma components to rgb pixels
-      // R
-      int32_t pixel_value = 0;
-
-      pixel_value                = output[8*x + row ] + rpixel;
-      output[8*x + row]          = clamp_8bit(pixel_value);
-
-      pixel_value                = output[8*x + 4 + row ] + rpixel;
-      output[8*x + 4 + row]      = clamp_8bit(pixel_value);
-
-      pixel_value                = output[8*x +     next_row] + rpixel;
-      output[8*x + next_row]     = clamp_8bit(pixel_value);
-
-      pixel_value                = output[8*x + 4 + next_row] + rpixel;
-      output[8*x + 4 + next_row] = clamp_8bit(pixel_value);
-
-      // G
-      pixel_value                = output[8*x + row + 1] + gpixel;
-      output[8*x + row + 1]      = clamp_8bit(pixel_value);
-
-      pixel_value                = output[8*x + 4 + row + 1] + gpixel;
-      output[8*x + 4 + row + 1]  = clamp_8bit(pixel_value);
+    uint8_t *in_y = input + y*width;
+    uint8_t *row_u = in_u + (y/2)*(width/2);
+    uint8_t *row_v = in_v + (y/2)*(width/2);
+    uint8_t *out = output + 4*y*width;
 
-      pixel_value                = output[8*x +  next_row + 1] + gpixel;
-      output[8*x + next_row + 1] = clamp_8bit(pixel_value);
-
-      pixel_value                    = output[8*x + 4 + next_row + 1] + gpixel;
-      output[8*x + 4 + next_row + 1] = clamp_8bit(pixel_value);
-
-      // B
-      pixel_value                = output[8*x + row + 2] + bpixel;
-      output[8*x + row + 2]      = clamp_8bit(pixel_value);
-
-      pixel_value                = output[8*x + 4 + row + 2] + bpixel;
-      output[8*x + 4 + row + 2]  = clamp_8bit(pixel_value);
-
-      pixel_value                = output[8*x + next_row + 2] + bpixel;
-      output[8*x + next_row + 2] = clamp_8bit(pixel_value);
-
-      pixel_value                    = output[8*x + 4 + next_row + 2] + bpixel;
-      output[8*x + 4 + next_row + 2] = clamp_8bit(pixel_value);
+    for (int x = 0; x < width; ++x)
+    {
+      yuv_to_bgra_pixel(in_y[x], row_u[x/2] - 128, row_v[x/2] - 128, out + 4*x);
     }
   }
 }
 
 
-int rgb_to_yuv420_i_sse41_mt(uint8_t* input, uint8_t* output, int width, int height, int threads)
+static inline TARGET_AVX2 __m256i yuv_to_bgra_avx2(__m256i luma, __m256i u, __m256i v)
 {
-  const int r_mul_y[4] = { 76, 76, 76, 76 };
-  const int r_mul_u[4] = { -43, -43, -43, -43 };
-  const int r_mul_v[4] = { 127, 127, 127, 127 };
-
-  const int g_mul_y[4] = { 150, 150, 150, 150 };
-  const int g_mul_u[4] = { -84, -84, -84, -84 };
-  const int g_mul_v[4] = { -106, -106, -106, -106 };
+  const __m256i min_val = _mm256_setzero_si256();
+  const __m256i max_val = _mm256_set1_epi32(255);
 
-  const int b_mul_y[4] = { 29, 29, 29, 29 };
-  const int b_mul_u[4] = { 127, 127, 127, 127 };
-  const int b_mul_v[4] = { -21, -21, -21, -21 };
+  __m256i r = _mm256_add_epi32(v, _mm256_add_epi32(_mm256_srai_epi32(v, 2), _mm256_add_epi32(_mm256_srai_epi32(v, 3), _mm256_srai_epi32(v, 5))));
+  __m256i g = _mm256_add_epi32(_mm256_add_epi32(_mm256_srai_epi32(u, 2), _mm256_add_epi32(_mm256_srai_epi32(u, 4), _mm256_srai_epi32(u, 5))),
+                               _mm256_add_epi32(_mm256_srai_epi32(v, 1), _mm256_add_epi32(_mm256_srai_epi32(v, 3), _mm256_add_epi32(_mm256_srai_epi32(v, 4), _mm256_srai_epi32(v, 5)))));
+  __m256i b = _mm256_add_epi32(u, _mm256_add_epi32(_mm256_srai_epi32(u, 1), _mm256_add_epi32(_mm256_srai_epi32(u, 2), _mm256_srai_epi32(u, 6))));
 
-  const __m128i r_y = _mm_loadu_si128((__m128i const*)r_mul_y);
-  const __m128i r_u = _mm_loadu_si128((__m128i const*)r_mul_u);
-  const __m128i r_v = _mm_loadu_si128((__m128i const*)r_mul_v);
+  r = _mm256_max_epi32(min_val, _mm256_min_epi32(max_val, _mm256_add_epi32(luma, r)));
+  g = _mm256_max_epi32(min_val, _mm256_min_epi32(max_val, _mm256_sub_epi32(luma, g)));
+  b = _mm256_max_epi32(min_val, _mm256_min_epi32(max_val, _mm256_add_epi32(luma, b)));
 
-  const __m128i g_y = _mm_loadu_si128((__m128i const*)g_mul_y);
-  const __m128i g_u = _mm_loadu_si128((__m128i const*)g_mul_u);
-  const __m128i g_v = _mm_loadu_si128((__m128i const*)g_mul_v);
-
-  const __m128i b_y = _mm_loadu_si128((__m128i const*)b_mul_y);
-  const __m128i b_u = _mm_loadu_si128((__m128i const*)b_mul_u);
-  const __m128i b_v = _mm_loadu_si128((__m128i const*)b_mul_v);
-
-  const int mini[4] = { 0,0,0,0 };
-  const int maxi[4] = { 255, 255, 255, 255 };
+  return _mm256_or_si256(_mm256_slli_epi32(r, 16), _mm256_or_si256(_mm256_slli_epi32(g, 8), b));
+}
 
-  const int chroma_offset[4] = { 255 * 255, 255 * 255, 255 * 255, 255 * 255 };
 
-  const __m128i min_val = _mm_loadu_si128((__m128i const*)mini);
-  const __m128i max_val = _mm_loadu_si128((__m128i const*)maxi);
-  const __m128i cr_offset = _mm_loadu_si128((__m128i const*)chroma_offset);
+static inline TARGET_AVX512 __m512i yuv_to_bgra_avx512(__m512i luma, __m512i u, __m512i v)
+{
+  const __m512i min_val = _mm512_setzero_si512();
+  const __m512i max_val = _mm512_set1_epi32(255);
 
-  //*output = (uint8_t *)malloc(width*height + width*height);
-  uint8_t *out_y = &output[width*height-width];
+  __m512i r = _mm512_add_epi32(v, _mm512_add_epi32(_mm512_srai_epi32(v, 2), _mm512_add_epi32(_mm512_srai_epi32(v, 3), _mm512_srai_epi32(v, 5))));
+  __m512i g = _mm512_add_epi32(_mm512_add_epi32(_mm512_srai_epi32(u, 2), _mm512_add_epi32(_mm512_srai_epi32(u, 4), _mm512_srai_epi32(u, 5))),
+                               _mm512_add_epi32(_mm512_srai_epi32(v, 1), _mm512_add_epi32(_mm512_srai_epi32(v, 3), _mm512_add_epi32(_mm512_srai_epi32(v, 4), _mm512_srai_epi32(v, 5)))));
+  __m512i b = _mm512_add_epi32(u, _mm512_add_epi32(_mm512_srai_epi32(u, 1), _mm512_add_epi32(_mm512_srai_epi32(u, 2), _mm512_srai_epi32(u, 6))));
 
-  __m128i shufflemask = _mm_set_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 12, 8, 4, 0);
-  __m128i shufflemask_chroma = _mm_set_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 8, 0);
+  r = _mm512_max_epi32(min_val, _mm512_min_epi32(max_val, _mm512_add_epi32(luma, r)));
+  g = _mm512_max_epi32(min_val, _mm512_min_epi32(max_val, _mm512_sub_epi32(luma, g)));
+  b = _mm512_max_epi32(min_val, _mm512_min_epi32(max_val, _mm512_add_epi32(luma, b)));
 
-  __m128i shufflemask_b = _mm_set_epi8(-1, -1, -1, 12, -1, -1, -1, 8, -1, -1, -1, 4, -1, -1, -1, 0);
-  __m128i shufflemask_g = _mm_set_epi8(-1, -1, -1, 13, -1, -1, -1, 9, -1, -1, -1, 5, -1, -1, -1, 1);
-  __m128i shufflemask_r = _mm_set_epi8(-1, -1, -1, 14, -1, -1, -1, 10, -1, -1, -1, 6, -1, -1, -1, 2);
+  return _mm512_or_si512(_mm512_slli_epi32(r, 16), _mm512_or_si512(_mm512_slli_epi32(g, 8), b));
+}
 
-  // It seems the number of threads needs to be adjusted just before calling omp parrallel
-  omp_set_num_threads(threads);
-  #pragma omp parallel for
-  for (int32_t i = 0; i < width*height << 2; i += 16) {
 
-    uint8_t *in = input + i;
+TARGET_AVX512 void yuv420_to_rgb_i_avx512(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+{
+  uint8_t *in_u = &input[width*height];
+  uint8_t *in_v = &input[width*height + (width*height >> 2)];
 
-    // Load 16 bytes (4 pixels)
-    const __m128i a = _mm_loadu_si128((__m128i const*) in);
+  // each chroma sample is used for two horizontal pixels
+  const __m512i duplicate = _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+  const __m512i middle_val = _mm512_set1_epi32(128);
 
-    __m128i b = _mm_shuffle_epi8(a, shufflemask_b);
-    __m128i g = _mm_shuffle_epi8(a, shufflemask_g);
-    __m128i r = _mm_shuffle_epi8(a, shufflemask_r);
+  for (int y = 0; y < height; ++y)
+  {
+    uint8_t *in_y = input + y*width;
+    uint8_t *row_u = in_u + (y/2)*(width/2);
+    uint8_t *row_v = in_v + (y/2)*(width/2);
+    uint8_t *out = output + 4*y*width;
 
-    __m128i res_y = _mm_max_epi32(min_val, _mm_min_epi32(
-                                    max_val, _mm_srai_epi32(
-                                      _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r, r_y), _mm_mullo_epi32(g, g_y)),
-                                                    _mm_mullo_epi32(b, b_y)), 8)));
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m512i luma = _mm512_cvtepu8_epi32(_mm_loadu_si128((__m128i const*)&in_y[x]));
+      __m512i u = _mm512_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*)&row_u[x/2]));
+      __m512i v = _mm512_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*)&row_v[x/2]));
 
-    __m128i temp_y = _mm_shuffle_epi8(res_y, shufflemask);
+      u = _mm512_sub_epi32(_mm512_permutexvar_epi32(duplicate, u), middle_val);
+      v = _mm512_sub_epi32(_mm512_permutexvar_epi32(duplicate, v), middle_val);
 
-    // this takes advantage of losing the remainder when dividing with width.
-    uint8_t *y_place = out_y + 4*i/16 - (((i/16 - 1)*4)/width)*2*width;
+      _mm512_storeu_si512((void*)&out[4*x], yuv_to_bgra_avx512(luma, u, v));
+    }
 
-    if (i == 0)
+    for (; x < width; ++x)
     {
-      y_place = out_y;
+      yuv_to_bgra_pixel(in_y[x], row_u[x/2] - 128, row_v[x/2] - 128, out + 4*x);
     }
-
-    memcpy(y_place, &temp_y, 4);
   }
+}
 
-  uint8_t *out_u = &output[width*height + (width*height>>2) - (width>>1)];
-  uint8_t *out_v = &out_u[width*height >> 2];
-
-  omp_set_num_threads(threads);
-  #pragma omp parallel for
-  for (int i = 0; i < width*height * 4; i += 2 * width * 4)
-  {
-    for (int j = i; j < i + width * 4; j += 4 * 4)
-    {
-      const __m128i a = _mm_loadu_si128((__m128i const*)&input[j]);
-      const __m128i a2 = _mm_loadu_si128((__m128i const*)&input[j+ width * 4]);
-
-      __m128i b = _mm_shuffle_epi8(a, shufflemask_b);
-      __m128i g = _mm_shuffle_epi8(a, shufflemask_g);
-      __m128i r = _mm_shuffle_epi8(a, shufflemask_r);
 
-      __m128i b2 = _mm_shuffle_epi8(a2, shufflemask_b);
-      __m128i g2 = _mm_shuffle_epi8(a2, shufflemask_g);
-      __m128i r2 = _mm_shuffle_epi8(a2, shufflemask_r);
+// Converts rows y and y + 1 starting from pixel x_start. The SIMD kernels
+// use this for the pixels that do not fill a whole vector.
+static void rgb_to_yuv420_rows_c(uint8_t* input, uint8_t* output, int width, int height,
+                                 int y, int x_start)
+{
+  uint8_t *row_0 = input + 4*y*width;
+  uint8_t *row_1 = row_0 + 4*width;
 
-      __m128i r_sum = _mm_add_epi32(r, r2);
-      __m128i g_sum = _mm_add_epi32(g, g2);
-      __m128i b_sum = _mm_add_epi32(b, b2);
+  uint8_t *out_y = output + y*width;
+  uint8_t *out_u = output + width*height + (y/2)*(width/2);
+  uint8_t *out_v = out_u + (width*height >> 2);
 
-      __m128i res_u_b = _mm_add_epi32(_mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r_sum, r_u),
-                                                                  _mm_mullo_epi32(g_sum, g_u)),
-                                                    _mm_mullo_epi32(b_sum, b_u)), cr_offset);
-      __m128i res_u_tmp = _mm_max_epi32(min_val, _mm_min_epi32(max_val, _mm_srai_epi32(res_u_b, 9)));
+  for (int x = x_start; x < width; ++x)
+  {
+    out_y[x]         = bgra_to_luma(row_0 + 4*x);
+    out_y[x + width] = bgra_to_luma(row_1 + 4*x);
+  }
 
-      __m128i res_u = _mm_srai_epi32(_mm_add_epi32(_mm_shuffle_epi32(res_u_tmp, 0xb1), res_u_tmp), 1);
-      __m128i temp_u = _mm_shuffle_epi8(res_u, shufflemask_chroma);
+  for (int x = x_start; x + 1 < width; x += 2)
+  {
+    int32_t b = row_0[4*x]     + row_0[4*x + 4] + row_1[4*x]     + row_1[4*x + 4];
+    int32_t g = row_0[4*x + 1] + row_0[4*x + 5] + row_1[4*x + 1] + row_1[4*x + 5];
+    int32_t r = row_0[4*x + 2] + row_0[4*x + 6] + row_1[4*x + 2] + row_1[4*x + 6];
 
+    out_u[x/2] = sums_to_chroma_u(r, g, b);
+    out_v[x/2] = sums_to_chroma_v(r, g, b);
+  }
+}
 
-      uint32_t i_laps = i/(2 * width * 4);
-      uint32_t j_laps_per_i = 4*width/16;
-      uint32_t j_laps = (j - i)/16;
 
-      int32_t loopPlace = 2*(i_laps*j_laps_per_i + j_laps) - ((i_laps*j_laps_per_i + j_laps)/(width/4))*width;
-      memcpy(out_u + loopPlace, &temp_u, 2);
+static TARGET_SSE41 void rgb_to_yuv420_rows_sse41(uint8_t* input, uint8_t* output, int width, int height,
+                                                  int y)
+{
+  const __m128i mask = _mm_set1_epi32(0xff);
+  const __m128i zero = _mm_setzero_si128();
+
+  const __m128i r_y = _mm_set1_epi32(76);
+  const __m128i g_y = _mm_set1_epi32(150);
+  const __m128i b_y = _mm_set1_epi32(29);
+  const __m128i r_u = _mm_set1_epi32(-43);
+  const __m128i g_u = _mm_set1_epi32(-84);
+  const __m128i b_u = _mm_set1_epi32(127);
+  const __m128i r_v = _mm_set1_epi32(127);
+  const __m128i g_v = _mm_set1_epi32(-106);
+  const __m128i b_v = _mm_set1_epi32(-21);
+
+  const __m128i luma_round = _mm_set1_epi32(128);
+  const __m128i chroma_round = _mm_set1_epi32(512);
+  const __m128i chroma_offset = _mm_set1_epi32(128);
+
+  uint8_t *row_0 = input + 4*y*width;
+  uint8_t *row_1 = row_0 + 4*width;
+
+  uint8_t *out_y = output + y*width;
+  uint8_t *out_u = output + width*height + (y/2)*(width/2);
+  uint8_t *out_v = out_u + (width*height >> 2);
+
+  int x = 0;
+  for (; x + 8 <= width; x += 8)
+  {
+    __m128i u_columns[2];
+    __m128i v_columns[2];
 
-      __m128i res_v_b = _mm_add_epi32(_mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r_sum, r_v), _mm_mullo_epi32(g_sum, g_v)),
-                                                    _mm_mullo_epi32(b_sum, b_v)), cr_offset);
+    for (int half = 0; half < 2; ++half)
+    {
+      __m128i luma[2];
+      __m128i b_sum = zero;
+      __m128i g_sum = zero;
+      __m128i r_sum = zero;
+
+      for (int row = 0; row < 2; ++row)
+      {
+        uint8_t *in = (row == 0 ? row_0 : row_1) + 4*(x + 4*half);
+        const __m128i pixels = _mm_loadu_si128((__m128i const*)in);
+
+        __m128i b = _mm_and_si128(pixels, mask);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 8), mask);
+        __m128i r = _mm_and_si128(_mm_srli_epi32(pixels, 16), mask);
+
+        luma[row] = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r, r_y), _mm_mullo_epi32(g, g_y)),
+                                                 _mm_add_epi32(_mm_mullo_epi32(b, b_y), luma_round)), 8);
+
+        b_sum = _mm_add_epi32(b_sum, b);
+        g_sum = _mm_add_epi32(g_sum, g);
+        r_sum = _mm_add_epi32(r_sum, r);
+      }
 
-      __m128i res_v_tmp = _mm_max_epi32(min_val, _mm_min_epi32(max_val, _mm_srai_epi32(res_v_b, 9)));
+      // 4 luma pixels of both rows
+      __m128i luma_bytes = _mm_packus_epi16(_mm_packus_epi32(luma[0], luma[1]), zero);
+      int32_t luma_0 = _mm_cvtsi128_si32(luma_bytes);
+      int32_t luma_1 = _mm_cvtsi128_si32(_mm_srli_si128(luma_bytes, 4));
+      memcpy(&out_y[x + 4*half], &luma_0, 4);
+      memcpy(&out_y[x + 4*half + width], &luma_1, 4);
+
+      // chroma is linear so the columns can be weighted before summing horizontally
+      u_columns[half] = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r_sum, r_u), _mm_mullo_epi32(g_sum, g_u)),
+                                      _mm_mullo_epi32(b_sum, b_u));
+      v_columns[half] = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r_sum, r_v), _mm_mullo_epi32(g_sum, g_v)),
+                                      _mm_mullo_epi32(b_sum, b_v));
+    }
 
-      __m128i res_v = _mm_srai_epi32(_mm_add_epi32(_mm_shuffle_epi32(res_v_tmp, 0xb1), res_v_tmp), 1);
-      __m128i temp_v = _mm_shuffle_epi8(res_v, shufflemask_chroma);
+    __m128i u = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(u_columns[0], u_columns[1]),
+                                                           chroma_round), 10), chroma_offset);
+    __m128i v = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(v_columns[0], v_columns[1]),
+                                                           chroma_round), 10), chroma_offset);
 
-      memcpy(out_v + loopPlace, &temp_v, 2);
-    }
+    __m128i chroma_bytes = _mm_packus_epi16(_mm_packus_epi32(u, v), zero);
+    int32_t u_bytes = _mm_cvtsi128_si32(chroma_bytes);
+    int32_t v_bytes = _mm_cvtsi128_si32(_mm_srli_si128(chroma_bytes, 4));
+    memcpy(&out_u[x/2], &u_bytes, 4);
+    memcpy(&out_v[x/2], &v_bytes, 4);
   }
 
-  //_mm_empty();
-  return 1;
+  rgb_to_yuv420_rows_c(input, output, width, height, y, x);
 }
 
 
-int rgb_to_yuv420_i_sse41(uint8_t* input, uint8_t* output, int width, int height)
+int rgb_to_yuv420_i_sse41_mt(uint8_t* input, uint8_t* output, int width, int height, int threads)
 {
-  // TODO: Green colorshift in this conversion
-
-  const int r_mul_y[4] = { 76, 76, 76, 76 };
-  const int r_mul_u[4] = { -43, -43, -43, -43 };
-  const int r_mul_v[4] = { 127, 127, 127, 127 };
-
-  const int g_mul_y[4] = { 150, 150, 150, 150 };
-  const int g_mul_u[4] = { -84, -84, -84, -84 };
-  const int g_mul_v[4] = { -106, -106, -106, -106 };
-
-  const int b_mul_y[4] = { 29, 29, 29, 29 };
-  const int b_mul_u[4] = { 127, 127, 127, 127 };
-  const int b_mul_v[4] = { -21, -21, -21, -21 };
-
-  const __m128i r_y = _mm_loadu_si128((__m128i const*)r_mul_y);
-  const __m128i r_u = _mm_loadu_si128((__m128i const*)r_mul_u);
-  const __m128i r_v = _mm_loadu_si128((__m128i const*)r_mul_v);
-
-  const __m128i g_y = _mm_loadu_si128((__m128i const*)g_mul_y);
-  const __m128i g_u = _mm_loadu_si128((__m128i const*)g_mul_u);
-  const __m128i g_v = _mm_loadu_si128((__m128i const*)g_mul_v);
+  int rows = band_rows(width, height, threads);
+  int bands = (height + rows - 1)/rows;
 
-  const __m128i b_y = _mm_loadu_si128((__m128i const*)b_mul_y);
-  const __m128i b_u = _mm_loadu_si128((__m128i const*)b_mul_u);
-  const __m128i b_v = _mm_loadu_si128((__m128i const*)b_mul_v);
-
-  const int mini[4] = { 0,0,0,0 };
-  const int maxi[4] = { 255, 255, 255, 255 };
+  ConversionPool::getPool().run(bands, threads, [=](int band)
+  {
+    int last = std::min(height, band*rows + rows);
+    for (int y = band*rows; y < last - 1; y += 2)
+    {
+      rgb_to_yuv420_rows_sse41(input, output, width, height, y);
+    }
+  });
 
-  const int chroma_offset[4] = { 255 * 255, 255 * 255, 255 * 255, 255 * 255 };
+  return 1;
+}
 
-  uint8_t *in = input;
 
-  const __m128i min_val = _mm_loadu_si128((__m128i const*)mini);
-  const __m128i max_val = _mm_loadu_si128((__m128i const*)maxi);
-  const __m128i cr_offset = _mm_loadu_si128((__m128i const*)chroma_offset);
+void rgb_to_yuv420_i_sse41(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+{
+  for (int y = 0; y < height - 1; y += 2)
+  {
+    rgb_to_yuv420_rows_sse41(input, output, width, height, y);
+  }
+}
 
-  //*output = (uint8_t *)malloc(width*height + width*height);
-  uint8_t *out_y = &output[width*height-width];
 
-  int32_t pix = 0;
+// packs 16 values between 0 and 255 to bytes
+static inline TARGET_AVX2 __m128i pack_bytes_avx2(__m256i first, __m256i second)
+{
+  __m256i words = _mm256_packus_epi32(first, second);
+  __m256i bytes = _mm256_packus_epi16(words, words);
 
-  __m128i shufflemask = _mm_set_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 12, 8, 4, 0);
-  __m128i shufflemask_chroma = _mm_set_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 8, 0);
+  // the packing is done inside 128-bit lanes, so the parts need to be reordered
+  return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 0, 0, 0, 0)));
+}
 
-  __m128i shufflemask_b = _mm_set_epi8(-1, -1, -1, 12, -1, -1, -1, 8, -1, -1, -1, 4, -1, -1, -1, 0);
-  __m128i shufflemask_g = _mm_set_epi8(-1, -1, -1, 13, -1, -1, -1, 9, -1, -1, -1, 5, -1, -1, -1, 1);
-  __m128i shufflemask_r = _mm_set_epi8(-1, -1, -1, 14, -1, -1, -1, 10, -1, -1, -1, 6, -1, -1, -1, 2);
 
-  for (int32_t i = 0; i < width*height << 2; i += 16) {
+TARGET_AVX2 void rgb_to_yuv420_i_avx2(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+{
+  const __m256i mask = _mm256_set1_epi32(0xff);
+
+  const __m256i r_y = _mm256_set1_epi32(76);
+  const __m256i g_y = _mm256_set1_epi32(150);
+  const __m256i b_y = _mm256_set1_epi32(29);
+  const __m256i r_u = _mm256_set1_epi32(-43);
+  const __m256i g_u = _mm256_set1_epi32(-84);
+  const __m256i b_u = _mm256_set1_epi32(127);
+  const __m256i r_v = _mm256_set1_epi32(127);
+  const __m256i g_v = _mm256_set1_epi32(-106);
+  const __m256i b_v = _mm256_set1_epi32(-21);
+
+  const __m256i luma_round = _mm256_set1_epi32(128);
+  const __m256i chroma_round = _mm256_set1_epi32(512);
+  const __m256i chroma_offset = _mm256_set1_epi32(128);
+
+  for (int y = 0; y < height - 1; y += 2)
+  {
+    uint8_t *row_0 = input + 4*y*width;
+    uint8_t *row_1 = row_0 + 4*width;
 
-    // Load 16 bytes (4 pixels)
-    const __m128i a = _mm_loadu_si128((__m128i const*) in);
-    in += 16;
+    uint8_t *out_y = output + y*width;
+    uint8_t *out_u = output + width*height + (y/2)*(width/2);
+    uint8_t *out_v = out_u + (width*height >> 2);
 
-    __m128i b = _mm_shuffle_epi8(a, shufflemask_b);
-    __m128i g = _mm_shuffle_epi8(a, shufflemask_g);
-    __m128i r = _mm_shuffle_epi8(a, shufflemask_r);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m256i luma[2][2];
+      __m256i u_columns[2];
+      __m256i v_columns[2];
+
+      for (int half = 0; half < 2; ++half)
+      {
+        __m256i b_sum = _mm256_setzero_si256();
+        __m256i g_sum = _mm256_setzero_si256();
+        __m256i r_sum = _mm256_setzero_si256();
+
+        for (int row = 0; row < 2; ++row)
+        {
+          uint8_t *in = (row == 0 ? row_0 : row_1) + 4*(x + 8*half);
+          const __m256i pixels = _mm256_loadu_si256((__m256i const*)in);
+
+          __m256i b = _mm256_and_si256(pixels, mask);
+          __m256i g = _mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask);
+          __m256i r = _mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask);
+
+          luma[row][half] = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, r_y), _mm256_mullo_epi32(g, g_y)),
+                                                               _mm256_add_epi32(_mm256_mullo_epi32(b, b_y), luma_round)), 8);
+
+          b_sum = _mm256_add_epi32(b_sum, b);
+          g_sum = _mm256_add_epi32(g_sum, g);
+          r_sum = _mm256_add_epi32(r_sum, r);
+        }
+
+        // chroma is linear so the columns can be weighted before summing horizontally
+        u_columns[half] = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r_sum, r_u), _mm256_mullo_epi32(g_sum, g_u)),
+                                           _mm256_mullo_epi32(b_sum, b_u));
+        v_columns[half] = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r_sum, r_v), _mm256_mullo_epi32(g_sum, g_v)),
+                                           _mm256_mullo_epi32(b_sum, b_v));
+      }
 
-    __m128i res_y = _mm_max_epi32(min_val, _mm_min_epi32(
-                                    max_val, _mm_srai_epi32(
-                                      _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r, r_y), _mm_mullo_epi32(g, g_y)),
-                                                    _mm_mullo_epi32(b, b_y)), 8)));
+      _mm_storeu_si128((__m128i*)&out_y[x],         pack_bytes_avx2(luma[0][0], luma[0][1]));
+      _mm_storeu_si128((__m128i*)&out_y[x + width], pack_bytes_avx2(luma[1][0], luma[1][1]));
 
-    __m128i temp_y = _mm_shuffle_epi8(res_y, shufflemask);
+      // horizontal add works inside 128-bit lanes
+      __m256i u_pairs = _mm256_permute4x64_epi64(_mm256_hadd_epi32(u_columns[0], u_columns[1]), _MM_SHUFFLE(3, 1, 2, 0));
+      __m256i v_pairs = _mm256_permute4x64_epi64(_mm256_hadd_epi32(v_columns[0], v_columns[1]), _MM_SHUFFLE(3, 1, 2, 0));
 
-    memcpy(out_y, &temp_y, 4);
-    out_y += 4;
+      __m256i u = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(u_pairs, chroma_round), 10), chroma_offset);
+      __m256i v = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(v_pairs, chroma_round), 10), chroma_offset);
 
-    pix+=4;
-    if(pix == width) {
-      pix = 0;
-      out_y -= 2 * width;
+      __m128i chroma_bytes = pack_bytes_avx2(u, v);
+      _mm_storel_epi64((__m128i*)&out_u[x/2], chroma_bytes);
+      _mm_storel_epi64((__m128i*)&out_v[x/2], _mm_srli_si128(chroma_bytes, 8));
     }
+
+    rgb_to_yuv420_rows_c(input, output, width, height, y, x);
   }
+}
 
-  pix = 0;
-  uint8_t *out_u = &output[width*height + (width*height>>2) - (width>>1)];
-  uint8_t *out_v = &out_u[width*height >> 2];
 
-  for (int i = 0; i < width*height * 4; i += 2 * width * 4)
+TARGET_AVX512 void rgb_to_yuv420_i_avx512(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+{
+  const __m512i mask = _mm512_set1_epi32(0xff);
+
+  const __m512i r_y = _mm512_set1_epi32(76);
+  const __m512i g_y = _mm512_set1_epi32(150);
+  const __m512i b_y = _mm512_set1_epi32(29);
+  const __m512i r_u = _mm512_set1_epi32(-43);
+  const __m512i g_u = _mm512_set1_epi32(-84);
+  const __m512i b_u = _mm512_set1_epi32(127);
+  const __m512i r_v = _mm512_set1_epi32(127);
+  const __m512i g_v = _mm512_set1_epi32(-106);
+  const __m512i b_v = _mm512_set1_epi32(-21);
+
+  const __m512i luma_round = _mm512_set1_epi32(128);
+  const __m512i chroma_round = _mm512_set1_epi32(512);
+  const __m512i chroma_offset = _mm512_set1_epi32(128);
+
+  const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m512i odd  = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 0, 0, 0, 0, 0, 0, 0, 0);
+
+  for (int y = 0; y < height - 1; y += 2)
   {
-    for (int j = i; j < i + width * 4; j += 4 * 4)
+    uint8_t *row_0 = input + 4*y*width;
+    uint8_t *row_1 = row_0 + 4*width;
+
+    uint8_t *out_y = output + y*width;
+    uint8_t *out_u = output + width*height + (y/2)*(width/2);
+    uint8_t *out_v = out_u + (width*height >> 2);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
     {
-      const __m128i a = _mm_loadu_si128((__m128i const*)&input[j]);
-      const __m128i a2 = _mm_loadu_si128((__m128i const*)&input[j+ width * 4]);
+      __m512i b_sum = _mm512_setzero_si512();
+      __m512i g_sum = _mm512_setzero_si512();
+      __m512i r_sum = _mm512_setzero_si512();
 
-      __m128i b = _mm_shuffle_epi8(a, shufflemask_b);
-      __m128i g = _mm_shuffle_epi8(a, shufflemask_g);
-      __m128i r = _mm_shuffle_epi8(a, shufflemask_r);
+      for (int row = 0; row < 2; ++row)
+      {
+        uint8_t *in = (row == 0 ? row_0 : row_1) + 4*x;
+        const __m512i pixels = _mm512_loadu_si512((void const*)in);
 
-      __m128i b2 = _mm_shuffle_epi8(a2, shufflemask_b);
-      __m128i g2 = _mm_shuffle_epi8(a2, shufflemask_g);
-      __m128i r2 = _mm_shuffle_epi8(a2, shufflemask_r);
+        __m512i b = _mm512_and_si512(pixels, mask);
+        __m512i g = _mm512_and_si512(_mm512_srli_epi32(pixels, 8), mask);
+        __m512i r = _mm512_and_si512(_mm512_srli_epi32(pixels, 16), mask);
 
-      __m128i r_sum = _mm_add_epi32(r, r2);
-      __m128i g_sum = _mm_add_epi32(g, g2);
-      __m128i b_sum = _mm_add_epi32(b, b2);
+        __m512i luma = _mm512_srli_epi32(_mm512_add_epi32(_mm512_add_epi32(_mm512_mullo_epi32(r, r_y), _mm512_mullo_epi32(g, g_y)),
+                                                          _mm512_add_epi32(_mm512_mullo_epi32(b, b_y), luma_round)), 8);
 
-      __m128i res_u_b = _mm_add_epi32(_mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r_sum, r_u),
-                                                                  _mm_mullo_epi32(g_sum, g_u)),
-                                                    _mm_mullo_epi32(b_sum, b_u)), cr_offset);
-      __m128i res_u_tmp = _mm_max_epi32(min_val, _mm_min_epi32(max_val, _mm_srai_epi32(res_u_b, 9)));
+        _mm_storeu_si128((__m128i*)&out_y[x + row*width], _mm512_cvtepi32_epi8(luma));
 
-      __m128i res_u = _mm_srai_epi32(_mm_add_epi32(_mm_shuffle_epi32(res_u_tmp, 0xb1), res_u_tmp), 1);
-      __m128i temp_u = _mm_shuffle_epi8(res_u, shufflemask_chroma);
-      memcpy(out_u, &temp_u, 2);
-      out_u += 2;
+        b_sum = _mm512_add_epi32(b_sum, b);
+        g_sum = _mm512_add_epi32(g_sum, g);
+        r_sum = _mm512_add_epi32(r_sum, r);
+      }
 
-      __m128i res_v_b = _mm_add_epi32(_mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r_sum, r_v), _mm_mullo_epi32(g_sum, g_v)),
-                                                    _mm_mullo_epi32(b_sum, b_v)), cr_offset);
+      // chroma is linear so the columns can be weighted before summing horizontally
+      __m512i u_columns = _mm512_add_epi32(_mm512_add_epi32(_mm512_mullo_epi32(r_sum, r_u), _mm512_mullo_epi32(g_sum, g_u)),
+                                           _mm512_mullo_epi32(b_sum, b_u));
+      __m512i v_columns = _mm512_add_epi32(_mm512_add_epi32(_mm512_mullo_epi32(r_sum, r_v), _mm512_mullo_epi32(g_sum, g_v)),
+                                           _mm512_mullo_epi32(b_sum, b_v));
 
-      __m128i res_v_tmp = _mm_max_epi32(min_val, _mm_min_epi32(max_val, _mm_srai_epi32(res_v_b, 9)));
+      __m512i u_pairs = _mm512_add_epi32(_mm512_permutexvar_epi32(even, u_columns), _mm512_permutexvar_epi32(odd, u_columns));
+      __m512i v_pairs = _mm512_add_epi32(_mm512_permutexvar_epi32(even, v_columns), _mm512_permutexvar_epi32(odd, v_columns));
 
-      __m128i res_v = _mm_srai_epi32(_mm_add_epi32(_mm_shuffle_epi32(res_v_tmp, 0xb1), res_v_tmp), 1);
-      __m128i temp_v = _mm_shuffle_epi8(res_v, shufflemask_chroma);
-      memcpy(out_v, &temp_v, 2);
-      out_v += 2;
+      __m512i u = _mm512_add_epi32(_mm512_srai_epi32(_mm512_add_epi32(u_pairs, chroma_round), 10), chroma_offset);
+      __m512i v = _mm512_add_epi32(_mm512_srai_epi32(_mm512_add_epi32(v_pairs, chroma_round), 10), chroma_offset);
 
-      pix += 4;
-      if (pix == width) {
-        pix = 0;
-        out_u -= width;
-        out_v -= width;
-      }
+      // only the first 8 values are valid
+      _mm_storel_epi64((__m128i*)&out_u[x/2], _mm512_cvtepi32_epi8(u));
+      _mm_storel_epi64((__m128i*)&out_v[x/2], _mm512_cvtepi32_epi8(v));
     }
-  }
 
-  //_mm_empty();
-  return 1;
+    rgb_to_yuv420_rows_c(input, output, width, height, y, x);
+  }
 }
 
 
@@ -770,10 +942,10 @@ void rgb_to_yuv420_i_c(uint8_t* input, uint8_t* output, uint16_t width, uint16_t
   uint8_t* chromaU = output + width*height;
   uint8_t* chromaV = output + width*height + width*height/4;
 
-  // Luma pixels
+  // Luma pixels, the input is in BGRA order
   for(unsigned int i = 0; i < rgb_size; i += 4)
   {
-    int32_t ypixel = 76*input[i] + 150 * input[i+1] + 29 * input[i+2];
+    int32_t ypixel = 76*input[i+2] + 150 * input[i+1] + 29 * input[i];
     lumaY[i/4] = (ypixel + 128) >> 8;
   }
 
@@ -834,98 +1006,1131 @@ void yuyv_to_yuv420_c(uint8_t* input, uint8_t* output, uint16_t width, uint16_t
 }
 
 
-void yuyv_to_rgb_c(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+// Converts rows y and y + 1 starting from pixel x_start
+static void yuyv_to_yuv420_rows_c(uint8_t* input, uint8_t* output, int width, int height,
+                                  int y, int x_start)
 {
-  // Luma values
-  for(int i = 0; i < width*height*2; i += 2)
+  uint8_t *row_0 = input + 2*y*width;
+  uint8_t *row_1 = row_0 + 2*width;
+
+  uint8_t *out_y = output + y*width;
+  uint8_t *out_u = output + width*height + (y/2)*(width/2);
+  uint8_t *out_v = out_u + (width*height >> 2);
+
+  for (int x = x_start; x < width; ++x)
   {
-    // In YUYV, the Luma value is every other byte for the whole file
-    output[i*2]   = input[i];
-    output[i*2+1] = input[i];
-    output[i*2+2] = input[i];
+    out_y[x]         = row_0[2*x];
+    out_y[x + width] = row_1[2*x];
   }
 
-  // TODO: chroma values
+  for (int x = x_start; x + 1 < width; x += 2)
+  {
+    out_u[x/2] = (row_0[2*x + 1] + row_1[2*x + 1])/2;
+    out_v[x/2] = (row_0[2*x + 3] + row_1[2*x + 3])/2;
+  }
 }
 
 
-void half_rgb(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+TARGET_AVX2 void yuyv_to_yuv420_avx2(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
 {
-  int old_rgb_row = width*4;
-  int new_rgb_row = width*4/2;
-  for (int y = 0; y < height; y += 2)
+  // luma is in even bytes and the chroma sums are in 16-bit words alternating between U and V
+  const __m256i luma_shuffle = _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m256i chroma_shuffle = _mm256_setr_epi8(0, 4, 8, 12, 2, 6, 10, 14, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                  0, 4, 8, 12, 2, 6, 10, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m256i luma_order = _mm256_setr_epi32(0, 1, 4, 5, 0, 0, 0, 0);
+  const __m256i chroma_order = _mm256_setr_epi32(0, 4, 1, 5, 0, 0, 0, 0);
+
+  for (int y = 0; y < height - 1; y += 2)
   {
-    for (int x = 0; x < width; x += 2)
+    uint8_t *row_0 = input + 2*y*width;
+    uint8_t *row_1 = row_0 + 2*width;
+
+    uint8_t *out_y = output + y*width;
+    uint8_t *out_u = output + width*height + (y/2)*(width/2);
+    uint8_t *out_v = out_u + (width*height >> 2);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
     {
-      int rgb_x = 4*x;
-      output[new_rgb_row*y/2 + rgb_x/2 + 0] = input[y*old_rgb_row + rgb_x];
-      output[new_rgb_row*y/2 + rgb_x/2 + 1] = input[y*old_rgb_row + rgb_x + 1];
-      output[new_rgb_row*y/2 + rgb_x/2 + 2] = input[y*old_rgb_row + rgb_x + 2];
-      output[new_rgb_row*y/2 + rgb_x/2 + 3] = input[y*old_rgb_row + rgb_x + 3];
+      __m256i pixels_0 = _mm256_loadu_si256((__m256i const*)&row_0[2*x]);
+      __m256i pixels_1 = _mm256_loadu_si256((__m256i const*)&row_1[2*x]);
+
+      __m256i luma_0 = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pixels_0, luma_shuffle), luma_order);
+      __m256i luma_1 = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pixels_1, luma_shuffle), luma_order);
+
+      _mm_storeu_si128((__m128i*)&out_y[x],         _mm256_castsi256_si128(luma_0));
+      _mm_storeu_si128((__m128i*)&out_y[x + width], _mm256_castsi256_si128(luma_1));
+
+      __m256i chroma = _mm256_srli_epi16(_mm256_add_epi16(_mm256_srli_epi16(pixels_0, 8),
+                                                          _mm256_srli_epi16(pixels_1, 8)), 1);
+      __m128i chroma_bytes = _mm256_castsi256_si128(
+            _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(chroma, chroma_shuffle), chroma_order));
+
+      _mm_storel_epi64((__m128i*)&out_u[x/2], chroma_bytes);
+      _mm_storel_epi64((__m128i*)&out_v[x/2], _mm_srli_si128(chroma_bytes, 8));
     }
+
+    yuyv_to_yuv420_rows_c(input, output, width, height, y, x);
   }
 }
 
-void flip_rgb(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height,
-              bool horizontally, bool vertically)
+
+TARGET_AVX512 void yuyv_to_yuv420_avx512(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
 {
-  if (!horizontally && !vertically)
+  const __m512i luma_mask = _mm512_set1_epi16(0xff);
+  const __m512i u_mask = _mm512_set1_epi32(0xffff);
+
+  for (int y = 0; y < height - 1; y += 2)
   {
-    return;
+    uint8_t *row_0 = input + 2*y*width;
+    uint8_t *row_1 = row_0 + 2*width;
+
+    uint8_t *out_y = output + y*width;
+    uint8_t *out_u = output + width*height + (y/2)*(width/2);
+    uint8_t *out_v = out_u + (width*height >> 2);
+
+    int x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+      __m512i pixels_0 = _mm512_loadu_si512((void const*)&row_0[2*x]);
+      __m512i pixels_1 = _mm512_loadu_si512((void const*)&row_1[2*x]);
+
+      _mm256_storeu_si256((__m256i*)&out_y[x],         _mm512_cvtepi16_epi8(_mm512_and_si512(pixels_0, luma_mask)));
+      _mm256_storeu_si256((__m256i*)&out_y[x + width], _mm512_cvtepi16_epi8(_mm512_and_si512(pixels_1, luma_mask)));
+
+      // 16-bit words alternate between U and V
+      __m512i chroma = _mm512_srli_epi16(_mm512_add_epi16(_mm512_srli_epi16(pixels_0, 8),
+                                                          _mm512_srli_epi16(pixels_1, 8)), 1);
+
+      _mm_storeu_si128((__m128i*)&out_u[x/2], _mm512_cvtepi32_epi8(_mm512_and_si512(chroma, u_mask)));
+      _mm_storeu_si128((__m128i*)&out_v[x/2], _mm512_cvtepi32_epi8(_mm512_srli_epi32(chroma, 16)));
+    }
+
+    yuyv_to_yuv420_rows_c(input, output, width, height, y, x);
   }
+}
 
-  int x_start = 0;
-  int x_change = 1;
-  int x_end = width;
 
-  if (horizontally)
+// two pixels share the chroma in YUYV
+static inline void yuyv_to_bgra_pair(uint8_t* input, uint8_t* output)
+{
+  int32_t u = input[1] - 128;
+  int32_t v = input[3] - 128;
+
+  yuv_to_bgra_pixel(input[0], u, v, output);
+  yuv_to_bgra_pixel(input[2], u, v, output + 4);
+}
+
+
+void yuyv_to_rgb_c(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+{
+  for (int i = 0; i < width*height; i += 2)
   {
-    x_start = width - 1;
-    x_change = -1;
-    x_end = -1;
+    yuyv_to_bgra_pair(input + 2*i, output + 4*i);
   }
+}
 
-  int y_start = 0;
-  int y_change = 1;
-  int y_end = height;
 
-  if (vertically)
+TARGET_AVX2 void yuyv_to_rgb_avx2(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+{
+  const __m128i luma_shuffle = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i u_shuffle = _mm_setr_epi8(1, 1, 5, 5, 9, 9, 13, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i v_shuffle = _mm_setr_epi8(3, 3, 7, 7, 11, 11, 15, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m256i middle_val = _mm256_set1_epi32(128);
+
+  int pixels = width*height;
+  int i = 0;
+  for (; i + 8 <= pixels; i += 8)
   {
-    y_start = height - 1;
-    y_change = -1;
-    y_end = -1;
+    __m128i yuyv = _mm_loadu_si128((__m128i const*)&input[2*i]);
+
+    __m256i luma = _mm256_cvtepu8_epi32(_mm_shuffle_epi8(yuyv, luma_shuffle));
+    __m256i u = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_shuffle_epi8(yuyv, u_shuffle)), middle_val);
+    __m256i v = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_shuffle_epi8(yuyv, v_shuffle)), middle_val);
+
+    _mm256_storeu_si256((__m256i*)&output[4*i], yuv_to_bgra_avx2(luma, u, v));
   }
 
-  int basic_y = 0;
-  for (int y = y_start; y != y_end; y += y_change)
+  for (; i + 1 < pixels; i += 2)
   {
-    int basic_x = 0;
-    for (int x = x_start; x != x_end; x += x_change)
-    {
-      int rgb_x = 4*x;
-      int rgb_y = 4*y*width;
+    yuyv_to_bgra_pair(input + 2*i, output + 4*i);
+  }
+}
 
-      int rgb_basic_x = 4*basic_x;
-      int rgb_basic_y = 4*basic_y*width;
 
-      output[rgb_basic_y + rgb_basic_x + 0] = input[rgb_y + rgb_x];
-      output[rgb_basic_y + rgb_basic_x + 1] = input[rgb_y + rgb_x + 1];
-      output[rgb_basic_y + rgb_basic_x + 2] = input[rgb_y + rgb_x + 2];
-      output[rgb_basic_y + rgb_basic_x + 3] = input[rgb_y + rgb_x + 3];
+TARGET_AVX512 void yuyv_to_rgb_avx512(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+{
+  const __m128i luma_shuffle = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i u_shuffle = _mm_setr_epi8(1, 1, 5, 5, 9, 9, 13, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i v_shuffle = _mm_setr_epi8(3, 3, 7, 7, 11, 11, 15, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m512i middle_val = _mm512_set1_epi32(128);
+
+  int pixels = width*height;
+  int i = 0;
+  for (; i + 16 <= pixels; i += 16)
+  {
+    __m128i first  = _mm_loadu_si128((__m128i const*)&input[2*i]);
+    __m128i second = _mm_loadu_si128((__m128i const*)&input[2*i + 16]);
+
+    __m512i luma = _mm512_cvtepu8_epi32(_mm_unpacklo_epi64(_mm_shuffle_epi8(first, luma_shuffle),
+                                                           _mm_shuffle_epi8(second, luma_shuffle)));
+    __m512i u = _mm512_cvtepu8_epi32(_mm_unpacklo_epi64(_mm_shuffle_epi8(first, u_shuffle),
+                                                        _mm_shuffle_epi8(second, u_shuffle)));
+    __m512i v = _mm512_cvtepu8_epi32(_mm_unpacklo_epi64(_mm_shuffle_epi8(first, v_shuffle),
+                                                        _mm_shuffle_epi8(second, v_shuffle)));
+
+    _mm512_storeu_si512((void*)&output[4*i], yuv_to_bgra_avx512(luma, _mm512_sub_epi32(u, middle_val),
+                                                                 _mm512_sub_epi32(v, middle_val)));
+  }
 
-      ++basic_x;
-    }
+  for (; i + 1 < pixels; i += 2)
+  {
+    yuyv_to_bgra_pair(input + 2*i, output + 4*i);
+  }
+}
 
-    ++basic_y;
+
+// Where the samples of a camera format are. Chroma has half the horizontal
+// resolution in all of them and the chroma row of a luma row is row >> chroma_shift.
+struct SelfViewPlanes
+{
+  const uint8_t* y;
+  int y_stride;
+  int y_step;
+
+  const uint8_t* u;
+  const uint8_t* v;
+  int chroma_stride;
+  int chroma_step;
+  int chroma_shift;
+};
+
+
+static SelfViewPlanes selfview_planes(const uint8_t* input, int width, int height, SelfViewFormat format)
+{
+  const uint8_t* chroma = input + width*height;
+
+  switch (format)
+  {
+    case SELF_VIEW_NV12:
+      return {input, width, 1, chroma, chroma + 1, width, 2, 1};
+    case SELF_VIEW_YUYV:
+      return {input, 2*width, 2, input + 1, input + 3, 2*width, 4, 0};
+    case SELF_VIEW_YUV420:
+      break;
   }
+
+  return {input, width, 1, chroma, chroma + (width/2)*(height/2), width/2, 1, 1};
 }
 
 
-uint8_t clamp_8bit(int32_t input)
+// box filters the luma of output pixels first to last - 1 on output row
+static void selfview_luma_c(const SelfViewPlanes& planes, int row, int factor,
+                            int first, int last, uint8_t* luma)
 {
-  if(input & ~255)
+  const uint32_t area = factor*factor;
+
+  for (int x = first; x < last; ++x)
   {
-    return (-input) >> 31;
+    uint32_t sum = 0;
+    for (int i = 0; i < factor; ++i)
+    {
+      const uint8_t* in = planes.y + (ptrdiff_t)(row*factor + i)*planes.y_stride + x*factor*planes.y_step;
+      for (int j = 0; j < factor; ++j)
+      {
+        sum += in[j*planes.y_step];
+      }
+    }
+    luma[x] = (sum + area/2)/area;
   }
-  return input;
+}
+
+
+// box filters the chroma samples first to last - 1 on output row, one sample covers two pixels
+static void selfview_chroma_c(const SelfViewPlanes& planes, int row, int factor,
+                              int first, int last, uint8_t* u, uint8_t* v)
+{
+  const int first_row = (row*factor) >> planes.chroma_shift;
+  const int last_row = (row*factor + factor - 1) >> planes.chroma_shift;
+  const uint32_t count = (last_row - first_row + 1)*factor;
+
+  for (int x = first; x < last; ++x)
+  {
+    uint32_t sum_u = 0;
+    uint32_t sum_v = 0;
+    for (int i = first_row; i <= last_row; ++i)
+    {
+      ptrdiff_t offset = (ptrdiff_t)i*planes.chroma_stride + x*factor*planes.chroma_step;
+      for (int j = 0; j < factor; ++j)
+      {
+        sum_u += planes.u[offset + j*planes.chroma_step];
+        sum_v += planes.v[offset + j*planes.chroma_step];
+      }
+    }
+    u[x] = (sum_u + count/2)/count;
+    v[x] = (sum_v + count/2)/count;
+  }
+}
+
+
+static void selfview_row_to_bgra_c(const uint8_t* luma, const uint8_t* u, const uint8_t* v,
+                                   uint8_t* output, int width, bool mirror, int first)
+{
+  for (int x = first; x < width; ++x)
+  {
+    int position = mirror ? width - 1 - x : x;
+    yuv_to_bgra_pixel(luma[x], u[x/2] - 128, v[x/2] - 128, output + 4*position);
+  }
+}
+
+
+size_t selfview_work_size(int width)
+{
+  // one row of luma and chroma, 16-bit sums of source rows and room for aligning them
+  return 4*(size_t)width + 2*SIMD_ALIGNMENT;
+}
+
+
+void selfview_to_rgb_c(const uint8_t* input, uint8_t* output, int width, int height,
+                       SelfViewFormat format, int factor, bool mirror, uint8_t* work)
+{
+  const int out_width = (width/factor) & ~1;
+  const int out_height = height/factor;
+  const SelfViewPlanes planes = selfview_planes(input, width, height, format);
+
+  uint8_t* luma = work;
+  uint8_t* u = luma + out_width;
+  uint8_t* v = u + out_width/2;
+
+  for (int row = 0; row < out_height; ++row)
+  {
+    selfview_luma_c(planes, row, factor, 0, out_width, luma);
+    selfview_chroma_c(planes, row, factor, 0, out_width/2, u, v);
+    selfview_row_to_bgra_c(luma, u, v, output + 4*(ptrdiff_t)row*out_width, out_width, mirror, 0);
+  }
+}
+
+
+// Averages 2x2 blocks of two rows, 16 output pixels at a time. Returns the number of pixels done.
+static TARGET_AVX2 int box2_row_avx2(const uint8_t* first, const uint8_t* second, uint8_t* output, int width)
+{
+  const __m256i ones = _mm256_set1_epi8(1);
+  const __m256i rounding = _mm256_set1_epi16(2);
+
+  int x = 0;
+  for (; x + 16 <= width; x += 16)
+  {
+    __m256i sums = _mm256_add_epi16(_mm256_maddubs_epi16(_mm256_loadu_si256((__m256i const*)&first[2*x]), ones),
+                                    _mm256_maddubs_epi16(_mm256_loadu_si256((__m256i const*)&second[2*x]), ones));
+    __m256i pixels = _mm256_srli_epi16(_mm256_add_epi16(sums, rounding), 2);
+
+    __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(pixels, pixels), 0xD8);
+    _mm_storeu_si128((__m128i*)&output[x], _mm256_castsi256_si128(bytes));
+  }
+  return x;
+}
+
+
+// Averages the luma of 2x2 blocks of two YUYV rows, 8 output pixels at a time
+static TARGET_AVX2 int box2_yuyv_luma_avx2(const uint8_t* first, const uint8_t* second, uint8_t* output, int width)
+{
+  const __m256i luma_mask = _mm256_set1_epi16(0x00ff);
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i rounding = _mm256_set1_epi32(2);
+
+  int x = 0;
+  for (; x + 8 <= width; x += 8)
+  {
+    __m256i luma = _mm256_add_epi16(_mm256_and_si256(_mm256_loadu_si256((__m256i const*)&first[4*x]), luma_mask),
+                                    _mm256_and_si256(_mm256_loadu_si256((__m256i const*)&second[4*x]), luma_mask));
+    __m256i pixels = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(luma, ones), rounding), 2);
+
+    __m256i words = _mm256_packus_epi32(pixels, pixels);
+    __m256i bytes = _mm256_packus_epi16(words, words);
+    _mm_storel_epi64((__m128i*)&output[x], _mm_unpacklo_epi32(_mm256_castsi256_si128(bytes),
+                                                               _mm256_extracti128_si256(bytes, 1)));
+  }
+  return x;
+}
+
+
+// Separates a YUYV row to luma and chroma rows, 8 pixels at a time
+static TARGET_AVX2 int unpack_yuyv_avx2(const uint8_t* input, uint8_t* luma, uint8_t* u, uint8_t* v, int width)
+{
+  const __m128i shuffle = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 5, 9, 13, 3, 7, 11, 15);
+
+  int x = 0;
+  for (; x + 8 <= width; x += 8)
+  {
+    __m128i samples = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const*)&input[2*x]), shuffle);
+
+    _mm_storel_epi64((__m128i*)&luma[x], samples);
+    int32_t chroma_u = _mm_extract_epi32(samples, 2);
+    int32_t chroma_v = _mm_extract_epi32(samples, 3);
+    memcpy(&u[x/2], &chroma_u, 4);
+    memcpy(&v[x/2], &chroma_v, 4);
+  }
+  return x;
+}
+
+
+// Separates an NV12 chroma row to U and V, 8 samples at a time
+static TARGET_AVX2 int unpack_nv12_chroma_avx2(const uint8_t* input, uint8_t* u, uint8_t* v, int samples)
+{
+  const __m128i shuffle = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+  int x = 0;
+  for (; x + 8 <= samples; x += 8)
+  {
+    __m128i chroma = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const*)&input[2*x]), shuffle);
+
+    _mm_storel_epi64((__m128i*)&u[x], chroma);
+    _mm_storel_epi64((__m128i*)&v[x], _mm_unpackhi_epi64(chroma, chroma));
+  }
+  return x;
+}
+
+
+static TARGET_AVX2 void selfview_row_to_bgra_avx2(const uint8_t* luma, const uint8_t* u, const uint8_t* v,
+                                                  uint8_t* output, int width, bool mirror)
+{
+  const __m128i chroma_shuffle = _mm_setr_epi8(0, 0, 1, 1, 2, 2, 3, 3, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+  const __m256i middle_val = _mm256_set1_epi32(128);
+
+  int x = 0;
+  for (; x + 8 <= width; x += 8)
+  {
+    int32_t chroma_u = 0;
+    int32_t chroma_v = 0;
+    memcpy(&chroma_u, &u[x/2], 4);
+    memcpy(&chroma_v, &v[x/2], 4);
+
+    __m256i pixel_luma = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*)&luma[x]));
+    __m256i pixel_u = _mm256_cvtepu8_epi32(_mm_shuffle_epi8(_mm_cvtsi32_si128(chroma_u), chroma_shuffle));
+    __m256i pixel_v = _mm256_cvtepu8_epi32(_mm_shuffle_epi8(_mm_cvtsi32_si128(chroma_v), chroma_shuffle));
+
+    __m256i bgra = yuv_to_bgra_avx2(pixel_luma, _mm256_sub_epi32(pixel_u, middle_val),
+                                    _mm256_sub_epi32(pixel_v, middle_val));
+
+    if (mirror)
+    {
+      _mm256_storeu_si256((__m256i*)&output[4*(width - x - 8)], _mm256_permutevar8x32_epi32(bgra, reverse));
+    }
+    else
+    {
+      _mm256_storeu_si256((__m256i*)&output[4*x], bgra);
+    }
+  }
+
+  selfview_row_to_bgra_c(luma, u, v, output, width, mirror, x);
+}
+
+
+enum SumBytes {SUM_ALL_BYTES, SUM_LOW_BYTES, SUM_HIGH_BYTES};
+
+// Sums the bytes of rows to 16-bit values. Low and high bytes take every
+// other byte, which separates the luma and chroma of YUYV.
+static TARGET_AVX2 void sum_rows_avx2(const uint8_t* input, ptrdiff_t stride, int rows,
+                                      int count, SumBytes bytes, uint16_t* sums)
+{
+  const __m256i low_mask = _mm256_set1_epi16(0x00ff);
+  const int step = bytes == SUM_ALL_BYTES ? 1 : 2;
+  const int offset = bytes == SUM_HIGH_BYTES ? 1 : 0;
+
+  int x = 0;
+  for (; x + 16 <= count; x += 16)
+  {
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < rows; ++i)
+    {
+      const uint8_t* in = input + i*stride + x*step;
+      __m256i values;
+      if (bytes == SUM_ALL_BYTES)
+      {
+        values = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)in));
+      }
+      else if (bytes == SUM_LOW_BYTES)
+      {
+        values = _mm256_and_si256(_mm256_loadu_si256((__m256i const*)in), low_mask);
+      }
+      else
+      {
+        values = _mm256_srli_epi16(_mm256_loadu_si256((__m256i const*)in), 8);
+      }
+      sum = _mm256_add_epi16(sum, values);
+    }
+    _mm256_storeu_si256((__m256i*)&sums[x], sum);
+  }
+
+  for (; x < count; ++x)
+  {
+    uint16_t sum = 0;
+    for (int i = 0; i < rows; ++i)
+    {
+      sum += input[i*stride + x*step + offset];
+    }
+    sums[x] = sum;
+  }
+}
+
+
+// Adds factor neighbouring sums taking every step:th and divides by divisor.
+// The multiplication gives the same result as division for sums this small.
+static void box_sums(const uint16_t* sums, int factor, int step, int count, uint32_t divisor, uint8_t* output)
+{
+  const uint64_t reciprocal = ((uint64_t)1 << 32)/divisor + 1;
+
+  for (int x = 0; x < count; ++x)
+  {
+    uint32_t sum = divisor/2;
+    for (int j = 0; j < factor; ++j)
+    {
+      sum += sums[(x*factor + j)*step];
+    }
+    output[x] = (sum*reciprocal) >> 32;
+  }
+}
+
+
+// Averages pairs of chroma samples from sums where U and V alternate, 8 outputs
+// of both at a time. The sums are divided by 1 << shift.
+static TARGET_AVX2 int box2_interleaved_avx2(const uint16_t* sums, int count, int shift, uint8_t* u, uint8_t* v)
+{
+  const __m256i pairs = _mm256_setr_epi8(0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15,
+                                         0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15);
+  const __m128i separate = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i rounding = _mm256_set1_epi32(1 << (shift - 1));
+
+  int x = 0;
+  for (; x + 8 <= count; x += 8)
+  {
+    __m256i first = _mm256_madd_epi16(_mm256_shuffle_epi8(_mm256_loadu_si256((__m256i const*)&sums[4*x]),
+                                                          pairs), ones);
+    __m256i second = _mm256_madd_epi16(_mm256_shuffle_epi8(_mm256_loadu_si256((__m256i const*)&sums[4*x + 16]),
+                                                           pairs), ones);
+
+    first = _mm256_srli_epi32(_mm256_add_epi32(first, rounding), shift);
+    second = _mm256_srli_epi32(_mm256_add_epi32(second, rounding), shift);
+
+    __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(first, second), 0xD8);
+    __m256i bytes = _mm256_packus_epi16(words, words);
+
+    __m128i chroma = _mm_shuffle_epi8(_mm_unpacklo_epi64(_mm256_castsi256_si128(bytes),
+                                                         _mm256_extracti128_si256(bytes, 1)), separate);
+    _mm_storel_epi64((__m128i*)&u[x], chroma);
+    _mm_storel_epi64((__m128i*)&v[x], _mm_unpackhi_epi64(chroma, chroma));
+  }
+  return x;
+}
+
+
+TARGET_AVX2 void selfview_to_rgb_avx2(const uint8_t* input, uint8_t* output, int width, int height,
+                                      SelfViewFormat format, int factor, bool mirror, uint8_t* work)
+{
+  const int out_width = (width/factor) & ~1;
+  const int out_height = height/factor;
+  const SelfViewPlanes planes = selfview_planes(input, width, height, format);
+
+  uint8_t* luma_work = (uint8_t*)ALIGNED_POINTER(work, SIMD_ALIGNMENT);
+  uint8_t* u_work = luma_work + out_width;
+  uint8_t* v_work = u_work + out_width/2;
+  uint16_t* sums = (uint16_t*)ALIGNED_POINTER(luma_work + 2*width, SIMD_ALIGNMENT);
+
+  for (int row = 0; row < out_height; ++row)
+  {
+    const uint8_t* luma = luma_work;
+    const uint8_t* u = u_work;
+    const uint8_t* v = v_work;
+
+    const uint8_t* in_y = planes.y + (ptrdiff_t)row*factor*planes.y_stride;
+
+    const int first_chroma = (row*factor) >> planes.chroma_shift;
+    const int chroma_rows = ((row*factor + factor - 1) >> planes.chroma_shift) - first_chroma + 1;
+    const uint8_t* in_u = planes.u + (ptrdiff_t)first_chroma*planes.chroma_stride;
+    const uint8_t* in_v = planes.v + (ptrdiff_t)first_chroma*planes.chroma_stride;
+
+    if (factor == 1)
+    {
+      // planar rows are used as they are
+      if (format == SELF_VIEW_YUV420)
+      {
+        luma = in_y;
+        u = in_u;
+        v = in_v;
+      }
+      else if (format == SELF_VIEW_NV12)
+      {
+        luma = in_y;
+        int done = unpack_nv12_chroma_avx2(in_u, u_work, v_work, out_width/2);
+        selfview_chroma_c(planes, row, factor, done, out_width/2, u_work, v_work);
+      }
+      else
+      {
+        int done = unpack_yuyv_avx2(in_y, luma_work, u_work, v_work, out_width);
+        selfview_luma_c(planes, row, factor, done, out_width, luma_work);
+        selfview_chroma_c(planes, row, factor, done/2, out_width/2, u_work, v_work);
+      }
+    }
+    else
+    {
+      int done = 0;
+      if (factor == 2 && format == SELF_VIEW_YUYV)
+      {
+        done = box2_yuyv_luma_avx2(in_y, in_y + planes.y_stride, luma_work, out_width);
+      }
+      else if (factor == 2)
+      {
+        done = box2_row_avx2(in_y, in_y + planes.y_stride, luma_work, out_width);
+      }
+      else
+      {
+        sum_rows_avx2(in_y, planes.y_stride, factor, out_width*factor,
+                      format == SELF_VIEW_YUYV ? SUM_LOW_BYTES : SUM_ALL_BYTES, sums);
+        box_sums(sums, factor, 1, out_width, factor*factor, luma_work);
+        done = out_width;
+      }
+      selfview_luma_c(planes, row, factor, done, out_width, luma_work);
+
+      const int chroma_samples = out_width/2*factor;
+      if (format == SELF_VIEW_YUV420 && factor == 2)
+      {
+        // one chroma row covers both luma rows
+        done = box2_row_avx2(in_u, in_u, u_work, out_width/2);
+        box2_row_avx2(in_v, in_v, v_work, out_width/2);
+        selfview_chroma_c(planes, row, factor, done, out_width/2, u_work, v_work);
+      }
+      else if (format == SELF_VIEW_YUV420)
+      {
+        sum_rows_avx2(in_u, planes.chroma_stride, chroma_rows, chroma_samples, SUM_ALL_BYTES, sums);
+        box_sums(sums, factor, 1, out_width/2, chroma_rows*factor, u_work);
+        sum_rows_avx2(in_v, planes.chroma_stride, chroma_rows, chroma_samples, SUM_ALL_BYTES, sums);
+        box_sums(sums, factor, 1, out_width/2, chroma_rows*factor, v_work);
+      }
+      else
+      {
+        // U and V alternate in the sums
+        if (format == SELF_VIEW_NV12)
+        {
+          sum_rows_avx2(in_u, planes.chroma_stride, chroma_rows, 2*chroma_samples, SUM_ALL_BYTES, sums);
+        }
+        else
+        {
+          sum_rows_avx2(in_u - 1, planes.chroma_stride, chroma_rows, 2*chroma_samples, SUM_HIGH_BYTES, sums);
+        }
+        // the number of summed samples is 2 or 4 when halving
+        done = 0;
+        if (factor == 2)
+        {
+          done = box2_interleaved_avx2(sums, out_width/2, chroma_rows, u_work, v_work);
+        }
+        box_sums(sums + 2*factor*done, factor, 2, out_width/2 - done, chroma_rows*factor, u_work + done);
+        box_sums(sums + 2*factor*done + 1, factor, 2, out_width/2 - done, chroma_rows*factor, v_work + done);
+      }
+    }
+
+    selfview_row_to_bgra_avx2(luma, u, v, output + 4*(ptrdiff_t)row*out_width, out_width, mirror);
+  }
+}
+
+
+void half_rgb_c(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+{
+  int old_rgb_row = width*4;
+  int new_rgb_row = width*4/2;
+  for (int y = 0; y < height; y += 2)
+  {
+    for (int x = 0; x < width; x += 2)
+    {
+      int rgb_x = 4*x;
+      output[new_rgb_row*y/2 + rgb_x/2 + 0] = input[y*old_rgb_row + rgb_x];
+      output[new_rgb_row*y/2 + rgb_x/2 + 1] = input[y*old_rgb_row + rgb_x + 1];
+      output[new_rgb_row*y/2 + rgb_x/2 + 2] = input[y*old_rgb_row + rgb_x + 2];
+      output[new_rgb_row*y/2 + rgb_x/2 + 3] = input[y*old_rgb_row + rgb_x + 3];
+    }
+  }
+}
+
+
+TARGET_AVX2 void half_rgb_avx2(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+{
+  // the output rows are not whole pixels with odd width
+  if (width % 2 != 0)
+  {
+    half_rgb_c(input, output, width, height);
+    return;
+  }
+
+  for (int y = 0; y < height; y += 2)
+  {
+    uint8_t *in = input + 4*y*width;
+    uint8_t *out = output + y*width;
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m256 first  = _mm256_loadu_ps((float const*)&in[4*x]);
+      __m256 second = _mm256_loadu_ps((float const*)&in[4*x + 32]);
+
+      // every other pixel, shuffled inside 128-bit lanes
+      __m256i even = _mm256_castps_si256(_mm256_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+      _mm256_storeu_si256((__m256i*)&out[2*x], _mm256_permute4x64_epi64(even, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    for (; x < width; x += 2)
+    {
+      memcpy(&out[2*x], &in[4*x], 4);
+    }
+  }
+}
+
+
+TARGET_AVX512 void half_rgb_avx512(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+{
+  if (width % 2 != 0)
+  {
+    half_rgb_c(input, output, width, height);
+    return;
+  }
+
+  const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+
+  for (int y = 0; y < height; y += 2)
+  {
+    uint8_t *in = input + 4*y*width;
+    uint8_t *out = output + y*width;
+
+    int x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+      __m512i first  = _mm512_loadu_si512((void const*)&in[4*x]);
+      __m512i second = _mm512_loadu_si512((void const*)&in[4*x + 64]);
+
+      _mm512_storeu_si512((void*)&out[2*x], _mm512_permutex2var_epi32(first, even, second));
+    }
+
+    for (; x < width; x += 2)
+    {
+      memcpy(&out[2*x], &in[4*x], 4);
+    }
+  }
+}
+
+
+void flip_rgb_c(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height,
+                bool horizontally, bool vertically)
+{
+  if (!horizontally && !vertically)
+  {
+    return;
+  }
+
+  int x_start = 0;
+  int x_change = 1;
+  int x_end = width;
+
+  if (horizontally)
+  {
+    x_start = width - 1;
+    x_change = -1;
+    x_end = -1;
+  }
+
+  int y_start = 0;
+  int y_change = 1;
+  int y_end = height;
+
+  if (vertically)
+  {
+    y_start = height - 1;
+    y_change = -1;
+    y_end = -1;
+  }
+
+  int basic_y = 0;
+  for (int y = y_start; y != y_end; y += y_change)
+  {
+    int basic_x = 0;
+    for (int x = x_start; x != x_end; x += x_change)
+    {
+      int rgb_x = 4*x;
+      int rgb_y = 4*y*width;
+
+      int rgb_basic_x = 4*basic_x;
+      int rgb_basic_y = 4*basic_y*width;
+
+      output[rgb_basic_y + rgb_basic_x + 0] = input[rgb_y + rgb_x];
+      output[rgb_basic_y + rgb_basic_x + 1] = input[rgb_y + rgb_x + 1];
+      output[rgb_basic_y + rgb_basic_x + 2] = input[rgb_y + rgb_x + 2];
+      output[rgb_basic_y + rgb_basic_x + 3] = input[rgb_y + rgb_x + 3];
+
+      ++basic_x;
+    }
+
+    ++basic_y;
+  }
+}
+
+
+TARGET_AVX2 void flip_rgb_avx2(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height,
+                               bool horizontally, bool vertically)
+{
+  if (!horizontally && !vertically)
+  {
+    return;
+  }
+
+  const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+  for (int y = 0; y < height; ++y)
+  {
+    uint8_t *in = input + 4*(vertically ? height - 1 - y : y)*width;
+    uint8_t *out = output + 4*y*width;
+
+    if (!horizontally)
+    {
+      memcpy(out, in, 4*width);
+      continue;
+    }
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      __m256i pixels = _mm256_loadu_si256((__m256i const*)&in[4*(width - x - 8)]);
+      _mm256_storeu_si256((__m256i*)&out[4*x], _mm256_permutevar8x32_epi32(pixels, reverse));
+    }
+
+    for (; x < width; ++x)
+    {
+      memcpy(&out[4*x], &in[4*(width - 1 - x)], 4);
+    }
+  }
+}
+
+
+TARGET_AVX512 void flip_rgb_avx512(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height,
+                                   bool horizontally, bool vertically)
+{
+  if (!horizontally && !vertically)
+  {
+    return;
+  }
+
+  const __m512i reverse = _mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+  for (int y = 0; y < height; ++y)
+  {
+    uint8_t *in = input + 4*(vertically ? height - 1 - y : y)*width;
+    uint8_t *out = output + 4*y*width;
+
+    if (!horizontally)
+    {
+      memcpy(out, in, 4*width);
+      continue;
+    }
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m512i pixels = _mm512_loadu_si512((void const*)&in[4*(width - x - 16)]);
+      _mm512_storeu_si512((void*)&out[4*x], _mm512_permutexvar_epi32(reverse, pixels));
+    }
+
+    for (; x < width; ++x)
+    {
+      memcpy(&out[4*x], &in[4*(width - 1 - x)], 4);
+    }
+  }
+}
+
+
+
+TARGET_AVX2 bool equal_bytes_avx2(const uint8_t* a, const uint8_t* b, int length)
+{
+  __m256i difference = _mm256_setzero_si256();
+
+  int i = 0;
+  for (; i + 32 <= length; i += 32)
+  {
+    __m256i first  = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i second = _mm256_loadu_si256((const __m256i*)(b + i));
+    difference = _mm256_or_si256(difference, _mm256_xor_si256(first, second));
+  }
+
+  if (!_mm256_testz_si256(difference, difference))
+  {
+    return false;
+  }
+
+  return memcmp(a + i, b + i, length - i) == 0;
+}
+
+
+TARGET_AVX512 bool equal_bytes_avx512(const uint8_t* a, const uint8_t* b, int length)
+{
+  __m512i difference = _mm512_setzero_si512();
+
+  int i = 0;
+  for (; i + 64 <= length; i += 64)
+  {
+    __m512i first  = _mm512_loadu_si512((void const*)(a + i));
+    __m512i second = _mm512_loadu_si512((void const*)(b + i));
+    difference = _mm512_or_si512(difference, _mm512_xor_si512(first, second));
+  }
+
+  if (_mm512_test_epi64_mask(difference, difference) != 0)
+  {
+    return false;
+  }
+
+  return memcmp(a + i, b + i, length - i) == 0;
+}
+
+
+bool equal_bytes_c(const uint8_t* a, const uint8_t* b, int length)
+{
+  return memcmp(a, b, length) == 0;
+}
+
+
+int update_dirty_blocks(uint8_t* previous, const uint8_t* current, uint8_t* dirty_map,
+                        uint16_t width, uint16_t height, int stride, uint16_t block_size,
+                        bool (*equal_bytes)(const uint8_t*, const uint8_t*, int))
+{
+  const int blocks_x = (width + block_size - 1)/block_size;
+  const int blocks_y = (height + block_size - 1)/block_size;
+  int dirty_blocks = 0;
+
+  for (int block_y = 0; block_y < blocks_y; ++block_y)
+  {
+    uint8_t* dirty_row = dirty_map + block_y*blocks_x;
+    memset(dirty_row, 0, blocks_x);
+
+    int y_start = block_y*block_size;
+    int y_end = y_start + block_size < height ? y_start + block_size : height;
+
+    // go through the block row one line at a time so the memory is accessed in order
+    for (int y = y_start; y < y_end; ++y)
+    {
+      const uint8_t* previous_line = previous + (ptrdiff_t)y*stride;
+      const uint8_t* current_line  = current  + (ptrdiff_t)y*stride;
+
+      for (int block_x = 0; block_x < blocks_x; ++block_x)
+      {
+        if (dirty_row[block_x])
+        {
+          continue;
+        }
+
+        int x_start = block_x*block_size;
+        int x_end = x_start + block_size < width ? x_start + block_size : width;
+
+        if (!equal_bytes(previous_line + 4*x_start, current_line + 4*x_start, 4*(x_end - x_start)))
+        {
+          dirty_row[block_x] = 1;
+        }
+      }
+    }
+
+    // store the changed blocks for next comparison
+    for (int block_x = 0; block_x < blocks_x; ++block_x)
+    {
+      if (dirty_row[block_x])
+      {
+        int x_start = block_x*block_size;
+        int x_end = x_start + block_size < width ? x_start + block_size : width;
+
+        for (int y = y_start; y < y_end; ++y)
+        {
+          memcpy(previous + (ptrdiff_t)y*stride + 4*x_start,
+                 current + (ptrdiff_t)y*stride + 4*x_start, 4*(x_end - x_start));
+        }
+
+        ++dirty_blocks;
+      }
+    }
+  }
+
+  return dirty_blocks;
+}
+
+
+int update_dirty_blocks_avx512(uint8_t* previous, const uint8_t* current, uint8_t* dirty_map,
+                               uint16_t width, uint16_t height, int stride, uint16_t block_size)
+{
+  return update_dirty_blocks(previous, current, dirty_map, width, height, stride, block_size,
+                             equal_bytes_avx512);
+}
+
+
+int update_dirty_blocks_avx2(uint8_t* previous, const uint8_t* current, uint8_t* dirty_map,
+                             uint16_t width, uint16_t height, int stride, uint16_t block_size)
+{
+  return update_dirty_blocks(previous, current, dirty_map, width, height, stride, block_size,
+                             equal_bytes_avx2);
+}
+
+
+int update_dirty_blocks_c(uint8_t* previous, const uint8_t* current, uint8_t* dirty_map,
+                          uint16_t width, uint16_t height, int stride, uint16_t block_size)
+{
+  return update_dirty_blocks(previous, current, dirty_map, width, height, stride, block_size,
+                             equal_bytes_c);
+}
+
+
+uint8_t clamp_8bit(int32_t input)
+{
+  if(input & ~255)
+  {
+    return (-input) >> 31;
+  }
+  return input;
+}
+
+
+// The SIMD versions of yuv420_to_rgb process 16 luma pixels at a time in
+// frame order so they can only be used when rows are divisible by 16.
+static void yuv420_to_rgb_sse41_any(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+{
+  if (width % 16 == 0)
+  {
+    yuv420_to_rgb_i_sse41(input, output, width, height);
+  }
+  else
+  {
+    yuv420_to_rgb_i_c(input, output, width, height);
+  }
+}
+
+
+static void yuv420_to_rgb_avx2_any(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height)
+{
+  if (width % 16 == 0)
+  {
+    yuv420_to_rgb_i_avx2(input, output, width, height);
+  }
+  else
+  {
+    yuv420_to_rgb_i_c(input, output, width, height);
+  }
+}
+
+
+static const ConversionKernels c_kernels = {
+  KERNEL_C,
+  yuv420_to_rgb_i_c,
+  rgb_to_yuv420_i_c,
+  yuyv_to_yuv420_c,
+  yuyv_to_rgb_c,
+  half_rgb_c,
+  flip_rgb_c,
+  update_dirty_blocks_c,
+  selfview_to_rgb_c,
+  scale_plane_bilinear_c,
+  scale_plane_box_c
+};
+
+
+// SSE4.1 has no versions of its own for the rest
+static const ConversionKernels sse41_kernels = {
+  KERNEL_SSE41,
+  yuv420_to_rgb_sse41_any,
+  rgb_to_yuv420_i_sse41,
+  yuyv_to_yuv420_c,
+  yuyv_to_rgb_c,
+  half_rgb_c,
+  flip_rgb_c,
+  update_dirty_blocks_c,
+  selfview_to_rgb_c,
+  scale_plane_bilinear_c,
+  scale_plane_box_c
+};
+
+
+static const ConversionKernels avx2_kernels = {
+  KERNEL_AVX2,
+  yuv420_to_rgb_avx2_any,
+  rgb_to_yuv420_i_avx2,
+  yuyv_to_yuv420_avx2,
+  yuyv_to_rgb_avx2,
+  half_rgb_avx2,
+  flip_rgb_avx2,
+  update_dirty_blocks_avx2,
+  selfview_to_rgb_avx2,
+  scale_plane_bilinear_avx2,
+  scale_plane_box_avx2
+};
+
+
+static const ConversionKernels avx512_kernels = {
+  KERNEL_AVX512,
+  yuv420_to_rgb_i_avx512,
+  rgb_to_yuv420_i_avx512,
+  yuyv_to_yuv420_avx512,
+  yuyv_to_rgb_avx512,
+  half_rgb_avx512,
+  flip_rgb_avx512,
+  update_dirty_blocks_avx512,
+  selfview_to_rgb_avx2,
+  scale_plane_bilinear_avx2,
+  scale_plane_box_avx2
+};
+
+
+const ConversionKernels* get_level_kernels(KernelLevel level)
+{
+  switch (level)
+  {
+    case KERNEL_C:
+      return &c_kernels;
+    case KERNEL_SSE41:
+      return is_sse41_available() ? &sse41_kernels : nullptr;
+    case KERNEL_AVX2:
+      return is_avx2_available() ? &avx2_kernels : nullptr;
+    case KERNEL_AVX512:
+      return is_avx512_available() ? &avx512_kernels : nullptr;
+  }
+
+  return nullptr;
+}
+
+
+const ConversionKernels& get_conversion_kernels()
+{
+  // resolved only once, the CPU does not change while we are running
+  static const ConversionKernels* kernels = []()
+  {
+    for (int level = KERNEL_AVX512; level > KERNEL_C; --level)
+    {
+      const ConversionKernels* candidate = get_level_kernels((KernelLevel)level);
+      if (candidate != nullptr)
+      {
+        return candidate;
+      }
+    }
+    return &c_kernels;
+  }();
+
+  return *kernels;
+}
+
+
+const char* kernel_level_name(KernelLevel level)
+{
+  switch (level)
+  {
+    case KERNEL_C:
+      return "C";
+    case KERNEL_SSE41:
+      return "SSE4.1";
+    case KERNEL_AVX2:
+      return "AVX2";
+    case KERNEL_AVX512:
+      return "AVX-512";
+  }
+
+  return "Unknown";
 }
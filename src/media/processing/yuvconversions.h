@@ -1,28 +1,109 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 
 bool is_avx2_available();
 bool is_sse41_available();
+bool is_avx512_available();
+
+// The 4:2:0 conversions expect even width and height. All versions of one
+// conversion produce identical output, the C versions are the reference.
 
 int  yuv420_to_rgb_i_avx2_mt (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height, uint8_t threads);
+
+// the SSE4.1 and AVX2 versions require width divisible by 16
 int  yuv420_to_rgb_i_avx2    (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
 int  yuv420_to_rgb_i_sse41   (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+void yuv420_to_rgb_i_avx512  (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
 void yuv420_to_rgb_i_c       (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
 
-// TODO: These also flip the input vertically!
 int  rgb_to_yuv420_i_sse41_mt(uint8_t* input, uint8_t* output, int width, int height, int threads);
-int  rgb_to_yuv420_i_sse41   (uint8_t* input, uint8_t* output, int width, int height);
+void rgb_to_yuv420_i_sse41   (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+void rgb_to_yuv420_i_avx2    (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+void rgb_to_yuv420_i_avx512  (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
 void rgb_to_yuv420_i_c       (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
 
+void yuyv_to_yuv420_avx2     (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+void yuyv_to_yuv420_avx512   (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
 void yuyv_to_yuv420_c        (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
 
+void yuyv_to_rgb_avx2        (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+void yuyv_to_rgb_avx512      (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
 void yuyv_to_rgb_c           (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
 
 // reduces the size of RGB frame to half height and half width
-void half_rgb                (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+void half_rgb_avx2           (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+void half_rgb_avx512         (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+void half_rgb_c              (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
 
-void flip_rgb                (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height,
+void flip_rgb_avx2           (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height,
+                              bool horizontally, bool vertically);
+void flip_rgb_avx512         (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height,
+                              bool horizontally, bool vertically);
+void flip_rgb_c              (uint8_t* input, uint8_t* output, uint16_t width, uint16_t height,
                               bool horizontally, bool vertically);
 
+// Camera formats the self view is converted from
+enum SelfViewFormat {SELF_VIEW_YUV420, SELF_VIEW_NV12, SELF_VIEW_YUYV};
+
+// Converts a camera frame to RGB32 downscaled by an integer factor with a box
+// filter and optionally mirrored horizontally, one output row at a time. The
+// output is (width/factor rounded down to even) x height/factor pixels. Width
+// must be even and work must hold selfview_work_size() bytes.
+size_t selfview_work_size(int width);
+
+void selfview_to_rgb_avx2    (const uint8_t* input, uint8_t* output, int width, int height,
+                              SelfViewFormat format, int factor, bool mirror, uint8_t* work);
+void selfview_to_rgb_c       (const uint8_t* input, uint8_t* output, int width, int height,
+                              SelfViewFormat format, int factor, bool mirror, uint8_t* work);
+
+// Compares the current RGB32 frame to previous one in blocks of block_size x block_size pixels.
+// Sets dirty_map to 1 for changed blocks and 0 for unchanged ones and copies the changed
+// blocks to previous. Stride can be negative to process the frames bottom-up.
+// Returns the number of changed blocks.
+int  update_dirty_blocks_avx512(uint8_t* previous, const uint8_t* current, uint8_t* dirty_map,
+                                uint16_t width, uint16_t height, int stride, uint16_t block_size);
+int  update_dirty_blocks_avx2(uint8_t* previous, const uint8_t* current, uint8_t* dirty_map,
+                              uint16_t width, uint16_t height, int stride, uint16_t block_size);
+int  update_dirty_blocks_c   (uint8_t* previous, const uint8_t* current, uint8_t* dirty_map,
+                              uint16_t width, uint16_t height, int stride, uint16_t block_size);
+
+
+enum KernelLevel {KERNEL_C = 0, KERNEL_SSE41, KERNEL_AVX2, KERNEL_AVX512};
+
+// One implementation of every conversion. Levels without their own version
+// of some conversion use the best one they support.
+struct ConversionKernels
+{
+  KernelLevel level;
+
+  void (*yuv420_to_rgb)(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+  void (*rgb_to_yuv420)(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+  void (*yuyv_to_yuv420)(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+  void (*yuyv_to_rgb)(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+  void (*half_rgb)(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height);
+  void (*flip_rgb)(uint8_t* input, uint8_t* output, uint16_t width, uint16_t height,
+                   bool horizontally, bool vertically);
+  int  (*update_dirty_blocks)(uint8_t* previous, const uint8_t* current, uint8_t* dirty_map,
+                              uint16_t width, uint16_t height, int stride, uint16_t block_size);
+  void (*selfview_to_rgb)(const uint8_t* input, uint8_t* output, int width, int height,
+                          SelfViewFormat format, int factor, bool mirror, uint8_t* work);
+
+  // plane scaling kernels from yuvscaling.h
+  void (*scale_plane_bilinear)(const uint8_t* src, int src_width, int src_height, int src_stride,
+                               uint8_t* dst, int dst_width, int dst_height, int dst_stride,
+                               uint8_t* work);
+  void (*scale_plane_box)(const uint8_t* src, int src_width, int src_height, int src_stride,
+                          uint8_t* dst, int dst_width, int dst_height, int dst_stride,
+                          uint8_t* work);
+};
+
+// returns the kernels of this level or nullptr if the CPU does not support it
+const ConversionKernels* get_level_kernels(KernelLevel level);
+
+// the best kernels this CPU supports, resolved on first call
+const ConversionKernels& get_conversion_kernels();
+
+const char* kernel_level_name(KernelLevel level);
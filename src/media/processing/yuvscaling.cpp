@@ -0,0 +1,390 @@
+#include "yuvscaling.h"
+
+#include "yuvconversions.h"
+
+#include <immintrin.h>
+
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+  #define TARGET_AVX2
+#endif
+
+// Bilinear weights have 7 bits so that the vertically filtered row fits
+// into signed 16-bit values and can be multiplied with madd.
+const int WEIGHT_BITS = 7;
+const int WEIGHT_ONE = 1 << WEIGHT_BITS;
+
+const size_t WORK_ALIGNMENT = 32;
+
+
+static size_t align_size(size_t size)
+{
+  return (size + WORK_ALIGNMENT - 1)/WORK_ALIGNMENT*WORK_ALIGNMENT;
+}
+
+
+static uint8_t* align_pointer(uint8_t* pointer)
+{
+  return (uint8_t*)(((uintptr_t)pointer + WORK_ALIGNMENT - 1)/WORK_ALIGNMENT*WORK_ALIGNMENT);
+}
+
+
+static size_t plane_work_size(int src_width, int dst_width)
+{
+  // position and weight tables, one filtered row and room for aligning the start
+  return 2*align_size(dst_width*sizeof(int32_t)) + align_size((src_width + 1)*sizeof(uint16_t)) +
+      WORK_ALIGNMENT;
+}
+
+
+// Maps the center of destination pixel to source in 16.16 fixed point
+static void source_position(int dst_pos, int src_size, int dst_size, int& index, int& weight)
+{
+  int64_t position = ((int64_t)(2*dst_pos + 1)*src_size << 16)/(2*dst_size) - (1 << 15);
+  int64_t last = (int64_t)(src_size - 1) << 16;
+
+  if (position < 0)
+  {
+    position = 0;
+  }
+  else if (position > last)
+  {
+    position = last;
+  }
+
+  index = (int)(position >> 16);
+  weight = (int)((position >> (16 - WEIGHT_BITS)) & (WEIGHT_ONE - 1));
+}
+
+
+// Fills the horizontal tables. Weights contain the pair (1 - w, w) as 16-bit values.
+static void horizontal_tables(int src_width, int dst_width, int32_t* offsets, int32_t* weights)
+{
+  for (int x = 0; x < dst_width; ++x)
+  {
+    int weight = 0;
+    source_position(x, src_width, dst_width, offsets[x], weight);
+    weights[x] = (WEIGHT_ONE - weight) | (weight << 16);
+  }
+}
+
+
+static inline uint8_t horizontal_pixel(const uint16_t* row, int32_t offset, int32_t weight)
+{
+  int32_t sum = row[offset]*(weight & 0xffff) + row[offset + 1]*(weight >> 16);
+  return (sum + (1 << (2*WEIGHT_BITS - 1))) >> (2*WEIGHT_BITS);
+}
+
+
+bool is_box_scalable(int src_width, int src_height, int dst_width, int dst_height)
+{
+  if (dst_width <= 0 || dst_height <= 0 ||
+      src_width % dst_width != 0 || src_height % dst_height != 0)
+  {
+    return false;
+  }
+
+  int factor_x = src_width/dst_width;
+  int factor_y = src_height/dst_height;
+
+  return factor_x <= MAX_BOX_FACTOR && factor_y <= MAX_BOX_FACTOR;
+}
+
+
+void scale_plane_bilinear_c(const uint8_t* src, int src_width, int src_height, int src_stride,
+                            uint8_t* dst, int dst_width, int dst_height, int dst_stride,
+                            uint8_t* work)
+{
+  work = align_pointer(work);
+  int32_t* offsets = (int32_t*)work;
+  int32_t* weights = (int32_t*)(work + align_size(dst_width*sizeof(int32_t)));
+  uint16_t* row = (uint16_t*)(work + 2*align_size(dst_width*sizeof(int32_t)));
+
+  horizontal_tables(src_width, dst_width, offsets, weights);
+
+  for (int y = 0; y < dst_height; ++y)
+  {
+    int index = 0;
+    int weight = 0;
+    source_position(y, src_height, dst_height, index, weight);
+
+    const uint8_t* first = src + (ptrdiff_t)index*src_stride;
+    const uint8_t* second = index + 1 < src_height ? first + src_stride : first;
+
+    for (int x = 0; x < src_width; ++x)
+    {
+      row[x] = first[x]*(WEIGHT_ONE - weight) + second[x]*weight;
+    }
+    row[src_width] = row[src_width - 1];
+
+    uint8_t* out = dst + (ptrdiff_t)y*dst_stride;
+    for (int x = 0; x < dst_width; ++x)
+    {
+      out[x] = horizontal_pixel(row, offsets[x], weights[x]);
+    }
+  }
+}
+
+
+TARGET_AVX2 void scale_plane_bilinear_avx2(const uint8_t* src, int src_width, int src_height, int src_stride,
+                                           uint8_t* dst, int dst_width, int dst_height, int dst_stride,
+                                           uint8_t* work)
+{
+  work = align_pointer(work);
+  int32_t* offsets = (int32_t*)work;
+  int32_t* weights = (int32_t*)(work + align_size(dst_width*sizeof(int32_t)));
+  uint16_t* row = (uint16_t*)(work + 2*align_size(dst_width*sizeof(int32_t)));
+
+  horizontal_tables(src_width, dst_width, offsets, weights);
+
+  const __m256i rounding = _mm256_set1_epi32(1 << (2*WEIGHT_BITS - 1));
+
+  for (int y = 0; y < dst_height; ++y)
+  {
+    int index = 0;
+    int weight = 0;
+    source_position(y, src_height, dst_height, index, weight);
+
+    const uint8_t* first = src + (ptrdiff_t)index*src_stride;
+    const uint8_t* second = index + 1 < src_height ? first + src_stride : first;
+
+    const __m256i first_weight = _mm256_set1_epi16(WEIGHT_ONE - weight);
+    const __m256i second_weight = _mm256_set1_epi16(weight);
+
+    int x = 0;
+    for (; x + 16 <= src_width; x += 16)
+    {
+      __m256i first_pixels = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)&first[x]));
+      __m256i second_pixels = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)&second[x]));
+
+      _mm256_storeu_si256((__m256i*)&row[x], _mm256_add_epi16(_mm256_mullo_epi16(first_pixels, first_weight),
+                                                              _mm256_mullo_epi16(second_pixels, second_weight)));
+    }
+
+    for (; x < src_width; ++x)
+    {
+      row[x] = first[x]*(WEIGHT_ONE - weight) + second[x]*weight;
+    }
+    row[src_width] = row[src_width - 1];
+
+    uint8_t* out = dst + (ptrdiff_t)y*dst_stride;
+
+    x = 0;
+    for (; x + 8 <= dst_width; x += 8)
+    {
+      // each gathered 32-bit value holds the two neighbouring samples
+      __m256i pairs = _mm256_i32gather_epi32((int const*)row,
+                                             _mm256_loadu_si256((__m256i const*)&offsets[x]), 2);
+      __m256i sums = _mm256_madd_epi16(pairs, _mm256_loadu_si256((__m256i const*)&weights[x]));
+      __m256i pixels = _mm256_srli_epi32(_mm256_add_epi32(sums, rounding), 2*WEIGHT_BITS);
+
+      __m256i words = _mm256_packus_epi32(pixels, pixels);
+      __m256i bytes = _mm256_packus_epi16(words, words);
+      _mm_storel_epi64((__m128i*)&out[x], _mm_unpacklo_epi32(_mm256_castsi256_si128(bytes),
+                                                             _mm256_extracti128_si256(bytes, 1)));
+    }
+
+    for (; x < dst_width; ++x)
+    {
+      out[x] = horizontal_pixel(row, offsets[x], weights[x]);
+    }
+  }
+}
+
+
+// rounding division of the block sum by the block area
+static inline uint32_t box_reciprocal(int area)
+{
+  return (65536 + area/2)/area;
+}
+
+
+static inline uint8_t box_pixel(uint32_t sum, uint32_t reciprocal)
+{
+  return (sum*reciprocal + 32768) >> 16;
+}
+
+
+void scale_plane_box_c(const uint8_t* src, int src_width, int src_height, int src_stride,
+                       uint8_t* dst, int dst_width, int dst_height, int dst_stride,
+                       uint8_t* work)
+{
+  uint16_t* sums = (uint16_t*)align_pointer(work);
+
+  const int factor_x = src_width/dst_width;
+  const int factor_y = src_height/dst_height;
+  const uint32_t reciprocal = box_reciprocal(factor_x*factor_y);
+
+  for (int y = 0; y < dst_height; ++y)
+  {
+    memset(sums, 0, src_width*sizeof(uint16_t));
+
+    for (int i = 0; i < factor_y; ++i)
+    {
+      const uint8_t* in = src + (ptrdiff_t)(y*factor_y + i)*src_stride;
+      for (int x = 0; x < src_width; ++x)
+      {
+        sums[x] += in[x];
+      }
+    }
+
+    uint8_t* out = dst + (ptrdiff_t)y*dst_stride;
+    for (int x = 0; x < dst_width; ++x)
+    {
+      uint32_t sum = 0;
+      for (int i = 0; i < factor_x; ++i)
+      {
+        sum += sums[x*factor_x + i];
+      }
+      out[x] = box_pixel(sum, reciprocal);
+    }
+  }
+}
+
+
+TARGET_AVX2 void scale_plane_box_avx2(const uint8_t* src, int src_width, int src_height, int src_stride,
+                                      uint8_t* dst, int dst_width, int dst_height, int dst_stride,
+                                      uint8_t* work)
+{
+  uint16_t* sums = (uint16_t*)align_pointer(work);
+
+  const int factor_x = src_width/dst_width;
+  const int factor_y = src_height/dst_height;
+  const uint32_t reciprocal = box_reciprocal(factor_x*factor_y);
+
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i multiplier = _mm256_set1_epi32(reciprocal);
+  const __m256i rounding = _mm256_set1_epi32(32768);
+
+  for (int y = 0; y < dst_height; ++y)
+  {
+    const uint8_t* in = src + (ptrdiff_t)y*factor_y*src_stride;
+
+    int x = 0;
+    for (; x + 16 <= src_width; x += 16)
+    {
+      __m256i sum = _mm256_setzero_si256();
+      for (int i = 0; i < factor_y; ++i)
+      {
+        sum = _mm256_add_epi16(sum, _mm256_cvtepu8_epi16(
+                                 _mm_loadu_si128((__m128i const*)&in[(ptrdiff_t)i*src_stride + x])));
+      }
+      _mm256_storeu_si256((__m256i*)&sums[x], sum);
+    }
+
+    for (; x < src_width; ++x)
+    {
+      uint16_t sum = 0;
+      for (int i = 0; i < factor_y; ++i)
+      {
+        sum += in[(ptrdiff_t)i*src_stride + x];
+      }
+      sums[x] = sum;
+    }
+
+    uint8_t* out = dst + (ptrdiff_t)y*dst_stride;
+
+    x = 0;
+    if (factor_x == 2)
+    {
+      for (; x + 8 <= dst_width; x += 8)
+      {
+        // adds the neighbouring column sums to 32-bit values
+        __m256i block_sums = _mm256_madd_epi16(_mm256_loadu_si256((__m256i const*)&sums[2*x]), ones);
+        __m256i pixels = _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(block_sums, multiplier),
+                                                            rounding), 16);
+
+        __m256i words = _mm256_packus_epi32(pixels, pixels);
+        __m256i bytes = _mm256_packus_epi16(words, words);
+        _mm_storel_epi64((__m128i*)&out[x], _mm_unpacklo_epi32(_mm256_castsi256_si128(bytes),
+                                                               _mm256_extracti128_si256(bytes, 1)));
+      }
+    }
+
+    for (; x < dst_width; ++x)
+    {
+      uint32_t sum = 0;
+      for (int i = 0; i < factor_x; ++i)
+      {
+        sum += sums[x*factor_x + i];
+      }
+      out[x] = box_pixel(sum, reciprocal);
+    }
+  }
+}
+
+
+static void scale_plane(const uint8_t* src, int src_width, int src_height,
+                        uint8_t* dst, int dst_width, int dst_height, uint8_t* work)
+{
+  const ConversionKernels& kernels = get_conversion_kernels();
+
+  if (is_box_scalable(src_width, src_height, dst_width, dst_height))
+  {
+    kernels.scale_plane_box(src, src_width, src_height, src_width,
+                            dst, dst_width, dst_height, dst_width, work);
+  }
+  else
+  {
+    kernels.scale_plane_bilinear(src, src_width, src_height, src_width,
+                                 dst, dst_width, dst_height, dst_width, work);
+  }
+}
+
+
+size_t scale_work_size(int src_width, int src_height, int dst_width, int dst_height)
+{
+  // NV12 chroma is separated into planes for scaling
+  return plane_work_size(src_width, dst_width) +
+      2*(src_width/2)*(src_height/2) + 2*(dst_width/2)*(dst_height/2);
+}
+
+
+void scale_yuv420(const uint8_t* src, int src_width, int src_height,
+                  uint8_t* dst, int dst_width, int dst_height, uint8_t* work)
+{
+  const uint8_t* src_u = src + src_width*src_height;
+  const uint8_t* src_v = src_u + (src_width/2)*(src_height/2);
+
+  uint8_t* dst_u = dst + dst_width*dst_height;
+  uint8_t* dst_v = dst_u + (dst_width/2)*(dst_height/2);
+
+  scale_plane(src, src_width, src_height, dst, dst_width, dst_height, work);
+  scale_plane(src_u, src_width/2, src_height/2, dst_u, dst_width/2, dst_height/2, work);
+  scale_plane(src_v, src_width/2, src_height/2, dst_v, dst_width/2, dst_height/2, work);
+}
+
+
+void scale_nv12(const uint8_t* src, int src_width, int src_height,
+                uint8_t* dst, int dst_width, int dst_height, uint8_t* work)
+{
+  const int src_chroma = (src_width/2)*(src_height/2);
+  const int dst_chroma = (dst_width/2)*(dst_height/2);
+
+  uint8_t* planes = work + plane_work_size(src_width, dst_width);
+  uint8_t* src_u = planes;
+  uint8_t* src_v = src_u + src_chroma;
+  uint8_t* dst_u = src_v + src_chroma;
+  uint8_t* dst_v = dst_u + dst_chroma;
+
+  const uint8_t* src_uv = src + src_width*src_height;
+  for (int i = 0; i < src_chroma; ++i)
+  {
+    src_u[i] = src_uv[2*i];
+    src_v[i] = src_uv[2*i + 1];
+  }
+
+  scale_plane(src, src_width, src_height, dst, dst_width, dst_height, work);
+  scale_plane(src_u, src_width/2, src_height/2, dst_u, dst_width/2, dst_height/2, work);
+  scale_plane(src_v, src_width/2, src_height/2, dst_v, dst_width/2, dst_height/2, work);
+
+  uint8_t* dst_uv = dst + dst_width*dst_height;
+  for (int i = 0; i < dst_chroma; ++i)
+  {
+    dst_uv[2*i] = dst_u[i];
+    dst_uv[2*i + 1] = dst_v[i];
+  }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Scaling of 8-bit planes. Box filter averages whole blocks and needs integer
+// scaling factors up to MAX_BOX_FACTOR, bilinear works with any sizes.
+// The work buffer must hold scale_work_size() bytes.
+
+const int MAX_BOX_FACTOR = 16;
+
+bool is_box_scalable(int src_width, int src_height, int dst_width, int dst_height);
+
+void scale_plane_bilinear_c   (const uint8_t* src, int src_width, int src_height, int src_stride,
+                               uint8_t* dst, int dst_width, int dst_height, int dst_stride,
+                               uint8_t* work);
+void scale_plane_bilinear_avx2(const uint8_t* src, int src_width, int src_height, int src_stride,
+                               uint8_t* dst, int dst_width, int dst_height, int dst_stride,
+                               uint8_t* work);
+
+void scale_plane_box_c        (const uint8_t* src, int src_width, int src_height, int src_stride,
+                               uint8_t* dst, int dst_width, int dst_height, int dst_stride,
+                               uint8_t* work);
+void scale_plane_box_avx2     (const uint8_t* src, int src_width, int src_height, int src_stride,
+                               uint8_t* dst, int dst_width, int dst_height, int dst_stride,
+                               uint8_t* work);
+
+// Frame scaling with the best kernels of this CPU. Box filter is used for
+// planes where it is possible. Dimensions must be even.
+size_t scale_work_size(int src_width, int src_height, int dst_width, int dst_height);
+
+void scale_yuv420(const uint8_t* src, int src_width, int src_height,
+                  uint8_t* dst, int dst_width, int dst_height, uint8_t* work);
+
+void scale_nv12  (const uint8_t* src, int src_width, int src_height,
+                  uint8_t* dst, int dst_width, int dst_height, uint8_t* work);
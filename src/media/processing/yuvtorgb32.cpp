@@ -28,37 +28,39 @@ void YUVtoRGB32::updateSettings()
 // also flips input
 void YUVtoRGB32::process()
 {
-  std::unique_ptr<Data> input = getInput();
+  // The RGB frames are only drawn, so if we have fallen behind there is no
+  // point converting frames that a newer one will replace on screen.
+  uint32_t discarded = 0;
+  std::unique_ptr<Data> input = getNewestInput(discarded);
 
   while(input)
   {
     uint32_t finalDataSize = input->vInfo->width*input->vInfo->height*4;
     std::unique_ptr<uchar[]> rgb32_frame(new uchar[finalDataSize]);
 
-    // TODO: Select thread count based on input resolution instead of settings.
-    // Anything above fullhd should be around 2
-    if (getHWManager()->isAVX2Enabled() && threadCount_ != 1 && input->vInfo->width % 16 == 0)
+    // the setting is the maximum, the budget depends on resolution and the number of streams
+    int threads = getHWManager()->getConversionThreads(input->vInfo->width, input->vInfo->height);
+    if (threadCount_ > 0 && threadCount_ < threads)
     {
-      yuv420_to_rgb_i_avx2_mt(input->data.get(), rgb32_frame.get(), input->vInfo->width, input->vInfo->height,
-                     threadCount_);
-    }
-    else if (getHWManager()->isAVX2Enabled() && input->vInfo->width % 16 == 0)
-    {
-      yuv420_to_rgb_i_avx2(input->data.get(), rgb32_frame.get(), input->vInfo->width, input->vInfo->height);
+      threads = threadCount_;
     }
-    else if (getHWManager()->isSSE41Enabled() && input->vInfo->width % 16 == 0)
+
+    const ConversionKernels& kernels = get_conversion_kernels();
+
+    if (kernels.level >= KERNEL_AVX2 && threads != 1 && input->vInfo->width % 16 == 0)
     {
-      yuv420_to_rgb_i_sse41(input->data.get(), rgb32_frame.get(), input->vInfo->width, input->vInfo->height);
+      yuv420_to_rgb_i_avx2_mt(input->data.get(), rgb32_frame.get(), input->vInfo->width, input->vInfo->height,
+                     threads);
     }
     else
     {
-      yuv420_to_rgb_i_c(input->data.get(), rgb32_frame.get(), input->vInfo->width, input->vInfo->height);
+      kernels.yuv420_to_rgb(input->data.get(), rgb32_frame.get(), input->vInfo->width, input->vInfo->height);
     }
     input->type = DT_RGB32VIDEO;
     input->data = std::move(rgb32_frame);
     input->data_size = finalDataSize;
     sendOutput(std::move(input));
 
-    input = getInput();
+    input = getNewestInput(discarded);
   }
 }
@@ -6,23 +6,59 @@
 #include "logger.h"
 #include "common.h"
 
+#include <QDateTime>
+#include <QThread>
+
 const int MIN_OPUS_BITRATE_BITS = 16000;    // 16 kbit/s
 const int MAX_OPUS_BITRATE_BITS = 24000;    // 24 kbit/s
 const int MIN_HEVC_BITRATE_BITS = 150000;   // 150 kbit/s
 const int MAX_HEVC_BITRATE_BITS = 10000000; // 10 Mbit/s
 
+// Text and sharp edges of screen content suffer from high QP. Unchanged areas
+// of the screen get maximum QP so the encoder can skip them cheaply.
+const int SCREEN_QP_DECREASE = 5;
+const int MIN_SCREEN_QP = 1;
+const int STATIC_SCREEN_QP = 51;
+
+// Using more threads than this many pixels per thread gives little benefit
+const int MIN_PIXELS_PER_THREAD = 640*360;
+
+// Encoding is the heaviest task so it gets half of the threads when we also
+// decode video. The rest of the threads are divided between the decoders.
+const int SEND_THREAD_DIVISOR = 2;
+const int ROI_THREAD_DIVISOR = 4;
+
+// The threads of each received stream are divided between its decoder and
+// the conversion of its decoded frames, which is much lighter.
+const int CONVERSION_THREAD_DIVISOR = 4;
+
+int limitThreadsByResolution(int threads, int width, int height);
+
 
 ResourceAllocator::ResourceAllocator():
-  avx2_(is_avx2_available()),
-  sse41_(is_sse41_available()),
   manualROI_(false),
   audioStreams_(),
   videoStreams_(),
   bitrateMutex_(),
   videoBitrate_(MAX_HEVC_BITRATE_BITS),
   audioBitrate_(MAX_OPUS_BITRATE_BITS),
-  roiObject_(0)
-{}
+  roiQp_(0),
+  backgroundQp_(0),
+  screenContentQp_(0),
+  roiObject_(0),
+  totalThreads_(QThread::idealThreadCount()),
+  videoDecoders_(0),
+  videoEncoding_(false),
+  speakerMutex_(),
+  speakers_()
+{
+  // resolve the conversion kernels once before any filter needs them
+  Logger::getLogger()->printNormal(this, "Selected video conversion kernels",
+                                   {"Instruction set"},
+                                   {kernel_level_name(get_conversion_kernels().level)});
+
+  updateSettings();
+}
 
 
 void ResourceAllocator::updateSettings()
@@ -33,18 +69,14 @@ void ResourceAllocator::updateSettings()
   roiQp_ = settingValue(SettingsKey::roiQp);
   backgroundQp_ = settingValue(SettingsKey::backgroundQp);
   roiObject_ = settingValue(SettingsKey::roiObject);
-}
-
-
-bool ResourceAllocator::isAVX2Enabled()
-{
-  return avx2_;
-}
 
-
-bool ResourceAllocator::isSSE41Enabled()
-{
-  return sse41_;
+  // read here and not for each captured frame
+  int screenQp = settingValue(SettingsKey::videoQP) - SCREEN_QP_DECREASE;
+  if (screenQp < MIN_SCREEN_QP)
+  {
+    screenQp = MIN_SCREEN_QP;
+  }
+  screenContentQp_ = screenQp;
 }
 
 
@@ -64,11 +96,16 @@ uint16_t ResourceAllocator::getRoiObject() const
 }
 
 
-void ResourceAllocator::addRTCPReport(uint32_t sessionID, DataType type,
+void ResourceAllocator::addRTCPReport(uint32_t sessionID, DataType type, uint8_t fraction,
                                       int32_t lost, uint32_t jitter)
 {
   std::shared_ptr<StreamInfo> info = getStreamInfo(sessionID, type);
 
+  if (info == nullptr)
+  {
+    return;
+  }
+
   if (jitter > info->previousJitter || lost > info->previousLost)
   {
     if (lost > info->previousLost)
@@ -92,6 +129,8 @@ void ResourceAllocator::addRTCPReport(uint32_t sessionID, DataType type,
   info->previousLost = lost;
 
   bitrateMutex_.lock();
+  info->fractionLost = fraction;
+
   if (type == DT_OPUSAUDIO)
   {
     updateGlobalBitrate(audioBitrate_, audioStreams_);
@@ -148,6 +187,82 @@ int ResourceAllocator::getBitrate(DataType type)
 }
 
 
+int ResourceAllocator::getPacketLoss(DataType type)
+{
+  uint8_t fraction = 0;
+
+  bitrateMutex_.lock();
+  std::map<uint32_t, std::shared_ptr<StreamInfo>>& streams =
+      type == DT_OPUSAUDIO ? audioStreams_ : videoStreams_;
+
+  for (auto& stream : streams)
+  {
+    if (stream.second != nullptr && stream.second->fractionLost > fraction)
+    {
+      fraction = stream.second->fractionLost;
+    }
+  }
+  bitrateMutex_.unlock();
+
+  // round up so that any loss is reported
+  return (fraction*100 + 255)/256;
+}
+
+
+void ResourceAllocator::requestKeyframe(uint32_t sessionID)
+{
+  Logger::getLogger()->printNormal(this, "Requesting a keyframe from peer",
+                                   {"SessionID"}, {QString::number(sessionID)});
+  emit sendKeyframeRequest(sessionID);
+}
+
+
+void ResourceAllocator::peerRequestsKeyframe(uint32_t sessionID)
+{
+  Logger::getLogger()->printNormal(this, "Peer requested a keyframe",
+                                   {"SessionID"}, {QString::number(sessionID)});
+  emit keyframeRequested(sessionID);
+}
+
+
+void ResourceAllocator::addAudioLevel(uint32_t sessionID, uint8_t level)
+{
+  speakerMutex_.lock();
+  bool changed = speakers_.addLevel(sessionID, level, QDateTime::currentMSecsSinceEpoch());
+  speakerMutex_.unlock();
+
+  if (changed)
+  {
+    Logger::getLogger()->printDebug(DEBUG_NORMAL, this, "Active speaker changed",
+                                    {"SessionID"}, {QString::number(sessionID)});
+    emit activeSpeakerChanged(sessionID);
+  }
+}
+
+
+void ResourceAllocator::removeSpeaker(uint32_t sessionID)
+{
+  speakerMutex_.lock();
+  bool changed = speakers_.removeSession(sessionID);
+  speakerMutex_.unlock();
+
+  if (changed)
+  {
+    emit activeSpeakerChanged(0);
+  }
+}
+
+
+uint32_t ResourceAllocator::getActiveSpeaker()
+{
+  speakerMutex_.lock();
+  uint32_t speaker = speakers_.activeSpeaker();
+  speakerMutex_.unlock();
+
+  return speaker;
+}
+
+
 std::shared_ptr<StreamInfo> ResourceAllocator::getStreamInfo(uint32_t sessionID, DataType type)
 {
   std::shared_ptr<StreamInfo> pointer = nullptr;
@@ -217,3 +332,115 @@ uint8_t ResourceAllocator::getBackgroundQp() const
 {
   return backgroundQp_;
 }
+
+
+uint8_t ResourceAllocator::getScreenContentQp() const
+{
+  return screenContentQp_;
+}
+
+
+int8_t ResourceAllocator::getStaticScreenQpDelta() const
+{
+  return int8_t(STATIC_SCREEN_QP - screenContentQp_);
+}
+
+
+void ResourceAllocator::setVideoDecoders(int decoders)
+{
+  if (videoDecoders_ != decoders)
+  {
+    Logger::getLogger()->printNormal(this, "Rebalancing thread budget",
+                                     {"Threads", "Decoders"},
+                                     {QString::number(totalThreads_), QString::number(decoders)});
+    videoDecoders_ = decoders;
+  }
+}
+
+
+void ResourceAllocator::setVideoEncoding(bool encoding)
+{
+  if (videoEncoding_ != encoding)
+  {
+    Logger::getLogger()->printNormal(this, "Rebalancing thread budget",
+                                     {"Threads", "Encoding"},
+                                     {QString::number(totalThreads_), encoding ? "Yes" : "No"});
+    videoEncoding_ = encoding;
+  }
+}
+
+
+int ResourceAllocator::getEncoderThreads(int width, int height) const
+{
+  int threads = getSendThreads();
+
+  if (autoROI_)
+  {
+    threads -= getROIThreads();
+  }
+
+  return limitThreadsByResolution(threads, width, height);
+}
+
+
+int ResourceAllocator::getDecoderThreads() const
+{
+  int threads = getReceiveThreads();
+  threads -= threads/CONVERSION_THREAD_DIVISOR;
+  return threads >= 1 ? threads : 1;
+}
+
+
+int ResourceAllocator::getROIThreads() const
+{
+  int threads = getSendThreads()/ROI_THREAD_DIVISOR;
+  return threads >= 1 ? threads : 1;
+}
+
+
+int ResourceAllocator::getConversionThreads(int width, int height) const
+{
+  return limitThreadsByResolution(getReceiveThreads()/CONVERSION_THREAD_DIVISOR,
+                                  width, height);
+}
+
+
+int ResourceAllocator::getSendThreads() const
+{
+  if (videoDecoders_ == 0)
+  {
+    return totalThreads_;
+  }
+
+  int threads = totalThreads_/SEND_THREAD_DIVISOR;
+  return threads >= 1 ? threads : 1;
+}
+
+
+int ResourceAllocator::getReceiveThreads() const
+{
+  int decoders = videoDecoders_;
+  if (decoders <= 0)
+  {
+    decoders = 1;
+  }
+
+  // without video to send the received streams get the whole CPU
+  int reserved = videoEncoding_ ? getSendThreads() : 0;
+
+  int threads = (totalThreads_ - reserved)/decoders;
+  return threads >= 1 ? threads : 1;
+}
+
+
+int limitThreadsByResolution(int threads, int width, int height)
+{
+  int usefulThreads = width*height/MIN_PIXELS_PER_THREAD;
+
+  if (threads > usefulThreads)
+  {
+    threads = usefulThreads;
+  }
+
+  return threads >= 1 ? threads : 1;
+}
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "processing/filter.h"
+#include "activespeakerdetector.h"
 
 #include <QObject>
 
+#include <atomic>
+
 /* The purpose of this class is the enable filters to easily query the
  * state of hardware in terms of possible optimizations and performance. */
 
@@ -13,6 +16,9 @@ struct StreamInfo
   int32_t  previousLost;
 
   int bitrate;
+
+  // of the latest report, in 1/256
+  uint8_t fractionLost = 0;
 };
 
 class ResourceAllocator : public QObject
@@ -23,23 +29,67 @@ public:
 
   void updateSettings();
 
-  bool isAVX2Enabled();
-  bool isSSE41Enabled();
-
   bool useManualROI();
   bool useAutoROI();
 
   uint16_t getRoiObject() const;
 
-  void addRTCPReport(uint32_t sessionID, DataType type,
+  void addRTCPReport(uint32_t sessionID, DataType type, uint8_t fraction,
                      int32_t lost, uint32_t jitter);
 
   int getBitrate(DataType type);
 
+  // the highest packet loss percentage reported by the receivers of this type
+  int getPacketLoss(DataType type);
+
+  // Our decoder cannot continue before the next keyframe, so the peer is
+  // asked to send one instead of waiting for its intra period.
+  void requestKeyframe(uint32_t sessionID);
+
+  // the peer cannot decode our video before the next keyframe
+  void peerRequestsKeyframe(uint32_t sessionID);
+
+  // The audio level of a received stream in -dBov. The stream that speaks
+  // the most becomes the active speaker, whose video is decoded first and
+  // requested at full size.
+  void addAudioLevel(uint32_t sessionID, uint8_t level);
+  void removeSpeaker(uint32_t sessionID);
+
+  // 0 if nobody has spoken
+  uint32_t getActiveSpeaker();
 
   uint8_t getRoiQp() const;
   uint8_t getBackgroundQp() const;
 
+  // QP of screen content frames. ROI maps hold deltas to the frame QP, so the
+  // unchanged areas of the screen use the delta to reach the maximum QP.
+  uint8_t getScreenContentQp() const;
+  int8_t getStaticScreenQpDelta() const;
+
+  // The threads of the CPU are divided between the encoder, decoders, RoI
+  // detection and conversions so that a call with many participants does
+  // not oversubscribe the CPU. Components limit these further with their settings.
+  void setVideoDecoders(int decoders);
+
+  // whether we are sending video, the encoder threads are only reserved then
+  void setVideoEncoding(bool encoding);
+
+  int getEncoderThreads(int width, int height) const;
+  int getDecoderThreads() const;
+  int getROIThreads() const;
+  int getConversionThreads(int width, int height) const;
+
+signals:
+
+  // sessionID is 0 if the active speaker left
+  void activeSpeakerChanged(uint32_t sessionID);
+
+  // the request is sent to the peer by the receiver of this session
+  void sendKeyframeRequest(uint32_t sessionID);
+
+  // our encoder should produce a keyframe
+  void keyframeRequested(uint32_t sessionID);
+
 private:
 
   void updateGlobalBitrate(int& bitrate,
@@ -49,8 +99,11 @@ private:
 
   void limitBitrate(int &bitrate, DataType type);
 
-  bool avx2_ = false;
-  bool sse41_ = false;
+  // threads reserved for processing the outgoing video
+  int getSendThreads() const;
+
+  // threads for decoding and converting one received stream
+  int getReceiveThreads() const;
 
   bool manualROI_ = false;
   bool autoROI_ = false;
@@ -65,6 +118,14 @@ private:
 
   uint8_t roiQp_;
   uint8_t backgroundQp_;
+  uint8_t screenContentQp_;
 
   uint16_t roiObject_;
+
+  int totalThreads_;
+  std::atomic<int> videoDecoders_;
+  std::atomic<bool> videoEncoding_;
+
+  QMutex speakerMutex_;
+  ActiveSpeakerDetector speakers_;
 };
@@ -0,0 +1,271 @@
+#include "metricscollector.h"
+
+#include <chrono>
+
+// must be a power of two
+const uint32_t RING_SIZE = 4096;
+
+// gives each collector an identity that is never reused
+static std::atomic<uint64_t> nextCollectorID(1);
+
+namespace
+{
+// the rings this thread records to, one per collector
+struct ThreadRings
+{
+  std::vector<std::pair<uint64_t, std::shared_ptr<void>>> rings;
+};
+
+thread_local ThreadRings threadRings;
+}
+
+
+MetricsCollector::SampleRing::SampleRing():
+  samples(RING_SIZE),
+  writeIndex(0),
+  readIndex(0),
+  lost(0)
+{}
+
+
+bool MetricsCollector::SampleRing::push(const Sample& sample)
+{
+  uint32_t write = writeIndex.load(std::memory_order_relaxed);
+  if (write - readIndex.load(std::memory_order_acquire) == RING_SIZE)
+  {
+    lost.store(lost.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return false;
+  }
+
+  samples[write & (RING_SIZE - 1)] = sample;
+  writeIndex.store(write + 1, std::memory_order_release);
+  return true;
+}
+
+
+bool MetricsCollector::SampleRing::pop(Sample& sample)
+{
+  uint32_t read = readIndex.load(std::memory_order_relaxed);
+  if (read == writeIndex.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+
+  sample = samples[read & (RING_SIZE - 1)];
+  readIndex.store(read + 1, std::memory_order_release);
+  return true;
+}
+
+
+MetricsCollector::MetricsCollector(int aggregationPeriodMs, int64_t historyMs):
+  id_(nextCollectorID.fetch_add(1)),
+  historyMs_(historyMs),
+  ringMutex_(),
+  rings_(),
+  lostValues_(0),
+  seriesMutex_(),
+  series_(),
+  threadMutex_(),
+  stopCondition_(),
+  stopped_(false),
+  aggregationPeriodMs_(aggregationPeriodMs),
+  aggregator_(&MetricsCollector::aggregateLoop, this)
+{}
+
+
+MetricsCollector::~MetricsCollector()
+{
+  {
+    std::lock_guard<std::mutex> lock(threadMutex_);
+    stopped_ = true;
+  }
+  stopCondition_.notify_all();
+  aggregator_.join();
+}
+
+
+int64_t MetricsCollector::now()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void MetricsCollector::record(MetricID metric, StatsMedia media, uint32_t source, int32_t value)
+{
+  threadRing()->push({source, value, metric, media});
+}
+
+
+MetricsCollector::SampleRing* MetricsCollector::threadRing()
+{
+  for (auto& ring : threadRings.rings)
+  {
+    if (ring.first == id_)
+    {
+      return static_cast<SampleRing*>(ring.second.get());
+    }
+  }
+
+  // first value from this thread, forget the rings of destroyed collectors
+  for (auto it = threadRings.rings.begin(); it != threadRings.rings.end();)
+  {
+    if (it->second.use_count() == 1)
+    {
+      it = threadRings.rings.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  std::shared_ptr<SampleRing> ring = std::make_shared<SampleRing>();
+  {
+    std::lock_guard<std::mutex> lock(ringMutex_);
+    rings_.push_back(ring);
+  }
+  threadRings.rings.push_back({id_, ring});
+  return ring.get();
+}
+
+
+void MetricsCollector::aggregate()
+{
+  std::vector<std::shared_ptr<SampleRing>> rings;
+  {
+    std::lock_guard<std::mutex> lock(ringMutex_);
+    rings = rings_;
+  }
+
+  std::lock_guard<std::mutex> lock(seriesMutex_);
+
+  int64_t timestamp = now();
+
+  Sample sample;
+  for (auto& ring : rings)
+  {
+    while (ring->pop(sample))
+    {
+      Series& series = series_[seriesKey(sample.metric, sample.media, sample.source)];
+      series.history.push_back({timestamp, sample.value});
+      ++series.count;
+      series.sum += sample.value;
+      series.last = sample.value;
+    }
+  }
+
+  int64_t oldest = timestamp - historyMs_;
+  for (auto& series : series_)
+  {
+    std::deque<Series::Value>& history = series.second.history;
+    while (!history.empty() && history.front().timestamp < oldest)
+    {
+      history.pop_front();
+    }
+  }
+
+  // the rings of exited threads are no longer written
+  std::lock_guard<std::mutex> ringLock(ringMutex_);
+  for (auto it = rings_.begin(); it != rings_.end();)
+  {
+    // our copy and the one in rings_
+    if (it->use_count() == 2 && (*it)->readIndex == (*it)->writeIndex)
+    {
+      lostValues_ += (*it)->lost;
+      it = rings_.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+
+MetricValues MetricsCollector::get(MetricID metric, StatsMedia media, uint32_t source, int64_t interval)
+{
+  MetricValues values;
+
+  std::lock_guard<std::mutex> lock(seriesMutex_);
+  auto it = series_.find(seriesKey(metric, media, source));
+  if (it == series_.end())
+  {
+    return values;
+  }
+
+  values.count = it->second.count;
+  values.sum = it->second.sum;
+  values.last = it->second.last;
+
+  // the newest values are at the end
+  int64_t start = now() - interval;
+  for (auto value = it->second.history.rbegin(); value != it->second.history.rend() &&
+       value->timestamp >= start; ++value)
+  {
+    ++values.windowCount;
+    values.windowSum += value->value;
+  }
+
+  return values;
+}
+
+
+void MetricsCollector::removeSession(uint32_t sessionID)
+{
+  removeSource(sessionID, false);
+}
+
+
+void MetricsCollector::removeFilter(uint32_t filterID)
+{
+  removeSource(filterID, true);
+}
+
+
+void MetricsCollector::removeSource(uint32_t source, bool filter)
+{
+  // values still in the rings would bring the series back
+  aggregate();
+
+  std::lock_guard<std::mutex> lock(seriesMutex_);
+  for (auto it = series_.begin(); it != series_.end();)
+  {
+    MetricID metric = static_cast<MetricID>((it->first >> 8) & 0xff);
+    if ((it->first >> 16) == source && (metric >= METRIC_FILTER_BUFFER) == filter)
+    {
+      it = series_.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+
+uint64_t MetricsCollector::lostValues()
+{
+  std::lock_guard<std::mutex> lock(ringMutex_);
+
+  uint64_t lost = lostValues_;
+  for (auto& ring : rings_)
+  {
+    lost += ring->lost.load(std::memory_order_relaxed);
+  }
+  return lost;
+}
+
+
+void MetricsCollector::aggregateLoop()
+{
+  std::unique_lock<std::mutex> lock(threadMutex_);
+  while (!stopped_)
+  {
+    stopCondition_.wait_for(lock, std::chrono::milliseconds(aggregationPeriodMs_));
+
+    lock.unlock();
+    aggregate();
+    lock.lock();
+  }
+}
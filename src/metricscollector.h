@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+
+// Collects statistics from the media threads without locks. Each producing
+// thread writes its samples to its own ring buffer and an aggregation thread
+// moves them periodically to per metric series which are then read by the
+// statistics views. Producers never wait for the readers.
+//
+// Reading the clock costs more than recording, so values get their time when
+// they are aggregated. The times are accurate to the aggregation period.
+
+// which media the statistic is about
+enum StatsMedia {STATS_NO_MEDIA = 0, STATS_VIDEO, STATS_AUDIO};
+
+enum MetricID : uint8_t
+{
+  // media metrics, the source is a session or 0 for local media and totals
+  METRIC_ENCODED_BYTES,
+  METRIC_ENCODING_DELAY,
+  METRIC_DECODING_DELAY,
+  METRIC_SENT_BYTES,
+  METRIC_RECEIVED_BYTES,
+  METRIC_PRESENTED,
+  METRIC_DISPLAY_DROPPED,
+  METRIC_TOTAL_DELAY,
+  METRIC_DECODER_SKIPPED,
+  METRIC_DECODER_QUEUE_LATENCY,
+  METRIC_RTCP_FRACTION_LOST,
+  METRIC_RTCP_LOST,
+  METRIC_RTCP_JITTER,
+  METRIC_AUDIO_BUFFER_DEPTH,
+  METRIC_AUDIO_BUFFER_TARGET,
+  METRIC_AUDIO_EXPANDED,
+  METRIC_AUDIO_COMPRESSED,
+  METRIC_AUDIO_CONCEALED,
+  METRIC_AEC_DELAY,
+  METRIC_AEC_DRIFT,
+  METRIC_AEC_ERLE,
+
+  // filter metrics, the source is the filter ID or 0 for totals
+  METRIC_FILTER_BUFFER,
+  METRIC_FILTER_BUFFER_SIZE,
+  METRIC_FILTER_DROPPED,
+
+  METRIC_COUNT
+};
+
+// the values of one metric, see MetricsCollector::get
+struct MetricValues
+{
+  uint64_t count = 0;       // values recorded since the start
+  int64_t sum = 0;
+  int32_t last = 0;         // the newest value
+
+  uint32_t windowCount = 0; // values recorded within the asked interval
+  int64_t windowSum = 0;
+};
+
+class MetricsCollector
+{
+public:
+  // Values older than history are forgotten, but they still count in totals
+  MetricsCollector(int aggregationPeriodMs = 50, int64_t historyMs = 20000);
+  ~MetricsCollector();
+
+  // Can be called from any thread and never blocks. If the aggregation has
+  // fallen so far behind that the ring of this thread is full, the value is lost.
+  void record(MetricID metric, StatsMedia media, uint32_t source, int32_t value);
+
+  // Moves the recorded values to the series. Done periodically by the
+  // aggregation thread, but can be called to get the latest values.
+  void aggregate();
+
+  // the values of a metric and the ones recorded during the last interval ms
+  MetricValues get(MetricID metric, StatsMedia media, uint32_t source, int64_t interval);
+
+  // forgets the media or filter metrics of this source
+  void removeSession(uint32_t sessionID);
+  void removeFilter(uint32_t filterID);
+
+  // values that did not fit in the ring buffers
+  uint64_t lostValues();
+
+  // milliseconds from a monotonic clock, the time of aggregated values
+  static int64_t now();
+
+private:
+
+  struct Sample
+  {
+    uint32_t source;
+    int32_t value;
+    MetricID metric;
+    StatsMedia media;
+  };
+
+  // single producer single consumer ring, the producer is the recording thread
+  struct SampleRing
+  {
+    SampleRing();
+
+    bool push(const Sample& sample);
+    bool pop(Sample& sample);
+
+    std::vector<Sample> samples;
+    std::atomic<uint32_t> writeIndex;
+    std::atomic<uint32_t> readIndex;
+
+    // only written by the producer
+    std::atomic<uint64_t> lost;
+  };
+
+  struct Series
+  {
+    struct Value
+    {
+      int64_t timestamp;
+      int32_t value;
+    };
+
+    std::deque<Value> history;
+    uint64_t count = 0;
+    int64_t sum = 0;
+    int32_t last = 0;
+  };
+
+  SampleRing* threadRing();
+
+  void aggregateLoop();
+
+  void removeSource(uint32_t source, bool filter);
+
+  static uint64_t seriesKey(MetricID metric, StatsMedia media, uint32_t source)
+  {
+    return (uint64_t)source << 16 | (uint64_t)metric << 8 | media;
+  }
+
+  // identifies this collector in the ring lists of threads
+  const uint64_t id_;
+  const int64_t historyMs_;
+
+  std::mutex ringMutex_;
+  std::vector<std::shared_ptr<SampleRing>> rings_;
+
+  // lost values of the removed rings
+  uint64_t lostValues_;
+
+  std::mutex seriesMutex_;
+  std::unordered_map<uint64_t, Series> series_;
+
+  std::mutex threadMutex_;
+  std::condition_variable stopCondition_;
+  bool stopped_;
+  int aggregationPeriodMs_;
+  std::thread aggregator_;
+};
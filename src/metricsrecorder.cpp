@@ -0,0 +1,158 @@
+#include "metricsrecorder.h"
+
+#include <cmath>
+
+
+MetricsRecorder::MetricsRecorder(std::shared_ptr<MetricsCollector> metrics):
+  metrics_(metrics ? metrics : std::make_shared<MetricsCollector>()),
+  nextFilterID_(1)
+{}
+
+
+MetricsRecorder::~MetricsRecorder()
+{}
+
+
+void MetricsRecorder::encodingDelay(StatsMedia media, uint32_t delay)
+{
+  metrics_->record(METRIC_ENCODING_DELAY, media, 0, delay);
+}
+
+
+void MetricsRecorder::decodingDelay(StatsMedia media, uint32_t delay)
+{
+  metrics_->record(METRIC_DECODING_DELAY, media, 0, delay);
+}
+
+
+void MetricsRecorder::totalDelay(uint32_t sessionID, StatsMedia media, int32_t delay)
+{
+  metrics_->record(METRIC_TOTAL_DELAY, media, sessionID, delay);
+}
+
+
+void MetricsRecorder::presentPackage(uint32_t sessionID, StatsMedia media)
+{
+  metrics_->record(METRIC_PRESENTED, media, sessionID, 1);
+}
+
+
+void MetricsRecorder::displayDroppedFrame(uint32_t sessionID, StatsMedia media)
+{
+  metrics_->record(METRIC_DISPLAY_DROPPED, media, sessionID, 1);
+}
+
+
+void MetricsRecorder::addEncodedPacket(StatsMedia media, uint32_t size)
+{
+  metrics_->record(METRIC_ENCODED_BYTES, media, 0, size);
+}
+
+
+void MetricsRecorder::decoderSkippedFrame(uint32_t sessionID, StatsMedia media)
+{
+  metrics_->record(METRIC_DECODER_SKIPPED, media, sessionID, 1);
+}
+
+
+void MetricsRecorder::decoderQueueLatency(uint32_t sessionID, StatsMedia media, uint32_t latency)
+{
+  metrics_->record(METRIC_DECODER_QUEUE_LATENCY, media, sessionID, latency);
+}
+
+
+void MetricsRecorder::audioBufferStatus(uint32_t sessionID, uint32_t depthMs, uint32_t targetMs)
+{
+  metrics_->record(METRIC_AUDIO_BUFFER_DEPTH, STATS_AUDIO, sessionID, depthMs);
+  metrics_->record(METRIC_AUDIO_BUFFER_TARGET, STATS_AUDIO, sessionID, targetMs);
+}
+
+
+void MetricsRecorder::audioBufferEvent(uint32_t sessionID, AudioBufferEvent event)
+{
+  switch (event)
+  {
+    case AUDIO_BUFFER_EXPANDED:
+      metrics_->record(METRIC_AUDIO_EXPANDED, STATS_AUDIO, sessionID, 1);
+      break;
+    case AUDIO_BUFFER_COMPRESSED:
+      metrics_->record(METRIC_AUDIO_COMPRESSED, STATS_AUDIO, sessionID, 1);
+      break;
+    case AUDIO_BUFFER_CONCEALED:
+      metrics_->record(METRIC_AUDIO_CONCEALED, STATS_AUDIO, sessionID, 1);
+      break;
+  }
+}
+
+
+void MetricsRecorder::aecStatus(int32_t delayMs, int32_t driftPpm, float erleDb)
+{
+  metrics_->record(METRIC_AEC_DELAY, STATS_AUDIO, 0, delayMs);
+  metrics_->record(METRIC_AEC_DRIFT, STATS_AUDIO, 0, driftPpm);
+  metrics_->record(METRIC_AEC_ERLE, STATS_AUDIO, 0, int32_t(std::lround(erleDb)));
+}
+
+
+void MetricsRecorder::addSendPacket(uint32_t size)
+{
+  metrics_->record(METRIC_SENT_BYTES, STATS_NO_MEDIA, 0, size);
+}
+
+
+void MetricsRecorder::addReceivePacket(uint32_t sessionID, StatsMedia media, uint32_t size)
+{
+  // the session and the total of all sessions
+  metrics_->record(METRIC_RECEIVED_BYTES, media, sessionID, size);
+  metrics_->record(METRIC_RECEIVED_BYTES, STATS_NO_MEDIA, 0, size);
+}
+
+
+void MetricsRecorder::addRTCPPacket(uint32_t sessionID, StatsMedia media,
+                                    uint8_t  fraction,
+                                    int32_t  lost,
+                                    uint32_t last_seq,
+                                    uint32_t jitter)
+{
+  Q_UNUSED(last_seq)
+
+  metrics_->record(METRIC_RTCP_FRACTION_LOST, media, sessionID, fraction);
+  metrics_->record(METRIC_RTCP_LOST, media, sessionID, lost);
+  metrics_->record(METRIC_RTCP_JITTER, media, sessionID, jitter);
+}
+
+
+uint32_t MetricsRecorder::addFilter(QString type, QString identifier, uint64_t TID)
+{
+  // 0 is the total of all filters
+  uint32_t id = nextFilterID_.fetch_add(1);
+  if (id == 0)
+  {
+    id = nextFilterID_.fetch_add(1);
+  }
+
+  filterAdded(id, type, identifier, TID);
+  return id;
+}
+
+
+void MetricsRecorder::removeFilter(uint32_t id)
+{
+  filterRemoved(id);
+  metrics_->removeFilter(id);
+}
+
+
+void MetricsRecorder::updateBufferStatus(uint32_t id, uint16_t buffersize,
+                                         uint16_t maxBufferSize)
+{
+  metrics_->record(METRIC_FILTER_BUFFER, STATS_NO_MEDIA, id, buffersize);
+  metrics_->record(METRIC_FILTER_BUFFER_SIZE, STATS_NO_MEDIA, id, maxBufferSize);
+}
+
+
+void MetricsRecorder::packetDropped(uint32_t id)
+{
+  // the filter and the total of all filters
+  metrics_->record(METRIC_FILTER_DROPPED, STATS_NO_MEDIA, id, 1);
+  metrics_->record(METRIC_FILTER_DROPPED, STATS_NO_MEDIA, 0, 1);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "statisticsinterface.h"
+
+#include <atomic>
+#include <memory>
+
+// Records the media, delivery and filter statistics to a MetricsCollector so
+// that the statistics views only have to present the values. Views given the
+// same collector share the recorded values and the aggregation thread. Filters
+// are numbered here so that their values can be found with the same IDs.
+
+class MetricsRecorder : public StatisticsInterface
+{
+public:
+  // creates its own collector if none is given
+  MetricsRecorder(std::shared_ptr<MetricsCollector> metrics = nullptr);
+  virtual ~MetricsRecorder();
+
+  std::shared_ptr<MetricsCollector> getCollector() const
+  {
+    return metrics_;
+  }
+
+  virtual void encodingDelay(StatsMedia media, uint32_t delay);
+  virtual void decodingDelay(StatsMedia media, uint32_t delay);
+  virtual void totalDelay(uint32_t sessionID, StatsMedia media, int32_t delay);
+  virtual void presentPackage(uint32_t sessionID, StatsMedia media);
+  virtual void displayDroppedFrame(uint32_t sessionID, StatsMedia media);
+  virtual void addEncodedPacket(StatsMedia media, uint32_t size);
+  virtual void decoderSkippedFrame(uint32_t sessionID, StatsMedia media);
+  virtual void decoderQueueLatency(uint32_t sessionID, StatsMedia media, uint32_t latency);
+  virtual void audioBufferStatus(uint32_t sessionID, uint32_t depthMs, uint32_t targetMs);
+  virtual void audioBufferEvent(uint32_t sessionID, AudioBufferEvent event);
+  virtual void aecStatus(int32_t delayMs, int32_t driftPpm, float erleDb);
+
+  virtual void addSendPacket(uint32_t size);
+  virtual void addReceivePacket(uint32_t sessionID, StatsMedia media, uint32_t size);
+  virtual void addRTCPPacket(uint32_t sessionID, StatsMedia media,
+                             uint8_t  fraction,
+                             int32_t  lost,
+                             uint32_t last_seq,
+                             uint32_t jitter);
+
+  virtual uint32_t addFilter(QString type, QString identifier, uint64_t TID);
+  virtual void removeFilter(uint32_t id);
+  virtual void updateBufferStatus(uint32_t id, uint16_t buffersize,
+                                  uint16_t maxBufferSize);
+  virtual void packetDropped(uint32_t id);
+
+  // Tell the view about the filters numbered by this or another recorder
+  // sharing the collector. The values of the filter are recorded with the id.
+  virtual void filterAdded(uint32_t id, QString type, QString identifier, uint64_t TID) = 0;
+  virtual void filterRemoved(uint32_t id) = 0;
+
+protected:
+
+  std::shared_ptr<MetricsCollector> metrics_;
+
+private:
+
+  std::atomic<uint32_t> nextFilterID_;
+};
@@ -76,6 +76,7 @@ const QString audioDevice = "audio/Device";
 const QString audioBitrate = "audio/bitrate";
 const QString audioComplexity = "audio/complexity";
 const QString audioSignalType = "audio/signalType";
+const QString audioFrameDuration = "audio/frameDuration"; // ms, offered as SDP ptime
 // const QString audioChannels = "audio/channels";
 
 
@@ -132,4 +133,10 @@ const QString roiKernelType = "roi/KernelType";
 const QString roiMaxThreads = "roi/Threads";
 const QString roiEnabled = "roi/Enabled";
 const QString roiMode = "roi/Mode";
+
+// Statistics export setting keys, exporting is off when these are not set
+const QString statsExportFile = "stats/exportFile";
+const QString statsExportPeriod = "stats/exportPeriod";
+const QString statsPrometheusPort = "stats/prometheusPort";
+const QString statsPrometheusSocket = "stats/prometheusSocket";
 }
@@ -0,0 +1,683 @@
+#include "statisticsexporter.h"
+
+#include "icetypes.h"
+#include "logger.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <cmath>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// rates and averages of Prometheus text when there is no JSON period
+const int DEFAULT_WINDOW_MS = 5000;
+
+// nobody sends us long requests, they only want the metrics
+const int MAX_REQUEST_SIZE = 8192;
+
+namespace
+{
+enum ValueType {VALUE_SUM, VALUE_COUNT, VALUE_AVERAGE, VALUE_LAST};
+
+struct PrometheusMetric
+{
+  MetricID metric;
+  ValueType value;
+  QString name;
+  QString type;
+  QString help;
+};
+
+// per session and media
+const std::vector<PrometheusMetric> SESSION_METRICS = {
+  {METRIC_RECEIVED_BYTES,        VALUE_SUM,     "uvgcomm_received_bytes_total",
+   "counter", "Media bytes received"},
+  {METRIC_PRESENTED,             VALUE_COUNT,   "uvgcomm_presented_frames_total",
+   "counter", "Frames presented to the user"},
+  {METRIC_DISPLAY_DROPPED,       VALUE_COUNT,   "uvgcomm_display_dropped_frames_total",
+   "counter", "Frames dropped before display"},
+  {METRIC_DECODER_SKIPPED,       VALUE_COUNT,   "uvgcomm_decoder_skipped_frames_total",
+   "counter", "Frames skipped by the decoder"},
+  {METRIC_TOTAL_DELAY,           VALUE_AVERAGE, "uvgcomm_total_delay_ms",
+   "gauge", "Average delay from capture to presentation"},
+  {METRIC_DECODER_QUEUE_LATENCY, VALUE_AVERAGE, "uvgcomm_decoder_queue_latency_ms",
+   "gauge", "Average time frames waited for the decoder"},
+  {METRIC_RTCP_FRACTION_LOST,    VALUE_LAST,    "uvgcomm_rtcp_fraction_lost",
+   "gauge", "Fraction lost of the latest RTCP report, in 1/256"},
+  {METRIC_RTCP_LOST,             VALUE_LAST,    "uvgcomm_rtcp_lost_packets",
+   "gauge", "Cumulative packets lost of the latest RTCP report"},
+  {METRIC_RTCP_JITTER,           VALUE_LAST,    "uvgcomm_rtcp_jitter",
+   "gauge", "Interarrival jitter of the latest RTCP report, in timestamp units"}
+};
+
+// per media of the local media
+const std::vector<PrometheusMetric> LOCAL_METRICS = {
+  {METRIC_ENCODED_BYTES,  VALUE_SUM,     "uvgcomm_encoded_bytes_total",
+   "counter", "Bytes output by the encoder"},
+  {METRIC_ENCODING_DELAY, VALUE_AVERAGE, "uvgcomm_encoding_delay_ms",
+   "gauge", "Average encoding delay"},
+  {METRIC_DECODING_DELAY, VALUE_AVERAGE, "uvgcomm_decoding_delay_ms",
+   "gauge", "Average decoding delay"}
+};
+
+// per session of the audio output, the mixed output is session 0
+const std::vector<PrometheusMetric> AUDIO_BUFFER_METRICS = {
+  {METRIC_AUDIO_BUFFER_DEPTH,  VALUE_AVERAGE, "uvgcomm_audio_buffer_depth_ms",
+   "gauge", "Average depth of the audio jitter buffer"},
+  {METRIC_AUDIO_BUFFER_TARGET, VALUE_LAST,    "uvgcomm_audio_buffer_target_ms",
+   "gauge", "Depth the audio jitter buffer aims for"},
+  {METRIC_AUDIO_EXPANDED,      VALUE_COUNT,   "uvgcomm_audio_expanded_frames_total",
+   "counter", "Audio frames stretched to grow the jitter buffer"},
+  {METRIC_AUDIO_COMPRESSED,    VALUE_COUNT,   "uvgcomm_audio_compressed_frames_total",
+   "counter", "Audio frames shortened to shrink the jitter buffer"},
+  {METRIC_AUDIO_CONCEALED,     VALUE_COUNT,   "uvgcomm_audio_concealed_frames_total",
+   "counter", "Audio frames concealed because nothing arrived in time"}
+};
+
+// of the local echo canceller
+const std::vector<PrometheusMetric> AEC_METRICS = {
+  {METRIC_AEC_DELAY, VALUE_LAST, "uvgcomm_aec_delay_ms",
+   "gauge", "Estimated delay of the echo from the playback to the capture"},
+  {METRIC_AEC_DRIFT, VALUE_LAST, "uvgcomm_aec_drift_ppm",
+   "gauge", "Clock drift between the playback and the capture"},
+  {METRIC_AEC_ERLE,  VALUE_LAST, "uvgcomm_aec_erle_db",
+   "gauge", "Echo return loss enhancement of the echo canceller"}
+};
+
+// per filter
+const std::vector<PrometheusMetric> FILTER_METRICS = {
+  {METRIC_FILTER_BUFFER,      VALUE_LAST,  "uvgcomm_filter_buffer",
+   "gauge", "Inputs waiting in the filter buffer"},
+  {METRIC_FILTER_BUFFER_SIZE, VALUE_LAST,  "uvgcomm_filter_buffer_size",
+   "gauge", "Maximum size of the filter buffer"},
+  {METRIC_FILTER_DROPPED,     VALUE_COUNT, "uvgcomm_filter_dropped_total",
+   "counter", "Inputs dropped because the filter buffer was full"}
+};
+
+const std::vector<std::pair<StatsMedia, QString>> MEDIAS = {
+  {STATS_VIDEO, "video"}, {STATS_AUDIO, "audio"}
+};
+
+
+QString labelValue(QString value)
+{
+  return value.replace("\\", "\\\\").replace("\"", "\\\"").replace("\n", "\\n");
+}
+
+
+void addHeader(QString& text, const QString& name, const QString& type, const QString& help)
+{
+  text += "# HELP " + name + " " + help + "\n";
+  text += "# TYPE " + name + " " + type + "\n";
+}
+
+
+void addSample(QString& text, const QString& name, const QString& labels, double value)
+{
+  text += name;
+  if (!labels.isEmpty())
+  {
+    text += "{" + labels + "}";
+  }
+  text += " " + QString::number(value, 'g', 15) + "\n";
+}
+}
+
+
+StatisticsExporter::StatisticsExporter(std::shared_ptr<MetricsCollector> metrics):
+  MetricsRecorder(metrics),
+  windowMs_(DEFAULT_WINDOW_MS),
+  infoMutex_(),
+  sessions_(),
+  filters_(),
+  framerate_(0),
+  resolution_(),
+  sampleRate_(0),
+  channelCount_(0),
+  sentSIPMessages_(0),
+  receivedSIPMessages_(0),
+  filename_(""),
+  exportTimer_(),
+  tcpServer_(nullptr),
+  localServer_(nullptr)
+{
+  QObject::connect(&exportTimer_, &QTimer::timeout,
+                   this, &StatisticsExporter::writeJSONLine);
+}
+
+
+StatisticsExporter::~StatisticsExporter()
+{
+  exportTimer_.stop();
+}
+
+
+bool StatisticsExporter::startJSONLines(QString filename, int periodMs)
+{
+  QFile file(filename);
+  if (periodMs <= 0 || !file.open(QIODevice::Append | QIODevice::Text))
+  {
+    Logger::getLogger()->printError(this, "Could not start exporting statistics to file",
+                                    "File", filename);
+    return false;
+  }
+  file.close();
+
+  Logger::getLogger()->printNormal(this, "Exporting statistics as JSON lines",
+                                   "File", filename);
+
+  filename_ = filename;
+  windowMs_ = periodMs;
+  exportTimer_.start(periodMs);
+  return true;
+}
+
+
+bool StatisticsExporter::listenTCP(uint16_t port)
+{
+  tcpServer_ = std::make_unique<QTcpServer>();
+  if (!tcpServer_->listen(QHostAddress::LocalHost, port))
+  {
+    Logger::getLogger()->printError(this, "Could not listen for statistics scraping",
+                                    "Error", tcpServer_->errorString());
+    tcpServer_ = nullptr;
+    return false;
+  }
+
+  QObject::connect(tcpServer_.get(), &QTcpServer::newConnection,
+                   this, &StatisticsExporter::newTCPConnection);
+
+  Logger::getLogger()->printNormal(this, "Serving statistics in Prometheus format",
+                                   "Port", QString::number(port));
+  return true;
+}
+
+
+bool StatisticsExporter::listenLocal(QString name)
+{
+  // remove the socket of a previous run that did not exit cleanly
+  QLocalServer::removeServer(name);
+
+  localServer_ = std::make_unique<QLocalServer>();
+  if (!localServer_->listen(name))
+  {
+    Logger::getLogger()->printError(this, "Could not listen for statistics scraping",
+                                    "Error", localServer_->errorString());
+    localServer_ = nullptr;
+    return false;
+  }
+
+  QObject::connect(localServer_.get(), &QLocalServer::newConnection,
+                   this, &StatisticsExporter::newLocalConnection);
+
+  Logger::getLogger()->printNormal(this, "Serving statistics in Prometheus format",
+                                   "Socket", localServer_->fullServerName());
+  return true;
+}
+
+
+void StatisticsExporter::newTCPConnection()
+{
+  while (tcpServer_->hasPendingConnections())
+  {
+    QTcpSocket* socket = tcpServer_->nextPendingConnection();
+    QObject::connect(socket, &QTcpSocket::readyRead,
+                     this, [this, socket](){ serveMetrics(socket); });
+    QObject::connect(socket, &QTcpSocket::disconnected,
+                     socket, &QTcpSocket::deleteLater);
+  }
+}
+
+
+void StatisticsExporter::newLocalConnection()
+{
+  while (localServer_->hasPendingConnections())
+  {
+    QLocalSocket* socket = localServer_->nextPendingConnection();
+    QObject::connect(socket, &QLocalSocket::readyRead,
+                     this, [this, socket](){ serveMetrics(socket); });
+    QObject::connect(socket, &QLocalSocket::disconnected,
+                     socket, &QLocalSocket::deleteLater);
+  }
+}
+
+
+void StatisticsExporter::serveMetrics(QIODevice* connection)
+{
+  // the request may arrive in pieces
+  QByteArray request = connection->property("request").toByteArray() + connection->readAll();
+  if (!request.contains("\r\n\r\n") && !request.contains("\n\n"))
+  {
+    if (request.size() > MAX_REQUEST_SIZE)
+    {
+      connection->close();
+    }
+    else
+    {
+      connection->setProperty("request", request);
+    }
+    return;
+  }
+
+  QByteArray body = prometheusText().toUtf8();
+  QByteArray response = "HTTP/1.0 200 OK\r\n"
+                        "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                        "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                        "Connection: close\r\n\r\n";
+  connection->write(response + body);
+
+  // the disconnects wait until the response has been written
+  if (QTcpSocket* socket = qobject_cast<QTcpSocket*>(connection))
+  {
+    socket->disconnectFromHost();
+  }
+  else if (QLocalSocket* socket = qobject_cast<QLocalSocket*>(connection))
+  {
+    socket->disconnectFromServer();
+  }
+}
+
+
+void StatisticsExporter::writeJSONLine()
+{
+  QFile file(filename_);
+  if (!file.open(QIODevice::Append | QIODevice::Text))
+  {
+    Logger::getLogger()->printWarning(this, "Could not open statistics file",
+                                      "File", filename_);
+    return;
+  }
+
+  file.write(QJsonDocument(snapshot()).toJson(QJsonDocument::Compact) + "\n");
+}
+
+
+QJsonObject StatisticsExporter::snapshot()
+{
+  metrics_->aggregate();
+
+  infoMutex_.lock();
+  std::map<uint32_t, SessionInfo> sessions = sessions_;
+  std::map<uint32_t, FilterInfo> filters = filters_;
+
+  QJsonObject video{{"framerate", framerate_},
+                    {"width", resolution_.width()},
+                    {"height", resolution_.height()}};
+  QJsonObject audio{{"sample_rate", (qint64)sampleRate_},
+                    {"channels", channelCount_}};
+  QJsonObject sip{{"sent", (qint64)sentSIPMessages_},
+                  {"received", (qint64)receivedSIPMessages_}};
+  infoMutex_.unlock();
+
+  for (auto& local : {std::make_pair(STATS_VIDEO, &video),
+                      std::make_pair(STATS_AUDIO, &audio)})
+  {
+    QJsonObject& object = *local.second;
+    object["encoded_bytes"] = (qint64)metrics_->get(METRIC_ENCODED_BYTES, local.first, 0, 0).sum;
+    object["encoding_bitrate"] = rate(METRIC_ENCODED_BYTES, local.first, 0)*8;
+    object["encoding_delay_ms"] = average(METRIC_ENCODING_DELAY, local.first, 0);
+    object["decoding_delay_ms"] = average(METRIC_DECODING_DELAY, local.first, 0);
+  }
+  audio["buffer"] = audioBufferSnapshot(0);
+  audio["aec"] = QJsonObject{
+    {"delay_ms", metrics_->get(METRIC_AEC_DELAY, STATS_AUDIO, 0, 0).last},
+    {"drift_ppm", metrics_->get(METRIC_AEC_DRIFT, STATS_AUDIO, 0, 0).last},
+    {"erle_db", metrics_->get(METRIC_AEC_ERLE, STATS_AUDIO, 0, 0).last}};
+
+  QJsonArray sessionArray;
+  for (auto& session : sessions)
+  {
+    sessionArray.append(QJsonObject{{"id", (qint64)session.first},
+                                    {"incoming", session.second.incoming},
+                                    {"outgoing", session.second.outgoing},
+                                    {"local_candidate", session.second.localCandidate},
+                                    {"remote_candidate", session.second.remoteCandidate},
+                                    {"video", mediaSnapshot(STATS_VIDEO, session.first)},
+                                    {"audio", mediaSnapshot(STATS_AUDIO, session.first)},
+                                    {"audio_buffer", audioBufferSnapshot(session.first)}});
+  }
+
+  QJsonArray filterArray;
+  for (auto& filter : filters)
+  {
+    filterArray.append(QJsonObject{
+      {"id", (qint64)filter.first},
+      {"type", filter.second.type},
+      {"identifier", filter.second.identifier},
+      {"tid", QString::number(filter.second.TID)},
+      {"buffer", metrics_->get(METRIC_FILTER_BUFFER, STATS_NO_MEDIA, filter.first, 0).last},
+      {"buffer_size", metrics_->get(METRIC_FILTER_BUFFER_SIZE, STATS_NO_MEDIA, filter.first, 0).last},
+      {"dropped", (qint64)metrics_->get(METRIC_FILTER_DROPPED, STATS_NO_MEDIA, filter.first, 0).count}});
+  }
+
+  MetricValues sent = metrics_->get(METRIC_SENT_BYTES, STATS_NO_MEDIA, 0, windowMs_);
+  MetricValues received = metrics_->get(METRIC_RECEIVED_BYTES, STATS_NO_MEDIA, 0, windowMs_);
+
+  return QJsonObject{{"time", QDateTime::currentMSecsSinceEpoch()},
+                     {"cpu_seconds", processCPUSeconds()},
+                     {"sent_bytes", (qint64)sent.sum},
+                     {"sent_bitrate", rate(METRIC_SENT_BYTES, STATS_NO_MEDIA, 0)*8},
+                     {"received_bytes", (qint64)received.sum},
+                     {"received_bitrate", rate(METRIC_RECEIVED_BYTES, STATS_NO_MEDIA, 0)*8},
+                     {"filter_dropped", (qint64)metrics_->get(METRIC_FILTER_DROPPED,
+                                                              STATS_NO_MEDIA, 0, 0).count},
+                     {"lost_values", (qint64)metrics_->lostValues()},
+                     {"video", video},
+                     {"audio", audio},
+                     {"sip", sip},
+                     {"sessions", sessionArray},
+                     {"filters", filterArray}};
+}
+
+
+QJsonObject StatisticsExporter::mediaSnapshot(StatsMedia media, uint32_t sessionID)
+{
+  return QJsonObject{
+    {"received_bytes", (qint64)metrics_->get(METRIC_RECEIVED_BYTES, media, sessionID, 0).sum},
+    {"bitrate", rate(METRIC_RECEIVED_BYTES, media, sessionID)*8},
+    {"framerate", rate(METRIC_PRESENTED, media, sessionID)},
+    {"presented", (qint64)metrics_->get(METRIC_PRESENTED, media, sessionID, 0).count},
+    {"display_dropped", (qint64)metrics_->get(METRIC_DISPLAY_DROPPED, media, sessionID, 0).count},
+    {"decoder_skipped", (qint64)metrics_->get(METRIC_DECODER_SKIPPED, media, sessionID, 0).count},
+    {"total_delay_ms", average(METRIC_TOTAL_DELAY, media, sessionID)},
+    {"decoder_queue_latency_ms", average(METRIC_DECODER_QUEUE_LATENCY, media, sessionID)},
+    {"rtcp_fraction_lost", metrics_->get(METRIC_RTCP_FRACTION_LOST, media, sessionID, 0).last},
+    {"rtcp_lost", metrics_->get(METRIC_RTCP_LOST, media, sessionID, 0).last},
+    {"rtcp_jitter", metrics_->get(METRIC_RTCP_JITTER, media, sessionID, 0).last}};
+}
+
+
+QJsonObject StatisticsExporter::audioBufferSnapshot(uint32_t sessionID)
+{
+  return QJsonObject{
+    {"depth_ms", average(METRIC_AUDIO_BUFFER_DEPTH, STATS_AUDIO, sessionID)},
+    {"target_ms", metrics_->get(METRIC_AUDIO_BUFFER_TARGET, STATS_AUDIO, sessionID, 0).last},
+    {"expanded", (qint64)metrics_->get(METRIC_AUDIO_EXPANDED, STATS_AUDIO, sessionID, 0).count},
+    {"compressed", (qint64)metrics_->get(METRIC_AUDIO_COMPRESSED, STATS_AUDIO, sessionID, 0).count},
+    {"concealed", (qint64)metrics_->get(METRIC_AUDIO_CONCEALED, STATS_AUDIO, sessionID, 0).count}};
+}
+
+
+QString StatisticsExporter::prometheusText()
+{
+  metrics_->aggregate();
+
+  infoMutex_.lock();
+  std::map<uint32_t, SessionInfo> sessions = sessions_;
+  std::map<uint32_t, FilterInfo> filters = filters_;
+  infoMutex_.unlock();
+
+  auto value = [this](const PrometheusMetric& metric, StatsMedia media, uint32_t source)
+  {
+    if (metric.value == VALUE_AVERAGE)
+    {
+      return average(metric.metric, media, source);
+    }
+
+    MetricValues values = metrics_->get(metric.metric, media, source, 0);
+    switch (metric.value)
+    {
+      case VALUE_SUM:
+        return (double)values.sum;
+      case VALUE_COUNT:
+        return (double)values.count;
+      default:
+        return (double)values.last;
+    }
+  };
+
+  QString text;
+
+  for (auto& metric : SESSION_METRICS)
+  {
+    addHeader(text, metric.name, metric.type, metric.help);
+    for (auto& session : sessions)
+    {
+      for (auto& media : MEDIAS)
+      {
+        addSample(text, metric.name, "session=\"" + QString::number(session.first) +
+                  "\",name=\"" + labelValue(session.second.incoming) +
+                  "\",media=\"" + media.second + "\"",
+                  value(metric, media.first, session.first));
+      }
+    }
+  }
+
+  for (auto& metric : LOCAL_METRICS)
+  {
+    addHeader(text, metric.name, metric.type, metric.help);
+    for (auto& media : MEDIAS)
+    {
+      addSample(text, metric.name, "media=\"" + media.second + "\"",
+                value(metric, media.first, 0));
+    }
+  }
+
+  for (auto& metric : AUDIO_BUFFER_METRICS)
+  {
+    addHeader(text, metric.name, metric.type, metric.help);
+    addSample(text, metric.name, "session=\"0\"", value(metric, STATS_AUDIO, 0));
+    for (auto& session : sessions)
+    {
+      addSample(text, metric.name, "session=\"" + QString::number(session.first) + "\"",
+                value(metric, STATS_AUDIO, session.first));
+    }
+  }
+
+  for (auto& metric : AEC_METRICS)
+  {
+    addHeader(text, metric.name, metric.type, metric.help);
+    addSample(text, metric.name, "", value(metric, STATS_AUDIO, 0));
+  }
+
+  for (auto& metric : FILTER_METRICS)
+  {
+    addHeader(text, metric.name, metric.type, metric.help);
+    for (auto& filter : filters)
+    {
+      addSample(text, metric.name, "id=\"" + QString::number(filter.first) +
+                "\",filter=\"" + labelValue(filter.second.type) +
+                "\",identifier=\"" + labelValue(filter.second.identifier) + "\"",
+                value(metric, STATS_NO_MEDIA, filter.first));
+    }
+  }
+
+  addHeader(text, "uvgcomm_sent_bytes_total", "counter", "Media bytes sent");
+  addSample(text, "uvgcomm_sent_bytes_total", "",
+            metrics_->get(METRIC_SENT_BYTES, STATS_NO_MEDIA, 0, 0).sum);
+
+  addHeader(text, "uvgcomm_sessions", "gauge", "Ongoing media sessions");
+  addSample(text, "uvgcomm_sessions", "", sessions.size());
+
+  infoMutex_.lock();
+  uint64_t sentSIP = sentSIPMessages_;
+  uint64_t receivedSIP = receivedSIPMessages_;
+  infoMutex_.unlock();
+
+  addHeader(text, "uvgcomm_sip_messages_total", "counter", "SIP messages");
+  addSample(text, "uvgcomm_sip_messages_total", "direction=\"sent\"", sentSIP);
+  addSample(text, "uvgcomm_sip_messages_total", "direction=\"received\"", receivedSIP);
+
+  addHeader(text, "uvgcomm_lost_statistics_total", "counter",
+            "Statistics values lost because they could not be aggregated in time");
+  addSample(text, "uvgcomm_lost_statistics_total", "", metrics_->lostValues());
+
+  addHeader(text, "process_cpu_seconds_total", "counter",
+            "Total user and system CPU time spent in seconds");
+  addSample(text, "process_cpu_seconds_total", "", processCPUSeconds());
+
+  return text;
+}
+
+
+double StatisticsExporter::average(MetricID metric, StatsMedia media, uint32_t source)
+{
+  MetricValues values = metrics_->get(metric, media, source, windowMs_);
+  if (values.windowCount == 0)
+  {
+    return 0;
+  }
+  return (double)values.windowSum/values.windowCount;
+}
+
+
+double StatisticsExporter::rate(MetricID metric, StatsMedia media, uint32_t source)
+{
+  MetricValues values = metrics_->get(metric, media, source, windowMs_);
+
+  // presented frames have value one so the sum is also the count
+  return (double)values.windowSum*1000/windowMs_;
+}
+
+
+double StatisticsExporter::processCPUSeconds()
+{
+#ifdef _WIN32
+  FILETIME creation, exitTime, kernel, user;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exitTime, &kernel, &user))
+  {
+    return 0;
+  }
+
+  // in 100 ns units
+  uint64_t kernelTime = (uint64_t)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime;
+  uint64_t userTime = (uint64_t)user.dwHighDateTime << 32 | user.dwLowDateTime;
+  return (kernelTime + userTime)/10000000.0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+  {
+    return 0;
+  }
+
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+      (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec)/1000000.0;
+#endif
+}
+
+
+void StatisticsExporter::addSession(uint32_t sessionID)
+{
+  infoMutex_.lock();
+  sessions_[sessionID] = SessionInfo{"", "", "", ""};
+  infoMutex_.unlock();
+}
+
+
+void StatisticsExporter::removeSession(uint32_t sessionID)
+{
+  infoMutex_.lock();
+  sessions_.erase(sessionID);
+  infoMutex_.unlock();
+
+  metrics_->removeSession(sessionID);
+}
+
+
+void StatisticsExporter::videoInfo(double framerate, QSize resolution)
+{
+  infoMutex_.lock();
+  framerate_ = framerate;
+  resolution_ = resolution;
+  infoMutex_.unlock();
+}
+
+
+void StatisticsExporter::audioInfo(uint32_t sampleRate, uint16_t channelCount)
+{
+  infoMutex_.lock();
+  sampleRate_ = sampleRate;
+  channelCount_ = channelCount;
+  infoMutex_.unlock();
+}
+
+
+void StatisticsExporter::incomingMedia(uint32_t sessionID, QString name)
+{
+  infoMutex_.lock();
+  if (sessions_.find(sessionID) != sessions_.end())
+  {
+    sessions_[sessionID].incoming = name;
+  }
+  infoMutex_.unlock();
+}
+
+
+void StatisticsExporter::outgoingMedia(uint32_t sessionID, QString name)
+{
+  infoMutex_.lock();
+  if (sessions_.find(sessionID) != sessions_.end())
+  {
+    sessions_[sessionID].outgoing = name;
+  }
+  infoMutex_.unlock();
+}
+
+
+void StatisticsExporter::selectedICEPair(uint32_t sessionID, std::shared_ptr<ICEPair> pair)
+{
+  infoMutex_.lock();
+  if (sessions_.find(sessionID) != sessions_.end() && pair->local && pair->remote)
+  {
+    sessions_[sessionID].localCandidate = pair->local->type + " " + pair->local->address +
+        ":" + QString::number(pair->local->port);
+    sessions_[sessionID].remoteCandidate = pair->remote->type + " " + pair->remote->address +
+        ":" + QString::number(pair->remote->port);
+  }
+  infoMutex_.unlock();
+}
+
+
+void StatisticsExporter::filterAdded(uint32_t id, QString type, QString identifier, uint64_t TID)
+{
+  infoMutex_.lock();
+  filters_[id] = FilterInfo{type, identifier, TID};
+  infoMutex_.unlock();
+}
+
+
+void StatisticsExporter::filterRemoved(uint32_t id)
+{
+  infoMutex_.lock();
+  filters_.erase(id);
+  infoMutex_.unlock();
+}
+
+
+void StatisticsExporter::addSentSIPMessage(const QString& headerType, const QString& header,
+                                           const QString& bodyType, const QString& body)
+{
+  Q_UNUSED(headerType)
+  Q_UNUSED(header)
+  Q_UNUSED(bodyType)
+  Q_UNUSED(body)
+
+  infoMutex_.lock();
+  ++sentSIPMessages_;
+  infoMutex_.unlock();
+}
+
+
+void StatisticsExporter::addReceivedSIPMessage(const QString& headerType, const QString& header,
+                                               const QString& bodyType, const QString& body)
+{
+  Q_UNUSED(headerType)
+  Q_UNUSED(header)
+  Q_UNUSED(bodyType)
+  Q_UNUSED(body)
+
+  infoMutex_.lock();
+  ++receivedSIPMessages_;
+  infoMutex_.unlock();
+}
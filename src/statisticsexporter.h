@@ -0,0 +1,114 @@
+#pragma once
+
+#include "metricsrecorder.h"
+
+#include <QObject>
+#include <QMutex>
+#include <QTimer>
+#include <QJsonObject>
+
+#include <map>
+#include <memory>
+
+// Statistics for nodes without anyone watching the statistics window. The
+// statistics are periodically appended to a file as JSON lines and can be
+// scraped in Prometheus text format from a local TCP port or a local socket.
+// Use StatisticsFanOut to have both this and the window active, they then
+// share one collector.
+
+class QTcpServer;
+class QLocalServer;
+class QIODevice;
+
+class StatisticsExporter : public QObject, public MetricsRecorder
+{
+  Q_OBJECT
+public:
+  StatisticsExporter(std::shared_ptr<MetricsCollector> metrics = nullptr);
+  ~StatisticsExporter();
+
+  // appends a snapshot to the file every period. Rates and averages are
+  // calculated over the period.
+  bool startJSONLines(QString filename, int periodMs);
+
+  // serves the Prometheus text to connections from this machine
+  bool listenTCP(uint16_t port);
+  bool listenLocal(QString name);
+
+  QJsonObject snapshot();
+  QString prometheusText();
+
+  virtual void addSession(uint32_t sessionID);
+  virtual void removeSession(uint32_t sessionID);
+
+  virtual void videoInfo(double framerate, QSize resolution);
+  virtual void audioInfo(uint32_t sampleRate, uint16_t channelCount);
+  virtual void incomingMedia(uint32_t sessionID, QString name);
+  virtual void outgoingMedia(uint32_t sessionID, QString name);
+
+  virtual void selectedICEPair(uint32_t sessionID, std::shared_ptr<ICEPair> pair);
+
+  virtual void filterAdded(uint32_t id, QString type, QString identifier, uint64_t TID);
+  virtual void filterRemoved(uint32_t id);
+
+  virtual void addSentSIPMessage(const QString& headerType, const QString& header,
+                                 const QString& bodyType, const QString& body);
+  virtual void addReceivedSIPMessage(const QString& headerType, const QString& header,
+                                     const QString& bodyType, const QString& body);
+
+private slots:
+  void writeJSONLine();
+
+  void newTCPConnection();
+  void newLocalConnection();
+
+private:
+
+  struct SessionInfo
+  {
+    QString incoming;
+    QString outgoing;
+    QString localCandidate;
+    QString remoteCandidate;
+  };
+
+  struct FilterInfo
+  {
+    QString type;
+    QString identifier;
+    uint64_t TID;
+  };
+
+  // answers one HTTP request with the metrics and closes the connection
+  void serveMetrics(QIODevice* connection);
+
+  QJsonObject mediaSnapshot(StatsMedia media, uint32_t sessionID);
+  QJsonObject audioBufferSnapshot(uint32_t sessionID);
+
+  double average(MetricID metric, StatsMedia media, uint32_t source);
+  double rate(MetricID metric, StatsMedia media, uint32_t source);
+
+  // user and system time used by this process
+  static double processCPUSeconds();
+
+  // rates and averages are calculated over this many ms
+  int windowMs_;
+
+  QMutex infoMutex_;
+  std::map<uint32_t, SessionInfo> sessions_;
+  std::map<uint32_t, FilterInfo> filters_;
+
+  double framerate_;
+  QSize resolution_;
+  uint32_t sampleRate_;
+  uint16_t channelCount_;
+
+  uint64_t sentSIPMessages_;
+  uint64_t receivedSIPMessages_;
+
+  QString filename_;
+  QTimer exportTimer_;
+
+  std::unique_ptr<QTcpServer> tcpServer_;
+  std::unique_ptr<QLocalServer> localServer_;
+};
@@ -0,0 +1,115 @@
+#include "statisticsfanout.h"
+
+
+StatisticsFanOut::StatisticsFanOut(std::shared_ptr<MetricsCollector> metrics):
+  MetricsRecorder(metrics),
+  sinks_()
+{}
+
+
+void StatisticsFanOut::addSink(MetricsRecorder* sink)
+{
+  Q_ASSERT(sink && sink->getCollector() == metrics_);
+  sinks_.push_back(sink);
+}
+
+
+void StatisticsFanOut::addSession(uint32_t sessionID)
+{
+  for (auto& sink : sinks_)
+  {
+    sink->addSession(sessionID);
+  }
+}
+
+
+void StatisticsFanOut::removeSession(uint32_t sessionID)
+{
+  for (auto& sink : sinks_)
+  {
+    sink->removeSession(sessionID);
+  }
+}
+
+
+void StatisticsFanOut::videoInfo(double framerate, QSize resolution)
+{
+  for (auto& sink : sinks_)
+  {
+    sink->videoInfo(framerate, resolution);
+  }
+}
+
+
+void StatisticsFanOut::audioInfo(uint32_t sampleRate, uint16_t channelCount)
+{
+  for (auto& sink : sinks_)
+  {
+    sink->audioInfo(sampleRate, channelCount);
+  }
+}
+
+
+void StatisticsFanOut::incomingMedia(uint32_t sessionID, QString name)
+{
+  for (auto& sink : sinks_)
+  {
+    sink->incomingMedia(sessionID, name);
+  }
+}
+
+
+void StatisticsFanOut::outgoingMedia(uint32_t sessionID, QString name)
+{
+  for (auto& sink : sinks_)
+  {
+    sink->outgoingMedia(sessionID, name);
+  }
+}
+
+
+void StatisticsFanOut::selectedICEPair(uint32_t sessionID, std::shared_ptr<ICEPair> pair)
+{
+  for (auto& sink : sinks_)
+  {
+    sink->selectedICEPair(sessionID, pair);
+  }
+}
+
+
+void StatisticsFanOut::filterAdded(uint32_t id, QString type, QString identifier, uint64_t TID)
+{
+  for (auto& sink : sinks_)
+  {
+    sink->filterAdded(id, type, identifier, TID);
+  }
+}
+
+
+void StatisticsFanOut::filterRemoved(uint32_t id)
+{
+  for (auto& sink : sinks_)
+  {
+    sink->filterRemoved(id);
+  }
+}
+
+
+void StatisticsFanOut::addSentSIPMessage(const QString& headerType, const QString& header,
+                                         const QString& bodyType, const QString& body)
+{
+  for (auto& sink : sinks_)
+  {
+    sink->addSentSIPMessage(headerType, header, bodyType, body);
+  }
+}
+
+
+void StatisticsFanOut::addReceivedSIPMessage(const QString& headerType, const QString& header,
+                                             const QString& bodyType, const QString& body)
+{
+  for (auto& sink : sinks_)
+  {
+    sink->addReceivedSIPMessage(headerType, header, bodyType, body);
+  }
+}
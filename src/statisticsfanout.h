@@ -0,0 +1,42 @@
+#pragma once
+
+#include "metricsrecorder.h"
+
+#include <vector>
+
+// Passes the statistics to several views so for example the statistics
+// window and an exporter can both be active. The views share the collector
+// of this, so the values are recorded only once here and the views are only
+// told about the sessions, filters and messages they present.
+
+class StatisticsFanOut : public MetricsRecorder
+{
+public:
+  StatisticsFanOut(std::shared_ptr<MetricsCollector> metrics);
+
+  // Does not take ownership. The sink must use the collector of this. Add
+  // the sinks before giving this to others.
+  void addSink(MetricsRecorder* sink);
+
+  virtual void addSession(uint32_t sessionID);
+  virtual void removeSession(uint32_t sessionID);
+
+  virtual void videoInfo(double framerate, QSize resolution);
+  virtual void audioInfo(uint32_t sampleRate, uint16_t channelCount);
+  virtual void incomingMedia(uint32_t sessionID, QString name);
+  virtual void outgoingMedia(uint32_t sessionID, QString name);
+
+  virtual void selectedICEPair(uint32_t sessionID, std::shared_ptr<ICEPair> pair);
+
+  virtual void filterAdded(uint32_t id, QString type, QString identifier, uint64_t TID);
+  virtual void filterRemoved(uint32_t id);
+
+  virtual void addSentSIPMessage(const QString& headerType, const QString& header,
+                                 const QString& bodyType, const QString& body);
+  virtual void addReceivedSIPMessage(const QString& headerType, const QString& header,
+                                     const QString& bodyType, const QString& body);
+
+private:
+
+  std::vector<MetricsRecorder*> sinks_;
+};
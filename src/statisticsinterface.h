@@ -1,5 +1,7 @@
 #pragma once
 
+#include "metricscollector.h"
+
 #include <QString>
 #include <QSize>
 
@@ -10,11 +12,15 @@
 
 // An interface where the program tells various statistics of its operations.
 // Can be used to show the statistics in window or to record the statistics to a file.
+// The media functions are called for every packet or frame, so they should
+// only record the value and leave the processing for later.
 
 // TODO: improve the interface to add the participant details in pieces.
 
 struct ICEPair;
 
+enum AudioBufferEvent {AUDIO_BUFFER_EXPANDED, AUDIO_BUFFER_COMPRESSED, AUDIO_BUFFER_CONCEALED};
+
 class StatisticsInterface
 {
 public:
@@ -37,29 +43,49 @@ public:
   virtual void selectedICEPair(uint32_t sessionID, std::shared_ptr<ICEPair> pair) = 0;
 
   // the delay it takes from input to the point when input is encoded
-  virtual void encodingDelay(QString type, uint32_t delay) = 0;
+  virtual void encodingDelay(StatsMedia media, uint32_t delay) = 0;
 
   // the delay it takes from receiving the packet to the point when media presented
-  virtual void decodingDelay(QString type, uint32_t delay) = 0;
+  virtual void decodingDelay(StatsMedia media, uint32_t delay) = 0;
 
   // the delay until the presentation of the packet
-  virtual void totalDelay(uint32_t sessionID, QString type, int32_t delay) = 0;
+  virtual void totalDelay(uint32_t sessionID, StatsMedia media, int32_t delay) = 0;
 
   // one packet has been presented to user
-  virtual void presentPackage(uint32_t sessionID, QString type) = 0;
+  virtual void presentPackage(uint32_t sessionID, StatsMedia media) = 0;
+
+  // a decoded frame was never presented because a newer one replaced it
+  virtual void displayDroppedFrame(uint32_t sessionID, StatsMedia media) = 0;
 
   // For tracking of encoding bitrate and possibly other information.
-  virtual void addEncodedPacket(QString type, uint32_t size) = 0;
+  virtual void addEncodedPacket(StatsMedia media, uint32_t size) = 0;
+
+  // the decoder skipped a frame to catch up when overloaded
+  virtual void decoderSkippedFrame(uint32_t sessionID, StatsMedia media) = 0;
+
+  // how long the packet waited in queue before it was decoded
+  virtual void decoderQueueLatency(uint32_t sessionID, StatsMedia media, uint32_t latency) = 0;
+
+  // the depth of the audio jitter buffer and the depth it aims for after each
+  // output frame. The output plays the mix of all sessions, which is session 0.
+  virtual void audioBufferStatus(uint32_t sessionID, uint32_t depthMs, uint32_t targetMs) = 0;
+
+  // the jitter buffer stretched or concealed an output frame
+  virtual void audioBufferEvent(uint32_t sessionID, AudioBufferEvent event) = 0;
+
+  // The echo delay of the AEC reference, the clock drift between playback
+  // and capture and the echo return loss enhancement. Reported once a second.
+  virtual void aecStatus(int32_t delayMs, int32_t driftPpm, float erleDb) = 0;
 
   // DELIVERY
   // Tracking of sent packets
   virtual void addSendPacket(uint32_t size) = 0;
 
   // tracking of received packets.
-  virtual void addReceivePacket(uint32_t sessionID, QString type, uint32_t size) = 0;
+  virtual void addReceivePacket(uint32_t sessionID, StatsMedia media, uint32_t size) = 0;
 
   // Details of an individual packet that shows how well our data is getting delivered
-  virtual void addRTCPPacket(uint32_t sessionID, QString type,
+  virtual void addRTCPPacket(uint32_t sessionID, StatsMedia media,
                              uint8_t  fraction,
                              int32_t  lost,
                              uint32_t last_seq,
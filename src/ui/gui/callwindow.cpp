@@ -458,6 +458,22 @@ void CallWindow::removeParticipant(uint32_t sessionID)
 }
 
 
+void CallWindow::setActiveSpeaker(uint32_t sessionID)
+{
+  std::vector<LayoutID> speakerLayouts;
+
+  if (layoutIDs_.find(sessionID) != layoutIDs_.end())
+  {
+    for (auto& layoutID : layoutIDs_.at(sessionID))
+    {
+      speakerLayouts.push_back(layoutID.layoutID);
+    }
+  }
+
+  conference_.setActiveSpeaker(speakerLayouts);
+}
+
+
 void CallWindow::removeWithMessage(uint32_t sessionID, QString message,
                                    bool temporaryMessage)
 {
@@ -47,6 +47,9 @@ public:
   void removeWithMessage(uint32_t sessionID, QString message,
                          bool temporaryMessage);
 
+  // gives the video of the talking participant more room, 0 if nobody talks
+  void setActiveSpeaker(uint32_t sessionID);
+
 signals:
 
   void endCall();
@@ -13,6 +13,9 @@
 
 const uint32_t INITIAL_LAYOUT_ID = 1;
 
+// how many times the others the active speaker is stretched
+const int ACTIVE_SPEAKER_STRETCH = 2;
+
 ConferenceView::ConferenceView(QWidget *parent):
   nextLayoutID_(INITIAL_LAYOUT_ID),
   parent_(parent),
@@ -60,6 +63,30 @@ void ConferenceView::removeWidget(LayoutID layoutID)
 }
 
 
+void ConferenceView::setActiveSpeaker(const std::vector<LayoutID>& layoutIDs)
+{
+  for (int row = 0; row < layout_->rowCount(); ++row)
+  {
+    layout_->setRowStretch(row, 1);
+  }
+
+  for (int column = 0; column < layout_->columnCount(); ++column)
+  {
+    layout_->setColumnStretch(column, 1);
+  }
+
+  for (auto& layoutID : layoutIDs)
+  {
+    auto view = activeViews_.find(layoutID);
+    if (view != activeViews_.end() && view->second->state == VIEW_VIDEO)
+    {
+      layout_->setRowStretch(view->second->loc.row, ACTIVE_SPEAKER_STRETCH);
+      layout_->setColumnStretch(view->second->loc.column, ACTIVE_SPEAKER_STRETCH);
+    }
+  }
+}
+
+
 void ConferenceView::updateLayoutState(SessionViewState state,
                                         QWidget* widget,
                                         uint32_t layoutID,
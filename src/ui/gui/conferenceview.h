@@ -11,6 +11,7 @@
 
 #include <map>
 #include <deque>
+#include <vector>
 #include <stdint.h>
 #include <memory>
 
@@ -67,6 +68,9 @@ public:
 
   void removeWidget(LayoutID layoutID);
 
+  // the views of the active speaker get more room, empty if nobody speaks
+  void setActiveSpeaker(const std::vector<LayoutID>& layoutIDs);
+
   void close();
 
 signals:
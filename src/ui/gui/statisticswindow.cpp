@@ -10,8 +10,8 @@
 #include <QFileDialog>
 #include <QTextStream>
 
+#include <cmath>
 
-const int BUFFERSIZE = 65536;
 
 const int FPSPRECISION = 4;
 
@@ -26,37 +26,13 @@ enum TabType {
 
 StatisticsWindow::StatisticsWindow(QWidget *parent) :
 QDialog(parent),
-StatisticsInterface(),
+MetricsRecorder(),
   sessions_(),
   buffers_(),
-  nextFilterID_(1),
   ui_(new Ui::StatisticsWindow),
   sessionMutex_(),
   filterMutex_(),
   sipMutex_(),
-  deliveryMutex_(),
-  dirtyBuffers_(false),
-  videoIndex_(0), // ringbuffer index
-  videoPackets_(BUFFERSIZE,nullptr), // ringbuffer
-  audioIndex_(0), // ringbuffer index
-  audioPackets_(BUFFERSIZE,nullptr), // ringbuffer
-  inIndex_(0),
-  inBandWidth_(BUFFERSIZE,nullptr),
-  outIndex_(0),
-  outBandwidth_(BUFFERSIZE,nullptr),
-  sendPacketCount_(0),
-  transferredData_(0),
-  receivePacketCount_(0),
-  receivedData_(0),
-  packetsDropped_(0),
-  videoEncDelayIndex_(0),
-  videoEncDelay_(BUFFERSIZE,nullptr),
-  audioEncDelayIndex_(0),
-  audioEncDelay_(BUFFERSIZE,nullptr),
-  videoDecDelayIndex_(0),
-  videoDecDelay_(BUFFERSIZE,nullptr),
-  audioDecDelayIndex_(0),
-  audioDecDelay_(BUFFERSIZE,nullptr),
   guiTimer_(),
   guiUpdates_(0),
   lastTabIndex_(254) // an invalid value so we will update the tab immediately
@@ -184,14 +160,9 @@ void StatisticsWindow::addSession(uint32_t sessionID)
     return;
   }
 
-  sessions_[sessionID] = {0, std::vector<ValueInfo*>(BUFFERSIZE, nullptr),
-                          0, std::vector<ValueInfo*>(BUFFERSIZE, nullptr),
-                          0, std::vector<ValueInfo*>(BUFFERSIZE, nullptr),
-                          0, std::vector<ValueInfo*>(BUFFERSIZE, nullptr),
-                          0, std::vector<ValueInfo*>(BUFFERSIZE, nullptr),
-                          0, std::vector<ValueInfo*>(BUFFERSIZE, nullptr),
-                          0,0, 0,0, // jitter and lost
-                          -1, -1, -1, {}};
+  sessionMutex_.lock();
+  sessions_[sessionID] = {-1, -1, -1, {}};
+  sessionMutex_.unlock();
 }
 
 
@@ -275,7 +246,7 @@ QString StatisticsWindow::combineList(QStringList &list)
   return listed;
 }
 
-uint32_t StatisticsWindow::addFilter(QString type, QString identifier, uint64_t TID)
+void StatisticsWindow::filterAdded(uint32_t id, QString type, QString identifier, uint64_t TID)
 {
   QString threadID = QString::number(TID);
   threadID = threadID.rightJustified(5, '0');
@@ -284,20 +255,12 @@ uint32_t StatisticsWindow::addFilter(QString type, QString identifier, uint64_t
                                   {type, identifier, threadID, "-/-", "0"});
 
   filterMutex_.lock();
-  uint32_t id = nextFilterID_;
-  ++nextFilterID_;
-  if (nextFilterID_ >= UINT32_MAX - 2)
-  {
-    nextFilterID_ = 10;
-  }
   buffers_[id] = FilterStatus{0,QString::number(TID), 0, 0, rowIndex};
   filterMutex_.unlock();
-
-  return id;
 }
 
 
-void StatisticsWindow::removeFilter(uint32_t id)
+void StatisticsWindow::filterRemoved(uint32_t id)
 {
   filterMutex_.lock();
   if (buffers_.find(id) == buffers_.end())
@@ -342,8 +305,14 @@ void StatisticsWindow::removeSession(uint32_t sessionID)
     return;
   }
 
-  Logger::getLogger()->printNormal(this, "Removing session from statistics",
-                                   "SessionID", QString::number(sessionID));
+  metrics_->aggregate();
+  Logger::getLogger()->printDebug(DEBUG_NORMAL, this, "Removing session from statistics",
+                                  {"SessionID", "Video frames displayed", "Video frames dropped"},
+                                  {QString::number(sessionID),
+                                   QString::number(metrics_->get(METRIC_PRESENTED, STATS_VIDEO,
+                                                                 sessionID, 0).count),
+                                   QString::number(metrics_->get(METRIC_DISPLAY_DROPPED, STATS_VIDEO,
+                                                                 sessionID, 0).count)});
 
   Logger::getLogger()->printNormal(this, "Removing ICE in/out table rows for this session",
                                    "Amount of rows", QString::number(sessions_[sessionID].iceIndexes.size()));
@@ -390,6 +359,8 @@ void StatisticsWindow::removeSession(uint32_t sessionID)
   sessions_.erase(sessionID);
 
   sessionMutex_.unlock();
+
+  metrics_->removeSession(sessionID);
 }
 
 
@@ -409,277 +380,38 @@ void StatisticsWindow::updatePerformanceIndexes(int removedIndex)
 }
 
 
-void StatisticsWindow::encodingDelay(QString type, uint32_t delay)
-{
-  if(type == "video" || type == "Video")
-  {
-    updateValueBuffer(videoEncDelay_,
-                      videoEncDelayIndex_, delay);
-  }
-  else if(type == "audio" || type == "Audio")
-  {
-    updateValueBuffer(audioEncDelay_,
-                      audioEncDelayIndex_, delay);
-  }
-}
-
-
-void StatisticsWindow::decodingDelay(QString type, uint32_t delay)
-{
-  if(type == "video" || type == "Video")
-  {
-    updateValueBuffer(videoDecDelay_,
-                      videoDecDelayIndex_, delay);
-  }
-  else if(type == "audio" || type == "Audio")
-  {
-    updateValueBuffer(audioDecDelay_,
-                      audioDecDelayIndex_, delay);
-  }
-}
-
-
-void StatisticsWindow::totalDelay(uint32_t sessionID, QString type, int32_t delay)
-{
-  if(sessions_.find(sessionID) != sessions_.end())
-  {
-    if(type == "video" || type == "Video")
-    {
-      updateValueBuffer(sessions_.at(sessionID).videoDelay,
-                        sessions_.at(sessionID).videoDelayIndex, delay);
-    }
-    else if(type == "audio" || type == "Audio")
-    {
-      updateValueBuffer(sessions_.at(sessionID).audioDelay,
-                        sessions_.at(sessionID).audioDelayIndex, delay);
-    }
-  }
-}
-
-
-void StatisticsWindow::presentPackage(uint32_t sessionID, QString type)
-{
-  Q_ASSERT(sessions_.find(sessionID) != sessions_.end());
-  if(sessions_.find(sessionID) != sessions_.end())
-  {
-    if(type == "video" || type == "Video")
-    {
-      updateValueBuffer(sessions_.at(sessionID).pVideoPackets,
-                            sessions_.at(sessionID).pVideoIndex, 0);
-    }
-    else if (type == "audio" || type == "Audio")
-    {
-      updateValueBuffer(sessions_.at(sessionID).pAudioPackets,
-                            sessions_.at(sessionID).pAudioIndex, 0);
-    }
-  }
-}
-
-
-void StatisticsWindow::addEncodedPacket(QString type, uint32_t size)
-{
-  if(type == "video" || type == "Video")
-  {
-    updateValueBuffer(videoPackets_, videoIndex_, size);
-  }
-  else if(type == "audio" || type == "Audio")
-  {
-    updateValueBuffer(audioPackets_, audioIndex_, size);
-  }
-}
-
-
-void StatisticsWindow::updateValueBuffer(std::vector<ValueInfo*>& packets,
-                                             uint32_t& index, uint32_t value)
-{
-  // delete previous value from ring-buffer
-  if(packets[index%BUFFERSIZE])
-  {
-    delete packets.at(index%BUFFERSIZE);
-  }
-
-  // add packet at this timestamp
-  packets[index%BUFFERSIZE] = new ValueInfo{QDateTime::currentMSecsSinceEpoch(), value};
-  ++index;
-}
-
-
-
-uint32_t StatisticsWindow::calculateAverageAndRate(std::vector<ValueInfo*>& packets, uint32_t index,
+uint32_t StatisticsWindow::calculateAverageAndRate(MetricID metric, StatsMedia media, uint32_t source,
                                                    float& rate, int64_t interval, bool calcData)
 {
-  if(index == 0)
-    return 0;
-
-  int64_t now = QDateTime::currentMSecsSinceEpoch();
-  int64_t average = 0;
-  uint16_t frames = 0;
-  uint32_t currentTs = 0;
+  MetricValues values = metrics_->get(metric, media, source, interval);
   rate = 0.0f;
 
-  // set timestamp indexes to ringbuffer
-  if(index == 0)
-  {
-    currentTs = BUFFERSIZE - 1;
-  }
-  else
-  {
-    currentTs = index - 1;
-  }
-
-  // sum all values and time intervals in ring-buffer for specified timeperiod
-  while(packets[currentTs%BUFFERSIZE] && now - packets[currentTs%BUFFERSIZE]->timestamp
-        < interval)
-  {
-    average += packets[currentTs%BUFFERSIZE]->value;
-    ++frames;
-    if(currentTs != 0)
-    {
-      --currentTs;
-    }
-    else
-    {
-      currentTs = BUFFERSIZE - 1;
-    }
-  }
-
   // calculate frame rate and the average amount of bits per timeinterval (bitrate)
-  if(frames > 0)
+  if(values.windowCount > 0)
   {
     // rate per second
-    rate = (float)frames*1000/interval;
+    rate = (float)values.windowCount*1000/interval;
 
     if (calcData)
     {
       // return the amount of value per second converted to kbits/s
-      return 8*average/(interval);
+      return 8*values.windowSum/(interval);
     }
     else
     {
       // return the average size of value
-      return average/frames;
+      return values.windowSum/values.windowCount;
     }
   }
   return 0;
 }
 
 
-uint32_t StatisticsWindow::calculateAverage(std::vector<ValueInfo*>& packets, uint32_t index,
+uint32_t StatisticsWindow::calculateAverage(MetricID metric, StatsMedia media, uint32_t source,
                                             int64_t interval, bool kbitConversion)
 {
   float rate = 0.0f;
-  return calculateAverageAndRate(packets, index, rate, interval, kbitConversion);
-}
-
-
-void StatisticsWindow::addSendPacket(uint32_t size)
-{
-  deliveryMutex_.lock();
-  ++sendPacketCount_;
-  transferredData_ += size;
-
-  updateValueBuffer(outBandwidth_, outIndex_, size);
-  deliveryMutex_.unlock();
-}
-
-
-void StatisticsWindow::addReceivePacket(uint32_t sessionID, QString type,
-                                        uint32_t size)
-{
-  deliveryMutex_.lock();
-  ++receivePacketCount_;
-  receivedData_ += size;
-
-  updateValueBuffer(inBandWidth_, inIndex_, size);
-  deliveryMutex_.unlock();
-
-  if(sessions_.find(sessionID) != sessions_.end())
-  {
-    if(type == "video" || type == "Video")
-    {
-      updateValueBuffer(sessions_.at(sessionID).videoPackets,
-                            sessions_.at(sessionID).videoIndex, size);
-    }
-    else if (type == "audio" || type == "Audio")
-    {
-      updateValueBuffer(sessions_.at(sessionID).audioPackets,
-                            sessions_.at(sessionID).audioIndex, size);
-    }
-    else
-    {
-      Logger::getLogger()->printWarning(this, "Unknown type with receive packet");
-    }
-  }
-}
-
-
-void StatisticsWindow::addRTCPPacket(uint32_t sessionID, QString type,
-                                     uint8_t  fraction,
-                                     int32_t  lost,
-                                     uint32_t last_seq,
-                                     uint32_t jitter)
-{
-  if(sessions_.find(sessionID) != sessions_.end())
-  {
-    deliveryMutex_.lock();
-    if(type == "video" || type == "Video")
-    {
-      sessions_[sessionID].videoLost = lost;
-      sessions_[sessionID].videoJitter = jitter;
-    }
-    else if (type == "audio" || type == "Audio")
-    {
-      sessions_[sessionID].audioLost = lost;
-      sessions_[sessionID].audioJitter = jitter;
-    }
-    else
-    {
-      Logger::getLogger()->printWarning(this, "Unknown type with RTCP packet");
-    }
-
-    deliveryMutex_.unlock();
-  }
-}
-
-
-void StatisticsWindow::updateBufferStatus(uint32_t id, uint16_t buffersize,
-                                          uint16_t maxBufferSize)
-{
-  filterMutex_.lock();
-  if(buffers_.find(id) != buffers_.end())
-  {
-    if(buffers_[id].bufferStatus != buffersize ||
-       buffers_[id].bufferSize != maxBufferSize)
-    {
-      dirtyBuffers_ = true;
-      buffers_[id].bufferStatus = buffersize;
-      buffers_[id].bufferSize = maxBufferSize;
-    }
-  }
-  else
-  {
-    Logger::getLogger()->printProgramWarning(this, "Couldn't find correct filter for buffer status",
-                                             "Filter id", QString::number(id));
-  }
-  filterMutex_.unlock();
-}
-
-
-void StatisticsWindow::packetDropped(uint32_t id)
-{
-  ++packetsDropped_;
-  filterMutex_.lock();
-  if(buffers_.find(id) != buffers_.end())
-  {
-    ++buffers_[id].dropped;
-    dirtyBuffers_ = true;
-  }
-  else
-  {
-    Logger::getLogger()->printProgramWarning(this, "Couldn't find correct filter for dropped packet",
-                                             "Filter id", QString::number(id));
-  }
-  filterMutex_.unlock();
+  return calculateAverageAndRate(metric, media, source, rate, interval, kbitConversion);
 }
 
 
@@ -736,21 +468,28 @@ void StatisticsWindow::paintEvent(QPaintEvent *event)
     }
     case DELIVERY_TAB:
     {
-      deliveryMutex_.lock();
-      ui_->packets_sent_value->setText( QString::number(sendPacketCount_));
-      ui_->data_sent_value->setText( QString::number(transferredData_));
-      ui_->packets_received_value->setText( QString::number(receivePacketCount_));
-      ui_->data_received_value->setText( QString::number(receivedData_));
+      MetricValues sent = metrics_->get(METRIC_SENT_BYTES, STATS_NO_MEDIA, 0, 0);
+      MetricValues received = metrics_->get(METRIC_RECEIVED_BYTES, STATS_NO_MEDIA, 0, 0);
+
+      ui_->packets_sent_value->setText( QString::number(sent.count));
+      ui_->data_sent_value->setText( QString::number(sent.sum));
+      ui_->packets_received_value->setText( QString::number(received.count));
+      ui_->data_received_value->setText( QString::number(received.sum));
 
       // jitter and lost charts
+      sessionMutex_.lock();
       for(auto& d : sessions_)
       {
         if (d.second.deliveryGraphIndex != -1)
         {
-          ui_->v_jitter->addPoint(d.second.deliveryGraphIndex, d.second.videoJitter);
-          ui_->v_lost->addPoint(  d.second.deliveryGraphIndex, d.second.videoLost);
-          ui_->a_jitter->addPoint(d.second.deliveryGraphIndex, d.second.audioJitter);
-          ui_->a_lost->addPoint(  d.second.deliveryGraphIndex, d.second.audioLost);
+          ui_->v_jitter->addPoint(d.second.deliveryGraphIndex,
+                                  metrics_->get(METRIC_RTCP_JITTER, STATS_VIDEO, d.first, 0).last);
+          ui_->v_lost->addPoint(  d.second.deliveryGraphIndex,
+                                  metrics_->get(METRIC_RTCP_LOST, STATS_VIDEO, d.first, 0).last);
+          ui_->a_jitter->addPoint(d.second.deliveryGraphIndex,
+                                  metrics_->get(METRIC_RTCP_JITTER, STATS_AUDIO, d.first, 0).last);
+          ui_->a_lost->addPoint(  d.second.deliveryGraphIndex,
+                                  metrics_->get(METRIC_RTCP_LOST, STATS_AUDIO, d.first, 0).last);
         }
         else
         {
@@ -760,9 +499,11 @@ void StatisticsWindow::paintEvent(QPaintEvent *event)
 
       // bandwidth chart
       float packetRate = 0.0f; // not interested in this at the moment.
-      uint32_t inBandwidth = calculateAverageAndRate(inBandWidth_, inIndex_, packetRate, 5000, true);
-      uint32_t outBandwidth = calculateAverageAndRate(outBandwidth_, outIndex_, packetRate, 5000, true);
-      deliveryMutex_.unlock();
+      uint32_t inBandwidth = calculateAverageAndRate(METRIC_RECEIVED_BYTES, STATS_NO_MEDIA, 0,
+                                                     packetRate, 5000, true);
+      uint32_t outBandwidth = calculateAverageAndRate(METRIC_SENT_BYTES, STATS_NO_MEDIA, 0,
+                                                      packetRate, 5000, true);
+      sessionMutex_.unlock();
 
       ui_->bandwidth_chart->addPoint(1, inBandwidth);
       ui_->bandwidth_chart->addPoint(2, outBandwidth);
@@ -776,13 +517,14 @@ void StatisticsWindow::paintEvent(QPaintEvent *event)
 
         // calculate local video bitrate and framerate
         float videoFramerate = 0.0f;
-        uint32_t videoBitrate = calculateAverageAndRate(videoPackets_, videoIndex_, videoFramerate, interval, true);
+        uint32_t videoBitrate = calculateAverageAndRate(METRIC_ENCODED_BYTES, STATS_VIDEO, 0,
+                                                        videoFramerate, interval, true);
 
         // calculate local audio bitrate
-        uint32_t audioBitrate = calculateAverage(audioPackets_, audioIndex_, interval, true);
+        uint32_t audioBitrate = calculateAverage(METRIC_ENCODED_BYTES, STATS_AUDIO, 0, interval, true);
 
-        uint32_t videoEncoderDelay = calculateAverage(videoEncDelay_, videoEncDelayIndex_, interval, false);
-        uint32_t audioEncoderDelay = calculateAverage(audioEncDelay_, audioEncDelayIndex_, interval, false);
+        uint32_t videoEncoderDelay = calculateAverage(METRIC_ENCODING_DELAY, STATS_VIDEO, 0, interval, false);
+        uint32_t audioEncoderDelay = calculateAverage(METRIC_ENCODING_DELAY, STATS_AUDIO, 0, interval, false);
 
         // add points to chart
         ui_->v_bitrate_chart->addPoint(chartVideoID_, videoBitrate);
@@ -792,8 +534,8 @@ void StatisticsWindow::paintEvent(QPaintEvent *event)
         ui_->v_framerate_chart->addPoint(chartVideoID_, videoFramerate);
 
         /* Decoding delay, can be enabled when the values are fixed
-        uint32_t videoDecoderDelay = calculateAverage(videoDecDelay_, videoDecDelayIndex_, interval, false);
-        uint32_t audioDecoderDelay = calculateAverage(audioDecDelay_, audioDecDelayIndex_, interval, false);
+        uint32_t videoDecoderDelay = calculateAverage(METRIC_DECODING_DELAY, STATS_VIDEO, 0, interval, false);
+        uint32_t audioDecoderDelay = calculateAverage(METRIC_DECODING_DELAY, STATS_AUDIO, 0, interval, false);
         ui_->v_delay_chart->addPoint(chartVideoDecID_, videoDecoderDelay);
         ui_->a_delay_chart->addPoint(chartAudioDecID_, audioDecoderDelay);
         */
@@ -804,19 +546,19 @@ void StatisticsWindow::paintEvent(QPaintEvent *event)
           sessionMutex_.lock();
 
           float receiveVideorate = 0; // not shown at the moment. We show presentation framerate instead
-          uint32_t videoBitrate = calculateAverageAndRate(d.second.videoPackets, d.second.videoIndex,
+          uint32_t videoBitrate = calculateAverageAndRate(METRIC_RECEIVED_BYTES, STATS_VIDEO, d.first,
                                                           receiveVideorate, interval, true);
 
           float presentationVideoFramerate = 0;
-          calculateAverageAndRate(d.second.pVideoPackets, d.second.pVideoIndex,
+          calculateAverageAndRate(METRIC_PRESENTED, STATS_VIDEO, d.first,
                                   presentationVideoFramerate, interval, true);
 
-          uint32_t audioBitrate = calculateAverage(d.second.audioPackets, d.second.audioIndex,
+          uint32_t audioBitrate = calculateAverage(METRIC_RECEIVED_BYTES, STATS_AUDIO, d.first,
                                                    interval, true);
 
-          uint32_t videoDelay = calculateAverage(d.second.videoDelay, d.second.videoDelayIndex,
+          uint32_t videoDelay = calculateAverage(METRIC_TOTAL_DELAY, STATS_VIDEO, d.first,
                                                  interval, false);
-          uint32_t audioDelay = calculateAverage(d.second.audioDelay, d.second.audioDelayIndex,
+          uint32_t audioDelay = calculateAverage(METRIC_TOTAL_DELAY, STATS_AUDIO, d.first,
                                                  interval, false);
 
           ui_->v_bitrate_chart->addPoint(d.second.performanceGraphIndex, videoBitrate);
@@ -833,40 +575,51 @@ void StatisticsWindow::paintEvent(QPaintEvent *event)
       }
     case FILTER_TAB:
     {
-      if(dirtyBuffers_)
+      uint32_t totalBuffers = 0;
+
+      filterMutex_.lock();
+      for(auto& it : buffers_)
       {
-        uint32_t totalBuffers = 0;
+        MetricValues buffer = metrics_->get(METRIC_FILTER_BUFFER, STATS_NO_MEDIA, it.first, 0);
+        MetricValues bufferSize = metrics_->get(METRIC_FILTER_BUFFER_SIZE, STATS_NO_MEDIA, it.first, 0);
+        MetricValues dropped = metrics_->get(METRIC_FILTER_DROPPED, STATS_NO_MEDIA, it.first, 0);
+
+        totalBuffers += buffer.last;
+
+        // only the changed rows are updated
+        if (it.second.bufferStatus == buffer.last && it.second.bufferSize == bufferSize.last &&
+            it.second.dropped == dropped.count)
+        {
+          continue;
+        }
 
-        filterMutex_.lock();
-        for(auto& it : buffers_)
+        it.second.bufferStatus = buffer.last;
+        it.second.bufferSize = bufferSize.last;
+        it.second.dropped = dropped.count;
+
+        if (it.second.tableIndex >= ui_->filterTable->rowCount() ||
+            it.second.tableIndex == -1)
         {
-          totalBuffers += it.second.bufferStatus;
-
-          if (it.second.tableIndex >= ui_->filterTable->rowCount() ||
-              it.second.tableIndex == -1)
-          {
-            filterMutex_.unlock();
-            Logger::getLogger()->printProgramError(this, "Invalid filtertable index detected!",
-                                                   {"ID"}, {QString::number(it.first)});
-            return;
-          }
-
-          ui_->filterTable->setItem(it.second.tableIndex, 3,
-                                    new QTableWidgetItem(QString::number(it.second.bufferStatus) +
-                                                         "/" + QString::number(it.second.bufferSize)));
-          ui_->filterTable->setItem(it.second.tableIndex, 4,
-                                    new QTableWidgetItem(QString::number(it.second.dropped)));
-
-          ui_->filterTable->item(it.second.tableIndex, 3)->setTextAlignment(Qt::AlignHCenter);
-          ui_->filterTable->item(it.second.tableIndex, 4)->setTextAlignment(Qt::AlignHCenter);
+          filterMutex_.unlock();
+          Logger::getLogger()->printProgramError(this, "Invalid filtertable index detected!",
+                                                 {"ID"}, {QString::number(it.first)});
+          return;
         }
-        filterMutex_.unlock();
 
-        ui_->value_buffers->setText(QString::number(totalBuffers));
-        ui_->value_dropped->setText(QString::number(packetsDropped_));
-        dirtyBuffers_ = false;
+        ui_->filterTable->setItem(it.second.tableIndex, 3,
+                                  new QTableWidgetItem(QString::number(it.second.bufferStatus) +
+                                                       "/" + QString::number(it.second.bufferSize)));
+        ui_->filterTable->setItem(it.second.tableIndex, 4,
+                                  new QTableWidgetItem(QString::number(it.second.dropped)));
 
+        ui_->filterTable->item(it.second.tableIndex, 3)->setTextAlignment(Qt::AlignHCenter);
+        ui_->filterTable->item(it.second.tableIndex, 4)->setTextAlignment(Qt::AlignHCenter);
       }
+      filterMutex_.unlock();
+
+      ui_->value_buffers->setText(QString::number(totalBuffers));
+      ui_->value_dropped->setText(QString::number(metrics_->get(METRIC_FILTER_DROPPED, STATS_NO_MEDIA,
+                                                                0, 0).count));
       break;
     }
     default:
@@ -1,5 +1,5 @@
 #pragma once
-#include "statisticsinterface.h"
+#include "metricsrecorder.h"
 
 #include <QDialog>
 #include <QMutex>
@@ -15,7 +15,7 @@ namespace Ui {
 class StatisticsWindow;
 }
 
-class StatisticsWindow : public QDialog, public StatisticsInterface
+class StatisticsWindow : public QDialog, public MetricsRecorder
 {
   Q_OBJECT
 
@@ -44,27 +44,11 @@ public:
 
   virtual void selectedICEPair(uint32_t sessionID, std::shared_ptr<ICEPair> pair);
 
-  virtual void encodingDelay(QString type, uint32_t delay);
-  virtual void decodingDelay(QString type, uint32_t delay);
-  virtual void totalDelay(uint32_t sessionID, QString type, int32_t delay);
-  virtual void presentPackage(uint32_t sessionID, QString type);
-  virtual void addEncodedPacket(QString type, uint32_t size);
-
-  // delivery
-  virtual void addSendPacket(uint32_t size);
-  virtual void addReceivePacket(uint32_t sessionID, QString type, uint32_t size);
-  virtual void addRTCPPacket(uint32_t sessionID, QString type,
-                             uint8_t  fraction,
-                             int32_t  lost,
-                             uint32_t last_seq,
-                             uint32_t jitter);
+  // the media, delivery and filter values are recorded by MetricsRecorder
 
   // filter
-  virtual uint32_t addFilter(QString type, QString identifier, uint64_t TID);
-  virtual void removeFilter(uint32_t id);
-  virtual void updateBufferStatus(uint32_t id, uint16_t buffersize,
-                                  uint16_t maxBufferSize);
-  virtual void packetDropped(uint32_t id);
+  virtual void filterAdded(uint32_t id, QString type, QString identifier, uint64_t TID);
+  virtual void filterRemoved(uint32_t id);
 
   // sip
   virtual void addSentSIPMessage(const QString& headerType, const QString& header,
@@ -89,22 +73,14 @@ private:
 
   void clearCharts();
 
-  // Info about one packet for calculating bitrate.
-  struct ValueInfo
-  {
-    int64_t timestamp;
-    uint32_t value;
-  };
-
-  uint32_t calculateAverageAndRate(std::vector<ValueInfo*>& packets, uint32_t index,
+  // Returns the average value or with calcData the kbit/s of values recorded
+  // during interval and sets rate to the number of values per second.
+  uint32_t calculateAverageAndRate(MetricID metric, StatsMedia media, uint32_t source,
                                    float &rate, int64_t interval, bool calcData);
 
-  uint32_t calculateAverage(std::vector<ValueInfo*>& packets, uint32_t index,
+  uint32_t calculateAverage(MetricID metric, StatsMedia media, uint32_t source,
                             int64_t interval, bool kbitConversion);
 
-  void updateValueBuffer(std::vector<ValueInfo*>& packets,
-                         uint32_t& index, uint32_t value);
-
   void delayMsConversion(int& delay, QString& unit);
 
   void fillTableHeaders(QTableWidget* table, QMutex& mutex, QStringList headers);
@@ -128,33 +104,9 @@ private:
 
   void updatePerformanceIndexes(int removedIndex);
 
+  // the values themselves are in metrics_
   struct SessionInfo
   {
-    // TODO: where are all these deleted?
-
-    // receive buffers for calculating stream size
-    uint32_t videoIndex;
-    std::vector<ValueInfo*> videoPackets;
-    uint32_t audioIndex;
-    std::vector<ValueInfo*> audioPackets;
-
-    // presentation buffers for frame rate
-    uint32_t pVideoIndex;
-    std::vector<ValueInfo*> pVideoPackets;
-    uint32_t pAudioIndex;
-    std::vector<ValueInfo*> pAudioPackets;
-
-    // delay buffers for calculating average delay
-    uint32_t videoDelayIndex;
-    std::vector<ValueInfo*> videoDelay;
-    uint32_t audioDelayIndex;
-    std::vector<ValueInfo*> audioDelay;
-
-    uint32_t videoJitter;
-    int32_t videoLost;
-    uint32_t audioJitter;
-    int32_t audioLost;
-
     int deliveryGraphIndex;
     int delayGraphIndex;
     int performanceGraphIndex;
@@ -164,61 +116,26 @@ private:
 
   std::map<uint32_t, SessionInfo> sessions_;
 
+  // the values currently shown in the filter table
   struct FilterStatus
   {
-    uint32_t bufferStatus;
+    int32_t bufferStatus;
     QString TID;
-    uint32_t bufferSize;
-    uint32_t dropped;
+    int32_t bufferSize;
+    uint64_t dropped;
 
     int tableIndex;
   };
 
   std::map<uint32_t, FilterStatus> buffers_;
-  uint32_t nextFilterID_;
 
   Ui::StatisticsWindow *ui_;
 
-  // mutexes to prevent simultanious recording of certain statistics
+  // mutexes to prevent simultanious modification of tables and session details.
+  // The media statistics are recorded to metrics_ without locks.
   QMutex sessionMutex_;
   QMutex filterMutex_;
   QMutex sipMutex_;
-  QMutex deliveryMutex_;
-
-  // should the buffervalue be updated in next paintEvent
-  bool dirtyBuffers_;
-
-  // ring-buffer and its current index
-  uint32_t videoIndex_;
-  std::vector<ValueInfo*> videoPackets_;
-
-  // ring-buffer and its current index
-  uint32_t audioIndex_;
-  std::vector<ValueInfo*> audioPackets_;
-
-  uint32_t inIndex_;
-  std::vector<ValueInfo*> inBandWidth_;
-  uint32_t outIndex_;
-  std::vector<ValueInfo*> outBandwidth_;
-
-  uint64_t sendPacketCount_;
-  uint64_t transferredData_;
-  uint64_t receivePacketCount_;
-  uint64_t receivedData_;
-
-  uint64_t packetsDropped_;
-
-  // encoder latencies
-  uint32_t videoEncDelayIndex_;
-  std::vector<ValueInfo*> videoEncDelay_;
-  uint32_t audioEncDelayIndex_;
-  std::vector<ValueInfo*> audioEncDelay_;
-
-  // decoder latencies
-  uint32_t videoDecDelayIndex_;
-  std::vector<ValueInfo*> videoDecDelay_;
-  uint32_t audioDecDelayIndex_;
-  std::vector<ValueInfo*> audioDecDelay_;
 
   // a timer for reducing number of gui updates and making it more readable
   QElapsedTimer guiTimer_;
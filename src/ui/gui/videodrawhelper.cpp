@@ -7,7 +7,6 @@
 #include <QPainter>
 #include <QDateTime>
 
-const uint16_t VIEWBUFFERSIZE = 5;
 const QImage::Format IMAGE_FORMAT = QImage::Format_ARGB32;
 const int maximumQPChange = 25;
 const int CTU_SIZE = 64;
@@ -20,7 +19,10 @@ VideoDrawHelper::VideoDrawHelper(uint32_t sessionID, LayoutID layoutID, uint8_t
   firstImageReceived_(false),
   previousSize_(QSize(0,0)),
   borderSize_(borderSize),
-  lastShownTimestamp_(0),
+  drawWidth_(0),
+  drawHeight_(0),
+  lastFrame_(),
+  pendingFrame_(),
   roiMutex_(),
   currentSize_(0),
   currentMask_(nullptr),
@@ -35,17 +37,14 @@ VideoDrawHelper::VideoDrawHelper(uint32_t sessionID, LayoutID layoutID, uint8_t
   pixelBasedDrawing_(false),
   micIcon_(QString(":/icons/mic_off.svg")),
   drawIcon_(false),
-  fullscreen_(false),
-  bufferFullWarnings_(0)
+  fullscreen_(false)
 {
   micIcon_.setAspectRatioMode(Qt::KeepAspectRatio);
 }
 
 
 VideoDrawHelper::~VideoDrawHelper()
-{
-  frameBuffer_.clear();
-}
+{}
 
 
 void VideoDrawHelper::initWidget(QWidget* widget)
@@ -134,19 +133,14 @@ bool VideoDrawHelper::readyToDraw()
 }
 
 
-void VideoDrawHelper::inputImage(QWidget* widget, std::unique_ptr<uchar[]> data, QImage &image,
-                                 double framerate, int64_t timestamp)
+bool VideoDrawHelper::inputImage(QWidget* widget, std::unique_ptr<uchar[]> data, QImage &image,
+                                 int64_t timestamp)
 {
   if (!widget->isVisible() ||
       widget->isHidden() ||
       widget->isMinimized())
   {
-    return;
-  }
-
-  if (framerate_ != framerate)
-  {
-    framerate_ = framerate;
+    return false;
   }
 
   if(!firstImageReceived_)
@@ -154,47 +148,13 @@ void VideoDrawHelper::inputImage(QWidget* widget, std::unique_ptr<uchar[]> data,
     lastFrame_ = {image, std::move(data), timestamp};
     firstImageReceived_ = true;
     updateTargetRect(widget);
+    return false;
   }
-  else
-  {
-    if(previousSize_ != image.size())
-    {
-      Logger::getLogger()->printNormal(this, "Video widget needs to update its target "
-                                             "rectangle because of resolution change");
-
-      frameBuffer_.clear();
-      frameBuffer_.push_front({image, std::move(data), timestamp});
-
-      updateTargetRect(widget);
-    }
-    else
-    {
-      frameBuffer_.push_front({image, std::move(data), timestamp});
-    }
-
-    // delete oldes image if there is too much buffer
-    if(frameBuffer_.size() > VIEWBUFFERSIZE)
-    {
-      if (bufferFullWarnings_ == 0)
-      {
-        Logger::getLogger()->printWarning(this, "Buffer full when inputting image",
-                                         {"Buffer"}, QString::number(frameBuffer_.size()) + "/" +
-                                                     QString::number(VIEWBUFFERSIZE));
-      }
 
-      ++bufferFullWarnings_;
-      frameBuffer_.pop_back();
-
-      //setUpdatesEnabled(true);
-      //stats_->packetDropped("view" + QString::number(sessionID_));
-    }
-    else if (bufferFullWarnings_ > 0)
-    {
-      Logger::getLogger()->printWarning(this, "Discarded frames because buffer was full",
-                                        {"Amount discarded"}, QString::number(bufferFullWarnings_));
-      bufferFullWarnings_ = 0;
-    }
-  }
+  // latest wins, the paint only ever needs the newest frame
+  bool replaced = pendingFrame_.data != nullptr;
+  pendingFrame_ = {image, std::move(data), timestamp};
+  return replaced;
 }
 
 
@@ -234,59 +194,35 @@ void VideoDrawHelper::visualizeROIMap(RoiMap& map, int baseQP)
 }
 
 
-bool VideoDrawHelper::getRecentImage(QImage& image)
+bool VideoDrawHelper::getRecentImage(QWidget* widget, QImage& image)
 {
   Q_ASSERT(readyToDraw());
-  bool showNewFrame = false;
+  bool showNewFrame = pendingFrame_.data != nullptr;
 
-  if (readyToDraw())
+  if (showNewFrame)
   {
-    int64_t now = QDateTime::currentMSecsSinceEpoch();
-    int64_t timeSinceLastFrame = now - lastShownTimestamp_ ;
-
-    int64_t targetInterval = (1000 - 100)/framerate_; // try waiting at least 90% of framerate interval
-
-    if (frameBuffer_.empty()) // no new frames to show
-    {
-      //Logger::getLogger()->printNormal(this, "No frames to show", "Interval", QString::number(timeSinceLastFrame));
-      showNewFrame = false;
-    }
-    else if (timeSinceLastFrame > targetInterval) // enough time has passed since previous frame
-    {
-      //Logger::getLogger()->printNormal(this, "Showing new frame", "Interval", QString::number(timeSinceLastFrame));
-      showNewFrame = true;
-    }
-    else if (frameBuffer_.size() == VIEWBUFFERSIZE) // we are buffering frames
-    {
-      Logger::getLogger()->printWarning(this, "We are buffering, showing more images",
-                                        "Image interval", QString::number(timeSinceLastFrame));
-      showNewFrame = true;
-    }
-    else // show previous frame while waiting
-    {
-      //Logger::getLogger()->printNormal(this, "Waiting", "Buffer size", QString::number(frameBuffer_.size()));
-      showNewFrame = false;
-    }
+    lastFrame_ = std::move(pendingFrame_);
+    pendingFrame_ = {QImage(), nullptr, 0};
 
-    if (showNewFrame)
+    if (previousSize_ != lastFrame_.image.size())
     {
-      image = frameBuffer_.back().image;
-      lastFrame_ = std::move(frameBuffer_.back());
-      frameBuffer_.pop_back();
-      lastShownTimestamp_ = now;
-    }
-    else
-    {
-      image = lastFrame_.image;
+      Logger::getLogger()->printNormal(this, "Video widget needs to update its target "
+                                             "rectangle because of resolution change");
+      updateTargetRect(widget);
     }
   }
 
+  image = lastFrame_.image;
   return showNewFrame;
 }
 
 
 void VideoDrawHelper::updateTargetRect(QWidget* widget)
 {
+  QSize drawArea = (widget->size() - QSize(borderSize_, borderSize_)*2)*widget->devicePixelRatioF();
+  drawWidth_ = drawArea.width();
+  drawHeight_ = drawArea.height();
+
   if(firstImageReceived_)
   {
     Q_ASSERT(lastFrame_.image.data_ptr());
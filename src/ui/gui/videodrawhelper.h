@@ -14,14 +14,15 @@
 #include <QMutex>
 #include <QSvgRenderer>
 
-#include <deque>
+#include <atomic>
 #include <memory>
 
 #include "media/processing/detection_types.h"
 
 /*
  * Purpose of the VideoDrawHelper is to process all the mouse and keyboard events
- * for video view widgets. It also includes the buffer for images waiting to be drawn.
+ * for video view widgets. It also holds the newest frame waiting to be drawn. Frames are
+ * not queued, a frame arriving before the previous one was drawn replaces it.
 */
 
 // This class could possibly be combined with displayfilter.
@@ -47,15 +48,17 @@ public:
   void setDrawMicOff(bool state);
 
   bool readyToDraw();
-  void inputImage(QWidget *widget, std::unique_ptr<uchar[]> data,
-                  QImage &image, double framerate, int64_t timestamp);
+
+  // returns true if this replaced a frame that was never drawn
+  bool inputImage(QWidget *widget, std::unique_ptr<uchar[]> data,
+                  QImage &image, int64_t timestamp);
 
   void inputDetections(std::vector<Detection> detections, QSize original_size, uint64_t timestamp);
 
   void visualizeROIMap(RoiMap &map, int baseQP);
 
   // returns whether this is a new image or the previous one
-  bool getRecentImage(QImage& image);
+  bool getRecentImage(QWidget* widget, QImage& image);
 
   void draw(QPainter& painter);
 
@@ -77,6 +80,12 @@ public:
     return borderRect_;
   }
 
+  // can be called from any thread
+  QSize getDrawSize() const
+  {
+    return QSize(drawWidth_, drawHeight_);
+  }
+
   std::unique_ptr<int8_t[]> getRoiMask(int& width, int& height, int qp, bool scaleToInput);
 
 signals:
@@ -115,6 +124,10 @@ private:
 
   int borderSize_;
 
+  // space for the video in device pixels, read by the filters scaling the video
+  std::atomic<int> drawWidth_;
+  std::atomic<int> drawHeight_;
+
   struct Frame
   {
     QImage image;
@@ -122,9 +135,9 @@ private:
     int64_t timestamp;
   };
 
+  // the frame being drawn and the next frame to draw
   Frame lastFrame_;
-  std::deque<Frame> frameBuffer_;
-  int64_t lastShownTimestamp_ = 0;
+  Frame pendingFrame_;
 
   QMutex roiMutex_;
   size_t currentSize_;
@@ -148,14 +161,10 @@ private:
 
   bool fullscreen_;
 
-  int bufferFullWarnings_;
-
   std::vector<Detection> detections_;
   int64_t timepoint_ = 0;
 
   RoiMap map_ = {0,0, nullptr};
   int64_t roiTimepoint_ = 0;
   int baseQP_ = 0;
-
-  double framerate_ = 30;
 };
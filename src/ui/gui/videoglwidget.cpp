@@ -82,7 +82,7 @@ void VideoGLWidget::paintEvent(QPaintEvent *event)
       // update stats only for each new image.
       if(stats_ && sessionID_ != 0)
       {
-        stats_->presentPackage(sessionID_, "Video");
+        stats_->presentPackage(sessionID_, STATS_VIDEO);
       }
     }
 
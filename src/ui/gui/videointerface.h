@@ -30,7 +30,7 @@ public:
 
   // Takes ownership of the image data
   virtual void inputImage(std::unique_ptr<uchar[]> data, QImage &image,
-                          double framerate, int64_t timestamp) = 0;
+                          int64_t timestamp) = 0;
 
   virtual void inputDetections(std::vector<Detection> detections, QSize original_size, int64_t timestamp) = 0;
 
@@ -42,6 +42,9 @@ public:
 
   virtual VideoFormat supportedFormat() = 0;
 
+  // the area in device pixels the video is drawn to, empty before the view has a size
+  virtual QSize drawSize() = 0;
+
 signals:
   virtual void reattach(LayoutID layoutID) = 0;
   virtual void detach(LayoutID layoutID) = 0;
@@ -67,18 +67,17 @@ void VideoWidget::visualizeROIMap(RoiMap& map, int qp)
   helper_.visualizeROIMap(map, qp);
 }
 
-void VideoWidget::inputImage(std::unique_ptr<uchar[]> data, QImage &image, double framerate,
-                             int64_t timestamp)
+void VideoWidget::inputImage(std::unique_ptr<uchar[]> data, QImage &image, int64_t timestamp)
 {
   drawMutex_.lock();
-  // if the resolution has changed in video
-
-  helper_.inputImage(this, std::move(data), image, framerate, timestamp);
-
-  //update();
-
-  emit newImage();
+  bool replaced = helper_.inputImage(this, std::move(data), image, timestamp);
   drawMutex_.unlock();
+
+  // the previous frame was never drawn
+  if (replaced && stats_ && sessionID_ != 0)
+  {
+    stats_->displayDroppedFrame(sessionID_, STATS_VIDEO);
+  }
 }
 
 
@@ -99,13 +98,13 @@ void VideoWidget::paintEvent(QPaintEvent *event)
     drawMutex_.lock();
 
     QImage frame;
-    if(helper_.getRecentImage(frame))
+    if(helper_.getRecentImage(this, frame))
     {
       // sessionID 0 is the self display and we are not interested
       // update stats only for each new image.
       if(stats_ && sessionID_ != 0)
       {
-        stats_->presentPackage(sessionID_, "Video");
+        stats_->presentPackage(sessionID_, STATS_VIDEO);
       }
     }
 
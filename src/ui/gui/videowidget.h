@@ -31,7 +31,7 @@ public:
   }
 
   // Takes ownership of the image data
-  virtual void inputImage(std::unique_ptr<uchar[]> data, QImage &image, double framerate, int64_t timestamp);
+  virtual void inputImage(std::unique_ptr<uchar[]> data, QImage &image, int64_t timestamp);
 
   virtual void inputDetections(std::vector<Detection> detections, QSize original_size, int64_t timestamp);
 
@@ -46,6 +46,11 @@ public:
     return VIDEO_RGB32;
   }
 
+  virtual QSize drawSize()
+  {
+    return helper_.getDrawSize();
+  }
+
   virtual bool isVisible()
   {
     return QWidget::isVisible();
@@ -61,7 +66,6 @@ signals:
   void reattach(LayoutID layoutID_);
   void detach(LayoutID layoutID_);
 
-  void newImage();
 protected:
   void paintEvent(QPaintEvent *event);
   void resizeEvent(QResizeEvent *event);
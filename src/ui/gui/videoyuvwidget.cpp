@@ -3,33 +3,73 @@
 #include "statisticsinterface.h"
 #include "logger.h"
 
+#include <QOpenGLContext>
 #include <QPaintEvent>
-#include <QCoreApplication>
-#include <QEvent>
 #include <QKeyEvent>
-#include <QLayout>
+
+#include <cstdint>
+#include <cstring>
+
+
+// same BT.601 coefficients as the CPU conversions in yuvconversions
+static const char *vertexShaderSource =
+    "attribute vec2 position;\n"
+    "attribute vec2 texCoord;\n"
+    "varying vec2 v_texCoord;\n"
+    "void main() {\n"
+    "  v_texCoord = texCoord;\n"
+    "  gl_Position = vec4(position, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentShaderSource =
+    "varying mediump vec2 v_texCoord;\n"
+    "uniform sampler2D textureY;\n"
+    "uniform sampler2D textureU;\n"
+    "uniform sampler2D textureV;\n"
+    "void main() {\n"
+    "  mediump float y = texture2D(textureY, v_texCoord).r;\n"
+    "  mediump float u = texture2D(textureU, v_texCoord).r - 128.0/255.0;\n"
+    "  mediump float v = texture2D(textureV, v_texCoord).r - 128.0/255.0;\n"
+    "  gl_FragColor = vec4(clamp(vec3(y + 1.402*v,\n"
+    "                                 y - 0.344*u - 0.714*v,\n"
+    "                                 y + 1.772*u), 0.0, 1.0), 1.0);\n"
+    "}\n";
+
+// full screen quad as triangle strip, the first row of texture is the top of the image
+static const GLfloat vertices[] = {-1.0f, -1.0f,   1.0f, -1.0f,   -1.0f, 1.0f,   1.0f, 1.0f};
+static const GLfloat texCoords[] = {0.0f, 1.0f,    1.0f, 1.0f,    0.0f, 0.0f,    1.0f, 0.0f};
+
 
 VideoYUVWidget::VideoYUVWidget(QWidget* parent, uint32_t sessionID,
-                               uint8_t borderSize)
+                               LayoutID layoutID, uint8_t borderSize)
   : QOpenGLWidget(parent),
   stats_(nullptr),
   sessionID_(sessionID),
-  helper_(sessionID, borderSize),
-  texture_(0),
-  prog_(nullptr)
-
+  helper_(sessionID, layoutID, borderSize),
+  program_(nullptr),
+  textures_{0, 0, 0},
+  textureSize_(QSize(0,0)),
+  pixelBuffers_{QOpenGLBuffer(QOpenGLBuffer::PixelUnpackBuffer),
+                QOpenGLBuffer(QOpenGLBuffer::PixelUnpackBuffer)},
+  currentBuffer_(0),
+  uploadedFrame_(0)
 {
   helper_.initWidget(this);
 
-  // the new syntax does not work for some reason (unresolved overloaded function type)
-  QObject::connect(this, SIGNAL(newImage()), this, SLOT(repaint()));
+  QObject::connect(&updateTimer_, SIGNAL(timeout()), this, SLOT(update()));
+  updateTimer_.start(16); // 16 ms is the screen refresh time for 60 hz monitors
+
   QObject::connect(&helper_, &VideoDrawHelper::detach, this, &VideoYUVWidget::detach);
   QObject::connect(&helper_, &VideoDrawHelper::reattach, this, &VideoYUVWidget::reattach);
+
+  helper_.updateTargetRect(this);
 }
 
 
 VideoYUVWidget::~VideoYUVWidget()
-{}
+{
+  releaseGL();
+}
 
 
 void VideoYUVWidget::drawMicOffIcon(bool status)
@@ -37,16 +77,10 @@ void VideoYUVWidget::drawMicOffIcon(bool status)
   helper_.setDrawMicOff(status);
 }
 
-void VideoYUVWidget::enableOverlay(int roiQP, int backgroundQP, int brushSize, 
-                                   bool showGrid, bool pixelBased, QSize videoResolution)
-{
-  helper_.enableOverlay(roiQP, backgroundQP, brushSize, showGrid, pixelBased, videoResolution);
-}
 
-
-void VideoYUVWidget::resetOverlay()
+void VideoYUVWidget::visualizeROIMap(RoiMap& map, int qp)
 {
-  helper_.resetOverlay();
+  helper_.visualizeROIMap(map, qp);
 }
 
 
@@ -58,282 +92,262 @@ std::unique_ptr<int8_t[]> VideoYUVWidget::getRoiMask(int& width, int& height, in
 
 void VideoYUVWidget::inputImage(std::unique_ptr<uchar[]> data, QImage &image, int64_t timestamp)
 {
-  Q_ASSERT(data != nullptr);
+  if (image.format() != QImage::Format_Grayscale8)
+  {
+    Logger::getLogger()->printProgramError(this, "YUV widget got image which is not YUV");
+    return;
+  }
+
   drawMutex_.lock();
-  // if the resolution has changed in video
+  bool replaced = helper_.inputImage(this, std::move(data), image, timestamp);
+  drawMutex_.unlock();
 
-  helper_.inputImage(this, std::move(data), image, timestamp);
+  // the previous frame was never drawn
+  if (replaced && stats_ && sessionID_ != 0)
+  {
+    stats_->displayDroppedFrame(sessionID_, STATS_VIDEO);
+  }
+}
 
-  //update();
 
-  emit newImage();
+void VideoYUVWidget::inputDetections(std::vector<Detection> detections, QSize original_size,
+                                     int64_t timestamp)
+{
+  drawMutex_.lock();
+  helper_.inputDetections(detections, original_size, timestamp);
   drawMutex_.unlock();
 }
 
-/*
-static const char *fragmentShaderSource =
-    "uniform sampler2D s_texture;\n"
-    "void main() {\n"
-        "float y = texture2D(s_texture, gl_FragCoord.xy).r;\n"
-        "float u = texture2D(s_texture, gl_FragCoord.xy).r - 0.5;\n"
-        "float v = texture2D(s_texture, gl_FragCoord.xy).r - 0.5;\n"
-        "float r = y +             1.402 * v;\n"
-        "float g = y - 0.344 * u - 0.714 * v;\n"
-        "float b = y + 1.772 * u;\n"
-       // "gl_FragColor = vec4(r,g,b,1.0);\n"
-        "gl_FragColor = vec4(1.0,0.0,0.0,1.0);\n"
-    "}\n";
-*/
-
-/*
-static const char *vertexShaderSource =
-    "attribute vec4 vertex;\n"
-    "void main() {\n"
-    "   gl_Position = vertex;\n"
-    "}\n";
-*/
-
-static const char *vertexShaderSource2 =
-    "attribute vec4 posAttr;\n"
-    "attribute lowp vec4 colAttr;\n"
-    "varying lowp vec4 col;\n"
-    "uniform mat4 matrix;\n"
-    "void main() {\n"
-    "   col = colAttr;\n"
-    "   gl_Position = matrix * posAttr;\n"
-    "}\n";
-
-static const char *fragmentShaderSource2 =
-    "varying lowp vec4 col;\n"
-    "void main() {\n"
-    "   gl_FragColor = col;\n"
-    "}\n";
-
 
 void VideoYUVWidget::initializeGL()
 {
   initializeOpenGLFunctions();
 
-  if(prog_ == nullptr)
+  // the context is recreated when the widget is moved to another window (fullscreen)
+  QObject::connect(context(), &QOpenGLContext::aboutToBeDestroyed,
+                   this, &VideoYUVWidget::releaseGL, Qt::UniqueConnection);
+
+  program_ = new QOpenGLShaderProgram();
+  if (!program_->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource) ||
+      !program_->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource) ||
+      !program_->link())
   {
-    //makeCurrent();
-    qDebug() << "Initializing OpenGLProgram:" << glGetError();
-    prog_ = new QOpenGLShaderProgram();
-    prog_->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource2);
-    prog_->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource2);
-    prog_->link();
-     qDebug() << "Opengl initialization linking:" << glGetError() << prog_->log();
-    m_posAttr = prog_->attributeLocation("posAttr");
-    qDebug() << "Opengl initialization:" << glGetError();
-    m_colAttr = prog_->attributeLocation("colAttr");
-    qDebug() << "Opengl initialization:" << glGetError();
-    m_matrixUniform = prog_->uniformLocation("matrix");
-    qDebug() << "Opengl initialization:" << glGetError();
-
-    m_frame = 0;
-    //doneCurrent();
-    qDebug() << "Opengl initialization:" << glGetError();
+    Logger::getLogger()->printError(this, "Failed to compile YUV shaders", "Log", program_->log());
+    delete program_;
+    program_ = nullptr;
+    return;
   }
 
-  /*
-  qDebug() << "=== Initializing YUV OpenGL drawing widget for sessionID:" << sessionID_;
+  program_->bind();
+  program_->setUniformValue("textureY", 0);
+  program_->setUniformValue("textureU", 1);
+  program_->setUniformValue("textureV", 2);
+  program_->release();
 
+  glGenTextures(3, textures_);
+  for (GLuint texture : textures_)
+  {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
 
-  qDebug() << "Opengl:" << glGetError();
+  // OpenGL ES 2.0 does not have pixel buffers, there the planes are uploaded from our memory
+  bool pixelBuffersSupported = !context()->isOpenGLES() ||
+      context()->format().majorVersion() >= 3;
 
-  if(!prog_.isLinked())
+  for (auto& buffer : pixelBuffers_)
   {
-    //static const GLfloat texCoords[] = { 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f };
-    static const GLfloat vertices[]= {1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f,  -1.0f, -1.0f };
-
-    vbo_.create();
-    vbo_.bind();
-    vbo_.allocate(vertices, 8*sizeof(GLfloat));
+    if (pixelBuffersSupported && buffer.create())
+    {
+      buffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    }
+  }
 
-    prog_.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource);
-    qDebug() << "Opengl:" << glGetError();
+  textureSize_ = QSize(0,0);
+  uploadedFrame_ = 0;
 
-    prog_.addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource);
-    qDebug() << "Opengl source:" << glGetError();
+  Logger::getLogger()->printNormal(this, "Initialized YUV drawing", "Pixel buffers",
+                                   pixelBuffers_[0].isCreated() ? "Yes" : "No");
+}
 
-    prog_.bindAttributeLocation("vertex", 0);
-    qDebug() << "Opengl attribute:" << glGetError();
 
-    prog_.link();
-    qDebug() << "Opengl Link:" << glGetError();
+void VideoYUVWidget::releaseGL()
+{
+  if (program_ == nullptr)
+  {
+    return;
   }
 
-  if(texture_ == 0)
-  {
-    prog_.bind();
-    qDebug() << "Opengl bind:" << glGetError();
+  makeCurrent();
 
-    glEnable(GL_TEXTURE_2D);
-    qDebug() << "Opengl:" << glGetError();
+  delete program_;
+  program_ = nullptr;
 
-    glGenTextures(1, &texture_);
-    qDebug() << "Opengl:" << glGetError();
+  glDeleteTextures(3, textures_);
+  for (auto& buffer : pixelBuffers_)
+  {
+    buffer.destroy();
+  }
 
-    glBindTexture(GL_TEXTURE_2D, texture_);
-    qDebug() << "Opengl:" << glGetError();
+  doneCurrent();
+}
 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    qDebug() << "Opengl:" << glGetError();
 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    qDebug() << "Opengl:" << glGetError();
+void VideoYUVWidget::paintGL()
+{
+  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 1600, 1344, 0,
-                 GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+  if (helper_.readyToDraw() && program_ != nullptr)
+  {
+    drawMutex_.lock();
 
-    //glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, lastImage_.size().width(), lastImage_.size().height(), 0,
-    //              GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    QImage frame;
+    if (helper_.getRecentImage(this, frame))
+    {
+      // sessionID 0 is the self display and we are not interested
+      // update stats only for each new image.
+      if (stats_ && sessionID_ != 0)
+      {
+        stats_->presentPackage(sessionID_, STATS_VIDEO);
+      }
+    }
+
+    uploadFrame(frame);
+    drawFrame();
 
-    //prog_.bindAttributeLocation("vertex", 0);
-    int loc = prog_.uniformLocation("s_texture");
-    prog_.setUniformValue(loc, texture_);
+    // overlays are drawn on top of the video
+    QPainter painter(this);
+    helper_.draw(painter);
 
-    prog_.release();
+    drawMutex_.unlock();
   }
+}
 
-  //glOrtho(-1.0, 1.0, -1.0, 1.0, 0.1, 50);
 
-  qDebug() << "Opengl Initialization:" << glGetError() << ":" << prog_.log();
-  qDebug() << "Image size:" << lastImage_.size();
-  */
-}
-void VideoYUVWidget::drawOpenGL(bool updateImage)
+void VideoYUVWidget::uploadFrame(const QImage& frame)
 {
-  Q_UNUSED(updateImage);
-  /*
-  qDebug() << "Drawing with OpenGL --------------------------------------------------";
-  glClear(GL_COLOR_BUFFER_BIT);
-  glBindTexture(GL_TEXTURE_2D, texture_);
-
-  if(updateImage)
+  if (frame.cacheKey() == uploadedFrame_)
   {
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 400, 1344,
-                   GL_BGRA,  GL_UNSIGNED_BYTE, dataBuffer_.back().get());
+    return;
   }
-  prog_.bind();
-*/
-  //glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, lastImage_.size().width(), lastImage_.size().height(),
-  //                 GL_RGB, GL_UNSIGNED_BYTE, dataBuffer_.back().get());
 
-  //prog_.enableAttributeArray(0);
-  //prog_.setAttributeBuffer(0, GL_FLOAT, 0, 2, 2*sizeof(GLfloat));
+  const int width = frame.width();
+  const int height = frame.height();
+  const int lumaSize = width*height;
+  const int frameSize = lumaSize + 2*(lumaSize/4);
 
-  //glBindBuffer();
-  //glEnableVertexAttribArray();
-  //glVertexAttribPointer();
-  //glDrawArrays(GL_TRIANGLES, 0, 3);
+  // the chroma planes are after luma in the same buffer
+  const uchar* source = frame.constBits();
 
-  qDebug() << "Drawing with OpenGL shaders";
+  QOpenGLBuffer& buffer = pixelBuffers_[currentBuffer_];
+  currentBuffer_ = (currentBuffer_ + 1)%2;
 
-  if(prog_ == nullptr)
+  if (buffer.isCreated())
   {
-    initializeGL();
-  }
-
- // makeCurrent();
+    buffer.bind();
 
-  const qreal retinaScale = devicePixelRatio();
-  glViewport(0, 0, width() * retinaScale, height() * retinaScale);
-  qDebug() << "Opengl:" << glGetError();
+    // orphan the previous storage so we don't wait for its upload to finish
+    buffer.allocate(frameSize);
 
-  glClear(GL_COLOR_BUFFER_BIT);
-  qDebug() << "Opengl:" << glGetError();
+    void* mapped = buffer.map(QOpenGLBuffer::WriteOnly);
+    if (mapped != nullptr)
+    {
+      memcpy(mapped, source, frameSize);
+      buffer.unmap();
+    }
+    else
+    {
+      buffer.write(0, source, frameSize);
+    }
+  }
 
-  prog_->bind();
-  qDebug() << "Opengl bind:" << glGetError();
+  const QSize planeSizes[3] = {QSize(width, height), QSize(width/2, height/2), QSize(width/2, height/2)};
+  const int planeOffsets[3] = {0, lumaSize, lumaSize + lumaSize/4};
 
-  QMatrix4x4 matrix;
-  matrix.perspective(60.0f, 4.0f/3.0f, 0.1f, 100.0f);
-  matrix.translate(0, 0, -2);
-  matrix.rotate(100.0f * m_frame / 30, 0, 1, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-  prog_->setUniformValue(m_matrixUniform, matrix);
-  qDebug() << "Opengl:" << glGetError() << prog_->log();
+  for (int plane = 0; plane < 3; ++plane)
+  {
+    glBindTexture(GL_TEXTURE_2D, textures_[plane]);
 
-  GLfloat vertices[] = {
-      0.0f, 0.707f,
-      -0.5f, -0.5f,
-      0.5f, -0.5f
-  };
+    // with a bound pixel buffer the pointer is an offset to the buffer
+    const void* pixels = source + planeOffsets[plane];
+    if (buffer.isCreated())
+    {
+      pixels = reinterpret_cast<const void*>(static_cast<uintptr_t>(planeOffsets[plane]));
+    }
 
-  GLfloat colors[] = {
-      1.0f, 0.0f, 0.0f,
-      0.0f, 1.0f, 0.0f,
-      0.0f, 0.0f, 1.0f
-  };
+    if (textureSize_ != frame.size())
+    {
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, planeSizes[plane].width(), planeSizes[plane].height(),
+                   0, GL_LUMINANCE, GL_UNSIGNED_BYTE, pixels);
+    }
+    else
+    {
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, planeSizes[plane].width(), planeSizes[plane].height(),
+                      GL_LUMINANCE, GL_UNSIGNED_BYTE, pixels);
+    }
+  }
 
-  glVertexAttribPointer(m_posAttr, 2, GL_FLOAT, GL_FALSE, 0, vertices);
-  qDebug() << "Opengl:" << glGetError();
-  glVertexAttribPointer(m_colAttr, 3, GL_FLOAT, GL_FALSE, 0, colors);
-  qDebug() << "Opengl:" << glGetError();
+  glBindTexture(GL_TEXTURE_2D, 0);
 
-  glEnableVertexAttribArray(0);
-  qDebug() << "Opengl:" << glGetError();
-  glEnableVertexAttribArray(1);
-  qDebug() << "Opengl:" << glGetError();
+  if (buffer.isCreated())
+  {
+    buffer.release();
+  }
 
-  glDrawArrays(GL_TRIANGLES, 0, 3);
-  qDebug() << "Opengl draw:" << glGetError();
+  textureSize_ = frame.size();
+  uploadedFrame_ = frame.cacheKey();
+}
 
-  glDisableVertexAttribArray(1);
-  qDebug() << "Opengl:" << glGetError();
-  glDisableVertexAttribArray(0);
-  qDebug() << "Opengl:" << glGetError();
 
-  prog_->release();
+void VideoYUVWidget::drawFrame()
+{
+  // OpenGL has its origin at bottom left corner
+  QRect target = helper_.getTargetRect();
+  const qreal ratio = devicePixelRatioF();
+  glViewport(target.x()*ratio, (height() - target.y() - target.height())*ratio,
+             target.width()*ratio, target.height()*ratio);
 
-  ++m_frame;
+  program_->bind();
 
-  //doneCurrent();
-  qDebug() << "Opengl done:" << glGetError();
-}
+  for (int plane = 0; plane < 3; ++plane)
+  {
+    glActiveTexture(GL_TEXTURE0 + plane);
+    glBindTexture(GL_TEXTURE_2D, textures_[plane]);
+  }
 
-void VideoYUVWidget::paintGL()
-{
-  //qDebug() << "PaintEvent for widget:" << sessionID_;
-  QPainter painter(this);
+  program_->enableAttributeArray("position");
+  program_->enableAttributeArray("texCoord");
+  program_->setAttributeArray("position", vertices, 2);
+  program_->setAttributeArray("texCoord", texCoords, 2);
 
-  if(helper_.readyToDraw())
-  {
-    drawMutex_.lock();
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-    QImage frame;
-    if(helper_.getRecentImage(frame))
-    {
-      // sessionID 0 is the self display and we are not interested
-      // update stats only for each new image.
-      if(stats_ && sessionID_ != 0)
-      {
-        stats_->presentPackage(sessionID_, "Video");
-      }
-    }
+  program_->disableAttributeArray("position");
+  program_->disableAttributeArray("texCoord");
 
-    drawOpenGL(true);
-    drawMutex_.unlock();
-  }
-  else
+  for (int plane = 2; plane >= 0; --plane)
   {
-    drawOpenGL(false);
+    glActiveTexture(GL_TEXTURE0 + plane);
+    glBindTexture(GL_TEXTURE_2D, 0);
   }
-}
 
-void VideoYUVWidget::resizeGL(int width, int height)
-{
-  Q_UNUSED(width);
-  Q_UNUSED(height);
+  program_->release();
 
-  //int side = qMin(width, height);
-  //glViewport((width - side) / 2, (height - side) / 2, side, side);
+  glViewport(0, 0, width()*ratio, height()*ratio);
 }
 
+
 void VideoYUVWidget::resizeEvent(QResizeEvent *event)
 {
   QOpenGLWidget::resizeEvent(event); // its important to call this resize function, not the qwidget one.
+  helper_.updateTargetRect(this);
 }
 
 
@@ -343,7 +357,8 @@ void VideoYUVWidget::keyPressEvent(QKeyEvent *event)
 }
 
 
-void VideoYUVWidget::mouseDoubleClickEvent(QMouseEvent *e) {
+void VideoYUVWidget::mouseDoubleClickEvent(QMouseEvent *e)
+{
   QWidget::mouseDoubleClickEvent(e);
   helper_.mouseDoubleClickEvent(this);
 }
@@ -3,103 +3,111 @@
 #include "videointerface.h"
 #include "videodrawhelper.h"
 
-#include <QOpenGLFunctions_2_0>
+#include "global.h"
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLBuffer>
 
 #include <QPainter>
 #include <QRect>
 #include <QSize>
 #include <QImage>
 #include <QMutex>
+#include <QTimer>
 
-#include <QtOpenGL>
-
-#include <deque>
 #include <memory>
 
 class StatisticsInterface;
 
-// The normal QOpenGLFunctions provides access to ES API so the whole API is used instead
+/* Draws YUV 4:2:0 frames with OpenGL. The planes are uploaded as separate
+ * textures through pixel buffer objects and the conversion to RGB is done in
+ * the fragment shader, so the CPU does not have to convert remote streams.
+ *
+ * The image given to inputImage is the luma plane as a Grayscale8 image and the
+ * chroma planes follow it in the same data. */
 
 class VideoYUVWidget : public QOpenGLWidget, public VideoInterface, protected QOpenGLFunctions
 {
   Q_OBJECT
-  Q_INTERFACES(VideoInterface)
 public:
-  VideoYUVWidget(QWidget* parent = nullptr, uint32_t sessionID = 0, uint8_t borderSize = 1);
+  VideoYUVWidget(QWidget* parent = nullptr, uint32_t sessionID = 0, LayoutID layoutID = 0,
+                 uint8_t borderSize = 1);
   ~VideoYUVWidget();
 
-  void setStats(StatisticsInterface* stats)
+  virtual void setStats(StatisticsInterface* stats)
   {
     stats_ = stats;
   }
 
   // Takes ownership of the image data
-  void inputImage(std::unique_ptr<uchar[]> data, QImage &image, int64_t timestamp);
+  virtual void inputImage(std::unique_ptr<uchar[]> data, QImage &image, int64_t timestamp);
 
-  static unsigned int number_;
+  virtual void inputDetections(std::vector<Detection> detections, QSize original_size, int64_t timestamp);
 
   virtual void drawMicOffIcon(bool status);
 
-  virtual void enableOverlay(int roiQP, int backgroundQP, int brushSize,
-                             bool showGrid, bool pixelBased, QSize videoResolution);
-  virtual void resetOverlay();
+  virtual void visualizeROIMap(RoiMap& map, int qp);
 
   virtual std::unique_ptr<int8_t[]> getRoiMask(int& width, int& height, int qp, bool scaleToInput);
 
   virtual VideoFormat supportedFormat()
   {
-    //return VIDEO_RGB32;
     return VIDEO_YUV420;
   }
 
+  virtual QSize drawSize()
+  {
+    return helper_.getDrawSize();
+  }
+
   virtual bool isVisible()
   {
     return QWidget::isVisible();
   }
 
 signals:
-  // for reattaching after fullscreenmode
-  void reattach(uint32_t sessionID_);
-  void detach(uint32_t sessionID_);
 
-  void newImage();
+  void reattach(LayoutID layoutID_);
+  void detach(LayoutID layoutID_);
+
 protected:
 
-  // QOpenGLwidget events
+  virtual void initializeGL();
+  virtual void paintGL();
+
   void resizeEvent(QResizeEvent *event);
   void keyPressEvent(QKeyEvent *event);
-
   void mouseDoubleClickEvent(QMouseEvent *e);
 
-  virtual void initializeGL();
-  virtual void paintGL();
-  virtual void resizeGL(int width, int height);
-
 private:
 
-  // update the rect in case the window or input has changed.
-  void updateTargetRect();
+  // copies the planes of frame to textures if the frame has changed
+  void uploadFrame(const QImage& frame);
 
-  void enterFullscreen();
-  void exitFullscreen();
+  void drawFrame();
 
-  void drawOpenGL(bool updateImage);
+  void releaseGL();
 
   QMutex drawMutex_;
 
   StatisticsInterface* stats_;
   uint32_t sessionID_;
-
   VideoDrawHelper helper_;
 
-  GLuint texture_;
+  QTimer updateTimer_;
+
+  QOpenGLShaderProgram* program_;
 
-  QOpenGLShaderProgram* prog_;
+  // Y, U and V
+  GLuint textures_[3];
+  QSize textureSize_;
 
-  QOpenGLBuffer vbo_;
+  // The frames are written alternately to these so writing the next frame
+  // does not have to wait for the previous upload to finish.
+  QOpenGLBuffer pixelBuffers_[2];
+  int currentBuffer_;
 
-  GLuint m_posAttr;
-  GLuint m_colAttr;
-  GLuint m_matrixUniform;
-  int m_frame;
+  qint64 uploadedFrame_;
 };
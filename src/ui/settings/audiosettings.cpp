@@ -15,6 +15,7 @@
 const QStringList neededSettings = {SettingsKey::audioBitrate,
                                     SettingsKey::audioComplexity,
                                     SettingsKey::audioSignalType,
+                                    SettingsKey::audioFrameDuration,
                                     SettingsKey::audioAEC,
                                     SettingsKey::audioDenoise,
                                     SettingsKey::audioDereverb,
@@ -78,6 +79,9 @@ AudioSettings::AudioSettings(QWidget* parent,
 
   connect(audioSettingsUI_->signal_combo, &QComboBox::currentTextChanged,
           this,                           &AudioSettings::showOkButton);
+
+  connect(audioSettingsUI_->frame_combo, &QComboBox::currentTextChanged,
+          this,                          &AudioSettings::showOkButton);
 }
 
 
@@ -158,6 +162,9 @@ void AudioSettings::restoreSettings()
   QString type = settings_.value(SettingsKey::audioSignalType).toString();
   audioSettingsUI_->signal_combo->setCurrentText(type);
 
+  uint32_t frameUs = settingAudioFrameDuration();
+  audioSettingsUI_->frame_combo->setCurrentText(packetTimeString(frameUs));
+
   for (auto& box : boxes_)
   {
     restoreCheckBox(box.first, box.second, settings_);
@@ -186,6 +193,9 @@ void AudioSettings::saveSettings()
 
   saveTextValue(SettingsKey::audioSignalType,
                 audioSettingsUI_->signal_combo->currentText(), settings_);
+
+  saveTextValue(SettingsKey::audioFrameDuration,
+                audioSettingsUI_->frame_combo->currentText(), settings_);
 }
 
 
@@ -241,7 +251,7 @@ void AudioSettings::updateMutingThreshold(int value)
 
 void AudioSettings::setTimeValue(int value, QLabel* label, QSlider* slider)
 {
-  int rounded = roundToNumber(value, 1000/AUDIO_FRAMES_PER_SECOND);
+  int rounded = roundToNumber(value, DEFAULT_AUDIO_FRAME_US/1000);
   label->setText(QString::number(rounded) + " ms");
   slider->setValue(rounded);
 }
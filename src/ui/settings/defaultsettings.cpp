@@ -5,6 +5,8 @@
 
 #include "logger.h"
 #include "settingskeys.h"
+#include "common.h"
+#include "global.h"
 
 #include <thread>
 
@@ -54,6 +56,7 @@ bool DefaultSettings::validateAudioSettings()
   QStringList neededSettings = {SettingsKey::audioBitrate,
                                 SettingsKey::audioComplexity,
                                 SettingsKey::audioSignalType,
+                                SettingsKey::audioFrameDuration,
                                 SettingsKey::audioAEC,
                                 SettingsKey::audioAECDelay,
                                 SettingsKey::audioAECFilterLength,
@@ -163,6 +166,7 @@ void DefaultSettings::setDefaultAudioSettings(std::shared_ptr<MicrophoneInfo> mi
   settings_.setValue(SettingsKey::audioBitrate,         24000);
   settings_.setValue(SettingsKey::audioComplexity,      10);
   settings_.setValue(SettingsKey::audioSignalType,      "Auto");
+  settings_.setValue(SettingsKey::audioFrameDuration,   packetTimeString(DEFAULT_AUDIO_FRAME_US));
   settings_.setValue(SettingsKey::audioAEC,             1);
   settings_.setValue(SettingsKey::audioAECDelay,        120);
   settings_.setValue(SettingsKey::audioAECFilterLength, 250);
@@ -92,7 +92,7 @@ void UIManager::updateServerStatus(QString status)
 
 
 // functions for managing the GUI
-StatisticsInterface* UIManager::createStatsWindow()
+MetricsRecorder* UIManager::createStatsWindow()
 {
   Logger::getLogger()->printNormal(this, "Creating statistics window");
 
@@ -150,6 +150,12 @@ void UIManager::removeWithMessage(uint32_t sessionID, QString message,
 }
 
 
+void UIManager::setActiveSpeaker(uint32_t sessionID)
+{
+  window_.setActiveSpeaker(sessionID);
+}
+
+
 void UIManager::videoSourceChanged(bool camera, bool screenShare)
 {
   settingsView_.setCameraState(camera);
@@ -5,7 +5,7 @@
 #include "gui/callwindow.h"
 
 class StatisticsWindow;
-class StatisticsInterface;
+class MetricsRecorder;
 class VideoviewFactory;
 class SDPMediaParticipant;
 
@@ -27,7 +27,7 @@ public:
   void init(ParticipantInterface *partInt, std::shared_ptr<VideoviewFactory> viewFactory);
 
   // functions for managing the GUI
-  StatisticsInterface* createStatsWindow();
+  MetricsRecorder* createStatsWindow();
 
   // sessionID identifies the view slot
   void displayOutgoingCall(uint32_t sessionID, QString name);
@@ -45,6 +45,9 @@ public:
   void removeWithMessage(uint32_t sessionID, QString message,
                          bool temporaryMessage);
 
+  // highlights the participant who is talking, 0 removes the highlight
+  void setActiveSpeaker(uint32_t sessionID);
+
   void updateServerStatus(QString status);
 
   void showICEFailedMessage();
@@ -1,6 +1,7 @@
 #include "videoviewfactory.h"
 
 #include "ui/gui/videowidget.h"
+#include "ui/gui/videoyuvwidget.h"
 
 
 #include "common.h"
@@ -105,9 +106,19 @@ void VideoviewFactory::createWidget(uint32_t sessionID, LayoutID layoutID, const
 
   QWidget* parent = nullptr;
 
+  if (openGLEnabled)
+  {
+    // draws YUV so the frames don't have to be converted to RGB
+    VideoYUVWidget* opengl = new VideoYUVWidget(parent, sessionID, layoutID);
+    vw = opengl;
+    video = opengl;
+  }
+  else
+  {
     VideoWidget* normal = new VideoWidget(parent, sessionID, layoutID);
     vw = normal;
     video = normal;
+  }
 
   if (vw != nullptr && video != nullptr)
   {
@@ -0,0 +1,117 @@
+#include "../src/media/activespeakerdetector.h"
+#include "../src/media/processing/audiomixing.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace
+{
+
+const uint8_t SPEECH = 30;
+const uint8_t NOISE = 80;
+const uint8_t SILENCE = 127;
+
+const int64_t FRAME_MS = 10;
+
+
+// feeds both sessions a frame every 10 ms, returns the time after the feeding
+int64_t talk(ActiveSpeakerDetector& detector, int64_t fromMs, int64_t durationMs,
+             uint8_t firstLevel, uint8_t secondLevel)
+{
+  int64_t timeMs = fromMs;
+  for (; timeMs < fromMs + durationMs; timeMs += FRAME_MS)
+  {
+    detector.addLevel(1, firstLevel, timeMs);
+    detector.addLevel(2, secondLevel, timeMs);
+  }
+  return timeMs;
+}
+
+}
+
+
+TEST(ActiveSpeakerDetectorTest, NoiseIsNotSpeech)
+{
+  ActiveSpeakerDetector detector;
+
+  talk(detector, 0, 2000, NOISE, SILENCE);
+  EXPECT_EQ(detector.activeSpeaker(), 0u);
+}
+
+
+TEST(ActiveSpeakerDetectorTest, SwitchesAfterHold)
+{
+  ActiveSpeakerDetector detector;
+
+  int64_t timeMs = talk(detector, 0, 1000, SPEECH, SILENCE);
+  EXPECT_EQ(detector.activeSpeaker(), 1u);
+
+  // a short remark does not take over
+  timeMs = talk(detector, timeMs, 300, NOISE, SPEECH);
+  EXPECT_EQ(detector.activeSpeaker(), 1u);
+
+  timeMs = talk(detector, timeMs, 1500, NOISE, SPEECH);
+  EXPECT_EQ(detector.activeSpeaker(), 2u);
+}
+
+
+TEST(ActiveSpeakerDetectorTest, OverlappingSpeechDoesNotSwitch)
+{
+  ActiveSpeakerDetector detector;
+
+  int64_t timeMs = talk(detector, 0, 1000, SPEECH, SILENCE);
+  ASSERT_EQ(detector.activeSpeaker(), 1u);
+
+  talk(detector, timeMs, 3000, SPEECH, SPEECH);
+  EXPECT_EQ(detector.activeSpeaker(), 1u);
+}
+
+
+TEST(ActiveSpeakerDetectorTest, StaysActiveThroughPause)
+{
+  ActiveSpeakerDetector detector;
+
+  int64_t timeMs = talk(detector, 0, 1000, SPEECH, SILENCE);
+  ASSERT_EQ(detector.activeSpeaker(), 1u);
+
+  // nothing is received from anyone during DTX
+  timeMs += 5000;
+  talk(detector, timeMs, 100, SILENCE, NOISE);
+  EXPECT_EQ(detector.activeSpeaker(), 1u);
+}
+
+
+TEST(ActiveSpeakerDetectorTest, RemovingSpeaker)
+{
+  ActiveSpeakerDetector detector;
+
+  talk(detector, 0, 1000, SPEECH, SILENCE);
+  ASSERT_EQ(detector.activeSpeaker(), 1u);
+
+  EXPECT_FALSE(detector.removeSession(2));
+  EXPECT_TRUE(detector.removeSession(1));
+  EXPECT_EQ(detector.activeSpeaker(), 0u);
+}
+
+
+TEST(AudioLevelTest, LevelsInDBov)
+{
+  std::vector<int16_t> samples(960, 0);
+  EXPECT_EQ(audio_level(samples.data(), samples.size()), 127);
+  EXPECT_EQ(audio_level(samples.data(), 0), 127);
+
+  // full scale square wave is 0 dBov
+  for (size_t i = 0; i < samples.size(); ++i)
+  {
+    samples[i] = i%2 ? INT16_MAX : -INT16_MAX;
+  }
+  EXPECT_EQ(audio_level(samples.data(), samples.size()), 0);
+
+  // a tenth of full scale is 20 dB down
+  for (size_t i = 0; i < samples.size(); ++i)
+  {
+    samples[i] = i%2 ? INT16_MAX/10 : -INT16_MAX/10;
+  }
+  EXPECT_EQ(audio_level(samples.data(), samples.size()), 20);
+}
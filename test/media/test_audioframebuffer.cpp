@@ -0,0 +1,159 @@
+#include "../src/media/processing/audioframebuffer.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// 10 ms of 48 kHz stereo
+const uint32_t FRAME_SAMPLES = 960;
+const uint32_t FRAME_SIZE = FRAME_SAMPLES*sizeof(uint16_t);
+const uint32_t CAPACITY_FRAMES = 4;
+
+// samples are counters so that the reader can tell where each came from
+std::vector<uint16_t> counters(uint16_t first, size_t count)
+{
+  std::vector<uint16_t> samples(count);
+  for (auto& sample : samples)
+  {
+    sample = first++;
+  }
+  return samples;
+}
+
+}
+
+
+TEST(AudioFrameBufferTest, FramesFromAnySizeInput)
+{
+  AudioFrameBuffer buffer(FRAME_SIZE, CAPACITY_FRAMES);
+  std::vector<uint16_t> samples = counters(0, FRAME_SAMPLES*5/2);
+
+  EXPECT_TRUE(buffer.inputData((uint8_t*)samples.data(), 100*sizeof(uint16_t)));
+  EXPECT_EQ(buffer.getBufferSize(), 0u);
+
+  EXPECT_TRUE(buffer.inputData((uint8_t*)(samples.data() + 100),
+                               (samples.size() - 100)*sizeof(uint16_t)));
+  EXPECT_EQ(buffer.getBufferSize(), 2u);
+
+  std::vector<uint16_t> frame(FRAME_SAMPLES);
+  for (uint16_t first = 0; first < 2*FRAME_SAMPLES; first += FRAME_SAMPLES)
+  {
+    ASSERT_TRUE(buffer.readFrame((uint8_t*)frame.data()));
+    EXPECT_EQ(frame, counters(first, FRAME_SAMPLES));
+  }
+
+  EXPECT_FALSE(buffer.readFrame((uint8_t*)frame.data()));
+  EXPECT_FALSE(buffer.skipFrame());
+}
+
+
+TEST(AudioFrameBufferTest, FullBufferDropsTail)
+{
+  AudioFrameBuffer buffer(FRAME_SIZE, CAPACITY_FRAMES);
+  std::vector<uint16_t> samples = counters(0, FRAME_SAMPLES*(CAPACITY_FRAMES + 1) - 10);
+
+  EXPECT_FALSE(buffer.inputData((uint8_t*)samples.data(), samples.size()*sizeof(uint16_t)));
+  EXPECT_EQ(buffer.getBufferSize(), CAPACITY_FRAMES);
+
+  EXPECT_TRUE(buffer.skipFrame());
+
+  // the input after the drop starts a frame of its own
+  std::vector<uint16_t> next = counters(50000, FRAME_SAMPLES);
+  EXPECT_TRUE(buffer.inputData((uint8_t*)next.data(), FRAME_SIZE));
+
+  std::vector<uint16_t> frame(FRAME_SAMPLES);
+  for (uint16_t first = FRAME_SAMPLES; first < CAPACITY_FRAMES*FRAME_SAMPLES; first += FRAME_SAMPLES)
+  {
+    ASSERT_TRUE(buffer.readFrame((uint8_t*)frame.data()));
+    EXPECT_EQ(frame, counters(first, FRAME_SAMPLES));
+  }
+
+  ASSERT_TRUE(buffer.readFrame((uint8_t*)frame.data()));
+  EXPECT_EQ(frame, next);
+}
+
+
+// The producer writes random size chunks in bursts and the consumer reads
+// frames a little slower than they are produced, so the buffer runs empty and
+// full. Each frame must be whole: a run of counters that may only jump
+// between frames where input was dropped.
+TEST(AudioFrameBufferTest, ProducerAndConsumerAtDifferentRates)
+{
+  const uint64_t TOTAL_SAMPLES = 2000*FRAME_SAMPLES;
+
+  AudioFrameBuffer buffer(FRAME_SIZE, CAPACITY_FRAMES);
+  std::atomic<bool> producing(true);
+  uint64_t droppedInputs = 0;
+
+  std::thread producer([&]()
+  {
+    std::mt19937 generator(1);
+    std::uniform_int_distribution<uint32_t> chunk(1, 3*FRAME_SAMPLES);
+    std::uniform_int_distribution<int> pause(0, 3);
+
+    uint16_t next = 0;
+    for (uint64_t produced = 0; produced < TOTAL_SAMPLES;)
+    {
+      std::vector<uint16_t> samples = counters(next, chunk(generator));
+      if (!buffer.inputData((uint8_t*)samples.data(), samples.size()*sizeof(uint16_t)))
+      {
+        ++droppedInputs;
+      }
+
+      next += samples.size();
+      produced += samples.size();
+
+      if (pause(generator) == 0)
+      {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    }
+    producing = false;
+  });
+
+  std::vector<uint16_t> frame(FRAME_SAMPLES);
+  uint64_t framesRead = 0;
+  uint64_t jumps = 0;
+  bool first = true;
+  uint16_t expected = 0;
+
+  while (producing || buffer.getBufferSize() > 0)
+  {
+    if (!buffer.readFrame((uint8_t*)frame.data()))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    for (uint32_t i = 1; i < FRAME_SAMPLES; ++i)
+    {
+      ASSERT_EQ(uint16_t(frame[i - 1] + 1), frame[i]) << "Frame " << framesRead << " is torn";
+    }
+
+    if (!first && frame.front() != expected)
+    {
+      ++jumps;
+    }
+    first = false;
+    expected = frame.back() + 1;
+    ++framesRead;
+
+    if (framesRead%3 == 0)
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+  producer.join();
+
+  EXPECT_GT(framesRead, 0u);
+  EXPECT_LE(jumps, droppedInputs);
+  EXPECT_LE(framesRead*FRAME_SAMPLES, TOTAL_SAMPLES);
+}
@@ -0,0 +1,242 @@
+#include "../src/media/processing/audiojitterbuffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+const uint32_t SAMPLE_RATE = 48000;
+const uint32_t FRAME = 480; // 10 ms
+const int64_t FRAME_US = 10000;
+
+class ToneSource
+{
+public:
+  std::vector<int16_t> next(uint32_t samples)
+  {
+    std::vector<int16_t> tone(samples);
+    for (auto& sample : tone)
+    {
+      sample = int16_t(10000*std::sin(2*M_PI*200*position_/SAMPLE_RATE));
+      ++position_;
+    }
+    return tone;
+  }
+
+private:
+  uint64_t position_ = 0;
+};
+
+
+void inputFrames(AudioJitterBuffer& buffer, ToneSource& source, int frames, int64_t time,
+                 bool afterSilence = false)
+{
+  std::vector<int16_t> tone = source.next(FRAME*frames);
+  buffer.input((uint8_t*)tone.data(), uint32_t(tone.size()*sizeof(int16_t)), time,
+               afterSilence);
+}
+
+
+// the largest step between samples, a pure tone has no larger steps than 262
+int maxStep(const std::vector<int16_t>& output)
+{
+  int step = 0;
+  for (size_t i = 1; i < output.size(); ++i)
+  {
+    step = std::max(step, std::abs(output[i] - output[i - 1]));
+  }
+  return step;
+}
+}
+
+
+TEST(AudioJitterBufferTest, steadyInputSettles)
+{
+  AudioJitterBuffer buffer(SAMPLE_RATE, 1, FRAME);
+  ToneSource source;
+  std::vector<int16_t> frame(FRAME);
+  std::vector<int16_t> output;
+
+  int stretched = 0;
+  for (int i = 0; i < 300; ++i)
+  {
+    inputFrames(buffer, source, 1, i*FRAME_US);
+    AudioFrameType type = buffer.readFrame(frame.data());
+
+    EXPECT_NE(type, AUDIO_FRAME_CONCEALED);
+    if (i >= 100 && type != AUDIO_FRAME_NORMAL)
+    {
+      ++stretched;
+    }
+    output.insert(output.end(), frame.begin(), frame.end());
+  }
+
+  EXPECT_EQ(stretched, 0);
+  EXPECT_LE(buffer.targetMs(), 10u);
+  EXPECT_LT(maxStep(output), 400);
+}
+
+
+TEST(AudioJitterBufferTest, compressesAfterBurst)
+{
+  AudioJitterBuffer buffer(SAMPLE_RATE, 1, FRAME);
+  ToneSource source;
+  std::vector<int16_t> frame(FRAME);
+  std::vector<int16_t> output;
+
+  int64_t time = 0;
+  inputFrames(buffer, source, 15, time);
+
+  int compressed = 0;
+  for (int i = 0; i < 200; ++i)
+  {
+    time += FRAME_US;
+    inputFrames(buffer, source, 1, time);
+    if (buffer.readFrame(frame.data()) == AUDIO_FRAME_COMPRESSED)
+    {
+      ++compressed;
+    }
+    output.insert(output.end(), frame.begin(), frame.end());
+  }
+
+  EXPECT_GT(compressed, 0);
+  EXPECT_LE(buffer.depthMs(), 30u);
+  EXPECT_LT(maxStep(output), 400);
+}
+
+
+TEST(AudioJitterBufferTest, targetFollowsJitter)
+{
+  AudioJitterBuffer buffer(SAMPLE_RATE, 1, FRAME);
+  ToneSource source;
+  std::vector<int16_t> frame(FRAME);
+
+  int concealed = 0;
+  for (int i = 0; i < 400; ++i)
+  {
+    // four frames of every ten arrive together, the first of them 30 ms late
+    if (i%10 < 4)
+    {
+      if (i%10 == 3)
+      {
+        inputFrames(buffer, source, 4, i*FRAME_US);
+      }
+    }
+    else
+    {
+      inputFrames(buffer, source, 1, i*FRAME_US);
+    }
+
+    if (buffer.readFrame(frame.data()) == AUDIO_FRAME_CONCEALED && i > 200)
+    {
+      ++concealed;
+    }
+  }
+
+  EXPECT_GE(buffer.targetMs(), 30u);
+  EXPECT_EQ(concealed, 0);
+}
+
+
+TEST(AudioJitterBufferTest, silenceIsNotLateness)
+{
+  AudioJitterBuffer buffer(SAMPLE_RATE, 1, FRAME);
+  ToneSource source;
+  std::vector<int16_t> frame(FRAME);
+
+  for (int i = 0; i < 400; ++i)
+  {
+    // the sender talks for a second and pauses for 300 ms
+    int position = i%130;
+    if (position < 100)
+    {
+      inputFrames(buffer, source, 1, i*FRAME_US, i > 0 && position == 0);
+    }
+
+    buffer.readFrame(frame.data());
+  }
+
+  EXPECT_LE(buffer.targetMs(), 10u);
+}
+
+
+TEST(AudioJitterBufferTest, concealsAndFades)
+{
+  AudioJitterBuffer buffer(SAMPLE_RATE, 2, FRAME);
+  std::vector<int16_t> frame(FRAME*2);
+
+  // stereo tone
+  ToneSource source;
+  for (int i = 0; i < 50; ++i)
+  {
+    std::vector<int16_t> tone = source.next(FRAME);
+    std::vector<int16_t> stereo;
+    for (int16_t sample : tone)
+    {
+      stereo.push_back(sample);
+      stereo.push_back(sample);
+    }
+    buffer.input((uint8_t*)stereo.data(), uint32_t(stereo.size()*sizeof(int16_t)), i*FRAME_US);
+    buffer.readFrame(frame.data());
+  }
+
+  int previousPeak = 0;
+  for (int i = 0; i < 20; ++i)
+  {
+    EXPECT_EQ(buffer.readFrame(frame.data()), AUDIO_FRAME_CONCEALED);
+
+    int peak = 0;
+    for (int16_t sample : frame)
+    {
+      peak = std::max(peak, std::abs(sample));
+    }
+
+    if (i == 0)
+    {
+      EXPECT_GT(peak, 5000);
+    }
+    else
+    {
+      EXPECT_LE(peak, previousPeak);
+    }
+    previousPeak = peak;
+  }
+
+  EXPECT_LT(previousPeak, 100);
+}
+
+
+TEST(AudioJitterBufferTest, silenceDuringPause)
+{
+  AudioJitterBuffer buffer(SAMPLE_RATE, 1, FRAME);
+  std::vector<int16_t> frame(FRAME);
+
+  // the sender talks and sends quiet background noise before it pauses
+  ToneSource source;
+  for (int i = 0; i < 50; ++i)
+  {
+    inputFrames(buffer, source, 1, i*FRAME_US);
+    buffer.readFrame(frame.data());
+  }
+
+  std::vector<int16_t> noise(FRAME, 20);
+  for (int i = 50; i < 55; ++i)
+  {
+    buffer.input((uint8_t*)noise.data(), uint32_t(noise.size()*sizeof(int16_t)), i*FRAME_US);
+    buffer.readFrame(frame.data());
+  }
+
+  for (int i = 0; i < 20; ++i)
+  {
+    EXPECT_EQ(buffer.readFrame(frame.data()), AUDIO_FRAME_PAUSED);
+    EXPECT_EQ(frame, std::vector<int16_t>(FRAME, 0));
+  }
+
+  // audio lost while talking is still concealed
+  inputFrames(buffer, source, 1, 75*FRAME_US, true);
+  EXPECT_NE(buffer.readFrame(frame.data()), AUDIO_FRAME_PAUSED);
+  EXPECT_EQ(buffer.readFrame(frame.data()), AUDIO_FRAME_CONCEALED);
+}
@@ -0,0 +1,213 @@
+#include "../src/media/processing/audiomixing.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+// 10 ms of 48 kHz stereo and a length that leaves a tail for the C code
+const size_t COUNTS[] = {960, 37};
+
+
+std::vector<int16_t> randomSamples(size_t count, unsigned int seed)
+{
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<int> distribution(INT16_MIN, INT16_MAX);
+
+  std::vector<int16_t> samples(count);
+  for (auto& sample : samples)
+  {
+    sample = (int16_t)distribution(generator);
+  }
+  return samples;
+}
+
+}
+
+
+class AudioMixingTest : public ::testing::TestWithParam<KernelLevel>
+{
+protected:
+  void SetUp() override
+  {
+    kernels_ = get_mixing_level_kernels(GetParam());
+
+    if (kernels_ == nullptr)
+    {
+      GTEST_SKIP() << kernel_level_name(GetParam()) << " is not supported by this CPU";
+    }
+  }
+
+  const MixingKernels* kernels_ = nullptr;
+};
+
+
+TEST_P(AudioMixingTest, mixesAndSaturates)
+{
+  for (size_t count : COUNTS)
+  {
+    std::vector<std::vector<int16_t>> inputs;
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+      inputs.push_back(randomSamples(count, i));
+    }
+
+    std::vector<int32_t> sum(count, 0);
+    for (auto& input : inputs)
+    {
+      kernels_->accumulate_samples(sum.data(), input.data(), count);
+    }
+
+    std::vector<int16_t> mix(count);
+    kernels_->saturate_mix(sum.data(), nullptr, mix.data(), count);
+
+    std::vector<int16_t> mixMinus(count);
+    kernels_->saturate_mix(sum.data(), inputs[1].data(), mixMinus.data(), count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      int32_t expected = inputs[0][i] + inputs[1][i] + inputs[2][i] + inputs[3][i];
+      ASSERT_EQ(sum[i], expected);
+      ASSERT_EQ(mix[i], std::min(std::max(expected, (int32_t)INT16_MIN), (int32_t)INT16_MAX));
+
+      int32_t others = expected - inputs[1][i];
+      ASSERT_EQ(mixMinus[i], std::min(std::max(others, (int32_t)INT16_MIN), (int32_t)INT16_MAX));
+    }
+  }
+}
+
+
+INSTANTIATE_TEST_SUITE_P(Levels, AudioMixingTest, ::testing::Values(KERNEL_C, KERNEL_AVX2),
+                         [](const ::testing::TestParamInfo<KernelLevel>& info)
+{
+  return std::string(info.param == KERNEL_C ? "C" : "AVX2");
+});
+
+
+TEST(MixingClockTest, mixesOnceEveryFrame)
+{
+  MixingClock clock(10000, 0);
+
+  EXPECT_TRUE(clock.due(0));
+  EXPECT_FALSE(clock.due(5000));
+  EXPECT_TRUE(clock.due(10000));
+  EXPECT_FALSE(clock.due(10000));
+
+  // the missed frames at 20, 30 and 40 ms are mixed as soon as possible
+  EXPECT_TRUE(clock.due(45000));
+  EXPECT_TRUE(clock.due(45000));
+  EXPECT_TRUE(clock.due(45000));
+  EXPECT_FALSE(clock.due(45000));
+
+  // restarts after a long pause
+  EXPECT_TRUE(clock.due(200000));
+  EXPECT_FALSE(clock.due(200000));
+  EXPECT_TRUE(clock.due(210000));
+}
+
+
+TEST(MixingClockTest, waitsForLateInputs)
+{
+  MixingClock clock(10000, 5000);
+
+  EXPECT_FALSE(clock.due(0));
+  EXPECT_TRUE(clock.due(5000));
+  EXPECT_FALSE(clock.due(12000));
+  EXPECT_TRUE(clock.due(15000));
+
+  // the next frame is due one frame after an early mix
+  clock.mixedEarly(18000);
+  EXPECT_FALSE(clock.due(32000));
+  EXPECT_TRUE(clock.due(33000));
+}
+
+
+TEST(MixingBacklogTest, dropsLateAndWaitingFrames)
+{
+  MixingBacklog backlog;
+
+  // two mixes went by without the frames, they are dropped when they arrive
+  EXPECT_EQ(backlog.mixed(false, 0), 0u);
+  EXPECT_EQ(backlog.mixed(false, 0), 0u);
+  EXPECT_TRUE(backlog.arrived());
+  EXPECT_TRUE(backlog.arrived());
+  EXPECT_FALSE(backlog.arrived());
+
+  // a pause is not lateness
+  for (int i = 0; i < 20; ++i)
+  {
+    backlog.mixed(false, 0);
+  }
+  EXPECT_FALSE(backlog.arrived());
+
+  // one frame waiting after every mix is dropped eventually
+  size_t dropped = 0;
+  for (int i = 0; i < 20; ++i)
+  {
+    dropped += backlog.mixed(true, 1);
+  }
+  EXPECT_GE(dropped, 1u);
+}
+
+
+TEST(LoudestInputsTest, ordersLoudestAboveThreshold)
+{
+  std::vector<uint8_t> levels = {40, 90, 20, 127, 40, 30, 255};
+
+  // ties go to the earlier input
+  EXPECT_EQ(loudest_inputs(levels, 70), std::vector<size_t>({2, 5, 0, 4}));
+
+  EXPECT_TRUE(loudest_inputs(levels, 10).empty());
+  EXPECT_TRUE(loudest_inputs({}, 70).empty());
+}
+
+
+TEST(MixSelectorTest, mixesLoudestWithFrames)
+{
+  MixSelector selector(3, 70, 20000, 500000);
+
+  EXPECT_EQ(selector.select({1, 2, 3, 4, 5}, {40, 90, 20, 30, 255}),
+            std::vector<bool>({true, false, true, true, false}));
+
+  // a free place is filled at once
+  selector.removeInput(3);
+  EXPECT_EQ(selector.select({1, 2, 4, 5}, {40, 90, 30, 50}),
+            std::vector<bool>({true, false, true, true}));
+}
+
+
+TEST(MixSelectorTest, holdsStreamsInMix)
+{
+  MixSelector selector(3, 70, 20000, 500000);
+
+  for (int i = 0; i < 10; ++i)
+  {
+    EXPECT_EQ(selector.select({1, 2, 3, 4}, {30, 30, 30, 50}),
+              std::vector<bool>({true, true, true, false}));
+  }
+
+  // a louder stream waits until the quietest one has been out of the loudest
+  // for the hold time
+  int switched = 0;
+  for (int i = 1; i <= 50 && switched == 0; ++i)
+  {
+    std::vector<bool> mixed = selector.select({1, 2, 3, 4}, {30, 30, 60, 20});
+    if (mixed[3])
+    {
+      EXPECT_EQ(mixed, std::vector<bool>({true, true, false, true}));
+      switched = i;
+    }
+  }
+  EXPECT_GE(switched, 20);
+  EXPECT_LE(switched, 30);
+
+  // pauses between words do not drop a stream
+  for (int i = 0; i < 10; ++i)
+  {
+    EXPECT_EQ(selector.select({1, 2, 3, 4}, {30, 30, 60, 127}),
+              std::vector<bool>({true, true, false, true}));
+  }
+}
@@ -0,0 +1,145 @@
+#include "../src/media/processing/audioresampling.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+
+const uint16_t CHANNELS = 2;
+const double AMPLITUDE = 10000;
+
+
+// feeds a sine in frames of 10 ms and returns the first channel of the output
+std::vector<int16_t> resampleSine(PolyphaseResampler& resampler, uint32_t inputRate,
+                                  double frequency, size_t seconds, size_t& outputCount)
+{
+  const size_t frameSamples = inputRate/100;
+
+  std::vector<int16_t> frame(frameSamples*CHANNELS);
+  std::vector<int16_t> output;
+  std::vector<int16_t> firstChannel;
+
+  outputCount = 0;
+  for (size_t f = 0; f < seconds*100; ++f)
+  {
+    for (size_t i = 0; i < frameSamples; ++i)
+    {
+      double t = double(f*frameSamples + i)/inputRate;
+      frame[i*CHANNELS] = int16_t(AMPLITUDE*std::sin(2*M_PI*frequency*t));
+      frame[i*CHANNELS + 1] = -frame[i*CHANNELS];
+    }
+
+    size_t produced = resampler.process(frame.data(), frameSamples, output);
+    for (size_t i = 0; i < produced; ++i)
+    {
+      EXPECT_EQ(output[i*CHANNELS + 1], -output[i*CHANNELS]);
+      firstChannel.push_back(output[i*CHANNELS]);
+    }
+    outputCount += produced;
+  }
+
+  return firstChannel;
+}
+
+
+// the amplitude of frequency in samples as a correlation with a sine and cosine
+double amplitudeAt(const std::vector<int16_t>& samples, size_t from, uint32_t rate, double frequency)
+{
+  double sine = 0;
+  double cosine = 0;
+  for (size_t i = from; i < samples.size(); ++i)
+  {
+    double angle = 2*M_PI*frequency*i/rate;
+    sine += samples[i]*std::sin(angle);
+    cosine += samples[i]*std::cos(angle);
+  }
+
+  return 2*std::sqrt(sine*sine + cosine*cosine)/(samples.size() - from);
+}
+
+}
+
+
+class AudioResamplingTest : public ::testing::TestWithParam<KernelLevel>
+{
+protected:
+  void SetUp() override
+  {
+    kernels_ = get_resampling_level_kernels(GetParam());
+
+    if (kernels_ == nullptr)
+    {
+      GTEST_SKIP() << kernel_level_name(GetParam()) << " is not supported by this CPU";
+    }
+  }
+
+  const ResamplingKernels* kernels_ = nullptr;
+};
+
+
+TEST_P(AudioResamplingTest, keepsSineAndRate)
+{
+  const uint32_t RATES[][2] = {{44100, 48000}, {48000, 44100}, {16000, 48000}, {48000, 24000}};
+
+  for (auto& rates : RATES)
+  {
+    for (ResamplerQuality quality : {RESAMPLER_FAST, RESAMPLER_DEFAULT, RESAMPLER_BEST})
+    {
+      PolyphaseResampler resampler(rates[0], rates[1], CHANNELS, quality, *kernels_);
+
+      size_t outputCount = 0;
+      std::vector<int16_t> output = resampleSine(resampler, rates[0], 1000, 2, outputCount);
+
+      EXPECT_NEAR(double(outputCount), 2.0*rates[1], 1) << rates[0] << " -> " << rates[1];
+
+      // the sine is where it should be and nowhere else
+      double wanted = amplitudeAt(output, rates[1]/10, rates[1], 1000);
+      double elsewhere = amplitudeAt(output, rates[1]/10, rates[1], 1300);
+
+      EXPECT_NEAR(wanted, AMPLITUDE, AMPLITUDE*0.01) << rates[0] << " -> " << rates[1];
+      EXPECT_LT(elsewhere, AMPLITUDE*0.01) << rates[0] << " -> " << rates[1];
+    }
+  }
+}
+
+
+TEST_P(AudioResamplingTest, removesFrequenciesAboveOutputNyquist)
+{
+  // 23 kHz cannot be presented at 44.1 kHz and would alias to 21.1 kHz
+  PolyphaseResampler resampler(48000, 44100, CHANNELS, RESAMPLER_DEFAULT, *kernels_);
+
+  size_t outputCount = 0;
+  std::vector<int16_t> output = resampleSine(resampler, 48000, 23000, 1, outputCount);
+
+  EXPECT_LT(amplitudeAt(output, 4410, 44100, 21100), AMPLITUDE*0.01);
+}
+
+
+TEST_P(AudioResamplingTest, matchesC)
+{
+  const ResamplingKernels* reference = get_resampling_level_kernels(KERNEL_C);
+
+  PolyphaseResampler tested(44100, 48000, CHANNELS, RESAMPLER_BEST, *kernels_);
+  PolyphaseResampler expected(44100, 48000, CHANNELS, RESAMPLER_BEST, *reference);
+
+  size_t testedCount = 0;
+  size_t expectedCount = 0;
+  std::vector<int16_t> testedOutput = resampleSine(tested, 44100, 3000, 1, testedCount);
+  std::vector<int16_t> expectedOutput = resampleSine(expected, 44100, 3000, 1, expectedCount);
+
+  ASSERT_EQ(testedCount, expectedCount);
+  for (size_t i = 0; i < testedOutput.size(); ++i)
+  {
+    ASSERT_NEAR(testedOutput[i], expectedOutput[i], 1) << "Sample " << i;
+  }
+}
+
+
+INSTANTIATE_TEST_SUITE_P(Levels, AudioResamplingTest, ::testing::Values(KERNEL_C, KERNEL_AVX2),
+                         [](const ::testing::TestParamInfo<KernelLevel>& info)
+{
+  return std::string(info.param == KERNEL_C ? "C" : "AVX2");
+});
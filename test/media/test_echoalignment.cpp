@@ -0,0 +1,173 @@
+#include "../src/media/processing/echoalignment.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const uint32_t SAMPLE_RATE = 48000;
+const size_t FRAME_SAMPLES = SAMPLE_RATE/100;
+const int MAX_DELAY_MS = 200;
+
+
+// noise in bursts of random length like speech
+std::vector<int16_t> speechLike(size_t count, unsigned int seed)
+{
+  std::mt19937 generator(seed);
+  std::normal_distribution<double> noise(0, 4000);
+  std::uniform_int_distribution<size_t> burst(SAMPLE_RATE/20, SAMPLE_RATE/4);
+
+  std::vector<int16_t> samples(count, 0);
+  bool talking = true;
+  for (size_t i = 0; i < count;)
+  {
+    size_t length = burst(generator);
+    for (size_t j = i; j < std::min(i + length, count); ++j)
+    {
+      samples[j] = talking ? int16_t(std::max(-32000.0, std::min(32000.0, noise(generator)))) : 0;
+    }
+    i += length;
+    talking = !talking;
+  }
+  return samples;
+}
+
+
+// the capture has the reference as an echo delayed by delayMs and some noise
+bool estimateDelay(int delayMs, int& estimate)
+{
+  const size_t total = SAMPLE_RATE*4;
+  std::vector<int16_t> reference = speechLike(total, 3);
+
+  std::mt19937 generator(5);
+  std::normal_distribution<double> noise(0, 200);
+
+  std::vector<int16_t> capture(total, 0);
+  long delaySamples = long(delayMs)*SAMPLE_RATE/1000;
+  for (size_t i = 0; i < total; ++i)
+  {
+    long source = long(i) - delaySamples;
+    double echo = (source >= 0 && source < long(total)) ? reference[source]/2.0 : 0.0;
+    capture[i] = int16_t(echo + noise(generator));
+  }
+
+  EchoDelayEstimator estimator(SAMPLE_RATE, 1, MAX_DELAY_MS);
+
+  bool estimated = false;
+  for (size_t i = 0; i + FRAME_SAMPLES <= total; i += FRAME_SAMPLES)
+  {
+    estimated |= estimator.addFrame(capture.data() + i, reference.data() + i, FRAME_SAMPLES);
+  }
+
+  estimate = estimator.delayMs();
+  return estimated;
+}
+
+}
+
+
+TEST(EchoDelayEstimatorTest, FindsDelay)
+{
+  for (int delay : {0, 37, 150, -60})
+  {
+    int estimate = 0;
+    ASSERT_TRUE(estimateDelay(delay, estimate)) << "Delay " << delay;
+    EXPECT_NEAR(estimate, delay, 1) << "Delay " << delay;
+  }
+}
+
+
+TEST(EchoDelayEstimatorTest, NoEstimateWithoutReference)
+{
+  std::vector<int16_t> capture = speechLike(SAMPLE_RATE*3, 7);
+  std::vector<int16_t> silence(capture.size(), 0);
+
+  EchoDelayEstimator estimator(SAMPLE_RATE, 1, MAX_DELAY_MS);
+  for (size_t i = 0; i + FRAME_SAMPLES <= capture.size(); i += FRAME_SAMPLES)
+  {
+    EXPECT_FALSE(estimator.addFrame(capture.data() + i, silence.data() + i, FRAME_SAMPLES));
+  }
+}
+
+
+TEST(ClockDriftEstimatorTest, MeasuresDriftThroughBursts)
+{
+  const double DRIFT = 120e-6;
+  const uint64_t WINDOW = SAMPLE_RATE*60;
+  const uint64_t BURST = 4*FRAME_SAMPLES;
+
+  ClockDriftEstimator estimator(WINDOW);
+
+  // the reference arrives in bursts of four frames at random times
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<double> jitter(0, BURST);
+
+  bool measured = false;
+  for (uint64_t capture = 0; capture <= WINDOW + FRAME_SAMPLES; capture += FRAME_SAMPLES)
+  {
+    uint64_t reference = uint64_t(capture*(1.0 + DRIFT) + jitter(generator))/BURST*BURST;
+    measured |= estimator.addPoint(capture, reference);
+  }
+
+  ASSERT_TRUE(measured);
+  EXPECT_NEAR(estimator.drift(), DRIFT, 30e-6);
+}
+
+
+TEST(DriftResamplerTest, KeepsSignalAndChangesRate)
+{
+  const uint16_t CHANNELS = 2;
+  DriftResampler resampler(CHANNELS);
+
+  std::vector<int16_t> frame(FRAME_SAMPLES*CHANNELS);
+  std::vector<int16_t> output;
+
+  // the ratio of one passes the samples through
+  for (size_t i = 0; i < FRAME_SAMPLES; ++i)
+  {
+    frame[i*CHANNELS] = int16_t(i);
+    frame[i*CHANNELS + 1] = -int16_t(i);
+  }
+
+  size_t produced = resampler.process(frame.data(), FRAME_SAMPLES, output);
+  ASSERT_EQ(produced, FRAME_SAMPLES - 1);
+  for (size_t i = 0; i < produced; ++i)
+  {
+    EXPECT_EQ(output[i*CHANNELS], int16_t(i));
+    EXPECT_EQ(output[i*CHANNELS + 1], -int16_t(i));
+  }
+
+  // a slow sine stays a sine while the count grows by the ratio
+  const double RATIO = 1.001;
+  DriftResampler drifting(CHANNELS);
+  drifting.setRatio(RATIO);
+
+  size_t input = 0;
+  size_t total = 0;
+  double phase = 0;
+  for (int f = 0; f < 100; ++f)
+  {
+    for (size_t i = 0; i < FRAME_SAMPLES; ++i)
+    {
+      int16_t value = int16_t(10000*std::sin(2*M_PI*200*(input + i)/SAMPLE_RATE));
+      frame[i*CHANNELS] = value;
+      frame[i*CHANNELS + 1] = value;
+    }
+    input += FRAME_SAMPLES;
+
+    produced = drifting.process(frame.data(), FRAME_SAMPLES, output);
+    for (size_t i = 0; i < produced; ++i)
+    {
+      EXPECT_NEAR(output[i*CHANNELS], 10000*std::sin(phase), 40);
+      EXPECT_EQ(output[i*CHANNELS], output[i*CHANNELS + 1]);
+      phase += 2*M_PI*200/SAMPLE_RATE/RATIO;
+    }
+    total += produced;
+  }
+
+  EXPECT_NEAR(double(total), input*RATIO, 2);
+}
@@ -0,0 +1,23 @@
+#include "../src/media/processing/screensharefilter.h"
+#include "../src/media/resourceallocator.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+
+TEST(ScreenShareFilterTest, RoiMapHasDeltas)
+{
+  ResourceAllocator allocator;
+  int8_t staticDelta = allocator.getStaticScreenQpDelta();
+
+  // the unchanged areas reach the maximum QP on top of the frame QP
+  EXPECT_EQ(allocator.getScreenContentQp() + staticDelta, 51);
+
+  std::vector<uint8_t> dirty = {1, 0, 0, 1, 1, 0};
+  std::vector<int8_t> roi(dirty.size(), 99);
+
+  ScreenShareFilter::fillRoiMap(dirty.data(), roi.data(), (int)dirty.size(), staticDelta);
+
+  EXPECT_EQ(roi, std::vector<int8_t>({0, staticDelta, staticDelta, 0, 0, staticDelta}));
+}
@@ -0,0 +1,68 @@
+#include "../src/media/processing/voiceactivitydetector.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace
+{
+
+// speech probabilities in percent
+const int SPEECH = 90;
+const int DIP = (VAD_PROB_START + VAD_PROB_CONTINUE)/2;
+const int NOISE = VAD_PROB_CONTINUE - 10;
+
+
+// returns the decision of each frame
+std::vector<bool> detect(VoiceActivityDetector& detector, const std::vector<int>& probabilities)
+{
+  std::vector<bool> decisions;
+  for (int probability : probabilities)
+  {
+    decisions.push_back(detector.addFrame(probability));
+  }
+  return decisions;
+}
+
+}
+
+
+TEST(VoiceActivityDetectorTest, NoiseIsNotSpeech)
+{
+  VoiceActivityDetector detector;
+
+  EXPECT_EQ(detect(detector, {NOISE, NOISE, DIP, DIP, NOISE}),
+            std::vector<bool>({false, false, false, false, false}));
+  EXPECT_FALSE(detector.speech());
+}
+
+
+TEST(VoiceActivityDetectorTest, SpeechContinuesOverDips)
+{
+  VoiceActivityDetector detector;
+
+  EXPECT_EQ(detect(detector, {NOISE, SPEECH, DIP, DIP, SPEECH, DIP, NOISE, DIP}),
+            std::vector<bool>({false, true, true, true, true, true, false, false}));
+}
+
+
+TEST(VoiceActivityDetectorTest, ExactLimits)
+{
+  VoiceActivityDetector detector;
+
+  EXPECT_FALSE(detector.addFrame(VAD_PROB_START - 1));
+  EXPECT_TRUE(detector.addFrame(VAD_PROB_START));
+  EXPECT_TRUE(detector.addFrame(VAD_PROB_CONTINUE));
+  EXPECT_FALSE(detector.addFrame(VAD_PROB_CONTINUE - 1));
+}
+
+
+TEST(VoiceActivityDetectorTest, Reset)
+{
+  VoiceActivityDetector detector;
+
+  EXPECT_TRUE(detector.addFrame(SPEECH));
+  detector.reset();
+  EXPECT_FALSE(detector.speech());
+  EXPECT_FALSE(detector.addFrame(DIP));
+}
@@ -0,0 +1,429 @@
+#include "../src/media/processing/yuvconversions.h"
+#include "../src/media/processing/yuvscaling.h"
+#include "../src/media/processing/conversionpool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+struct FrameSize
+{
+  uint16_t width;
+  uint16_t height;
+};
+
+// aligned, unaligned and full HD sizes
+const FrameSize SIZES[] = {{64, 32}, {100, 50}, {34, 6}, {1920, 1080}};
+
+
+std::vector<uint8_t> randomBytes(size_t size, unsigned int seed)
+{
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<int> distribution(0, 255);
+
+  std::vector<uint8_t> bytes(size);
+  for (auto& byte : bytes)
+  {
+    byte = (uint8_t)distribution(generator);
+  }
+  return bytes;
+}
+
+}
+
+
+class YUVConversionTest : public ::testing::TestWithParam<KernelLevel>
+{
+protected:
+  void SetUp() override
+  {
+    reference_ = get_level_kernels(KERNEL_C);
+    kernels_ = get_level_kernels(GetParam());
+
+    if (kernels_ == nullptr)
+    {
+      GTEST_SKIP() << kernel_level_name(GetParam()) << " is not supported by this CPU";
+    }
+  }
+
+  const ConversionKernels* reference_ = nullptr;
+  const ConversionKernels* kernels_ = nullptr;
+};
+
+
+TEST_P(YUVConversionTest, yuv420ToRGB)
+{
+  for (auto& size : SIZES)
+  {
+    std::vector<uint8_t> input = randomBytes(size.width*size.height*3/2, size.width);
+    std::vector<uint8_t> expected(size.width*size.height*4);
+    std::vector<uint8_t> result(size.width*size.height*4);
+
+    reference_->yuv420_to_rgb(input.data(), expected.data(), size.width, size.height);
+    kernels_->yuv420_to_rgb(input.data(), result.data(), size.width, size.height);
+
+    EXPECT_EQ(expected, result) << size.width << "x" << size.height;
+  }
+}
+
+
+TEST_P(YUVConversionTest, rgbToYUV420)
+{
+  for (auto& size : SIZES)
+  {
+    std::vector<uint8_t> input = randomBytes(size.width*size.height*4, size.width);
+    std::vector<uint8_t> expected(size.width*size.height*3/2);
+    std::vector<uint8_t> result(size.width*size.height*3/2);
+
+    reference_->rgb_to_yuv420(input.data(), expected.data(), size.width, size.height);
+    kernels_->rgb_to_yuv420(input.data(), result.data(), size.width, size.height);
+
+    EXPECT_EQ(expected, result) << size.width << "x" << size.height;
+  }
+}
+
+
+TEST_P(YUVConversionTest, yuyvToYUV420)
+{
+  for (auto& size : SIZES)
+  {
+    std::vector<uint8_t> input = randomBytes(size.width*size.height*2, size.width);
+    std::vector<uint8_t> expected(size.width*size.height*3/2);
+    std::vector<uint8_t> result(size.width*size.height*3/2);
+
+    reference_->yuyv_to_yuv420(input.data(), expected.data(), size.width, size.height);
+    kernels_->yuyv_to_yuv420(input.data(), result.data(), size.width, size.height);
+
+    EXPECT_EQ(expected, result) << size.width << "x" << size.height;
+  }
+}
+
+
+TEST_P(YUVConversionTest, yuyvToRGB)
+{
+  for (auto& size : SIZES)
+  {
+    std::vector<uint8_t> input = randomBytes(size.width*size.height*2, size.width);
+    std::vector<uint8_t> expected(size.width*size.height*4);
+    std::vector<uint8_t> result(size.width*size.height*4);
+
+    reference_->yuyv_to_rgb(input.data(), expected.data(), size.width, size.height);
+    kernels_->yuyv_to_rgb(input.data(), result.data(), size.width, size.height);
+
+    EXPECT_EQ(expected, result) << size.width << "x" << size.height;
+  }
+}
+
+
+TEST_P(YUVConversionTest, halfRGB)
+{
+  for (auto& size : SIZES)
+  {
+    std::vector<uint8_t> input = randomBytes(size.width*size.height*4, size.width);
+    std::vector<uint8_t> expected(size.width*size.height);
+    std::vector<uint8_t> result(size.width*size.height);
+
+    reference_->half_rgb(input.data(), expected.data(), size.width, size.height);
+    kernels_->half_rgb(input.data(), result.data(), size.width, size.height);
+
+    EXPECT_EQ(expected, result) << size.width << "x" << size.height;
+  }
+}
+
+
+TEST_P(YUVConversionTest, flipRGB)
+{
+  for (auto& size : SIZES)
+  {
+    std::vector<uint8_t> input = randomBytes(size.width*size.height*4, size.width);
+
+    for (int flip = 1; flip < 4; ++flip)
+    {
+      bool horizontally = flip & 1;
+      bool vertically = flip & 2;
+
+      std::vector<uint8_t> expected(size.width*size.height*4);
+      std::vector<uint8_t> result(size.width*size.height*4);
+
+      reference_->flip_rgb(input.data(), expected.data(), size.width, size.height,
+                           horizontally, vertically);
+      kernels_->flip_rgb(input.data(), result.data(), size.width, size.height,
+                         horizontally, vertically);
+
+      EXPECT_EQ(expected, result) << size.width << "x" << size.height
+                                  << " horizontally: " << horizontally
+                                  << " vertically: " << vertically;
+    }
+  }
+}
+
+
+TEST_P(YUVConversionTest, dirtyBlocks)
+{
+  const uint16_t blockSize = 16;
+
+  for (auto& size : SIZES)
+  {
+    const int stride = size.width*4;
+    const int blocks = ((size.width + blockSize - 1)/blockSize)*((size.height + blockSize - 1)/blockSize);
+
+    std::vector<uint8_t> current = randomBytes(size.width*size.height*4, size.width);
+
+    // change a few pixels here and there
+    std::vector<uint8_t> previous = current;
+    for (size_t i = 0; i < previous.size(); i += 4999)
+    {
+      previous[i] ^= 0x80;
+    }
+
+    // negative stride processes the frame bottom-up
+    for (int direction : {1, -1})
+    {
+      int offset = direction > 0 ? 0 : (size.height - 1)*stride;
+
+      std::vector<uint8_t> expectedPrevious = previous;
+      std::vector<uint8_t> resultPrevious = previous;
+      std::vector<uint8_t> expectedMap(blocks);
+      std::vector<uint8_t> resultMap(blocks);
+
+      int expectedCount = reference_->update_dirty_blocks(expectedPrevious.data() + offset,
+                                                          current.data() + offset, expectedMap.data(),
+                                                          size.width, size.height,
+                                                          direction*stride, blockSize);
+      int resultCount = kernels_->update_dirty_blocks(resultPrevious.data() + offset,
+                                                      current.data() + offset, resultMap.data(),
+                                                      size.width, size.height,
+                                                      direction*stride, blockSize);
+
+      EXPECT_EQ(expectedCount, resultCount) << size.width << "x" << size.height;
+      EXPECT_EQ(expectedMap, resultMap) << size.width << "x" << size.height;
+      EXPECT_EQ(expectedPrevious, resultPrevious) << size.width << "x" << size.height;
+      EXPECT_EQ(current, resultPrevious) << size.width << "x" << size.height;
+    }
+  }
+}
+
+
+TEST_P(YUVConversionTest, scalePlane)
+{
+  // downscaling, upscaling and factors that only bilinear can do
+  const FrameSize targets[] = {{32, 16}, {50, 25}, {17, 9}, {128, 64}};
+
+  for (auto& size : SIZES)
+  {
+    std::vector<uint8_t> input = randomBytes(size.width*size.height, size.width);
+
+    for (auto& target : targets)
+    {
+      std::vector<uint8_t> work(scale_work_size(size.width, size.height, target.width, target.height));
+      std::vector<uint8_t> expected(target.width*target.height);
+      std::vector<uint8_t> result(target.width*target.height);
+
+      reference_->scale_plane_bilinear(input.data(), size.width, size.height, size.width,
+                                       expected.data(), target.width, target.height, target.width,
+                                       work.data());
+      kernels_->scale_plane_bilinear(input.data(), size.width, size.height, size.width,
+                                     result.data(), target.width, target.height, target.width,
+                                     work.data());
+
+      EXPECT_EQ(expected, result) << "bilinear " << size.width << "x" << size.height
+                                  << " -> " << target.width << "x" << target.height;
+
+      if (is_box_scalable(size.width, size.height, target.width, target.height))
+      {
+        reference_->scale_plane_box(input.data(), size.width, size.height, size.width,
+                                    expected.data(), target.width, target.height, target.width,
+                                    work.data());
+        kernels_->scale_plane_box(input.data(), size.width, size.height, size.width,
+                                  result.data(), target.width, target.height, target.width,
+                                  work.data());
+
+        EXPECT_EQ(expected, result) << "box " << size.width << "x" << size.height
+                                    << " -> " << target.width << "x" << target.height;
+      }
+    }
+  }
+}
+
+
+TEST_P(YUVConversionTest, selfViewToRGB)
+{
+  const SelfViewFormat formats[] = {SELF_VIEW_YUV420, SELF_VIEW_NV12, SELF_VIEW_YUYV};
+
+  for (auto& size : SIZES)
+  {
+    std::vector<uint8_t> work(selfview_work_size(size.width));
+
+    for (SelfViewFormat format : formats)
+    {
+      size_t inputSize = format == SELF_VIEW_YUYV ? size.width*size.height*2 : size.width*size.height*3/2;
+      std::vector<uint8_t> input = randomBytes(inputSize, size.width + format);
+
+      for (int factor = 1; factor <= 4; ++factor)
+      {
+        for (bool mirror : {false, true})
+        {
+          size_t outputSize = ((size.width/factor) & ~1)*(size.height/factor)*4;
+          std::vector<uint8_t> expected(outputSize);
+          std::vector<uint8_t> result(outputSize);
+
+          reference_->selfview_to_rgb(input.data(), expected.data(), size.width, size.height,
+                                      format, factor, mirror, work.data());
+          kernels_->selfview_to_rgb(input.data(), result.data(), size.width, size.height,
+                                    format, factor, mirror, work.data());
+
+          EXPECT_EQ(expected, result) << size.width << "x" << size.height << " format " << format
+                                      << " factor " << factor << " mirror " << mirror;
+        }
+      }
+    }
+  }
+}
+
+
+TEST(YUVConversionThreadsTest, matchesReference)
+{
+  if (!is_avx2_available() || !is_sse41_available())
+  {
+    GTEST_SKIP() << "AVX2 is not supported by this CPU";
+  }
+
+  const uint16_t width = 1920;
+  const uint16_t height = 1080;
+
+  std::vector<uint8_t> yuv = randomBytes(width*height*3/2, 1);
+  std::vector<uint8_t> expected(width*height*4);
+  std::vector<uint8_t> result(width*height*4);
+
+  yuv420_to_rgb_i_c(yuv.data(), expected.data(), width, height);
+  yuv420_to_rgb_i_avx2_mt(yuv.data(), result.data(), width, height, 4);
+  EXPECT_EQ(expected, result);
+
+  std::vector<uint8_t> rgb = randomBytes(width*height*4, 2);
+  std::vector<uint8_t> expectedYUV(width*height*3/2);
+  std::vector<uint8_t> resultYUV(width*height*3/2);
+
+  rgb_to_yuv420_i_c(rgb.data(), expectedYUV.data(), width, height);
+  rgb_to_yuv420_i_sse41_mt(rgb.data(), resultYUV.data(), width, height, 4);
+  EXPECT_EQ(expectedYUV, resultYUV);
+}
+
+
+TEST(YUVConversionThreadsTest, poolRunsEveryBandOnce)
+{
+  // several filters may convert at the same time
+  const int callers = 4;
+  const int bands = 37;
+
+  std::vector<std::vector<std::atomic<int>>> counts(callers);
+  std::vector<std::thread> threads;
+
+  for (int caller = 0; caller < callers; ++caller)
+  {
+    counts[caller] = std::vector<std::atomic<int>>(bands);
+    threads.push_back(std::thread([&counts, caller]()
+    {
+      for (int round = 0; round < 50; ++round)
+      {
+        ConversionPool::getPool().run(bands, 3, [&counts, caller](int band)
+        {
+          ++counts[caller][band];
+        });
+      }
+    }));
+  }
+
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  for (int caller = 0; caller < callers; ++caller)
+  {
+    for (int band = 0; band < bands; ++band)
+    {
+      EXPECT_EQ(counts[caller][band], 50);
+    }
+  }
+}
+
+
+TEST(YUVScalingTest, boxAverages)
+{
+  // 2x2 blocks of 0, 1, 2 and 5 average to 2
+  const uint8_t input[] = {0, 1, 0, 1,
+                           2, 5, 2, 5};
+  uint8_t output[2] = {};
+  std::vector<uint8_t> work(scale_work_size(4, 2, 2, 1));
+
+  scale_plane_box_c(input, 4, 2, 4, output, 2, 1, 2, work.data());
+
+  EXPECT_EQ(2, output[0]);
+  EXPECT_EQ(2, output[1]);
+}
+
+
+TEST(YUVScalingTest, bilinearKeepsFlatColor)
+{
+  const uint16_t width = 100;
+  const uint16_t height = 50;
+
+  std::vector<uint8_t> input(width*height*3/2, 77);
+  std::vector<uint8_t> output(64*36*3/2);
+  std::vector<uint8_t> work(scale_work_size(width, height, 64, 36));
+
+  scale_yuv420(input.data(), width, height, output.data(), 64, 36, work.data());
+  EXPECT_EQ(std::vector<uint8_t>(output.size(), 77), output);
+
+  scale_nv12(input.data(), width, height, output.data(), 64, 36, work.data());
+  EXPECT_EQ(std::vector<uint8_t>(output.size(), 77), output);
+}
+
+
+TEST(SelfViewConversionTest, matchesSeparateConversions)
+{
+  const uint16_t width = 100;
+  const uint16_t height = 50;
+
+  std::vector<uint8_t> work(selfview_work_size(width));
+  std::vector<uint8_t> expected(width*height*4);
+  std::vector<uint8_t> result(width*height*4);
+  std::vector<uint8_t> mirrored(width*height*4);
+
+  std::vector<uint8_t> yuv420 = randomBytes(width*height*3/2, 1);
+  yuv420_to_rgb_i_c(yuv420.data(), expected.data(), width, height);
+  selfview_to_rgb_c(yuv420.data(), result.data(), width, height, SELF_VIEW_YUV420, 1, false, work.data());
+  EXPECT_EQ(expected, result);
+
+  std::vector<uint8_t> yuyv = randomBytes(width*height*2, 2);
+  yuyv_to_rgb_c(yuyv.data(), expected.data(), width, height);
+  selfview_to_rgb_c(yuyv.data(), result.data(), width, height, SELF_VIEW_YUYV, 1, false, work.data());
+  EXPECT_EQ(expected, result);
+
+  // mirroring is the same as flipping the converted frame
+  flip_rgb_c(expected.data(), mirrored.data(), width, height, true, false);
+  selfview_to_rgb_c(yuyv.data(), result.data(), width, height, SELF_VIEW_YUYV, 1, true, work.data());
+  EXPECT_EQ(mirrored, result);
+}
+
+
+INSTANTIATE_TEST_SUITE_P(Kernels, YUVConversionTest,
+                         ::testing::Values(KERNEL_C, KERNEL_SSE41, KERNEL_AVX2, KERNEL_AVX512),
+                         [](const ::testing::TestParamInfo<KernelLevel>& info)
+                         {
+                           switch (info.param)
+                           {
+                             case KERNEL_C:      return std::string("C");
+                             case KERNEL_SSE41:  return std::string("SSE41");
+                             case KERNEL_AVX2:   return std::string("AVX2");
+                             case KERNEL_AVX512: return std::string("AVX512");
+                           }
+                           return std::string("Unknown");
+                         });
@@ -1,4 +1,5 @@
 #include "../src/common.h"
+#include "../src/global.h"
 
 #include <gtest/gtest.h>
 
@@ -14,3 +15,23 @@ TEST(CommonTest, random) {
     EXPECT_EQ(r2.length(), 2);
     EXPECT_EQ(r100.length(), 100);
 }
+
+
+TEST(CommonTest, audioFrameDuration) {
+    EXPECT_EQ(supportedAudioFrameDuration(2500), 2500u);
+    EXPECT_EQ(supportedAudioFrameDuration(20000), 20000u);
+    EXPECT_EQ(supportedAudioFrameDuration(30000), 20000u);
+    EXPECT_EQ(supportedAudioFrameDuration(1000), MIN_AUDIO_FRAME_US);
+    EXPECT_EQ(supportedAudioFrameDuration(120000), MAX_AUDIO_FRAME_US);
+
+    EXPECT_FALSE(audioFrameHasFEC(2500));
+    EXPECT_FALSE(audioFrameHasFEC(5000));
+    EXPECT_TRUE(audioFrameHasFEC(10000));
+    EXPECT_TRUE(audioFrameHasFEC(60000));
+
+    EXPECT_EQ(audioFrameSamples(48000, 2500), 120u);
+    EXPECT_EQ(audioFrameSamples(44100, 10000), 441u);
+
+    EXPECT_EQ(packetTimeString(2500), QString("2.5"));
+    EXPECT_EQ(packetTimeString(20000), QString("20"));
+}
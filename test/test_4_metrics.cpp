@@ -0,0 +1,146 @@
+#include "../src/metricscollector.h"
+#include "../src/statisticsfanout.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+// a view that only keeps the filters it has been told about
+class FilterView : public MetricsRecorder
+{
+public:
+  FilterView(std::shared_ptr<MetricsCollector> metrics):
+    MetricsRecorder(metrics),
+    filters()
+  {}
+
+  virtual void addSession(uint32_t) {}
+  virtual void removeSession(uint32_t) {}
+  virtual void videoInfo(double, QSize) {}
+  virtual void audioInfo(uint32_t, uint16_t) {}
+  virtual void incomingMedia(uint32_t, QString) {}
+  virtual void outgoingMedia(uint32_t, QString) {}
+  virtual void selectedICEPair(uint32_t, std::shared_ptr<ICEPair>) {}
+  virtual void addSentSIPMessage(const QString&, const QString&,
+                                 const QString&, const QString&) {}
+  virtual void addReceivedSIPMessage(const QString&, const QString&,
+                                     const QString&, const QString&) {}
+
+  virtual void filterAdded(uint32_t id, QString type, QString, uint64_t)
+  {
+    filters[id] = type;
+  }
+
+  virtual void filterRemoved(uint32_t id)
+  {
+    filters.erase(id);
+  }
+
+  std::map<uint32_t, QString> filters;
+};
+}
+
+
+TEST(MetricsTest, aggregatesValues)
+{
+  MetricsCollector metrics;
+
+  metrics.record(METRIC_TOTAL_DELAY, STATS_VIDEO, 5, 10);
+  metrics.record(METRIC_TOTAL_DELAY, STATS_VIDEO, 5, 30);
+  metrics.record(METRIC_TOTAL_DELAY, STATS_AUDIO, 5, 7);
+  metrics.aggregate();
+
+  MetricValues video = metrics.get(METRIC_TOTAL_DELAY, STATS_VIDEO, 5, 1000);
+  EXPECT_EQ(video.count, 2u);
+  EXPECT_EQ(video.sum, 40);
+  EXPECT_EQ(video.last, 30);
+  EXPECT_EQ(video.windowCount, 2u);
+  EXPECT_EQ(video.windowSum, 40);
+
+  EXPECT_EQ(metrics.get(METRIC_TOTAL_DELAY, STATS_AUDIO, 5, 1000).sum, 7);
+  EXPECT_EQ(metrics.get(METRIC_TOTAL_DELAY, STATS_VIDEO, 6, 1000).count, 0u);
+}
+
+
+TEST(MetricsTest, removesSources)
+{
+  MetricsCollector metrics;
+
+  // filters and sessions have their own IDs
+  metrics.record(METRIC_PRESENTED, STATS_VIDEO, 3, 1);
+  metrics.record(METRIC_FILTER_DROPPED, STATS_NO_MEDIA, 3, 1);
+
+  metrics.removeSession(3);
+  EXPECT_EQ(metrics.get(METRIC_PRESENTED, STATS_VIDEO, 3, 0).count, 0u);
+  EXPECT_EQ(metrics.get(METRIC_FILTER_DROPPED, STATS_NO_MEDIA, 3, 0).count, 1u);
+
+  metrics.removeFilter(3);
+  EXPECT_EQ(metrics.get(METRIC_FILTER_DROPPED, STATS_NO_MEDIA, 3, 0).count, 0u);
+}
+
+
+TEST(MetricsTest, recordsFromThreads)
+{
+  const int THREADS = 4;
+  const int VALUES = 100000;
+
+  MetricsCollector metrics(1);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < THREADS; ++i)
+  {
+    threads.push_back(std::thread([&metrics]()
+    {
+      for (int j = 0; j < VALUES; ++j)
+      {
+        metrics.record(METRIC_RECEIVED_BYTES, STATS_VIDEO, 1, 2);
+      }
+    }));
+  }
+
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  metrics.aggregate();
+
+  // values are only lost if the aggregation does not keep up
+  MetricValues values = metrics.get(METRIC_RECEIVED_BYTES, STATS_VIDEO, 1, 0);
+  EXPECT_EQ(values.count + metrics.lostValues(), (uint64_t)THREADS*VALUES);
+  EXPECT_EQ(values.sum, 2*(int64_t)values.count);
+}
+
+
+TEST(MetricsTest, viewsShareRecordedValues)
+{
+  std::shared_ptr<MetricsCollector> metrics = std::make_shared<MetricsCollector>();
+  FilterView window(metrics);
+  FilterView exporter(metrics);
+
+  StatisticsFanOut fanOut(metrics);
+  fanOut.addSink(&window);
+  fanOut.addSink(&exporter);
+
+  // the values are recorded once for both views
+  fanOut.presentPackage(2, STATS_VIDEO);
+  uint32_t id = fanOut.addFilter("Encoder", "", 1);
+  fanOut.packetDropped(id);
+  metrics->aggregate();
+
+  EXPECT_EQ(metrics->get(METRIC_PRESENTED, STATS_VIDEO, 2, 0).count, 1u);
+  EXPECT_EQ(metrics->get(METRIC_FILTER_DROPPED, STATS_NO_MEDIA, id, 0).count, 1u);
+
+  // the views know the filter by the same ID
+  EXPECT_EQ(window.filters[id], "Encoder");
+  EXPECT_EQ(exporter.filters[id], "Encoder");
+
+  fanOut.removeFilter(id);
+  EXPECT_TRUE(window.filters.empty());
+  EXPECT_TRUE(exporter.filters.empty());
+  EXPECT_EQ(metrics->get(METRIC_FILTER_DROPPED, STATS_NO_MEDIA, id, 0).count, 0u);
+}
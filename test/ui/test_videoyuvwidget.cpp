@@ -0,0 +1,88 @@
+#include "../src/ui/gui/videoyuvwidget.h"
+#include "../src/media/processing/yuvconversions.h"
+
+#include <gtest/gtest.h>
+
+#include <QApplication>
+#include <QOpenGLContext>
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+/* The widget is drawn with whatever OpenGL the environment has. Without a GPU
+ * run the tests with a software rasterizer, for example:
+ * LIBGL_ALWAYS_SOFTWARE=1 QT_QPA_PLATFORM=offscreen ./uvgComm_test */
+
+namespace
+{
+
+const int WIDTH = 64;
+const int HEIGHT = 32;
+
+QApplication* application()
+{
+  static int argc = 1;
+  static char name[] = "uvgComm_test";
+  static char* argv[] = {name, nullptr};
+
+  if (QApplication::instance() == nullptr)
+  {
+    if (getenv("DISPLAY") == nullptr && getenv("WAYLAND_DISPLAY") == nullptr)
+    {
+      qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    new QApplication(argc, argv);
+  }
+  return qobject_cast<QApplication*>(QApplication::instance());
+}
+
+
+bool openGLAvailable()
+{
+  QOpenGLContext context;
+  return context.create();
+}
+
+}
+
+
+TEST(VideoYUVWidgetTest, drawsColors)
+{
+  application();
+  if (!openGLAvailable())
+  {
+    GTEST_SKIP() << "No OpenGL available";
+  }
+
+  const uint8_t colors[][3] = {{16, 128, 128}, {235, 128, 128}, {81, 90, 240},
+                               {145, 54, 34}, {41, 240, 110}, {128, 200, 60}};
+
+  for (auto& color : colors)
+  {
+    // flat frames so scaling or filtering do not change the color
+    std::unique_ptr<uchar[]> data(new uchar[WIDTH*HEIGHT*3/2]);
+    memset(data.get(), color[0], WIDTH*HEIGHT);
+    memset(data.get() + WIDTH*HEIGHT, color[1], WIDTH*HEIGHT/4);
+    memset(data.get() + WIDTH*HEIGHT*5/4, color[2], WIDTH*HEIGHT/4);
+
+    std::vector<uint8_t> expected(WIDTH*HEIGHT*4);
+    yuv420_to_rgb_i_c(data.get(), expected.data(), WIDTH, HEIGHT);
+
+    VideoYUVWidget widget(nullptr, 1, 1, 0);
+    widget.show();
+
+    QImage luma(data.get(), WIDTH, HEIGHT, WIDTH, QImage::Format_Grayscale8);
+    widget.inputImage(std::move(data), luma, 0);
+
+    QImage result = widget.grabFramebuffer();
+    ASSERT_FALSE(result.isNull());
+
+    QRgb pixel = result.pixel(result.width()/2, result.height()/2);
+
+    // the CPU conversion approximates the coefficients with shifts
+    EXPECT_NEAR(qRed(pixel),   expected[2], 4);
+    EXPECT_NEAR(qGreen(pixel), expected[1], 4);
+    EXPECT_NEAR(qBlue(pixel),  expected[0], 4);
+  }
+}